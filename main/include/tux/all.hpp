@@ -4,17 +4,27 @@ Convenience header aggregating all other headers in the library. */
 
 #include "tux/admin.hpp"
 #include "tux/buffer.hpp"
+#include "tux/buffer_pool.hpp"
 #include "tux/carray.hpp"
+#include "tux/compression.hpp"
 #include "tux/context.hpp"
 #include "tux/conversation.hpp"
 #include "tux/convert.hpp"
 #include "tux/cstring.hpp"
 #include "tux/decimal_number.hpp"
+#include "tux/expression_cache.hpp"
+#include "tux/field_table.hpp"
 #include "tux/fml32.hpp" //32 must come before 16
 #include "tux/fml16.hpp"
+#include "tux/fml32_builder.hpp"
+#include "tux/fml32_extread.hpp"
+#include "tux/fml32_file.hpp"
+#include "tux/hash.hpp"
 #include "tux/init_request.hpp"
+#include "tux/json.hpp"
 #include "tux/mbstring.hpp"
 #include "tux/message_queuing.hpp"
+#include "tux/predicate.hpp"
 #include "tux/pub_sub.hpp"
 #include "tux/record.hpp"
 #include "tux/request_response.hpp"
@@ -25,4 +35,6 @@ Convenience header aggregating all other headers in the library. */
 #include "tux/util.hpp"
 #include "tux/view16.hpp"
 #include "tux/view32.hpp"
+#include "tux/view_array.hpp"
+#include "tux/view_traits.hpp"
 #include "tux/xml.hpp"
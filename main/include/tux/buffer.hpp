@@ -12,9 +12,34 @@ Various data structures backed by a tpalloc'ed buffer */
 namespace tux
 {
 
+/** Identifies the standard buffer types.
+@sa buffer::type_code()
+@ingroup buffers */
+enum class buffer_type : unsigned char
+{
+  none, /**< null buffer */
+  unknown, /**< type could not be determined [@c tptypes failed] */
+  fml32, /**< "FML32" */
+  fml, /**< "FML" */
+  view32, /**< "VIEW32" */
+  view, /**< "VIEW" */
+  x_c_type, /**< "X_C_TYPE" */
+  x_common, /**< "X_COMMON" */
+  string, /**< "STRING" */
+  carray, /**< "CARRAY" */
+  x_octet, /**< "X_OCTET" */
+  xml, /**< "XML" */
+  mbstring, /**< "MBSTRING" */
+  record, /**< "RECORD" */
+  other /**< any other (e.g. custom) type */
+};
+
 /** Models a typed buffer allocated via @c tpalloc.
 A buffer has a "null" state by default, and is
 moveable but not copyable.
+
+The type, subtype, and capacity are looked up once [@c tptypes] whenever
+the buffer is allocated, acquired, or reallocated, and cached thereafter.
 @ingroup buffers */
 class buffer
 {
@@ -28,12 +53,14 @@ public:
   buffer& operator=(buffer const& x) = delete; /**< Non-copyable. */
   buffer(buffer&& x) noexcept; /**< Move construct (x is left in default constructed state). */
   buffer& operator=(buffer&& x) noexcept; /**< Move assign (x is left in default constructed state). */
-  ~buffer() noexcept; /**< Frees resources as needed [@c tpfree]. */
+  ~buffer() noexcept; /**< Frees resources as needed [@c tpfree, or back to the current buffer_pool]. */
   
   /** Construct an allocated buffer [@c tpalloc].
   @param type e.g. "FML32", "STRING", "VIEW32"
   @param subtype optional subtype like a viewname
   @param  size optional initial capacity
+  @note If a buffer_pool is installed for this thread, the
+  buffer is taken from the pool when possible.
   @sa buffer::alloc
   */
   explicit buffer(const char* type,
@@ -66,7 +93,7 @@ public:
   
   void realloc(long size); /**< Changes the buffer's capacity [@c tprealloc]. */
   
-  void free() noexcept; /**< Frees the buffer [@c tpfree]. */
+  void free() noexcept; /**< Frees the buffer [@c tpfree, or back to the current buffer_pool]. */
   
   /** Takes ownership of a previously tpalloc'ed buffer.
   @param data previously tpalloc'ed buffer
@@ -81,6 +108,9 @@ public:
   std::string type() const; /**< Returns buffer type [@c tptypes]. */
   std::string subtype() const; /**< Returns buffer subtype [@c tptypes]. */
   long size() const; /**< Returns buffer size (capacity) [@c tptypes]. */
+  buffer_type type_code() const noexcept { return type_code_; } /**< Returns buffer type as an enum (no allocation). */
+  const char* type_c_str() const noexcept { return type_; } /**< Returns buffer type as an interned null-terminated string (no allocation). */
+  const char* subtype_c_str() const noexcept { return subtype_; } /**< Returns buffer subtype as an interned null-terminated string (no allocation). */
   /** Returns used portion of buffer, as set by user.
   @sa buffer::data_size(long) */
   long data_size() const noexcept; 
@@ -93,20 +123,49 @@ public:
   which require buffer length (e.g. @c tpcall). */
   void data_size(long size) noexcept;
   
+  /** Returns the number of bytes actually carrying data.
+  This is the length handed to ATMI send routines (@c tpcall,
+  @c tpenqueue, @c tppost, @c tpnotify, etc.).
+  @arg FML32/FML: bytes used [@c Fused32, @c Fused]
+  @arg VIEW32/VIEW/X_C_TYPE/X_COMMON: size of the view [@c Fvneeded32, @c Fvneeded]
+  @arg STRING: length including the null terminator
+  @arg CARRAY/X_OCTET: data_size() (so 0 bytes if it was never set)
+  @arg others (e.g. XML, RECORD): data_size() if set, or else size(),
+  so the whole capacity is sent if data_size() was never set */
+  long payload_size() const noexcept;
+  
+  /** Reduces capacity to payload_size() [@c tprealloc].
+  Useful before persisting a buffer (e.g. enqueueing to a
+  /Q queue), since growth policies can leave a good deal of slack. */
+  void shrink_to_fit();
+  
   char* data() noexcept { return data_; } /**< Returns pointer to raw buffer. */
   const char* data() const noexcept { return data_; } /**< Returns pointer to raw buffer. */
   
   
   
 private:
+  void refresh_metadata() noexcept;
+  void reset_metadata() noexcept;
+
   char* data_ = nullptr;
   long data_size_ = 0;
+  long capacity_ = 0;
+  const char* type_ = "";
+  const char* subtype_ = "";
+  buffer_type type_code_ = buffer_type::none;
 };
 
 /** Controls serialization of buffers.
 @sa export_buffer, import_buffer
 @ingroup buffers */
-enum class export_mode { binary, base64 };
+enum class export_mode
+{
+    binary, /**< @c tpexport output as is */
+    base64, /**< @c tpexport output as a base64 string [@c TPEX_STRING] */
+    compressed, /**< binary, then compressed (see tux::compress) */
+    compressed_base64 /**< binary, then compressed, then base64 encoded */
+};
 
 /** Serializes a buffer [@c tpexport].
 @relates buffer
@@ -122,6 +181,8 @@ std::string export_buffer(buffer const& x,
 
 
 /** Deserializes a buffer [@c tpimport].
+Compressed exports are detected and decompressed transparently: binary
+and compressed accept each other's output, as do base64 and compressed_base64.
 @relates buffer
 @param x string to be parsed
 @param mode serialization mode
@@ -0,0 +1,126 @@
+/** @file buffer_pool.hpp
+@c buffer_pool class and related functions.
+@ingroup buffers */
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "atmi.h"
+
+namespace tux
+{
+
+/** Caches freed buffers for reuse by later allocations.
+Pooling is opt-in.  While a pool is installed as the current
+pool for a thread (see buffer_pool_scope), buffer::alloc takes
+buffers from the pool instead of calling @c tpalloc, and
+buffer::free hands buffers back to the pool instead of calling
+@c tpfree.  Everything built on buffer::alloc -- e.g. fml32::reserve,
+cstring::reserve, and the default @c output buffers of call() and
+async_call::get_reply() -- picks up the pool automatically.
+
+Freed buffers are kept in size classes (powers of two) keyed by
+type and subtype.  A request is served from the smallest class that is
+guaranteed to be large enough; misses are @c tpalloc 'ed with the size
+rounded up to the class size, so they can be reused by the same request
+later.  Reused buffers are reinitialized (@c Finit32, @c Finit,
+@c Fvsinit32, @c Fvsinit, or a leading null terminator) so they look
+freshly allocated; types that can't be reset that way (e.g. MBSTRING,
+RECORD, and custom types) are freed as usual rather than pooled.
+
+A pool is not thread safe, and is meant to be used by a single thread.
+In a multi-contexted client, use a separate pool for each context,
+and clear() it before the context is terminated [@c tpterm].
+@warning Don't let a service's request buffer [@c TPSVCINFO::data]
+be freed while a pool is installed; that buffer belongs to Tuxedo and
+must not be recycled.
+@code
+tux::buffer_pool pool;
+tux::buffer_pool_scope scope(pool);
+for(auto& r : requests)
+{
+    tux::fml32 input; // buffer comes from pool
+    // ...
+    tux::fml32 output = tux::call("SVC", input.buffer());
+} // both buffers go back to the pool
+@endcode
+@ingroup buffers */
+class buffer_pool
+{
+public:
+    /** Counters describing pool effectiveness. */
+    struct statistics
+    {
+        unsigned long long hits = 0; /**< Allocations served from the pool. */
+        unsigned long long misses = 0; /**< Allocations which required a @c tpalloc. */
+        unsigned long long returns = 0; /**< Frees which were kept in the pool. */
+        unsigned long long discards = 0; /**< Frees which were passed along to @c tpfree. */
+    };
+
+    /** Construct an empty pool.
+    @param max_per_class maximum number of idle buffers kept in each size class */
+    explicit buffer_pool(std::size_t max_per_class = 8);
+    buffer_pool(buffer_pool const& x) = delete; /**< Non-copyable. */
+    buffer_pool& operator=(buffer_pool const& x) = delete; /**< Non-copyable. */
+    buffer_pool(buffer_pool&& x) = delete; /**< Non-moveable. */
+    buffer_pool& operator=(buffer_pool&& x) = delete; /**< Non-moveable. */
+    ~buffer_pool() noexcept; /**< Frees any idle buffers [@c tpfree]. */
+
+    /** Returns a buffer from the pool, or allocates one [@c tpalloc].
+    @param type e.g. "FML32", "STRING", "VIEW32"
+    @param subtype optional subtype like a viewname
+    @param size optional minimum capacity */
+    char* allocate(const char* type, const char* subtype = nullptr, long size = 0);
+
+    /** Hands a buffer back to the pool.
+    @returns false (and does nothing) if the buffer could not be pooled,
+    in which case the caller still owns it. */
+    bool deallocate(char* data) noexcept;
+    /** Hands a buffer back to the pool, using already known
+    type, subtype, and capacity (rather than querying via @c tptypes).
+    @sa deallocate(char*) */
+    bool deallocate(char* data, const char* type, const char* subtype, long capacity) noexcept;
+
+    void clear() noexcept; /**< Frees all idle buffers [@c tpfree]. */
+    std::size_t idle() const noexcept; /**< Returns number of idle buffers held. */
+    statistics const& stats() const noexcept; /**< Returns hit/miss counters. */
+    void reset_stats() noexcept; /**< Zeroes hit/miss counters. */
+
+    /** Returns the pool installed for this thread, or nullptr. */
+    static buffer_pool* current() noexcept;
+    /** Installs a pool for this thread (nullptr disables pooling).
+    @returns the previously installed pool
+    @sa buffer_pool_scope */
+    static buffer_pool* make_current(buffer_pool* x) noexcept;
+
+private:
+    struct size_classes
+    {
+        std::string type;
+        std::string subtype;
+        std::vector<std::vector<std::pair<char*, long>>> classes; // (data, capacity)
+    };
+
+    size_classes* find(const char* type, const char* subtype) noexcept;
+
+    std::size_t max_per_class_;
+    std::vector<size_classes> free_lists_;
+    statistics stats_;
+};
+
+/** Installs a buffer_pool for the current thread for the lifetime of the scope.
+The previously installed pool (if any) is restored on exit.
+@ingroup buffers */
+class buffer_pool_scope
+{
+public:
+    explicit buffer_pool_scope(buffer_pool& x) noexcept; /**< Installs x. */
+    buffer_pool_scope(buffer_pool_scope const& x) = delete; /**< Non-copyable. */
+    buffer_pool_scope& operator=(buffer_pool_scope const& x) = delete; /**< Non-copyable. */
+    ~buffer_pool_scope() noexcept; /**< Restores the previous pool. */
+
+private:
+    buffer_pool* previous_;
+};
+
+}
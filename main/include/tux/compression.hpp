@@ -0,0 +1,42 @@
+/** @file compression.hpp
+Fast lossless compression of serialized buffers and payloads.
+@ingroup buffers */
+#pragma once
+#include <string>
+#include "tux/carray.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Compresses bytes [LZ4 block format].
+The result is framed: a 4 byte magic number ("TXZ1"), the uncompressed
+size (8 bytes, little endian), then a single LZ4 block.  The codec is
+self-contained (no external library), favours speed over ratio, and
+typically shrinks exported FML32 several fold.
+@param x the bytes to compress
+@returns the framed, compressed bytes
+@sa decompress(), is_compressed(), export_mode::compressed
+@ingroup buffers */
+std::string compress(string_ref x);
+
+/** Decompresses bytes produced by compress().
+@throws std::runtime_error if @c x isn't a valid compressed frame
+@ingroup buffers */
+std::string decompress(string_ref x);
+
+/** Tests for the compress() frame magic number.
+@ingroup buffers */
+bool is_compressed(string_ref x) noexcept;
+
+/** Compresses a carray payload in place, e.g. before sending it with call().
+The receiver restores it with decompress(carray&).
+@ingroup buffers */
+void compress(carray& x);
+
+/** Decompresses, in place, a carray payload compressed by compress(carray&).
+@throws std::runtime_error if the payload isn't a valid compressed frame
+@ingroup buffers */
+void decompress(carray& x);
+
+}
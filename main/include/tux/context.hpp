@@ -23,6 +23,7 @@ std::string context_to_string(TPCONTEXT_T c);
 int check_authentication_level();
 
 /** connect to a domain [@c tpinit].
+Also preloads the fml32 field tables (field_table::preload()).
 @param x supply a populated object to specify password, options, etc.
 @param mode normal or appthread
 @sa context::context()
@@ -7,6 +7,7 @@ Routines for converting between various buffer types. @ingroup buffers */
 #include "tux/fml32.hpp" 
 #include "tux/fml16.hpp"
 #include "tux/record.hpp"
+#include "tux/view_traits.hpp"
 #include "tux/xml.hpp"
 
 
@@ -17,21 +18,22 @@ namespace tux
 fml32 to_fml32(fml16 const&); /**< Convert an fml16 to an fml32 [@c F16to32]. @ingroup buffers */
 fml16 to_fml16(fml32 const&); /**< Convert an fml32 to an fml16 [@c F32to16]. @ingroup buffers */
 
-// fml <-> view    
-template <typename T> T to_struct(fml16 const& x); /**< Convert an fml16 to a struct (defined in a view) [@c Fvftos]. @ingroup buffers */
-template <typename T> T to_struct(fml32 const& x); /**< Convert an fml32 to a struct (defined in a view) [@c Fvftos32]. @ingroup buffers */
+// fml <-> view (via view_traits<T> where viewhpp32 / viewhpp16 generated one:
+// include that header everywhere T is converted, see view_traits)
+template <typename T, bool Generated = view_traits<T, fml16>::generated> T to_struct(fml16 const& x); /**< Convert an fml16 to a struct (defined in a view) [@c Fvftos]. @ingroup buffers */
+template <typename T, bool Generated = view_traits<T, fml32>::generated> T to_struct(fml32 const& x); /**< Convert an fml32 to a struct (defined in a view) [@c Fvftos32]. @ingroup buffers */
 /** Convert a struct (defined in a view) to an fml16 [@c Fvstof].
 @param dest existing fml16
 @param mode valid options include FUPDATE, FJOIN, FOJOIN, FCONCAT
 @ingroup buffers */
-template <typename T> void convert(T const& src, fml16& dest, int mode);
+template <typename T, bool Generated = view_traits<T, fml16>::generated> void convert(T const& src, fml16& dest, int mode);
 /** Convert a struct (defined in a view) to an fml32 [@c Fvstof32].
 @param dest existing fml32
 @param mode valid options include FUPDATE, FJOIN, FOJOIN, FCONCAT
 @ingroup buffers */
-template <typename T> void convert(T const& src, fml32& dest, int mode);
-template <typename T> fml16 to_fml16(T const& x); /**< Convert a struct (defined in a view) to an fml16 [@c Fvstof] @ingroup buffers */
-template <typename T> fml32 to_fml32(T const& x); /**< Convert a struct (defined in a view) to an fml32 [@c Fvstof32] @ingroup buffers */
+template <typename T, bool Generated = view_traits<T, fml32>::generated> void convert(T const& src, fml32& dest, int mode);
+template <typename T, bool Generated = view_traits<T, fml16>::generated> fml16 to_fml16(T const& x); /**< Convert a struct (defined in a view) to an fml16 [@c Fvstof] @ingroup buffers */
+template <typename T, bool Generated = view_traits<T, fml32>::generated> fml32 to_fml32(T const& x); /**< Convert a struct (defined in a view) to an fml32 [@c Fvstof32] @ingroup buffers */
 
 #if TUXEDO_VERSION >= 1222
 /** Convert a record to an fml32 [@c Fvrtof32].
@@ -128,100 +130,157 @@ std::pair<fml32, std::string> to_fml32(xml const& x, long flags = TPNOFLAGS);
 
 //----------------TEMPLATE DEFS ---------------------------
 
+namespace view_detail
+{
+    //----------------FML TO STRUCT ---------------------------
+    template <typename T, typename Fml>
+    void to_struct(Fml const& x, T& result, std::true_type)
+    {
+        view_traits<T, Fml>::to_struct(x, result);
+    }
+    
+    template <typename T>
+    void to_struct(fml16 const& x, T& result, std::false_type)
+    {
+        int rc = Fvftos(const_cast<FBFR*>(x.as_fbfr()),
+                         reinterpret_cast<char*>(&result),
+                         const_cast<char*>(type_name<T>::value()));
+        if(rc == -1)
+        {
+            throw fml16::last_error("Fvftos");
+        }
+    }
+    
+    template <typename T>
+    void to_struct(fml32 const& x, T& result, std::false_type)
+    {
+        int rc = Fvftos32(const_cast<FBFR32*>(x.as_fbfr()),
+                         reinterpret_cast<char*>(&result),
+                         const_cast<char*>(type_name<T>::value()));
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvftos32");
+        }
+    }
+    
+    //---------------STRUCT TO FML----------------------------
+    template <typename T>
+    void convert(T const& src, fml16& dest, int mode, std::false_type)
+    {
+        if(!dest)
+        {
+            dest.reserve(0);
+        }
+        // the compiled view doesn't say how long the strings are: grow geometrically until they fit
+        int rc;
+        while((rc = Fvstof(dest.as_fbfr(),
+                        reinterpret_cast<char*>(const_cast<T*>(&src)),
+                        mode,
+                        const_cast<char*>(type_name<T>::value()))) == -1 && Ferror == FNOSPACE)
+        {
+            dest.reserve(dest.size() * 2 + static_cast<long>(sizeof(T)));
+        }
+        if(rc == -1)
+        {
+            throw fml16::last_error("Fvstof");
+        }   
+    }
+    
+    template <typename T>
+    void convert(T const& src, fml32& dest, int mode, std::false_type)
+    {
+        if(!dest)
+        {
+            dest.reserve(0);
+        }
+        // the compiled view doesn't say how long the strings are: grow geometrically until they fit
+        dest.modified();
+        int rc;
+        while((rc = Fvstof32(dest.as_fbfr(),
+                        reinterpret_cast<char*>(const_cast<T*>(&src)),
+                        mode,
+                        const_cast<char*>(type_name<T>::value()))) == -1 && Ferror32 == FNOSPACE)
+        {
+            dest.reserve(dest.size() * 2 + static_cast<long>(sizeof(T)));
+        }
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvstof32");
+        }   
+    }
+    
+    // Fvstof converts the struct to a buffer, then combines it with dest
+    template <typename T, typename Fml>
+    void convert(T const& src, Fml& dest, int mode, std::true_type)
+    {
+        if(mode == FCONCAT || (mode == FUPDATE && (!dest || dest.field_count() == 0)))
+        {
+            view_traits<T, Fml>::to_fml(src, dest);
+            return;
+        }
+        Fml converted;
+        view_traits<T, Fml>::to_fml(src, converted);
+        switch(mode)
+        {
+            case FUPDATE:
+                dest.update(converted);
+                break;
+            case FJOIN:
+                dest.join(converted);
+                break;
+            case FOJOIN:
+                dest.outer_join(converted);
+                break;
+            default:
+                convert(src, dest, mode, std::false_type()); // let Tuxedo report it
+        }
+    }
+}
+
 //----------------FML TO STRUCT ---------------------------
-template <typename T>
+template <typename T, bool Generated>
 T to_struct(fml16 const& x)
 {
     T result;
-    int rc = Fvftos(const_cast<FBFR*>(x.as_fbfr()),
-                     reinterpret_cast<char*>(&result),
-                     const_cast<char*>(type_name<T>::value()));
-    if(rc == -1)
-    {
-        throw fml16::last_error("Fvftos");
-    }
+    view_detail::to_struct(x, result, std::integral_constant<bool, Generated>());
     return result;
 }
 
-template <typename T>
+template <typename T, bool Generated>
 T to_struct(fml32 const& x)
 {
     T result;
-    int rc = Fvftos32(const_cast<FBFR32*>(x.as_fbfr()),
-                     reinterpret_cast<char*>(&result),
-                     const_cast<char*>(type_name<T>::value()));
-    if(rc == -1)
-    {
-        throw fml32::last_error("Fvftos32");
-    }
+    view_detail::to_struct(x, result, std::integral_constant<bool, Generated>());
     return result;
 }    
 
 
 //---------------STRUCT TO FML----------------------------
-template <typename T>
+template <typename T, bool Generated>
 void convert(T const& src, fml16& dest, int mode) // mode = FUPDATE, FJOIN, FOJOIN, FCONCAT 
 {
-    if(!dest)
-    {
-        dest.reserve(0);
-    }
-    int rc = Fvstof(dest.as_fbfr(),
-                    reinterpret_cast<char*>(const_cast<T*>(&src)),
-                    mode,
-                    const_cast<char*>(type_name<T>::value()));
-    if(rc == -1 && Ferror == FNOSPACE)
-    {
-        dest.reserve(sizeof(T) * 4);
-        rc = Fvstof(dest.as_fbfr(),
-                    reinterpret_cast<char*>(const_cast<T*>(&src)),
-                    mode,
-                    const_cast<char*>(type_name<T>::value()));
-    }
-    if(rc == -1)
-    {
-        throw fml16::last_error("Fvstof");
-    }   
+    view_detail::convert(src, dest, mode, std::integral_constant<bool, Generated>());
 }
 
-template <typename T>
+template <typename T, bool Generated>
 void convert(T const& src, fml32& dest, int mode) // mode = FUPDATE, FJOIN, FOJOIN, FCONCAT 
 {
-    if(!dest)
-    {
-        dest.reserve(0);
-    }
-    int rc = Fvstof32(dest.as_fbfr(),
-                    reinterpret_cast<char*>(const_cast<T*>(&src)),
-                    mode,
-                    const_cast<char*>(type_name<T>::value()));
-    if(rc == -1 && Ferror32 == FNOSPACE)
-    {
-        dest.reserve(sizeof(T) * 4);
-        rc = Fvstof32(dest.as_fbfr(),
-                    reinterpret_cast<char*>(const_cast<T*>(&src)),
-                    mode,
-                    const_cast<char*>(type_name<T>::value()));
-    }
-    if(rc == -1)
-    {
-        throw fml32::last_error("Fvstof32");
-    }   
+    view_detail::convert(src, dest, mode, std::integral_constant<bool, Generated>());
 }
 
-template <typename T>
+template <typename T, bool Generated>
 fml16 to_fml16(T const& x) 
 {
     fml16 result;
-    convert(x, result, FUPDATE);
+    convert<T, Generated>(x, result, FUPDATE);
     return result;
 }
 
-template <typename T>
+template <typename T, bool Generated>
 fml32 to_fml32(T const& x) 
 {
     fml32 result;
-    convert(x, result, FUPDATE);
+    convert<T, Generated>(x, result, FUPDATE);
     return result;
 }
 
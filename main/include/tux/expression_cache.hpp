@@ -0,0 +1,110 @@
+/** @file expression_cache.hpp
+@c expression_cache class.
+@ingroup buffers */
+#pragma once
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace tux
+{
+
+/** A bounded, thread-safe, least recently used cache of compiled
+boolean and arithmetic expressions, keyed by expression text.
+Compiling an expression [@c Fboolco32, @c Fboolco, @c Fvboolco32,
+@c Fvboolco] is relatively expensive.  Every fml32, fml16, view32<T>,
+and view16<T> boolean_expression and arithmetic_expression compiles
+through the global() cache, so code which builds the same expression
+from a string over and over (e.g. per request) only compiles it once.
+
+Compiled trees are immutable, and are shared (via @c std::shared_ptr)
+between the cache and every expression using them; a tree evicted from
+the cache is only freed once the last expression using it is gone.
+Setting the capacity to zero disables caching.
+@code
+// compiled on the first request only
+tux::fml32::boolean_expression is_minor("AGE < 18");
+auto& stats = tux::expression_cache::global().stats();
+@endcode
+@ingroup buffers */
+class expression_cache
+{
+public:
+    /** Immutable compiled expression tree. */
+    typedef std::shared_ptr<const char> tree;
+
+    /** Counters describing cache effectiveness. */
+    struct statistics
+    {
+        unsigned long long hits = 0; /**< Lookups served from the cache. */
+        unsigned long long misses = 0; /**< Lookups which required compilation. */
+        unsigned long long evictions = 0; /**< Trees dropped to stay within capacity. */
+    };
+
+    /** Construct an empty cache.
+    @param capacity maximum number of compiled expressions kept */
+    explicit expression_cache(std::size_t capacity = 1024);
+    expression_cache(expression_cache const& x) = delete; /**< Non-copyable. */
+    expression_cache& operator=(expression_cache const& x) = delete; /**< Non-copyable. */
+    expression_cache(expression_cache&& x) = delete; /**< Non-moveable. */
+    expression_cache& operator=(expression_cache&& x) = delete; /**< Non-moveable. */
+    ~expression_cache() noexcept = default; /**< Destruct. */
+
+    /** Returns the cached tree for an expression, compiling (and caching) it on a miss.
+    @param domain what the expression applies to, e.g. "FML32" or a view name;
+    identical text compiles differently in different domains
+    @param text the expression
+    @param compile callable returning a malloc'ed tree, or nullptr on failure
+    @returns the tree, or an empty pointer if compilation failed (in which case
+    the relevant error, e.g. @c Ferror32, is left as set by @c compile) */
+    template <typename F>
+    tree get(std::string const& domain, std::string const& text, F compile)
+    {
+        std::string key = make_key(domain, text);
+        tree result = find(key);
+        if(!result)
+        {
+            // compile outside the lock; if another thread got there
+            // first, insert() returns its tree instead
+            char* compiled = compile();
+            if(compiled)
+            {
+                result = insert(std::move(key), tree(compiled, free_tree()));
+            }
+        }
+        return result;
+    }
+
+    void clear() noexcept; /**< Drops all cached trees. */
+    std::size_t size() const noexcept; /**< Returns number of cached trees. */
+    std::size_t capacity() const noexcept; /**< Returns maximum number of cached trees. */
+    void set_capacity(std::size_t capacity); /**< Sets maximum number of cached trees (evicting as needed). */
+    statistics stats() const noexcept; /**< Returns hit/miss/eviction counters. */
+    void reset_stats() noexcept; /**< Zeroes hit/miss/eviction counters. */
+
+    /** Returns the process-wide cache used by the expression classes. */
+    static expression_cache& global();
+
+private:
+    struct free_tree
+    {
+        void operator()(const char* x) const noexcept { std::free(const_cast<char*>(x)); }
+    };
+    typedef std::list<std::pair<std::string, tree>> lru_list; // most recently used first
+
+    static std::string make_key(std::string const& domain, std::string const& text);
+    tree find(std::string const& key);
+    tree insert(std::string key, tree x);
+    void evict_to(std::size_t capacity) noexcept;
+
+    mutable std::mutex mutex_;
+    std::size_t capacity_;
+    lru_list lru_;
+    std::unordered_map<std::string, lru_list::iterator> index_;
+    statistics stats_;
+};
+
+}
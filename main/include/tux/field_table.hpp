@@ -0,0 +1,110 @@
+/** @file field_table.hpp
+@c field_table class: an in-memory copy of the fml32 field tables.
+@ingroup buffers */
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "fml32.h"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Field names and ids from the fml32 field tables, for lookups in either direction.
+Tuxedo loads field tables lazily: the first @c Fldid32 or @c Fname32 call
+in a process reads every table in @c FIELDTBLS32 from disk.  A field_table
+reads them up front (typically in @c tpsvrinit, or via initialize() in a
+client) and answers lookups from perfect hash maps: one hash and one
+comparison per lookup, with no locks.
+@code
+int tpsvrinit(int argc, char** argv)
+{
+    tux::field_table::load();
+    tux::log("INFO: %zu fields loaded in %ld us", tux::field_table::current()->size(),
+             static_cast<long>(tux::field_table::current()->load_time().count()));
+    // ...
+}
+@endcode
+Once a table has been loaded, fml32::field_id(std::string const&) and
+fml32::field_name() use it, falling back to Tuxedo for fields that it
+doesn't contain.  A field_table is immutable, so it's safe to read from
+any number of threads.
+@ingroup buffers */
+class field_table
+{
+public:
+    /** A field table entry. */
+    struct entry
+    {
+        FLDID32 id; /**< The field id. */
+        std::string name; /**< The field name. */
+    };
+
+    /** Reads and indexes the named field table files.
+    Where a name (or an id) is defined more than once, lookups return the
+    first definition.
+    @param files field table paths
+    @throws std::runtime_error if a file can't be read or contains a malformed field */
+    explicit field_table(std::vector<std::string> const& files);
+
+    field_table(field_table const&) = delete; /**< Not copyable. */
+    field_table& operator=(field_table const&) = delete; /**< Not copyable. */
+
+    /** Returns the field id, or @c BADFLDID if @c name isn't in the table. */
+    FLDID32 id(string_ref name) const noexcept;
+    /** Returns the field name, or nullptr if @c id isn't in the table. */
+    const char* name(FLDID32 id) const noexcept;
+
+    std::size_t size() const noexcept; /**< Returns the number of fields. */
+    std::vector<entry> const& entries() const noexcept; /**< Returns the fields, in table order. */
+    std::vector<std::string> const& files() const noexcept; /**< Returns the field table paths. */
+    /** Returns the time taken to read and index the field tables. */
+    std::chrono::microseconds load_time() const noexcept;
+
+    /** Returns the field table files configured by @c FIELDTBLS32 and
+    @c FLDTBLDIR32 [@c tuxgetenv].  Relative names are resolved against the
+    first directory in @c FLDTBLDIR32 that contains them. */
+    static std::vector<std::string> configured_files();
+
+    /** Reads the configured field tables and makes them current(),
+    replacing any table loaded before.
+    @throws std::runtime_error if a file can't be read or contains a malformed field */
+    static void load();
+
+    /** Calls load() unless a table is already loaded.
+    A failure is remembered: until @c FIELDTBLS32 or @c FLDTBLDIR32 changes,
+    later calls return false without reading the files again (call load()
+    to retry regardless).
+    @returns false, leaving lookups to Tuxedo, if the field tables couldn't be read */
+    static bool preload() noexcept;
+
+    /** Returns the table loaded by load(), or nullptr if there isn't one.
+    Tables are never freed once loaded (reloading is expected to be rare),
+    so the pointer remains valid for the life of the process. */
+    static field_table const* current() noexcept;
+
+private:
+    // a hash and displace perfect hash over a set of entries
+    struct perfect_hash
+    {
+        std::uint64_t seed = 0;
+        std::vector<std::uint32_t> displacements;
+        std::vector<std::uint32_t> slots; // entry index, or empty_slot
+        static constexpr std::uint32_t empty_slot = UINT32_MAX;
+
+        template <typename KeyOf>
+        void build(std::vector<std::uint32_t> const& members, KeyOf key_of);
+        std::uint32_t find(string_ref key) const noexcept;
+    };
+
+    std::vector<std::string> files_;
+    std::vector<entry> entries_;
+    perfect_hash name_index_;
+    perfect_hash id_index_;
+    std::chrono::microseconds load_time_;
+};
+
+}
@@ -7,8 +7,11 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <type_traits>
+#include <iterator>
 #include "fml.h"
 #include "tux/buffer.hpp"
+#include "tux/expression_cache.hpp"
 #include "tux/util.hpp"
 
 
@@ -16,6 +19,22 @@
 namespace tux
 {
 
+/** Maps a C++ value type onto the FML field types which can store it.
+Used by fml16::field to reject mismatched descriptors at compile time.
+@sa fml16::field */
+template <typename T> struct fml16_value_traits
+{
+    static constexpr bool accepts(int) { return false; } /**< Tests whether a field of this FLD_ type can store a T. */
+};
+/** @cond */
+template <> struct fml16_value_traits<short> { static constexpr bool accepts(int type) { return type == FLD_SHORT; } };
+template <> struct fml16_value_traits<long> { static constexpr bool accepts(int type) { return type == FLD_LONG; } };
+template <> struct fml16_value_traits<char> { static constexpr bool accepts(int type) { return type == FLD_CHAR; } };
+template <> struct fml16_value_traits<float> { static constexpr bool accepts(int type) { return type == FLD_FLOAT; } };
+template <> struct fml16_value_traits<double> { static constexpr bool accepts(int type) { return type == FLD_DOUBLE; } };
+template <> struct fml16_value_traits<std::string> { static constexpr bool accepts(int type) { return type == FLD_STRING || type == FLD_CARRAY; } };
+/** @endcond */
+
 /** Models an "FML" typed buffer.  FML
 is a self-describing data structure
 conceptually similar to JSON or
@@ -75,6 +94,19 @@ public:
     static void unload_id_name_table() noexcept; /**< Unload field id to field name mapping [@c Fidnm_unload]. */
     static void unload_name_id_table() noexcept; /**< Unload field name to field id mapping [@c Fnmid_unload]. */
     
+    // ---------------typed field descriptors-------------------------------------
+    /** Describes a field at compile time: its id, and the C++ type of its values.
+    Normally generated by @c fmlhpp16 @c -t.
+    @sa fml32::field */
+    template <FLDID Id, typename T>
+    struct field
+    {
+        static_assert(fml16_value_traits<T>::accepts(static_cast<int>(Id >> 13)),
+                      "value type does not match the type of the field id");
+        typedef T value_type; /**< The C++ type of values of this field. */
+        constexpr operator FLDID() const noexcept { return Id; } /**< Returns the field id. */
+    };
+    
     // ---------------constructors and assignment-------------------------------------
     fml16() noexcept = default; /**< Default construct (no allocation). */
     fml16(fml16 const& x); /**< Copy construct [@c Fcpy, @c Findex]. */
@@ -215,6 +247,17 @@ public:
     double get_double(FLDID id, FLDOCC oc = 0) const; /**< Get a double [@c CFget]. */
     std::string get_string(FLDID id, FLDOCC oc = 0) const; /**< Get a string [@c Ffind, @c CFget]. */
     
+    // ------------------------------typed fields--------------------------------------------
+    /** Get a field via a typed descriptor [@c Fget, @c Ffind].
+    @sa fml32::get(fml32::field<Id,T>, FLDOCC32) const */
+    template <FLDID Id, typename T> T get(field<Id,T> id, FLDOCC oc = 0) const;
+    /** Set a field via a typed descriptor [@c Fchg].
+    @sa fml32::set(fml32::field<Id,T>, U const&, FLDOCC32) */
+    template <FLDID Id, typename T, typename U> void set(field<Id,T> id, U const& x, FLDOCC oc = 0);
+    /** Add a field via a typed descriptor [@c Fadd].
+    @sa fml32::add(fml32::field<Id,T>, U const&) */
+    template <FLDID Id, typename T, typename U> void add(field<Id,T> id, U const& x);
+    
     // ------------------------------find matching occurrence-------------------------------
     FLDOCC find(FLDID id, short x) const; /**< Find a short [@c CFfindocc]. */
     FLDOCC find(FLDID id, long x) const; /**< Find a long [@c CFfindocc]. */
@@ -242,6 +285,78 @@ public:
     no more fields in the buffer. */
     bool next_field(field_info& x) const;
     
+    /** A read-only reference to one field occurrence, yielded by const_iterator.
+    The id and occurrence come from the scan itself [@c Fnext]; the value is
+    located on first use [@c Ffind] and read in place.  A field_ref
+    is invalidated by any modification of the fml16. */
+    class field_ref
+    {
+    public:
+        FLDID id() const noexcept { return id_; } /**< Returns the field id. */
+        FLDOCC oc() const noexcept { return oc_; } /**< Returns the field occurrence. */
+        int type() const noexcept { return field_type(id_); } /**< Returns the field type [@c Fldtype]. */
+        std::string name() const { return field_name(id_); } /**< Returns the field name [@c Fname]. */
+        
+        const char* data() const; /**< Access the value in place [@c Ffind]. */
+        FLDLEN size() const; /**< Returns the length of the value in bytes [@c Ffind]. */
+        
+        short as_short() const; /**< Reads a short field in place, or converts [@c CFget32]. */
+        long as_long() const; /**< Reads a long field in place, or converts [@c CFget32]. */
+        char as_char() const; /**< Reads a char field in place, or converts [@c CFget32]. */
+        float as_float() const; /**< Reads a float field in place, or converts [@c CFget32]. */
+        double as_double() const; /**< Reads a double field in place, or converts [@c CFget32]. */
+        /** Views a string (excluding the null terminator) or carray in place.
+        @throws error (@c FTYPERR) for other field types */
+        string_ref as_string_ref() const;
+        std::string as_string() const; /**< Copies a string or carray, or converts [@c CFget32]. */
+        
+    private:
+        friend class fml16;
+        void locate() const;
+        
+        const fml16* owner_ = nullptr;
+        FLDID id_ = BADFLDID;
+        FLDOCC oc_ = 0;
+        mutable const char* value_ = nullptr;
+        mutable FLDLEN len_ = 0;
+    };
+    
+    /** Forward iterator over every field occurrence, in buffer order [@c Fnext].
+    @code
+    for(auto const& field : person)
+    {
+        std::cout << field.name() << '[' << field.oc() << "] = " << field.as_string() << std::endl;
+    }
+    @endcode */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category; /**< Iterator category. */
+        typedef field_ref value_type; /**< Value type. */
+        typedef std::ptrdiff_t difference_type; /**< Difference type. */
+        typedef field_ref const* pointer; /**< Pointer type. */
+        typedef field_ref const& reference; /**< Reference type. */
+        
+        const_iterator() noexcept = default; /**< Default construct (end). */
+        reference operator*() const noexcept { return ref_; } /**< Access the current field. */
+        pointer operator->() const noexcept { return &ref_; } /**< Access the current field. */
+        const_iterator& operator++(); /**< Advance to the next field [@c Fnext]. */
+        const_iterator operator++(int) { const_iterator tmp(*this); ++*this; return tmp; } /**< Advance to the next field [@c Fnext]. */
+        /** Equality. */
+        bool operator==(const_iterator const& x) const noexcept { return ref_.id_ == x.ref_.id_ && ref_.oc_ == x.ref_.oc_; }
+        bool operator!=(const_iterator const& x) const noexcept { return !(*this == x); } /**< Inequality. */
+        
+    private:
+        friend class fml16;
+        explicit const_iterator(const fml16* owner);
+        
+        field_ref ref_;
+    };
+    
+    typedef const_iterator iterator; /**< Fields can't be modified through an iterator. */
+    const_iterator begin() const; /**< Iterator to the first field [@c Fnext]. */
+    const_iterator end() const noexcept; /**< Iterator past the last field. */
+    
     // -------------------------boolean expression---------------------------------------
     /** Models a boolean expression (string) that can be compiled
     once and applied to multiple instance of fml16.  For example:
@@ -258,8 +373,8 @@ public:
     {
     public:
         boolean_expression() noexcept = default; /**< Default construct (no allocation). */
-        boolean_expression(boolean_expression const&); /**< Copy construct. */
-        boolean_expression& operator=(boolean_expression const&); /**< Copy assign. */
+        boolean_expression(boolean_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        boolean_expression& operator=(boolean_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         boolean_expression(boolean_expression&&) noexcept = default; /**< Move construct. */
         boolean_expression& operator=(boolean_expression&&) noexcept = default; /**< Move assign. */
         ~boolean_expression() noexcept = default; /**< Destruct. */
@@ -277,8 +392,7 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
     // -------------------------arithmetic expression----------------------------------------
@@ -298,8 +412,8 @@ public:
     {
     public:
         arithmetic_expression() noexcept = default; /**< Default construct (no allocation). */
-        arithmetic_expression(arithmetic_expression const&); /**< Copy construct. */
-        arithmetic_expression& operator=(arithmetic_expression const&); /**< Copy assign. */
+        arithmetic_expression(arithmetic_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        arithmetic_expression& operator=(arithmetic_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         arithmetic_expression(arithmetic_expression&&) noexcept = default; /**< Move construct. */
         arithmetic_expression& operator=(arithmetic_expression&&) noexcept = default; /**< Move assign. */
         ~arithmetic_expression() noexcept = default; /**< Destruct. */
@@ -317,14 +431,40 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
 private:
     
     static void check_field_type(FLDID fieldid, int expected_type);
     
+    template <typename T, typename U> struct storable : std::integral_constant<bool,
+        std::is_convertible<U const&, T>::value &&
+        !(std::is_floating_point<U>::value && std::is_integral<T>::value)> {};
+    template <typename T, typename U> static typename std::enable_if<std::is_arithmetic<T>::value, T>::type value_as(U const& x) { return static_cast<T>(x); }
+    template <typename T, typename U> static typename std::enable_if<!std::is_arithmetic<T>::value, U const&>::type value_as(U const& x) { return x; }
+    
+    void typed_get(FLDID fieldid, FLDOCC oc, short& x) const;
+    void typed_get(FLDID fieldid, FLDOCC oc, long& x) const;
+    void typed_get(FLDID fieldid, FLDOCC oc, char& x) const;
+    void typed_get(FLDID fieldid, FLDOCC oc, float& x) const;
+    void typed_get(FLDID fieldid, FLDOCC oc, double& x) const;
+    void typed_get(FLDID fieldid, FLDOCC oc, std::string& x) const;
+    void typed_set(FLDID fieldid, FLDOCC oc, short x);
+    void typed_set(FLDID fieldid, FLDOCC oc, long x);
+    void typed_set(FLDID fieldid, FLDOCC oc, char x);
+    void typed_set(FLDID fieldid, FLDOCC oc, float x);
+    void typed_set(FLDID fieldid, FLDOCC oc, double x);
+    void typed_set(FLDID fieldid, FLDOCC oc, const char* x);
+    void typed_set(FLDID fieldid, FLDOCC oc, std::string const& x);
+    void typed_add(FLDID fieldid, short x);
+    void typed_add(FLDID fieldid, long x);
+    void typed_add(FLDID fieldid, char x);
+    void typed_add(FLDID fieldid, float x);
+    void typed_add(FLDID fieldid, double x);
+    void typed_add(FLDID fieldid, const char* x);
+    void typed_add(FLDID fieldid, std::string const& x);
+    
     void convert_and_add(FLDID fieldid, const char* value, FLDLEN len, int type);
     void add(FLDID fieldid, const char* value, FLDLEN len);
     void get_and_convert(FLDID fieldid, FLDOCC oc, char* buf, FLDLEN* len, int type) const;
@@ -343,6 +483,26 @@ private:
     class buffer buffer_;
 };
 
+// TEMPLATE DEFS
+template <FLDID Id, typename T> T fml16::get(field<Id,T>, FLDOCC oc) const
+{
+    T x = T();
+    typed_get(Id, oc, x);
+    return x;
+}
+
+template <FLDID Id, typename T, typename U> void fml16::set(field<Id,T>, U const& x, FLDOCC oc)
+{
+    static_assert(storable<T, U>::value, "value cannot be stored in this field");
+    typed_set(Id, oc, value_as<T>(x));
+}
+
+template <FLDID Id, typename T, typename U> void fml16::add(field<Id,T>, U const& x)
+{
+    static_assert(storable<T, U>::value, "value cannot be stored in this field");
+    typed_add(Id, value_as<T>(x));
+}
+
 /** Compare two fml16 structures [@c Fcmp].
 @relates fml16
 @returns -1 if a < b, 0 if a == b, and 1 if a > b */
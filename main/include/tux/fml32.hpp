@@ -2,13 +2,19 @@
 @c fml32 class and related functions.
 @ingroup buffers*/
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <stdexcept>
 #include <vector>
 #include <map>
 #include <memory>
+#include <type_traits>
+#include <cassert>
+#include <iterator>
 #include "fml32.h"
 #include "tux/buffer.hpp"
+#include "tux/expression_cache.hpp"
 #include "tux/util.hpp"
 
 namespace tux
@@ -73,6 +79,26 @@ private:
     FLDLEN32 len_ = 0;
 };
 
+class fml32;
+class const_fml32_view;
+
+/** Maps a C++ value type onto the FML32 field types which can store it.
+Used by fml32::field to reject mismatched descriptors at compile time.
+@sa fml32::field */
+template <typename T> struct fml32_value_traits
+{
+    static constexpr bool accepts(int) { return false; } /**< Tests whether a field of this FLD_ type can store a T. */
+};
+/** @cond */
+template <> struct fml32_value_traits<short> { static constexpr bool accepts(int type) { return type == FLD_SHORT; } };
+template <> struct fml32_value_traits<long> { static constexpr bool accepts(int type) { return type == FLD_LONG; } };
+template <> struct fml32_value_traits<char> { static constexpr bool accepts(int type) { return type == FLD_CHAR; } };
+template <> struct fml32_value_traits<float> { static constexpr bool accepts(int type) { return type == FLD_FLOAT; } };
+template <> struct fml32_value_traits<double> { static constexpr bool accepts(int type) { return type == FLD_DOUBLE; } };
+template <> struct fml32_value_traits<std::string> { static constexpr bool accepts(int type) { return type == FLD_STRING || type == FLD_CARRAY; } };
+template <> struct fml32_value_traits<fml32> { static constexpr bool accepts(int type) { return type == FLD_FML32; } };
+/** @endcond */
+
 /** Models an "FML32" typed buffer.  FML
 is a self-describing data structure
 conceptually similar to JSON or
@@ -122,8 +148,8 @@ public:
     @param type e.g. FLD_SHORT, FLD_LONG
     @returns a string representing the type e.g. "short", "long" */
     static std::string field_type_name_from_type(int type); 
-    static FLDID32 field_id(std::string const& name); /**< Returns the field id [@c Fldid32]. */
-    static std::string field_name(FLDID32 id); /**< Returns the field name [@c Fname32]. */
+    static FLDID32 field_id(std::string const& name); /**< Returns the field id [@c Fldid32, or field_table once loaded]. */
+    static std::string field_name(FLDID32 id); /**< Returns the field name [@c Fname32, or field_table once loaded]. */
     static FLDOCC32 field_number(FLDID32 id) noexcept; /**< Returns the field number [@c Fldno32]. */
     static int field_type(FLDID32 id) noexcept; /**< Returns the field type [@c Fldtype32]. */
     static std::string field_type_name(FLDID32 id); /**< Returns the field type name [@c Ftype32]. */
@@ -133,13 +159,83 @@ public:
     static void unload_id_name_table() noexcept; /**< Unload field id to field name mapping [@c Fidnm_unload32]. */
     static void unload_name_id_table() noexcept; /**< Unload field name to field id mapping [@c Fnmid_unload32]. */
     
+    // ---------------------typed field descriptors------------------------
+    /** Describes a field at compile time: its id, and the C++ type of its values.
+    The FLD_ type is encoded in the id itself, so a descriptor whose value
+    type doesn't fit the field is a compile error.  Descriptors convert
+    implicitly to @c FLDID32, so they work with every function taking a field id.
+    They're normally generated by @c fmlhpp32 @c -t:
+    @code{.cpp}
+    constexpr tux::fml32::field<33555434, long> AGE{};
+    fml32 person;
+    person.set(AGE, 32);       // no Fldtype32 check, no conversion
+    long age = person.get(AGE);
+    person.set(AGE, "32");     // compile error
+    @endcode
+    @sa get(field<Id,T>, FLDOCC32) const, set(field<Id,T>, U const&, FLDOCC32) */
+    template <FLDID32 Id, typename T>
+    struct field
+    {
+        static_assert(fml32_value_traits<T>::accepts(static_cast<int>(Id >> 25)),
+                      "value type does not match the type of the field id");
+        typedef T value_type; /**< The C++ type of values of this field. */
+        constexpr operator FLDID32() const noexcept { return Id; } /**< Returns the field id. */
+    };
+    
+    /** A read-only view of a string or carray value, in place inside the fml32.
+    Returned by get_string_view() and get_carray_view().  A value_ref
+    converts to tux::string_ref, and stays valid until the fml32 is
+    next modified (add, set, erase, reserve, etc.), assigned, or destroyed.
+    In debug builds (@c NDEBUG not defined when the library was built) the
+    fml32 keeps a generation counter, so valid() can tell, and using a stale
+    value_ref trips an assertion (where @c NDEBUG isn't defined in the
+    calling code either).  Release builds track nothing, so a value_ref is
+    just a pointer and a length.
+    @code
+    fml32 person;
+    // ...
+    if(person.get_string_view(NAME) == "George")
+    {
+        // no std::string was constructed
+    }
+    @endcode */
+    class value_ref
+    {
+    public:
+        value_ref() noexcept = default; /**< Default construct (empty). */
+    
+        const char* data() const noexcept { check(); return ref_.data(); } /**< Access the characters. */
+        std::size_t size() const noexcept { check(); return ref_.size(); } /**< Returns the number of characters. */
+        bool empty() const noexcept { check(); return ref_.empty(); } /**< Test for zero length. */
+        string_ref::const_iterator begin() const noexcept { check(); return ref_.begin(); } /**< Iterator to first character. */
+        string_ref::const_iterator end() const noexcept { check(); return ref_.end(); } /**< Iterator past last character. */
+        char operator[](std::size_t i) const noexcept { check(); return ref_[i]; } /**< Unchecked access. */
+        std::string str() const { check(); return ref_.str(); } /**< Copies into a std::string. */
+        operator string_ref() const noexcept { check(); return ref_; } /**< Converts to a string_ref. */
+        
+        /** Returns false if the owning fml32 was modified since this was created.
+        Always true in release builds of the library, which don't track generations. */
+        bool valid() const noexcept { return !generation_ || generation_->load() == expected_; }
+        
+    private:
+        friend class fml32;
+        friend class const_fml32_view;
+        value_ref(string_ref ref, std::shared_ptr<const std::atomic<unsigned long>> generation) noexcept :
+            ref_(ref), generation_(std::move(generation)), expected_(generation_ ? generation_->load() : 0) {}
+        void check() const noexcept { assert(valid() && "fml32::value_ref used after its fml32 was modified"); }
+        
+        string_ref ref_;
+        std::shared_ptr<const std::atomic<unsigned long>> generation_;
+        unsigned long expected_ = 0;
+    };
+    
     // ---------------------constructors and assignment------------------------
     fml32() noexcept = default; /**< Default construct (no allocation). */
     fml32(fml32 const& x); /**< Copy construct [@c Fcpy32, @c Findex32]. */
     fml32& operator=(fml32 const& x); /**< Copy assign [@c Fcpy32, @c Findex32]. */
-    fml32(fml32&& x) noexcept = default; /**< Move construct. */
-    fml32& operator=(fml32&& x) noexcept = default; /**< Move assign. */
-    ~fml32() noexcept = default; /**< Destruct. */
+    fml32(fml32&& x) noexcept; /**< Move construct. */
+    fml32& operator=(fml32&& x) noexcept; /**< Move assign. */
+    ~fml32() noexcept; /**< Destruct. */
     
     /** Construct from a buffer.
     @sa cstring::cstring(buffer&&). */
@@ -157,7 +253,9 @@ public:
     
     // ---------------------------------buffer access----------------------------
     class buffer const& buffer() const noexcept; /**< Access underlying buffer. */
-    class buffer& buffer() noexcept; /**< Access underlying buffer. */
+    /** Access underlying buffer.  Changing the buffer through this (or
+    as_fbfr()) isn't seen by the fml32: call modified() afterwards.  */
+    class buffer& buffer() noexcept;
     /** Move underlying buffer.
     This can (and usually will) leave @c this in a default (null) state. */
     class buffer&& move_buffer() noexcept;
@@ -176,8 +274,13 @@ public:
     call to index. */
     bool is_fielded() const noexcept;
     
-    FBFR32* as_fbfr() noexcept; /**< Access pointer to underlying FBFR. */
+    FBFR32* as_fbfr() noexcept; /**< Access pointer to underlying FBFR.  @sa modified() */
     const FBFR32* as_fbfr() const noexcept; /**< Access pointer to underlying FBFR. */
+    /** Records that the buffer was changed directly (through as_fbfr() or
+    buffer(), by a Tuxedo call): the side index is discarded, and in debug
+    builds outstanding value_refs and views become invalid.  The fml32's own
+    modifiers do this themselves. */
+    void modified() noexcept;
     
     /** Calculates checksum of buffer [@c Fchksum32].
     @pre The internal buffer cannot be null. */
@@ -207,6 +310,27 @@ public:
     /** Restore a previously dropped index [@c Frstrindex32].
     @param index_element_count the index element count returned from unindex */
     void restore_index(FLDOCC32 index_element_count); 
+    /** Builds a side index locating every occurrence of every field [@c Fnext32, @c Ffind32].
+    Tuxedo's own index [@c Findex32] records only every n-th field, so finding
+    a value in a buffer with tens of thousands of fields still scans.  While
+    the side index exists, the getters (get_long(), get_string(),
+    get_string_view(), etc.) find values with a hash lookup, and field
+    iterators walk it in buffer order, with no lookups at all.
+    Any modification (add, set, erase, reserve, assignment, etc.) discards
+    it, so build it once the buffer is complete:
+    @code
+    fml32 batch;
+    batch.read(input);
+    batch.build_side_index();
+    for(FLDOCC32 i = 0; i < n; ++i)
+    {
+        total += batch.get_double(AMOUNT, i); // no scan
+    }
+    @endcode
+    @sa drop_side_index(), has_side_index() */
+    void build_side_index();
+    void drop_side_index() noexcept; /**< Discards the side index. @sa build_side_index() */
+    bool has_side_index() const noexcept; /**< Tests whether a side index exists. @sa build_side_index() */
     
     // -----------------------------------------bytes used------------------------------
     long index_size() const; /**< Returns the number of bytes used by the index  [@c Fidxused32]. */
@@ -235,6 +359,31 @@ public:
     fml32 project(std::vector<FLDID32> ids) const; /**< Create a projection (with only the specified fields) of this fml32 [@c Fprojcpy32]. */
     void update(fml32 const& x); /**< Update this fml32 based on field values in another fml32 [@c Fupdate32]. */
     
+    // ---------------------------------------patches-----------------------------------------
+    /** Field id of the control field in a patch: a long field numbered 33554431,
+    the highest FML32 field number.  It must not be used for application data:
+    diff() and apply_patch() throw if their inputs hold it.
+    @sa diff() */
+    static constexpr FLDID32 patch_field = 67108863;
+    /** Computes the changes turning @c base into @c next, as a compact patch.
+    The patch is itself an fml32 (so it can be sent anywhere @c next could be),
+    holding only the occurrences which were added or changed, plus a few longs
+    of bookkeeping per changed field in patch_field; deleted occurrences cost
+    no values at all.  Occurrences are compared byte for byte.
+    @code
+    fml32 patch = fml32::diff(last_sent, state);
+    // ... send patch; the receiver, holding last_sent, calls
+    received.apply_patch(patch); // received == state
+    @endcode
+    @throws std::runtime_error if @c base or @c next holds patch_field
+    @sa apply_patch() */
+    static fml32 diff(fml32 const& base, fml32 const& next);
+    /** Applies a patch computed by diff() [@c Fchg32, @c Fdel32, @c Fadd32].
+    @c this must hold the same occurrence counts as the @c base the patch was
+    computed from (for every field the patch touches), and not hold patch_field,
+    else an exception is thrown and @c this is left unchanged. */
+    void apply_patch(fml32 const& patch);
+    
     // -----------------------------------mbstrings-----------------------------------------
     /** Get the encoding name at the buffer level [@c tpgetmbenc].
     @sa set_encoding_name(), clear_encoding_name(), mbpack_option */
@@ -295,6 +444,9 @@ public:
         not own x. */
     void add_ptr(FLDID32 id, const void* x);
     template <typename T> void add_view(FLDID32 id, T const& x); /**< Add a nested struct (defined in a view) [@c Fadd32]*/
+    /** Add a nested struct, given its view name, when its C++ type isn't known [@c Fadd32].
+    @param data an instance of the view's structure */
+    void add_view(FLDID32 id, std::string const& view_name, const void* data);
     
     // -----------------------------------append fields---------------------------------------------
     void append(FLDID32 id, short x); /**< Append a short [@c Fappend32]. */
@@ -330,12 +482,39 @@ public:
     float get_float(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a float [@c CFget32]. */
     double get_double(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a double [@c CFget32]. */
     std::string get_string(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a string [@c Ffind32, @c CFget32]. */
+    /** Get a string or carray without copying it [@c Ffind32].
+    The trailing null terminator of a string field is excluded.
+    @throws error (@c FTYPERR) for other field types
+    @sa value_ref */
+    value_ref get_string_view(FLDID32 id, FLDOCC32 oc = 0) const;
+    /** Get a carray without copying it [@c Ffind32].
+    @throws error (@c FTYPERR) for other field types
+    @sa value_ref */
+    value_ref get_carray_view(FLDID32 id, FLDOCC32 oc = 0) const;
     unpacked_mbstring get_mbstring(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get an mbstring [@c Fgetalloc32, @c Fmbunpack32]. */
-    fml32 get_fml(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a nested fml32 [@c Ffind32]. */
-    void get_fml(FLDID32 id, FLDOCC32 oc, fml32& output) const; /**< Get a nested fml32 [@c Ffind32]. */
+    fml32 get_fml(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a nested fml32 [@c Ffind32]. @sa get_fml_view() */
+    void get_fml(FLDID32 id, FLDOCC32 oc, fml32& output) const; /**< Get a nested fml32 [@c Ffind32]. @sa get_fml_view() */
+    /** Get a nested fml32 without copying it [@c Ffind32].
+    get_fml() allocates and copies at every level of nesting; a view reads
+    the nested buffer where it lies.
+    @sa const_fml32_view */
+    const_fml32_view get_fml_view(FLDID32 id, FLDOCC32 oc = 0) const;
     void* get_ptr(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a pointer [@c Fget32]. Use at your own risk. @sa add_ptr() */
     template <typename T> T get_view(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a nested struct (defined in a view) [@c Fgetalloc32]. */
     
+    // -----------------------------------typed fields---------------------------------------------
+    /** Get a field via a typed descriptor [@c Fget32, @c Ffind32].
+    The value type is known at compile time, so no runtime type check
+    or conversion is performed. */
+    template <FLDID32 Id, typename T> T get(field<Id,T> id, FLDOCC32 oc = 0) const;
+    /** Set a field via a typed descriptor [@c Fchg32].
+    @c U must be convertible to the descriptor's value type
+    (floating point values are never narrowed to integers). */
+    template <FLDID32 Id, typename T, typename U> void set(field<Id,T> id, U const& x, FLDOCC32 oc = 0);
+    /** Add a field via a typed descriptor [@c Fadd32].
+    @sa set(field<Id,T>, U const&, FLDOCC32) */
+    template <FLDID32 Id, typename T, typename U> void add(field<Id,T> id, U const& x);
+    
     // -----------------------------------find matching occurrences----------------------------------------
     FLDOCC32 find(FLDID32 id, short x) const; /**< Find a short [@c CFfindocc32]. */
     FLDOCC32 find(FLDID32 id, long x) const; /**< Find a long [@c CFfindocc32]. */
@@ -364,6 +543,27 @@ public:
     std::pair<FLDOCC32,void*> get_last_ptr(FLDID32 id) const; /**< Get the last occurrence of a field [@c Fgetlast32]. */
     template <typename T> std::pair<FLDOCC32,T> get_last_view(FLDID32 id) const;  /**< Get the last occurrence of a field [@c Foccur32, @c Fgetalloc32]. */
     
+    // -----------------------------all occurrences at once---------------------------------------
+    /** Get every occurrence of a field [@c Foccur32, @c Ffind32].
+    Each value is read in place and copied straight into @c out, which is
+    resized to the occurrence count, without the intermediate copy a loop over
+    get_long(id, oc) makes.  Ffind32 still locates each occurrence from the
+    start of the field; with a side index (build_side_index()) the values are
+    read from it instead.
+    T may be short, long, char, float, double, or std::string.  If T doesn't
+    match the field type, each value is converted as by get_long() etc.
+    @code
+    std::vector<long> amounts;
+    report.get_all(AMOUNT, amounts);
+    @endcode */
+    template <typename T> void get_all(FLDID32 id, std::vector<T>& out) const { get_all_values(id, out); }
+    /** Replace every occurrence of a field with the values in [first, last)
+    [@c Fdelall32, @c Fappend32, @c Fconcat32].
+    The new occurrences are built in a single, exactly sized buffer and merged
+    in one pass.  Like append(), the value type must match the field type.
+    @note requires forward iterators (the range is traversed twice). */
+    template <typename ForwardIt> void set_all(FLDID32 id, ForwardIt first, ForwardIt last);
+    
     // ---------------------------------iterate over all fields--------------------------------------------------
     /** Get information about the next field in the buffer.
     @param x on input, this represents the current "iterator";
@@ -372,6 +572,101 @@ public:
     no more fields in the buffer. */
     bool next_field(field_info& x) const;
     
+private:
+    struct side_index; // see build_side_index
+    
+public:
+    /** A read-only reference to one field occurrence, yielded by const_iterator.
+    The id, occurrence and value all come from the same step of the scan: the
+    value is read in place when the iterator walks a side index, and otherwise
+    is the copy Fnext32 made into storage the iterator owns, so data(),
+    as_string_ref() and as_fml_view() are only valid until the iterator
+    advances.  Like a value_ref, a field_ref is invalidated by any
+    modification of the fml32 (or of the fml32 a const_fml32_view being
+    walked came from). */
+    class field_ref
+    {
+    public:
+        FLDID32 id() const noexcept { return id_; } /**< Returns the field id. */
+        FLDOCC32 oc() const noexcept { return oc_; } /**< Returns the field occurrence. */
+        int type() const noexcept { return field_type(id_); } /**< Returns the field type [@c Fldtype32]. */
+        std::string name() const { return field_name(id_); } /**< Returns the field name [@c Fname32]. */
+        
+        const char* data() const noexcept { return value_ ? value_ : copy_.data(); } /**< Access the value (in place, or the iterator's copy). */
+        FLDLEN32 size() const noexcept { return len_; } /**< Returns the length of the value in bytes. */
+        
+        short as_short() const; /**< Reads a short field in place, or converts [@c CFget32]. */
+        long as_long() const; /**< Reads a long field in place, or converts [@c CFget32]. */
+        char as_char() const; /**< Reads a char field in place, or converts [@c CFget32]. */
+        float as_float() const; /**< Reads a float field in place, or converts [@c CFget32]. */
+        double as_double() const; /**< Reads a double field in place, or converts [@c CFget32]. */
+        /** Views a string (excluding the null terminator) or carray in place.
+        @throws error (@c FTYPERR) for other field types */
+        string_ref as_string_ref() const;
+        std::string as_string() const; /**< Copies a string or carray, or converts [@c CFget32]. */
+        fml32 as_fml() const; /**< Copies a nested fml32. */
+        const_fml32_view as_fml_view() const; /**< Views a nested fml32 (until the iterator advances). */
+        
+    private:
+        friend class fml32;
+        friend class const_fml32_view;
+        const_fml32_view view() const; // the buffer walked, for conversions
+        
+        const fml32* owner_ = nullptr; // null when walking a const_fml32_view
+        const FBFR32* fbfr_ = nullptr;
+        std::shared_ptr<const std::atomic<unsigned long>> generation_; // of a walked view
+        FLDID32 id_ = BADFLDID;
+        FLDOCC32 oc_ = 0;
+        const char* value_ = nullptr; // in place, when walking a side index
+        FLDLEN32 len_ = 0;
+        std::vector<char> copy_; // the value, copied out by Fnext32 otherwise
+    };
+    
+    /** Forward iterator over every field occurrence, in buffer order [@c Fnext32].
+    Each step is a single Fnext32 call, which copies the value out along with
+    the id and occurrence (into storage the iterator reuses), so reading
+    values costs no further lookup.  While a side index exists
+    (build_side_index()) the iterator walks that instead, and values are read
+    in place.  Converting a value to another type (as_long() of a string
+    field, etc.) does look it up again [@c CFget32].
+    @code
+    for(auto const& field : person)
+    {
+        std::cout << field.name() << '[' << field.oc() << "] = " << field.as_string() << std::endl;
+    }
+    @endcode */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category; /**< Iterator category. */
+        typedef field_ref value_type; /**< Value type. */
+        typedef std::ptrdiff_t difference_type; /**< Difference type. */
+        typedef field_ref const* pointer; /**< Pointer type. */
+        typedef field_ref const& reference; /**< Reference type. */
+        
+        const_iterator() noexcept = default; /**< Default construct (end). */
+        reference operator*() const noexcept { return ref_; } /**< Access the current field. */
+        pointer operator->() const noexcept { return &ref_; } /**< Access the current field. */
+        const_iterator& operator++(); /**< Advance to the next field [@c Fnext32]. */
+        const_iterator operator++(int) { const_iterator tmp(*this); ++*this; return tmp; } /**< Advance to the next field [@c Fnext32]. */
+        /** Equality. */
+        bool operator==(const_iterator const& x) const noexcept { return ref_.id_ == x.ref_.id_ && ref_.oc_ == x.ref_.oc_; }
+        bool operator!=(const_iterator const& x) const noexcept { return !(*this == x); } /**< Inequality. */
+        
+    private:
+        friend class fml32;
+        friend class const_fml32_view;
+        explicit const_iterator(const fml32* owner);
+        const_iterator(const FBFR32* f, std::shared_ptr<const std::atomic<unsigned long>> generation);
+        
+        field_ref ref_;
+        std::shared_ptr<const side_index> index_; // walked instead of Fnext32, if set
+        std::size_t next_slot_ = 0;
+    };
+    
+    typedef const_iterator iterator; /**< Fields can't be modified through an iterator. */
+    const_iterator begin() const; /**< Iterator to the first field [@c Fnext32]. */
+    const_iterator end() const noexcept; /**< Iterator past the last field. */
     
 
     // -------------------------boolean expression---------------------------------------
@@ -390,8 +685,8 @@ public:
     {
     public:
         boolean_expression() noexcept = default; /**< Default construct (no allocation). */
-        boolean_expression(boolean_expression const&); /**< Copy construct. */
-        boolean_expression& operator=(boolean_expression const&); /**< Copy assign. */
+        boolean_expression(boolean_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        boolean_expression& operator=(boolean_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         boolean_expression(boolean_expression&&) noexcept = default; /**< Move construct. */
         boolean_expression& operator=(boolean_expression&&) noexcept = default; /**< Move assign. */
         ~boolean_expression() noexcept = default; /**< Destruct. */
@@ -405,12 +700,30 @@ public:
         
         bool evaluate(fml32 const&) const; /**< Evaluates the expression on an fml32 [@c Fboolev32]. */
         bool operator()(fml32 const&) const; /**< Evaluates the expression on an fml32 [@c Fboolev32]. */
+        bool evaluate(const_fml32_view const&) const; /**< Evaluates the expression on a view [@c Fboolev32]. */
+        bool operator()(const_fml32_view const&) const; /**< Evaluates the expression on a view [@c Fboolev32]. */
+        
+        /** Evaluates the expression on each of @c count fml32, in parallel [@c Fboolev32].
+        The batch is split into contiguous ranges, one per worker thread; batches
+        too small to benefit are evaluated on the calling thread.  FML needs no
+        Tuxedo context, so workers don't join the application.
+        @param buffers the batch
+        @param count number of buffers
+        @param bitmap receives the results, resized to hold @c count bits:
+        the result for buffers[i] is bit <tt>i % 64</tt> of <tt>bitmap[i / 64]</tt>
+        @param threads maximum number of worker threads; 0 means one per hardware thread
+        @throws the first error encountered, after all workers have finished */
+        void evaluate_batch(fml32 const* buffers, std::size_t count, std::vector<std::uint64_t>& bitmap, unsigned threads = 0) const;
+        /** Evaluates the expression on each fml32 in a vector, in parallel [@c Fboolev32]. */
+        void evaluate_batch(std::vector<fml32> const& buffers, std::vector<std::uint64_t>& bitmap, unsigned threads = 0) const
+        {
+            evaluate_batch(buffers.data(), buffers.size(), bitmap, threads);
+        }
         
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
     // -------------------------arithmetic expression----------------------------------------
@@ -429,8 +742,8 @@ public:
     {
     public:
         arithmetic_expression() noexcept = default; /**< Default construct (no allocation). */
-        arithmetic_expression(arithmetic_expression const&); /**< Copy construct. */
-        arithmetic_expression& operator=(arithmetic_expression const&); /**< Copy assign. */
+        arithmetic_expression(arithmetic_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        arithmetic_expression& operator=(arithmetic_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         arithmetic_expression(arithmetic_expression&&) noexcept = default; /**< Move construct. */
         arithmetic_expression& operator=(arithmetic_expression&&) noexcept = default; /**< Move assign. */
         ~arithmetic_expression() noexcept = default; /**< Destruct. */
@@ -444,17 +757,64 @@ public:
         
         double evaluate(fml32 const&) const; /**< Evaluates the expression on an fml32 [@c Ffloatev32]. */
         double operator()(fml32 const&) const; /**< Evaluates the expression on an fml32 [@c Ffloatev32]. */
+        double evaluate(const_fml32_view const&) const; /**< Evaluates the expression on a view [@c Ffloatev32]. */
+        double operator()(const_fml32_view const&) const; /**< Evaluates the expression on a view [@c Ffloatev32]. */
+        
+        /** Evaluates the expression on each of @c count fml32, in parallel [@c Ffloatev32].
+        @param buffers the batch
+        @param count number of buffers
+        @param results receives the results, resized to @c count
+        @param threads maximum number of worker threads; 0 means one per hardware thread
+        @throws the first error encountered, after all workers have finished
+        @sa boolean_expression::evaluate_batch() */
+        void evaluate_batch(fml32 const* buffers, std::size_t count, std::vector<double>& results, unsigned threads = 0) const;
+        /** Evaluates the expression on each fml32 in a vector, in parallel [@c Ffloatev32]. */
+        void evaluate_batch(std::vector<fml32> const& buffers, std::vector<double>& results, unsigned threads = 0) const
+        {
+            evaluate_batch(buffers.data(), buffers.size(), results, threads);
+        }
         
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
 private:
+    friend class const_fml32_view;
     
     static void check_field_type(FLDID32 fieldid, int expected_type);
+    template <typename T> static T view_value(FBFR32* f, FLDID32 id, FLDOCC32 oc);
+    
+    template <typename T, typename U> struct storable : std::integral_constant<bool,
+        std::is_convertible<U const&, T>::value &&
+        !(std::is_floating_point<U>::value && std::is_integral<T>::value)> {};
+    template <typename T, typename U> static typename std::enable_if<std::is_arithmetic<T>::value, T>::type value_as(U const& x) { return static_cast<T>(x); }
+    template <typename T, typename U> static typename std::enable_if<!std::is_arithmetic<T>::value, U const&>::type value_as(U const& x) { return x; }
+    
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, short& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, long& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, char& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, float& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, double& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, std::string& x) const;
+    void typed_get(FLDID32 fieldid, FLDOCC32 oc, fml32& x) const;
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, short x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, long x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, char x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, float x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, double x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, const char* x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, std::string const& x);
+    void typed_set(FLDID32 fieldid, FLDOCC32 oc, fml32 const& x);
+    void typed_add(FLDID32 fieldid, short x);
+    void typed_add(FLDID32 fieldid, long x);
+    void typed_add(FLDID32 fieldid, char x);
+    void typed_add(FLDID32 fieldid, float x);
+    void typed_add(FLDID32 fieldid, double x);
+    void typed_add(FLDID32 fieldid, const char* x);
+    void typed_add(FLDID32 fieldid, std::string const& x);
+    void typed_add(FLDID32 fieldid, fml32 const& x);
     
     void convert_and_add(FLDID32 fieldid, const char* value, FLDLEN32 len, int type);
     void add(FLDID32 fieldid, const char* value, FLDLEN32 len);
@@ -473,10 +833,127 @@ private:
     FLDOCC32 find_occurence(FLDID32 id, const char* value, FLDLEN32 len) const; // Ffindocc .. or CFfindocc ?
     FLDOCC32 convert_and_find_occurrence(FLDID32 id, const char* value, FLDLEN32 len, int type) const;
     
+    void get_all_values(FLDID32 id, std::vector<short>& out) const;
+    void get_all_values(FLDID32 id, std::vector<long>& out) const;
+    void get_all_values(FLDID32 id, std::vector<char>& out) const;
+    void get_all_values(FLDID32 id, std::vector<float>& out) const;
+    void get_all_values(FLDID32 id, std::vector<double>& out) const;
+    void get_all_values(FLDID32 id, std::vector<std::string>& out) const;
+    static FLDLEN32 value_size(std::string const& x) noexcept { return static_cast<FLDLEN32>(x.size() + 1); }
+    template <typename T> static FLDLEN32 value_size(T const&) noexcept { return sizeof(double); } // upper bound for numbers
+    
+    value_ref make_value_ref(const char* data, std::size_t size) const;
+    std::shared_ptr<const std::atomic<unsigned long>> generation() const; // null in release builds
+    const char* find_indexed(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const noexcept;
+    
     class buffer buffer_;
+    mutable std::shared_ptr<std::atomic<unsigned long>> generation_; // debug builds only; see value_ref
+    std::shared_ptr<side_index> side_index_; // see build_side_index
+};
+
+/** A read-only view of an fml32, in place.
+Usually a nested fml32 field: fml32::get_fml_view() wraps the nested
+buffer where it lies inside its parent [@c Ffind32], so reading a few
+fields of a deeply nested document costs no allocation or copy at any
+level.  A view can also be constructed from an fml32, so functions taking
+a const_fml32_view accept either.
+@code
+fml32 order;
+// ...
+auto address = order.get_fml_view(CUSTOMER).get_fml_view(ADDRESS);
+if(address.get_string_view(COUNTRY) == "NZ")
+{
+    // nothing was copied
+}
+@endcode
+Like fml32::value_ref, a view (and anything read through it in place) is
+valid until the fml32 it came from is next modified, assigned, or
+destroyed.  In debug builds of the library the view shares the fml32's
+generation counter, so valid() can tell, and using a stale view trips an
+assertion (where @c NDEBUG isn't defined in the calling code either).
+@ingroup buffers */
+class const_fml32_view
+{
+public:
+    const_fml32_view() noexcept = default; /**< Default construct (null). */
+    const_fml32_view(fml32 const& x); /**< Views an entire fml32. */
+    /** Views an FBFR32 whose lifetime the caller manages (e.g. in mapped
+    memory, as fml32_file_reader does).  No generation is tracked. */
+    explicit const_fml32_view(const FBFR32* f) noexcept : fbfr_(f) {}
+    
+    explicit operator bool() const noexcept; /**< Tests for a non-null view with at least one field. */
+    const FBFR32* as_fbfr() const noexcept; /**< Access pointer to the viewed FBFR. */
+    /** Returns false if the owning fml32 was modified since this was created.
+    Always true for views of an FBFR32 the caller manages, and in release
+    builds of the library. */
+    bool valid() const noexcept { return !generation_ || generation_->load() == expected_; }
+    /** Copies the viewed fields into a new fml32 of their used size [@c Fused32, @c Fconcat32]. */
+    fml32 copy() const;
+    
+    long used_size() const; /**< Returns the number of bytes used [@c Fused32]. */
+    FLDOCC32 field_count() const; /**< Returns the field count [@c Fnum32]. */
+    FLDOCC32 count(FLDID32 id) const; /**< Returns the count of field @c id [@c Foccur32]. */
+    bool has(FLDID32 id, FLDOCC32 oc = 0) const; /**< Checks for the existence of a particular field [@c Fpres32]. */
+    long field_value_size(FLDID32 id, FLDOCC32 oc = 0) const; /**< Returns the size of a value in bytes [@c Flen32]. */
+    
+    short get_short(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a short [@c CFget32]. */
+    long get_long(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a long [@c CFget32]. */
+    char get_char(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a char [@c CFget32]. */
+    float get_float(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a float [@c CFget32]. */
+    double get_double(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a double [@c CFget32]. */
+    std::string get_string(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a string [@c Ffind32, @c CFget32]. */
+    /** Get a string or carray without copying it [@c Ffind32].  @sa fml32::get_string_view() */
+    fml32::value_ref get_string_view(FLDID32 id, FLDOCC32 oc = 0) const;
+    /** Get a carray without copying it [@c Ffind32].  @sa fml32::get_carray_view() */
+    fml32::value_ref get_carray_view(FLDID32 id, FLDOCC32 oc = 0) const;
+    fml32 get_fml(FLDID32 id, FLDOCC32 oc = 0) const; /**< Copy a nested fml32 [@c Ffind32, @c Fcpy32]. */
+    const_fml32_view get_fml_view(FLDID32 id, FLDOCC32 oc = 0) const; /**< View a nested fml32 in place [@c Ffind32]. */
+    template <typename T> T get_view(FLDID32 id, FLDOCC32 oc = 0) const; /**< Get a nested struct (defined in a view) [@c Fgetalloc32]. */
+    
+    /** Get information about the next field in the buffer [@c Fnext32].
+    @sa fml32::next_field() */
+    bool next_field(fml32::field_info& x) const;
+    
+    fml32::const_iterator begin() const; /**< Iterator to the first field [@c Fnext32].  @sa fml32::begin() */
+    fml32::const_iterator end() const noexcept; /**< Iterator past the last field. */
+    
+private:
+    friend class fml32;
+    const_fml32_view(const FBFR32* f, std::shared_ptr<const std::atomic<unsigned long>> generation) noexcept :
+        fbfr_(f), generation_(std::move(generation)), expected_(generation_ ? generation_->load() : 0) {}
+    void check() const noexcept { assert(valid() && "const_fml32_view used after its fml32 was modified"); }
+    FBFR32* fbfr() const noexcept { check(); return const_cast<FBFR32*>(fbfr_); } // for Tuxedo's non-const signatures
+    char* find_value(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const;
+    
+    const FBFR32* fbfr_ = nullptr;
+    std::shared_ptr<const std::atomic<unsigned long>> generation_;
+    unsigned long expected_ = 0;
 };
 
 // TEMPLATE DEFS
+template <typename ForwardIt> void fml32::set_all(FLDID32 id, ForwardIt first, ForwardIt last)
+{
+    FLDOCC32 n = 0;
+    FLDLEN32 space = 0;
+    for(auto it = first; it != last; ++it)
+    {
+        ++n;
+        space += value_size(*it);
+    }
+    fml32 values;
+    if(n > 0)
+    {
+        values.reserve(n, space);
+        for(auto it = first; it != last; ++it)
+        {
+            values.append(id, *it);
+        }
+        values.index();
+    }
+    erase(id);
+    *this += values;
+}
+
 template <typename T> void fml32::add_view(FLDID32 id, T const& x)
 {
     using namespace std;
@@ -508,6 +985,11 @@ template <typename T> void fml32::set_view(FLDID32 id, T const& x, FLDOCC32 oc)
 
 
 template <typename T> T fml32::get_view(FLDID32 id, FLDOCC32 oc) const
+{
+    return view_value<T>(const_cast<FBFR32*>(as_fbfr()), id, oc);
+}
+
+template <typename T> T fml32::view_value(FBFR32* f, FLDID32 id, FLDOCC32 oc)
 {
     // TODO this is fairly inefficient
     // double allocation, allocating for intermediate FVIEWFLD
@@ -519,11 +1001,10 @@ template <typename T> T fml32::get_view(FLDID32 id, FLDOCC32 oc) const
     // Fgetalloc32 triggers a heap buffer overflow during a memmove.  turning off
     // asan results in SIGSEGV.  I notice that Flen reports an insanely large value
     // for such occurrences (presumably uninitialized?)
-    unique_ptr<char, decltype(&std::free)> buf { Fgetalloc32(const_cast<FBFR32*>(as_fbfr()),
-                                                                id, oc, &length),
+    unique_ptr<char, decltype(&std::free)> buf { Fgetalloc32(f, id, oc, &length),
                                                 &std::free};
-    FVIEWFLD* f = (FVIEWFLD*)buf.get();
-    std::string actual_type = f->vname;
+    FVIEWFLD* v = (FVIEWFLD*)buf.get();
+    std::string actual_type = v->vname;
     std::string requested_type = type_name<T>::value();
     if(actual_type != requested_type)
     {
@@ -533,11 +1014,35 @@ template <typename T> T fml32::get_view(FLDID32 id, FLDOCC32 oc) const
     }
     
     T x = make_default<T>();
-    memmove(&x, f->data, sizeof(x));
+    memmove(&x, v->data, sizeof(x));
 
     return x;
 }
 
+template <typename T> T const_fml32_view::get_view(FLDID32 id, FLDOCC32 oc) const
+{
+    return fml32::view_value<T>(fbfr(), id, oc);
+}
+
+template <FLDID32 Id, typename T> T fml32::get(field<Id,T>, FLDOCC32 oc) const
+{
+    T x = T();
+    typed_get(Id, oc, x);
+    return x;
+}
+
+template <FLDID32 Id, typename T, typename U> void fml32::set(field<Id,T>, U const& x, FLDOCC32 oc)
+{
+    static_assert(storable<T, U>::value, "value cannot be stored in this field");
+    typed_set(Id, oc, value_as<T>(x));
+}
+
+template <FLDID32 Id, typename T, typename U> void fml32::add(field<Id,T>, U const& x)
+{
+    static_assert(storable<T, U>::value, "value cannot be stored in this field");
+    typed_add(Id, value_as<T>(x));
+}
+
 /*template<typename T> FLDOCC32 fml32::find_view(FLDID32 id, T const& x) const
 {
     using namespace std;
@@ -0,0 +1,86 @@
+/** @file fml32_builder.hpp
+@c fml32_builder class.
+@ingroup buffers */
+#pragma once
+#include <string>
+#include <vector>
+#include "fml32.h"
+#include "tux/fml32.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Builds an fml32 with a single allocation.
+Adding fields one at a time via fml32::add() grows the buffer on demand,
+and each growth [@c tprealloc] copies everything added so far.
+An fml32_builder instead collects field values in a local arena, sizes
+the buffer exactly [@c Fneeded32] once all values are known, allocates
+it once [@c tpalloc], populates it [@c Fappend32], and indexes it once
+[@c Findex32].
+
+Values are not converted: like fml32::append(), the value type must
+match the field type (strings may go to string or carray fields).
+Occurrences of the same field keep the order in which they were added.
+@code
+tux::fml32_builder b;
+for(auto const& row : rows)
+{
+    b.add(NAME, row.name).add(AGE, row.age);
+}
+tux::fml32 reply = b.finish();
+@endcode
+@ingroup buffers */
+class fml32_builder
+{
+public:
+    fml32_builder() = default; /**< Default construct (no allocation). */
+    /** Construct, reserving room for an expected number of fields and value bytes. */
+    fml32_builder(std::size_t field_count, std::size_t value_bytes);
+    fml32_builder(fml32_builder const& x) = default; /**< Copy construct. */
+    fml32_builder& operator=(fml32_builder const& x) = default; /**< Copy assign. */
+    fml32_builder(fml32_builder&& x) noexcept = default; /**< Move construct. */
+    fml32_builder& operator=(fml32_builder&& x) noexcept = default; /**< Move assign. */
+    ~fml32_builder() noexcept = default; /**< Destruct. */
+
+    fml32_builder& add(FLDID32 id, short x); /**< Add a short. */
+    fml32_builder& add(FLDID32 id, long x); /**< Add a long. */
+    fml32_builder& add(FLDID32 id, int x) { return add(id, static_cast<long>(x)); } /**< Add an int. */
+    fml32_builder& add(FLDID32 id, char x); /**< Add a char. */
+    fml32_builder& add(FLDID32 id, float x); /**< Add a float. */
+    fml32_builder& add(FLDID32 id, double x); /**< Add a double. */
+    fml32_builder& add(FLDID32 id, string_ref x); /**< Add a string or carray. */
+    fml32_builder& add(FLDID32 id, std::string const& x) { return add(id, string_ref(x)); } /**< Add a string or carray. */
+    fml32_builder& add(FLDID32 id, const char* x) { return add(id, string_ref(x)); } /**< Add a string or carray. */
+    fml32_builder& add(FLDID32 id, packed_mbstring const& x); /**< Add an mbstring. */
+    fml32_builder& add(FLDID32 id, fml32 const& x); /**< Add a nested fml32. */
+
+    /** Reserve local storage for an expected number of fields and value bytes. */
+    void reserve(std::size_t field_count, std::size_t value_bytes);
+    std::size_t field_count() const noexcept; /**< Returns the number of fields added so far. */
+    /** Returns the size of the buffer finish() will allocate [@c Fneeded32]. */
+    long bytes_needed() const;
+    void clear() noexcept; /**< Discards all fields added so far (keeps local storage). */
+
+    /** Allocates and populates the fml32 [@c tpalloc, @c Fappend32, @c Findex32],
+    then clears the builder. */
+    fml32 finish();
+
+private:
+    struct entry
+    {
+        FLDID32 id;
+        FLDLEN32 len;
+        std::size_t offset; // into arena_
+    };
+
+    static void check_field_type(FLDID32 id, int expected_type);
+    void push(FLDID32 id, const void* value, FLDLEN32 len, bool null_terminate = false);
+
+    std::vector<entry> entries_;
+    std::vector<char> arena_;
+    long value_bytes_ = 0;
+    bool sorted_ = true;
+};
+
+}
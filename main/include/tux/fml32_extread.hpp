@@ -0,0 +1,44 @@
+/** @file fml32_extread.hpp
+Parallel parsing of fml32 buffers in the @c Fprint32 / @c Fextread32 text format.
+@ingroup buffers */
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "tux/fml32.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Parses every buffer in a text dump, as repeated fml32::extread() calls would [@c Fextread32].
+Each buffer is a series of lines, ended by an empty line:
+@code
+[flag]name<tab>value
+@endcode
+With no flag, the value is added; @c + changes occurrence 0, @c - deletes
+occurrence 0, and @c = assigns occurrence 0 the value of the field named
+by the value.  Lines starting with @c # are comments.  In string, carray
+and char values, a backslash followed by two hex digits stands for that
+byte, and @c \\\\ for a backslash; other values are converted from text
+[@c CFadd32].  A nested fml32 field has an empty value, and its fields
+follow on lines indented by one more tab.
+
+The text is split on buffer boundaries into chunks parsed by up to
+@c threads threads (0 means one per hardware thread), each buffer in a
+single allocation sized from its text.  The result is in input order.
+Field names are resolved only through field_table (preloaded on first
+use), never Tuxedo's own lazily loaded tables [@c Fldid32, @c Fname32],
+so the workers don't touch them.  If no field table can be loaded, the
+text is parsed in the calling thread with Tuxedo's lookups instead.
+@throws std::runtime_error (naming the line) for malformed text, unknown
+field names, or ptr, mbstring or view32 fields, which this parser
+doesn't support
+@throws fml32::error for unknown field names when there is no field table
+@ingroup buffers */
+std::vector<fml32> extread_all(string_ref text, unsigned threads = 0);
+
+/** Reads the rest of @c input, then parses it with extread_all(string_ref, unsigned).
+@ingroup buffers */
+std::vector<fml32> extread_all(FILE* input, unsigned threads = 0);
+
+}
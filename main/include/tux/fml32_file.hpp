@@ -0,0 +1,141 @@
+/** @file fml32_file.hpp
+@c fml32_file_writer and @c fml32_file_reader classes: files of fml32 buffers.
+@ingroup buffers */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "tux/fml32.hpp"
+
+namespace tux
+{
+
+/** Writes fml32 buffers to a file, for fml32_file_reader.
+Each buffer is stored as its used bytes [@c Fused32], aligned to 8 bytes,
+and close() ends the file with an index of where each one starts.  Writes
+are batched in memory, so appending a buffer is usually just a copy.
+@code
+tux::fml32_file_writer capture("traffic.fml32");
+for(;;)
+{
+    capture.append(request); // e.g. from a service routine
+}
+capture.close();
+@endcode
+The file is in the writer's native byte order; fml32_file_reader rejects
+files from a machine with a different one.
+@sa fml32_file_reader
+@ingroup buffers */
+class fml32_file_writer
+{
+public:
+    /** Creates (or truncates) the file.
+    @param path file path
+    @param buffer_size bytes batched in memory between writes
+    @throws std::runtime_error if the file can't be created */
+    explicit fml32_file_writer(std::string const& path, std::size_t buffer_size = 1 << 20);
+    fml32_file_writer(fml32_file_writer const&) = delete; /**< Not copyable. */
+    fml32_file_writer& operator=(fml32_file_writer const&) = delete; /**< Not copyable. */
+    /** Destruct, calling close() if it hasn't been (errors are ignored; call
+    close() to see them). */
+    ~fml32_file_writer() noexcept;
+
+    /** Appends a buffer.  A null buffer is stored as an empty one.
+    @throws std::runtime_error if a write fails */
+    void append(const_fml32_view x);
+    /** Writes any batched buffers, then the index, and closes the file.
+    @throws std::runtime_error if a write fails */
+    void close();
+
+    std::size_t size() const noexcept; /**< Returns the number of buffers appended. */
+
+private:
+    void flush();
+    void write(const void* data, std::size_t size);
+
+    std::string path_;
+    FILE* file_ = nullptr;
+    std::vector<char> pending_;
+    std::size_t capacity_;
+    std::uint64_t offset_ = 0; // of the end of pending_ in the file
+    std::vector<std::uint64_t> index_; // offset and size of each buffer
+};
+
+/** Reads a file written by fml32_file_writer, by mapping it into memory.
+Buffers are handed out as const_fml32_view, directly over the mapped
+pages: there's no @c tpalloc, copy, or read call per buffer, so a scan
+runs at the speed the operating system can page the file in.
+@code
+tux::fml32_file_reader capture("traffic.fml32");
+tux::fml32::boolean_expression failed("STATUS != 0");
+std::size_t failures = 0;
+for(auto request : capture)
+{
+    failures += failed(request);
+}
+@endcode
+Views (and values read from them in place) are valid for the life of the
+reader.  Use const_fml32_view::copy() for an fml32 that outlives it.
+@sa fml32_file_writer
+@ingroup buffers */
+class fml32_file_reader
+{
+public:
+    /** Iterates over the buffers in a file, in order. */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category; /**< Iterator category. */
+        typedef const_fml32_view value_type; /**< Value type. */
+        typedef std::ptrdiff_t difference_type; /**< Difference type. */
+        typedef const_fml32_view const* pointer; /**< Pointer type. */
+        typedef const_fml32_view reference; /**< Reference type (views are returned by value). */
+
+        const_iterator() noexcept = default; /**< Default construct. */
+        reference operator*() const noexcept { return (*owner_)[i_]; } /**< Access the current buffer. */
+        const_iterator& operator++() noexcept { ++i_; return *this; } /**< Advance. */
+        const_iterator operator++(int) noexcept { const_iterator tmp(*this); ++i_; return tmp; } /**< Advance. */
+        bool operator==(const_iterator const& x) const noexcept { return i_ == x.i_; } /**< Equality. */
+        bool operator!=(const_iterator const& x) const noexcept { return i_ != x.i_; } /**< Inequality. */
+
+    private:
+        friend class fml32_file_reader;
+        const_iterator(fml32_file_reader const* owner, std::size_t i) noexcept : owner_(owner), i_(i) {}
+
+        fml32_file_reader const* owner_ = nullptr;
+        std::size_t i_ = 0;
+    };
+
+    /** Maps the file into memory, and checks its index, and that each
+    buffer's header fits in its entry [@c Fused32].
+    @throws std::runtime_error if the file can't be mapped, or isn't a
+    complete fml32_file_writer file */
+    explicit fml32_file_reader(std::string const& path);
+    fml32_file_reader(fml32_file_reader const&) = delete; /**< Not copyable. */
+    fml32_file_reader& operator=(fml32_file_reader const&) = delete; /**< Not copyable. */
+    ~fml32_file_reader() noexcept; /**< Destruct, unmapping the file. */
+
+    std::size_t size() const noexcept { return count_; } /**< Returns the number of buffers. */
+    /** Returns a view of buffer @c i.  Unchecked. */
+    const_fml32_view operator[](std::size_t i) const noexcept;
+    /** Returns a view of buffer @c i.
+    @throws std::out_of_range if there is no such buffer */
+    const_fml32_view at(std::size_t i) const;
+
+    const_iterator begin() const noexcept { return const_iterator(this, 0); } /**< Iterator to the first buffer. */
+    const_iterator end() const noexcept { return const_iterator(this, count_); } /**< Iterator past the last buffer. */
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    const std::uint64_t* index_ = nullptr;
+    std::size_t count_ = 0;
+#ifdef _WIN32
+    std::vector<char> contents_; // read rather than mapped
+#endif
+};
+
+}
@@ -0,0 +1,108 @@
+/** @file hash.hpp
+Fast 64 bit content hashes of buffers, e.g. for cache keys and deduplication.
+@ingroup buffers */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "tux/buffer.hpp"
+#include "tux/carray.hpp"
+#include "tux/cstring.hpp"
+#include "tux/fml32.hpp" //32 must come before 16
+#include "tux/fml16.hpp"
+#include "tux/record.hpp"
+#include "tux/util.hpp"
+#include "tux/view16.hpp"
+#include "tux/view32.hpp"
+
+namespace tux
+{
+
+/** Controls how field occurrences contribute to an fml hash.
+@sa hash(fml32 const&, std::uint64_t, hash_mode)
+@ingroup buffers */
+enum class hash_mode
+{
+    /** Every field occurrence, in buffer order.  FML keeps fields sorted by
+    id, so this only depends on the order in which occurrences of the same
+    field were added. */
+    exact,
+    /** The occurrences of each field are treated as an unordered collection,
+    so buffers holding the same values in a different occurrence order hash
+    the same.  Slower than hash_mode::exact. */
+    canonical
+};
+
+/** Hashes bytes [XXH64].
+Non-cryptographic: fast and well distributed, but don't use it where an
+adversary could choose colliding inputs.  The result depends only on the
+bytes and the seed, and is the same on every platform.
+@ingroup buffers */
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept;
+
+/** Hashes a string's bytes. @ingroup buffers */
+inline std::uint64_t hash(string_ref x, std::uint64_t seed = 0) noexcept
+{
+    return hash_bytes(x.data(), x.size(), seed);
+}
+
+/** Hashes the used portion (@ref buffer::payload_size(), so the data_size()
+needn't have been set) of a buffer, byte for byte.
+Suits any buffer type whose bytes are its value, e.g. @c STRING, @c XML, or
+@c MBSTRING buffers.  A null buffer hashes like an empty one.
+@ingroup buffers */
+std::uint64_t hash(buffer const& x, std::uint64_t seed = 0) noexcept;
+
+/** Hashes a cstring's characters, excluding the terminator. @ingroup buffers */
+std::uint64_t hash(cstring const& x, std::uint64_t seed = 0) noexcept;
+
+/** Hashes a carray's bytes. @ingroup buffers */
+std::uint64_t hash(carray const& x, std::uint64_t seed = 0) noexcept;
+
+/** Hashes an fml32's content.
+Each occurrence contributes its field id and value, by meaning rather than
+memory layout, so the hash is the same on every platform: numbers as
+fixed width little endian integers (whatever the size of @c long), nested
+@c FLD_FML32 values by content (recursively), and @c FLD_VIEW32 values by
+view name and members [@c Fvstof32], padding aside.  So buffers that
+compare equal with @c == hash the same regardless of capacity or internal
+slack.  Each occurrence is visited with one @c Fnext32 call.  This is a much stronger hash than fml32::checksum() [@c Fchksum32],
+and doesn't require a non-null buffer: a null fml32 hashes like an empty one.
+@param x the buffer
+@param seed varies the hash, e.g. per cache or to separate key spaces
+@param mode whether the occurrence order of each field matters
+@throws std::runtime_error for @c FLD_PTR fields (whose value is an
+address) and decimal fields
+@ingroup buffers */
+std::uint64_t hash(fml32 const& x, std::uint64_t seed = 0, hash_mode mode = hash_mode::exact);
+
+/** Hashes an fml16's content, like hash(fml32 const&, std::uint64_t, hash_mode).
+@ingroup buffers */
+std::uint64_t hash(fml16 const& x, std::uint64_t seed = 0, hash_mode mode = hash_mode::exact);
+
+#if TUXEDO_VERSION >= 1222
+/** Hashes a record's raw data [@c Rget]. @ingroup buffers */
+std::uint64_t hash(record const& x, std::uint64_t seed = 0);
+#endif
+
+/** Hashes a view32's structure, byte for byte.
+Padding bytes between members are included.  They are zero in views
+initialized by view32 (or @c Fvsinit32, or converted from FML), but may
+not be in structures filled in some other way.  The struct's layout (and
+so the hash) is the platform's; hash an fml32 holding the view for a hash
+that's the same everywhere.
+@ingroup buffers */
+template <typename T>
+std::uint64_t hash(view32<T> const& x, std::uint64_t seed = 0) noexcept
+{
+    return x ? hash_bytes(x.buffer().data(), sizeof(T), seed) : hash_bytes(nullptr, 0, seed);
+}
+
+/** Hashes a view16's structure, byte for byte, like hash(view32<T> const&, std::uint64_t).
+@ingroup buffers */
+template <typename T>
+std::uint64_t hash(view16<T> const& x, std::uint64_t seed = 0) noexcept
+{
+    return x ? hash_bytes(x.buffer().data(), sizeof(T), seed) : hash_bytes(nullptr, 0, seed);
+}
+
+}
@@ -0,0 +1,62 @@
+/** @file json.hpp
+Conversion between fml32 and JSON text.
+@ingroup buffers */
+#pragma once
+#include <string>
+#include "tux/fml32.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Converts an fml32 to JSON, appending to @c out.
+The buffer becomes an object with a member per field, named after the
+field [@c Fname32, or field_table], whose value is an array of the
+field's occurrences:
+@arg short and long values are integers, float and double values are numbers
+(always with a '.' decimal point, whatever the C locale)
+@arg char values are one character strings (a byte above 0x7f is written as
+the Latin-1 character, @c \\u0080 to @c \\u00ff, so the text stays UTF-8)
+@arg string values are strings (their bytes are copied, so they should be UTF-8)
+@arg carray values are base64 encoded strings
+@arg nested fml32 values are objects, converted the same way
+@arg view32 values are objects, with the view name in an @c "@view" member,
+then the view's members that map to fml32 fields [@c Fvstof32]
+
+@c out isn't cleared, so a caller can reuse (or build around) a single string.
+This is a single pass over the buffer (fml32::const_iterator, one Fnext32
+per value), with none of the intermediate
+documents the xml route [@c tpfml32toxml] involves.
+@code
+std::string reply;
+tux::to_json(person, reply); // {"AGE":[32],"NAME":["John Doe"]}
+@endcode
+@throws std::runtime_error for ptr and mbstring fields, and non-finite
+float or double values, which have no JSON representation
+@sa to_fml32(string_ref)
+@ingroup buffers */
+void to_json(fml32 const& x, std::string& out);
+
+/** Converts an fml32 to JSON.  @sa to_json(fml32 const&, std::string&) @ingroup buffers */
+std::string to_json(fml32 const& x);
+
+/** Converts JSON, as produced by to_json(), to an fml32.
+Field names are looked up with fml32::field_id(), and values are
+converted to the field's type; an occurrence array may be replaced by a
+single value.  Unpaired surrogate escapes are rejected, as is @c \\u0000
+anywhere but in a char value (it would cut a string field short).  The text is parsed in one pass, directly into the result
+(no document tree), skipping quickly over runs of ordinary string
+characters.
+@throws std::runtime_error if the text isn't valid JSON, or a value doesn't
+suit its field
+@throws fml32::error if a field name is unknown
+@ingroup buffers */
+fml32 to_fml32(string_ref json);
+
+/** Converts JSON to an fml32.  @sa to_fml32(string_ref) @ingroup buffers */
+inline fml32 to_fml32(std::string const& json) { return to_fml32(string_ref(json)); }
+
+/** Converts JSON to an fml32.  @sa to_fml32(string_ref) @ingroup buffers */
+inline fml32 to_fml32(const char* json) { return to_fml32(string_ref(json)); }
+
+}
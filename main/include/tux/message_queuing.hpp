@@ -25,7 +25,8 @@ a corresponding reply
 which other members should be inspected. For instance, if we
 want the @c replyqueue and @c corrid fields to be used, we'd need to
 set the @c TPQCORRID and @c TPQREPLYQ flags.
-@param input optional data to send
+@param input optional data to send; buffer::payload_size() bytes are
+sent, so a CARRAY whose data_size() is 0 enqueues an empty message
 @param flags additional flags (beyond those in @c ctl) that control
 the enqueue operation
 @sa dequeue(), dequeue_nonblocking()
@@ -36,6 +37,26 @@ void enqueue(std::string const& queue_space,
              buffer const& input = buffer(),
              long flags = TPNOFLAGS);
 
+/** Enqueue a message, optionally shrinking the buffer first [@c tprealloc, @c tpenqueue].
+Only buffer::payload_size() bytes are sent either way, but shrinking
+keeps slack capacity out of persistent storage for buffer types
+whose length Tuxedo derives from the buffer itself.
+@param queue_space the name of the queue space
+@param queue_name the name of the queue
+@param ctl a struct controlling the enqueue operation
+@param input data to send
+@param flags additional flags (beyond those in @c ctl) that control
+the enqueue operation
+@param shrink_to_fit if true, call buffer::shrink_to_fit() on input prior to enqueuing
+@sa enqueue(std::string const&, std::string const&, TPQCTL&, buffer const&, long)
+@ingroup comm */
+void enqueue(std::string const& queue_space,
+             std::string const& queue_name,
+             TPQCTL& ctl,
+             buffer& input,
+             long flags,
+             bool shrink_to_fit);
+
 /** Dequeue a message if one is available [@c tpdequeue].
 @param queue_space the name of the queue space
 @param queue_name the name of the queue
@@ -0,0 +1,274 @@
+/** @file predicate.hpp
+Compile-time predicates over typed fml32 fields.
+@ingroup buffers */
+#pragma once
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "fml32.h"
+#include "tux/fml32.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Base of all predicate expression nodes (CRTP).
+Nodes are built by comparing typed field descriptors (fml32::field) with
+values, and combined with @c &&, @c ||, and @c !.
+@sa where() */
+template <typename D>
+struct predicate_expression
+{
+    D const& derived() const noexcept { return static_cast<D const&>(*this); } /**< Access the concrete node. */
+};
+
+/** Refers to a field operand of a predicate: occurrence @c oc, or any
+occurrence when @c any is set (@c FIELD[?] in an @c Fboolco32 expression).
+@sa at(), any() */
+template <FLDID32 Id, typename T>
+struct field_operand
+{
+    FLDOCC32 oc; /**< Occurrence to test. */
+    bool any; /**< Test every occurrence, true if any matches. */
+};
+
+/** Refers to occurrence @c oc of a field (@c FIELD[oc]). */
+template <FLDID32 Id, typename T>
+constexpr field_operand<Id, T> at(fml32::field<Id, T>, FLDOCC32 oc) noexcept
+{
+    return field_operand<Id, T>{oc, false};
+}
+
+/** Refers to any occurrence of a field (@c FIELD[?]). */
+template <FLDID32 Id, typename T>
+constexpr field_operand<Id, T> any(fml32::field<Id, T>) noexcept
+{
+    return field_operand<Id, T>{0, true};
+}
+
+namespace predicates
+{
+    struct equal { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a == b; } };
+    struct not_equal { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a != b; } };
+    struct less { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a < b; } };
+    struct less_equal { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a <= b; } };
+    struct greater { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a > b; } };
+    struct greater_equal { template <typename A, typename B> static bool apply(A const& a, B const& b) { return a >= b; } };
+
+    // calls match(value, len) on the selected occurrence(s) until it returns true
+    template <FLDID32 Id, typename T, typename M>
+    bool match_occurrences(fml32 const& f, field_operand<Id, T> field, M match)
+    {
+        FBFR32* fbfr = const_cast<FBFR32*>(f.as_fbfr());
+        if(!fbfr)
+        {
+            return false;
+        }
+        for(FLDOCC32 oc = field.oc; ; ++oc)
+        {
+            FLDLEN32 len = 0;
+            const char* value = Ffind32(fbfr, Id, oc, &len);
+            if(!value)
+            {
+                return false; // not present
+            }
+            if(match(value, len))
+            {
+                return true;
+            }
+            if(!field.any)
+            {
+                return false;
+            }
+        }
+    }
+
+    // string and carray values are compared like strcmp
+    template <typename Op, FLDID32 Id, typename T>
+    bool compare_value(std::true_type, const char* value, FLDLEN32 len, std::string const& constant)
+    {
+        bool terminated = static_cast<int>(Id >> 25) == FLD_STRING;
+        string_ref x(value, terminated && len > 0 ? len - 1 : len);
+        return Op::apply(x.compare(constant), 0);
+    }
+
+    template <typename Op, FLDID32 Id, typename T, typename V>
+    bool compare_value(std::false_type, const char* value, FLDLEN32, V const& constant)
+    {
+        T x;
+        std::memcpy(&x, value, sizeof(x)); // values aren't guaranteed to be aligned
+        return Op::apply(x, constant);
+    }
+
+    template <typename T, typename U> struct constant_type
+    {
+        static_assert(std::is_arithmetic<U>::value, "numeric fields must be compared with numbers");
+        typedef U type;
+    };
+    template <typename U> struct constant_type<std::string, U>
+    {
+        static_assert(std::is_convertible<U const&, std::string>::value, "string fields must be compared with strings");
+        typedef std::string type;
+    };
+}
+
+/** Compares a field with a constant. */
+template <FLDID32 Id, typename T, typename Op, typename V>
+struct field_comparison : predicate_expression<field_comparison<Id, T, Op, V>>
+{
+    field_operand<Id, T> field; /**< The field. */
+    V constant; /**< The value to compare against. */
+
+    field_comparison(field_operand<Id, T> f, V c) : field(f), constant(std::move(c)) {} /**< Construct. */
+
+    /** Evaluates against x [@c Ffind32]; false if the field isn't present. */
+    bool evaluate(fml32 const& x) const
+    {
+        V const& c = constant;
+        return predicates::match_occurrences(x, field, [&c](const char* value, FLDLEN32 len)
+        {
+            return predicates::compare_value<Op, Id, T>(std::is_same<T, std::string>(), value, len, c);
+        });
+    }
+};
+
+/** Tests for the presence of a field. @sa has() */
+template <FLDID32 Id, typename T>
+struct field_presence : predicate_expression<field_presence<Id, T>>
+{
+    field_operand<Id, T> field; /**< The field. */
+
+    explicit field_presence(field_operand<Id, T> f) : field(f) {} /**< Construct. */
+    /** Evaluates against x [@c Ffind32]. */
+    bool evaluate(fml32 const& x) const
+    {
+        return predicates::match_occurrences(x, field, [](const char*, FLDLEN32) { return true; });
+    }
+};
+
+/** Logical and (short-circuit). */
+template <typename L, typename R>
+struct and_expression : predicate_expression<and_expression<L, R>>
+{
+    L left; /**< Left operand. */
+    R right; /**< Right operand. */
+    and_expression(L l, R r) : left(std::move(l)), right(std::move(r)) {} /**< Construct. */
+    bool evaluate(fml32 const& x) const { return left.evaluate(x) && right.evaluate(x); } /**< Evaluates against x. */
+};
+
+/** Logical or (short-circuit). */
+template <typename L, typename R>
+struct or_expression : predicate_expression<or_expression<L, R>>
+{
+    L left; /**< Left operand. */
+    R right; /**< Right operand. */
+    or_expression(L l, R r) : left(std::move(l)), right(std::move(r)) {} /**< Construct. */
+    bool evaluate(fml32 const& x) const { return left.evaluate(x) || right.evaluate(x); } /**< Evaluates against x. */
+};
+
+/** Logical negation. */
+template <typename E>
+struct not_expression : predicate_expression<not_expression<E>>
+{
+    E operand; /**< The negated expression. */
+    explicit not_expression(E e) : operand(std::move(e)) {} /**< Construct. */
+    bool evaluate(fml32 const& x) const { return !operand.evaluate(x); } /**< Evaluates against x. */
+};
+
+/** A compiled predicate over fml32, built by where().
+Evaluation reads field values in place with their C++ types known at
+compile time; there is no expression string to parse, and no tree to
+interpret [@c Fboolev32].  Semantics follow @c Fboolco32 expressions:
+a comparison with a field that isn't present is false, @c FIELD means
+occurrence 0, at(FIELD, n) means @c FIELD[n], and any(FIELD) means
+@c FIELD[?].
+@code
+using namespace field32; // generated by fmlhpp32 -t
+auto adult_in_ny = tux::where(AGE >= 18 && STATE == "NY");
+if(adult_in_ny(person))
+{
+    // ...
+}
+// equivalent to tux::fml32::boolean_expression("AGE >= 18 && STATE == 'NY'")
+@endcode
+@note comparing a typed field descriptor with a value (field on the left)
+builds a predicate node, rather than comparing field ids.
+@ingroup buffers */
+template <typename E>
+class predicate
+{
+public:
+    explicit predicate(E e) : expression_(std::move(e)) {} /**< Construct from an expression. */
+    bool evaluate(fml32 const& x) const { return expression_.evaluate(x); } /**< Evaluates the predicate on an fml32. */
+    bool operator()(fml32 const& x) const { return expression_.evaluate(x); } /**< Evaluates the predicate on an fml32. */
+
+private:
+    E expression_;
+};
+
+/** Builds a predicate from an expression.  @relates predicate */
+template <typename E>
+predicate<E> where(predicate_expression<E> const& e)
+{
+    return predicate<E>(e.derived());
+}
+
+/** Tests for the presence of occurrence 0 of a field (@c FIELD). @relates predicate */
+template <FLDID32 Id, typename T>
+field_presence<Id, T> has(fml32::field<Id, T>)
+{
+    return field_presence<Id, T>(field_operand<Id, T>{0, false});
+}
+
+/** Tests for the presence of a field occurrence. @relates predicate */
+template <FLDID32 Id, typename T>
+field_presence<Id, T> has(field_operand<Id, T> f)
+{
+    return field_presence<Id, T>(f);
+}
+
+#define TUXPP_PREDICATE_COMPARISON(OP, NAME) \
+template <FLDID32 Id, typename T, typename U> \
+field_comparison<Id, T, predicates::NAME, typename predicates::constant_type<T, U>::type> \
+operator OP(field_operand<Id, T> f, U const& c) \
+{ \
+    return field_comparison<Id, T, predicates::NAME, typename predicates::constant_type<T, U>::type>(f, c); \
+} \
+template <FLDID32 Id, typename T, typename U> \
+field_comparison<Id, T, predicates::NAME, typename predicates::constant_type<T, U>::type> \
+operator OP(fml32::field<Id, T>, U const& c) \
+{ \
+    return field_comparison<Id, T, predicates::NAME, typename predicates::constant_type<T, U>::type>(field_operand<Id, T>{0, false}, c); \
+}
+
+TUXPP_PREDICATE_COMPARISON(==, equal)
+TUXPP_PREDICATE_COMPARISON(!=, not_equal)
+TUXPP_PREDICATE_COMPARISON(<, less)
+TUXPP_PREDICATE_COMPARISON(<=, less_equal)
+TUXPP_PREDICATE_COMPARISON(>, greater)
+TUXPP_PREDICATE_COMPARISON(>=, greater_equal)
+
+#undef TUXPP_PREDICATE_COMPARISON
+
+/** Logical and. @relates predicate */
+template <typename L, typename R>
+and_expression<L, R> operator&&(predicate_expression<L> const& l, predicate_expression<R> const& r)
+{
+    return and_expression<L, R>(l.derived(), r.derived());
+}
+
+/** Logical or. @relates predicate */
+template <typename L, typename R>
+or_expression<L, R> operator||(predicate_expression<L> const& l, predicate_expression<R> const& r)
+{
+    return or_expression<L, R>(l.derived(), r.derived());
+}
+
+/** Logical negation. @relates predicate */
+template <typename E>
+not_expression<E> operator!(predicate_expression<E> const& e)
+{
+    return not_expression<E>(e.derived());
+}
+
+}
@@ -120,6 +120,82 @@ int compare(const char* a, long alen, const char* b, long blen);
 /** Converts char* to std::string (null-safe) @ingroup utils */
 std::string cstr_to_string(const char* ptr);
 
+/** Non-owning, read-only reference to a run of characters.
+A minimal stand-in for std::string_view (c++17) which lets callers
+look at character data in place (e.g. a field value inside an fml32
+buffer) without copying it into a std::string.  The referenced
+characters are not necessarily null-terminated.
+@note The referenced data must outlive the string_ref.
+@sa fml32::get_string_view() @ingroup utils */
+class string_ref
+{
+public:
+    typedef const char* const_iterator; /**< Iterator type. */
+    typedef const_iterator iterator; /**< Iterator type. */
+    static const std::size_t npos = static_cast<std::size_t>(-1); /**< "Not found" / "until the end". */
+
+    constexpr string_ref() noexcept = default; /**< Default construct (empty). */
+    constexpr string_ref(const char* data, std::size_t size) noexcept : data_(data), size_(size) {} /**< Construct from pointer and size. */
+    string_ref(const char* s) noexcept : data_(s), size_(s ? std::strlen(s) : 0) {} /**< Construct from a null-terminated string (null-safe). */
+    string_ref(std::string const& s) noexcept : data_(s.data()), size_(s.size()) {} /**< Construct from a std::string. */
+
+    constexpr const char* data() const noexcept { return data_; } /**< Access the characters. */
+    constexpr std::size_t size() const noexcept { return size_; } /**< Returns the number of characters. */
+    constexpr std::size_t length() const noexcept { return size_; } /**< Returns the number of characters. */
+    constexpr bool empty() const noexcept { return size_ == 0; } /**< Test for zero length. */
+    constexpr const_iterator begin() const noexcept { return data_; } /**< Iterator to first character. */
+    constexpr const_iterator end() const noexcept { return data_ + size_; } /**< Iterator past last character. */
+    constexpr char operator[](std::size_t i) const noexcept { return data_[i]; } /**< Unchecked access. */
+
+    std::string str() const { return size_ ? std::string(data_, size_) : std::string(); } /**< Copies into a std::string. */
+    explicit operator std::string() const { return str(); } /**< Copies into a std::string. */
+
+    /** Returns a string_ref to a portion of this one.
+    @throws std::out_of_range if pos > size() */
+    string_ref substr(std::size_t pos, std::size_t n = npos) const
+    {
+        if(pos > size_)
+        {
+            throw std::out_of_range("string_ref::substr");
+        }
+        return string_ref(data_ + pos, n < size_ - pos ? n : size_ - pos);
+    }
+
+    /** Returns position of the first c at or after pos, or npos. */
+    std::size_t find(char c, std::size_t pos = 0) const noexcept
+    {
+        if(pos >= size_)
+        {
+            return npos;
+        }
+        auto p = static_cast<const char*>(std::memchr(data_ + pos, c, size_ - pos));
+        return p ? static_cast<std::size_t>(p - data_) : npos;
+    }
+
+    /** Lexicographic comparison (like std::string::compare). */
+    int compare(string_ref x) const noexcept
+    {
+        std::size_t n = size_ < x.size_ ? size_ : x.size_;
+        int rc = n ? std::memcmp(data_, x.data_, n) : 0;
+        return rc ? rc : (size_ < x.size_ ? -1 : (size_ > x.size_ ? 1 : 0));
+    }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/** Equality (compares characters, not pointers). @ingroup utils */
+inline bool operator==(string_ref a, string_ref b) noexcept
+{
+    return a.size() == b.size() && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+inline bool operator!=(string_ref a, string_ref b) noexcept { return !(a == b); } /**< Inequality. @ingroup utils */
+inline bool operator<(string_ref a, string_ref b) noexcept { return a.compare(b) < 0; } /**< Less than. @ingroup utils */
+inline bool operator>(string_ref a, string_ref b) noexcept { return a.compare(b) > 0; } /**< Greater than. @ingroup utils */
+inline bool operator<=(string_ref a, string_ref b) noexcept { return a.compare(b) <= 0; } /**< Less than or equal. @ingroup utils */
+inline bool operator>=(string_ref a, string_ref b) noexcept { return a.compare(b) >= 0; } /**< Greater than or equal. @ingroup utils */
+
 //--------------------------------STRUCTS------------------------------
 /** Zero-initializes bytes in struct.
 Useful for "default" initializing various structs used in ATMI functions (e.g. @c TPQCTL).
@@ -154,6 +230,14 @@ Used to read embedded size in compiled boolean/arithmetic expressions on
 views and fml buffers. @ingroup utils */
 uint16_t make_16bit_unsigned(uint8_t least_significant_byte, uint8_t most_significant_byte);
 
+/** Appends the (padded) base64 encoding of @c x to @c out. @ingroup utils */
+void base64_encode(string_ref x, std::string& out);
+
+/** Decodes (padded) base64 into @c out, replacing its contents.
+@returns false if @c x isn't valid base64
+@ingroup utils */
+bool base64_decode(string_ref x, std::string& out);
+
 
 //----------------------------------LOGGING-----------------------------------------------
 /** Writes a message to the application log [@c userlog] @ingroup utils */
@@ -2,11 +2,15 @@
 @c view16 class and related functions.
 @ingroup buffers*/
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <utility>
 #include <memory>
 #include "atmi.h"
 #include "tux/buffer.hpp"
+#include "tux/expression_cache.hpp"
 #include "tux/util.hpp"
 #include "tux/fml16.hpp" 
 
@@ -30,6 +34,62 @@ inline long view_size16(std::string const& view_name)
     return view_size16(view_name.c_str());
 }
 
+/** Counts calls to refresh_view16_definitions(); cached view sizes and
+compiled view expressions are looked up and compiled again once it changes. */
+inline std::atomic<unsigned long>& view16_definitions_epoch() noexcept
+{
+    static std::atomic<unsigned long> epoch(0);
+    return epoch;
+}
+
+namespace view_detail
+{
+    /** The expression_cache domain for expressions on a view, which names the
+    definitions epoch: trees compiled before refresh_view16_definitions()
+    are never found again, and age out of the cache. */
+    inline std::string expression_domain16(const char* view_name)
+    {
+        return std::string("VIEW16 ") + view_name + " " + std::to_string(view16_definitions_epoch().load(std::memory_order_acquire));
+    }
+
+    /** Packs a view size with the epoch it was looked up in (plus one, so
+    zero means not looked up), for publishing both in one atomic store.
+    32 bits each: views are much smaller than 4GB, and epochs are only
+    compared for equality. */
+    inline std::uint64_t pack_view_size16(unsigned long epoch, long size) noexcept
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(epoch + 1)) << 32 | static_cast<std::uint32_t>(size);
+    }
+
+    /** The packed size cached for struct @c T by view_size16<T>(). */
+    template <typename T>
+    std::atomic<std::uint64_t>& view_size16_cache() noexcept
+    {
+        static std::atomic<std::uint64_t> cache(0);
+        return cache;
+    }
+}
+
+/** Returns the size of the view for struct @c T [@c Fvneeded].
+The view is looked up by name once, and again only after
+refresh_view16_definitions(), rather than on every allocation.
+@ingroup buffers*/
+template <typename T>
+long view_size16()
+{
+    // a size and its epoch are stored together, so a lookup which raced a
+    // refresh is tagged with the old epoch and never outlives it
+    unsigned long epoch = view16_definitions_epoch().load(std::memory_order_acquire);
+    auto& cache = view_detail::view_size16_cache<T>();
+    std::uint64_t cached = cache.load(std::memory_order_acquire);
+    if(cached >> 32 != static_cast<std::uint32_t>(epoch + 1))
+    {
+        cached = view_detail::pack_view_size16(epoch, view_size16(type_name<T>::value()));
+        cache.store(cached, std::memory_order_release);
+    }
+    return static_cast<long>(cached & 0xFFFFFFFF);
+}
+
 /** Mapping options between views(structs) and fml buffers.
 @sa view16::set_mapping_option(). */
 enum class view16_mapping_option : int { none = F_OFF, /**< No fml to struct mapping support. */
@@ -38,8 +98,9 @@ enum class view16_mapping_option : int { none = F_OFF, /**< No fml to struct map
                                         both = F_BOTH /**< Support both. */
                                         }; 
                                         
-/** Refreshes view definitions */
-inline void refresh_view16_definitions() noexcept { Fvrefresh(); }
+/** Refreshes view definitions [@c Fvrefresh].  Sizes cached by view_size16<T>(),
+and expressions compiled for views, are looked up and compiled again. */
+inline void refresh_view16_definitions() noexcept { Fvrefresh(); ++view16_definitions_epoch(); }
                                      
 /** Models a "VIEW" typed buffer (C struct).
 This template class acts a bit like a smart
@@ -145,8 +206,8 @@ public:
     {
     public:
         boolean_expression() noexcept = default; /**< Default construct (no allocation). */
-        boolean_expression(boolean_expression const&); /**< Copy construct. */
-        boolean_expression& operator=(boolean_expression const&); /**< Copy assign. */
+        boolean_expression(boolean_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        boolean_expression& operator=(boolean_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         boolean_expression(boolean_expression&&) noexcept = default; /**< Move construct. */
         boolean_expression& operator=(boolean_expression&&) noexcept = default; /**< Move assign. */
         ~boolean_expression() noexcept = default; /**< Destruct. */
@@ -164,8 +225,7 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
     /** Models an arithmetic expression (string) that can be compiled
@@ -192,8 +252,8 @@ public:
     {
     public:
         arithmetic_expression() noexcept = default; /**< Default construct (no allocation). */
-        arithmetic_expression(arithmetic_expression const&); /**< Copy construct. */
-        arithmetic_expression& operator=(arithmetic_expression const&); /**< Copy assign. */
+        arithmetic_expression(arithmetic_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        arithmetic_expression& operator=(arithmetic_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         arithmetic_expression(arithmetic_expression&&) noexcept = default; /**< Move construct. */
         arithmetic_expression& operator=(arithmetic_expression&&) noexcept = default; /**< Move assign. */
         ~arithmetic_expression() noexcept = default; /**< Destruct. */
@@ -211,8 +271,7 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
 private:
@@ -271,7 +330,7 @@ view16<T>& view16<T>::operator=(view16<T> const& x)
 template<typename T>
 view16<T>::view16(class buffer&& x)
 {
-    if(x && (x.type() != "VIEW" || x.subtype() != type_name<T>::value()))
+    if(x && (x.type_code() != buffer_type::view || std::strcmp(x.subtype_c_str(), type_name<T>::value()) != 0))
     {
         throw std::runtime_error(x.type() + "." + x.subtype() +
                                  " buffer cannot be cast to VIEW." +
@@ -283,7 +342,7 @@ view16<T>::view16(class buffer&& x)
 template<typename T>
 view16<T>& view16<T>::operator=(class buffer&& x)
 {
-    if(x && (x.type() != "VIEW" || x.subtype() != type_name<T>::value()))
+    if(x && (x.type_code() != buffer_type::view || std::strcmp(x.subtype_c_str(), type_name<T>::value()) != 0))
     {
         throw std::runtime_error(x.type() + "." + x.subtype() +
                                  " buffer cannot be cast to VIEW." +
@@ -369,7 +428,7 @@ void view16<T>::alloc()
         const char* view_name = type_name<T>::value();
         buffer_.alloc("VIEW",
                       const_cast<char*>(view_name),
-                      view_size16(view_name));
+                      view_size16<T>());
         buffer_.data_size(sizeof(T));
         clear();
     }
@@ -421,30 +480,6 @@ bool view16<T>::is_null(std::string const& field_name, FLDOCC oc)
 
 
 
-template<typename T>
-view16<T>::boolean_expression::boolean_expression(view16<T>::boolean_expression const& x)
-{
-    if(x.tree_)
-    {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
-        {
-            throw std::bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
-    }
-}
-
-
-template<typename T>
-typename view16<T>::boolean_expression& view16<T>::boolean_expression::operator=(view16<T>::boolean_expression const& x)
-{
-    view16<T>::boolean_expression tmp(x);
-    *this = move(tmp);
-    return *this;
-}
-
 template<typename T>
 view16<T>::boolean_expression::boolean_expression(std::string const& x)
 {
@@ -463,7 +498,7 @@ void view16<T>::boolean_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        int rc = Fvboolpr(tree_.get(), f, const_cast<char*>(type_name<T>::value()));
+        int rc = Fvboolpr(const_cast<char*>(tree_.get()), f, const_cast<char*>(type_name<T>::value()));
         if(rc == -1)
         {
             throw fml16::last_error("Fvboolpr");
@@ -476,7 +511,7 @@ bool view16<T>::boolean_expression::evaluate(T const& x) const
 {
 
     int result = Fvboolev(reinterpret_cast<char*>(const_cast<T*>(&x)),
-                            tree_.get(),
+                            const_cast<char*>(tree_.get()),
                             const_cast<char*>(type_name<T>::value()));
     if(result == -1)
     {
@@ -500,46 +535,16 @@ void view16<T>::boolean_expression::free() noexcept
 template<typename T>
 void view16<T>::boolean_expression::compile(std::string const& x)
 {
-    tree_.reset(Fvboolco(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value())));
-    if(!tree_)
+    tree_ = expression_cache::global().get(view_detail::expression_domain16(type_name<T>::value()), x, [&x]
     {
-        throw fml16::last_error("Fvboolco");
-    }
-}
-
-template<typename T>
-unsigned view16<T>::boolean_expression::size() const
-{
+        return Fvboolco(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value()));
+    });
     if(!tree_)
     {
-        return 0;
-    }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
-}
-
-template<typename T>
-view16<T>::arithmetic_expression::arithmetic_expression(view16<T>::arithmetic_expression const& x)
-{
-    if(x.tree_)
-    {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
-        {
-            throw std::bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
+        throw fml16::last_error("Fvboolco");
     }
 }
 
-template<typename T>
-typename view16<T>::arithmetic_expression& view16<T>::arithmetic_expression::operator=(view16<T>::arithmetic_expression const& x)
-{
-    view16<T>::arithmetic_expression tmp(x);
-    *this = move(tmp);
-    return *this;
-}
-
 template<typename T>
 view16<T>::arithmetic_expression::arithmetic_expression(std::string const& x)
 {
@@ -558,7 +563,7 @@ void view16<T>::arithmetic_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        int rc = Fvboolpr(tree_.get(), f, const_cast<char*>(type_name<T>::value()));
+        int rc = Fvboolpr(const_cast<char*>(tree_.get()), f, const_cast<char*>(type_name<T>::value()));
         if(rc == -1)
         {
             throw fml16::last_error("Fvboolpr");
@@ -569,7 +574,7 @@ void view16<T>::arithmetic_expression::print(FILE* f) const noexcept
 template<typename T>
 double view16<T>::arithmetic_expression::evaluate(T const& x) const
 {
-    double result = Fvfloatev(reinterpret_cast<char*>(const_cast<T*>(&x)), tree_.get(), const_cast<char*>(type_name<T>::value()));
+    double result = Fvfloatev(reinterpret_cast<char*>(const_cast<T*>(&x)), const_cast<char*>(tree_.get()), const_cast<char*>(type_name<T>::value()));
     if(result == -1)
     {
         throw fml16::last_error("Fvfloatev");
@@ -592,25 +597,16 @@ void view16<T>::arithmetic_expression::free() noexcept
 template<typename T>
 void view16<T>::arithmetic_expression::compile(std::string const& x)
 {
-    tree_.reset(Fvboolco(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value())));
-    if(!tree_)
+    tree_ = expression_cache::global().get(view_detail::expression_domain16(type_name<T>::value()), x, [&x]
     {
-        throw fml16::last_error("Fvboolco");
-    }
-}
-
-template<typename T>
-unsigned view16<T>::arithmetic_expression::size() const
-{
+        return Fvboolco(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value()));
+    });
     if(!tree_)
     {
-        return 0;
+        throw fml16::last_error("Fvboolco");
     }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
 }
 
-
-
 template <typename T>
 bool operator==(view16<T> const& a, view16<T> const& b)
 {
@@ -2,13 +2,20 @@
 @c view32 class and related functions.
 @ingroup buffers*/
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <string>
+#include <vector>
 #include <utility>
 #include <memory>
 #include "atmi.h"
 #include "tux/buffer.hpp"
+#include "tux/expression_cache.hpp"
 #include "tux/util.hpp"
 #include "tux/fml32.hpp"
+#include "tux/view_traits.hpp"
 
 
 namespace tux
@@ -32,6 +39,62 @@ inline long view_size32(std::string const& view_name)
     return view_size32(view_name.c_str());
 }
 
+/** Counts calls to refresh_view32_definitions(); cached view sizes and
+compiled view expressions are looked up and compiled again once it changes. */
+inline std::atomic<unsigned long>& view32_definitions_epoch() noexcept
+{
+    static std::atomic<unsigned long> epoch(0);
+    return epoch;
+}
+
+namespace view_detail
+{
+    /** The expression_cache domain for expressions on a view, which names the
+    definitions epoch: trees compiled before refresh_view32_definitions()
+    are never found again, and age out of the cache. */
+    inline std::string expression_domain32(const char* view_name)
+    {
+        return std::string("VIEW32 ") + view_name + " " + std::to_string(view32_definitions_epoch().load(std::memory_order_acquire));
+    }
+
+    /** Packs a view size with the epoch it was looked up in (plus one, so
+    zero means not looked up), for publishing both in one atomic store.
+    32 bits each: views are much smaller than 4GB, and epochs are only
+    compared for equality. */
+    inline std::uint64_t pack_view_size32(unsigned long epoch, long size) noexcept
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(epoch + 1)) << 32 | static_cast<std::uint32_t>(size);
+    }
+
+    /** The packed size cached for struct @c T by view_size32<T>(). */
+    template <typename T>
+    std::atomic<std::uint64_t>& view_size32_cache() noexcept
+    {
+        static std::atomic<std::uint64_t> cache(0);
+        return cache;
+    }
+}
+
+/** Returns the size of the view for struct @c T [@c Fvneeded32].
+The view is looked up by name once, and again only after
+refresh_view32_definitions(), rather than on every allocation.
+@ingroup buffers*/
+template <typename T>
+long view_size32()
+{
+    // a size and its epoch are stored together, so a lookup which raced a
+    // refresh is tagged with the old epoch and never outlives it
+    unsigned long epoch = view32_definitions_epoch().load(std::memory_order_acquire);
+    auto& cache = view_detail::view_size32_cache<T>();
+    std::uint64_t cached = cache.load(std::memory_order_acquire);
+    if(cached >> 32 != static_cast<std::uint32_t>(epoch + 1))
+    {
+        cached = view_detail::pack_view_size32(epoch, view_size32(type_name<T>::value()));
+        cache.store(cached, std::memory_order_release);
+    }
+    return static_cast<long>(cached & 0xFFFFFFFF);
+}
+
 /** Mapping options between views(structs) and fml buffers.
 @sa view16::set_mapping_option(). */
 enum class view32_mapping_option : int { none = F_OFF,
@@ -39,8 +102,9 @@ enum class view32_mapping_option : int { none = F_OFF,
                                         to_fml = F_STOF,
                                         both = F_BOTH };
 
-/** Refreshes view definitions */
-inline void refresh_view32_definitions() noexcept { Fvrefresh32(); }
+/** Refreshes view definitions [@c Fvrefresh32].  Sizes cached by view_size32<T>(),
+and expressions compiled for views, are looked up and compiled again. */
+inline void refresh_view32_definitions() noexcept { Fvrefresh32(); ++view32_definitions_epoch(); }
 
 /** Models a "VIEW32" typed buffer (C struct).
 This template class acts a bit like a smart
@@ -122,6 +186,60 @@ public:
     file will be used.*/
     bool is_null(std::string const& field_name, FLDOCC32 oc = 0);
     
+    /** A member of T, looked up once, for null tests and clears over
+    many structs.
+    
+    view32::is_null() and view32::clear(std::string const&) look the member up
+    by name on every call [@c Fvnull32, @c Fvselinit32].  A handle
+    takes the member's layout from view_traits (so include the header
+    @c viewhpp32 generated for the view), and its cleared value from
+    @c Fvselinit32, once; the batch operations then compare memory
+    directly, as @c Fvnull32 would: strings as strings, numbers as
+    numbers, carrays byte for byte.
+    @code
+    view32<my_struct>::member_handle amount("amount");
+    std::vector<std::uint64_t> nulls = amount.null_bitmap(rows.data(), rows.size());
+    amount.clear(rows.data(), rows.size(), nulls.data()); // or only some of them
+    @endcode
+    For views without generated view_traits, a handle still works, calling
+    @c Fvnull32 / @c Fvselinit32 once per struct. */
+    class member_handle
+    {
+    public:
+        member_handle() = default; /**< Default construct (refers to no member). */
+        /** Looks @c member_name (the structure member name) up [@c Fvnull32, @c Fvselinit32].
+        (@c Generated names the layout's source in the constructor's own
+        signature, so translation units with and without the generated
+        header don't define the same function differently; leave it defaulted.) */
+        template <bool Generated = view_traits<T, fml32>::generated>
+        explicit member_handle(std::string const& member_name);
+        
+        std::string const& name() const noexcept { return name_; } /**< Returns the member name. */
+        /** Returns true if element @c oc of the member is null in @c x [@c Fvnull32]. */
+        bool is_null(T const& x, FLDOCC32 oc = 0) const;
+        /** Tests element @c oc of the member in @c n structs, setting bit i (of bit i % 64
+        in word i / 64) of @c bits when struct i's is null.  @c bits needs (n + 63) / 64 words.
+        @returns the number of nulls */
+        std::size_t null_bitmap(T const* rows, std::size_t n, std::uint64_t* bits, FLDOCC32 oc = 0) const;
+        /** @copybrief null_bitmap(T const*, std::size_t, std::uint64_t*, FLDOCC32) const
+        @returns the bitmap */
+        std::vector<std::uint64_t> null_bitmap(T const* rows, std::size_t n, FLDOCC32 oc = 0) const;
+        /** Returns the number of the @c n structs in which element @c oc of the member is null. */
+        std::size_t count_nulls(T const* rows, std::size_t n, FLDOCC32 oc = 0) const;
+        /** Clears (all elements of) the member in @c x [@c Fvselinit32]. */
+        void clear(T& x) const;
+        /** Clears the member in those of the @c n structs whose bit is set in @c mask
+        (as null_bitmap() sets them), or in all of them if @c mask is null [@c Fvselinit32]. */
+        void clear(T* rows, std::size_t n, std::uint64_t const* mask = nullptr) const;
+        
+    private:
+        void check(FLDOCC32 oc) const;
+        
+        std::string name_;
+        bool compiled_ = false; // view_traits describe the member
+        view_detail::null_test test_;
+    };
+    
     /** Models a boolean expression (string) that can be compiled
     once and applied to multiple instances of T.
     Given a struct definition from a view like:
@@ -147,8 +265,8 @@ public:
     {
     public:
         boolean_expression() noexcept = default; /**< Default construct (no allocation). */
-        boolean_expression(boolean_expression const&); /**< Copy construct. */
-        boolean_expression& operator=(boolean_expression const&); /**< Copy assign. */
+        boolean_expression(boolean_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        boolean_expression& operator=(boolean_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         boolean_expression(boolean_expression&&) noexcept = default; /**< Move construct. */
         boolean_expression& operator=(boolean_expression&&) noexcept = default; /**< Move assign. */
         ~boolean_expression() noexcept = default; /**< Destruct. */
@@ -166,8 +284,7 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
     /** Models an arithmetic expression (string) that can be compiled
@@ -194,8 +311,8 @@ public:
     {
     public:
         arithmetic_expression() noexcept = default; /**< Default construct (no allocation). */
-        arithmetic_expression(arithmetic_expression const&); /**< Copy construct. */
-        arithmetic_expression& operator=(arithmetic_expression const&); /**< Copy assign. */
+        arithmetic_expression(arithmetic_expression const&) = default; /**< Copy construct (shares the compiled tree). */
+        arithmetic_expression& operator=(arithmetic_expression const&) = default; /**< Copy assign (shares the compiled tree). */
         arithmetic_expression(arithmetic_expression&&) noexcept = default; /**< Move construct. */
         arithmetic_expression& operator=(arithmetic_expression&&) noexcept = default; /**< Move assign. */
         ~arithmetic_expression() noexcept = default; /**< Destruct. */
@@ -213,8 +330,7 @@ public:
     private:
         void free() noexcept;
         void compile(std::string const&);
-        unsigned size() const;
-        std::unique_ptr<char, decltype(&::free)> tree_ = std::unique_ptr<char, decltype(&::free)>(nullptr, &::free);
+        expression_cache::tree tree_;
     };
     
 private:
@@ -274,7 +390,7 @@ view32<T>& view32<T>::operator=(view32<T> const& x)
 template<typename T>
 view32<T>::view32(class buffer&& x)
 {
-    if(x && (x.type() != "VIEW32" || x.subtype() != type_name<T>::value()))
+    if(x && (x.type_code() != buffer_type::view32 || std::strcmp(x.subtype_c_str(), type_name<T>::value()) != 0))
     {
         throw std::runtime_error(x.type() + "." + x.subtype() +
                                  " buffer cannot be cast to VIEW32." +
@@ -286,7 +402,7 @@ view32<T>::view32(class buffer&& x)
 template<typename T>
 view32<T>& view32<T>::operator=(class buffer&& x)
 {
-    if(x && (x.type() != "VIEW32" || x.subtype() != type_name<T>::value()))
+    if(x && (x.type_code() != buffer_type::view32 || std::strcmp(x.subtype_c_str(), type_name<T>::value()) != 0))
     {
         throw std::runtime_error(x.type() + "." + x.subtype() +
                                  " buffer cannot be cast to VIEW32." +
@@ -372,7 +488,7 @@ void view32<T>::alloc()
         const char* view_name = type_name<T>::value();
         buffer_.alloc("VIEW32",
                       const_cast<char*>(view_name),
-                      view_size32(view_name));
+                      view_size32<T>());
         buffer_.data_size(sizeof(T));
         clear();
     }
@@ -424,27 +540,132 @@ bool view32<T>::is_null(std::string const& field_name, FLDOCC32 oc)
 
 
 template<typename T>
-view32<T>::boolean_expression::boolean_expression(view32<T>::boolean_expression const& x)
+template<bool Generated>
+view32<T>::member_handle::member_handle(std::string const& member_name) :
+    name_(member_name)
 {
-    if(x.tree_)
+    const char* view_name = type_name<T>::value();
+    T cleared;
+    std::memset(&cleared, 0, sizeof(T));
+    char* data = reinterpret_cast<char*>(&cleared);
+    if(Fvselinit32(data, const_cast<char*>(name_.c_str()), const_cast<char*>(view_name)) == -1)
     {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
+        throw fml32::last_error("Fvselinit32");
+    }
+    typedef view_traits<T, fml32> traits;
+    view_member const* members = nullptr;
+    std::size_t member_count = 0;
+    view_detail::view_members<traits>(members, member_count, std::integral_constant<bool, Generated>());
+    for(std::size_t i = 0; i < member_count; ++i)
+    {
+        view_member const& m = members[i];
+        if(name_ == m.name)
         {
-            throw std::bad_alloc{};
+            test_.offset = m.offset;
+            test_.size = m.size;
+            test_.count = m.count;
+            test_.type = m.type;
+            test_.has_null = std::strcmp(m.null_value, "NONE") != 0;
+            test_.null_image.assign(data + m.offset, m.size * m.count);
+            compiled_ = true;
+            break;
         }
-        memmove(tree_.get(), x.tree_.get(), size);
     }
 }
 
+template<typename T>
+void view32<T>::member_handle::check(FLDOCC32 oc) const
+{
+    if(compiled_ && (oc < 0 || static_cast<std::size_t>(oc) >= test_.count))
+    {
+        throw std::out_of_range("view32::member_handle: occurrence " + std::to_string(oc) + " of " + name_);
+    }
+}
 
 template<typename T>
-typename view32<T>::boolean_expression& view32<T>::boolean_expression::operator=(view32<T>::boolean_expression const& x)
+bool view32<T>::member_handle::is_null(T const& x, FLDOCC32 oc) const
 {
-    view32<T>::boolean_expression tmp(x);
-    *this = move(tmp);
-    return *this;
+    return count_nulls(&x, 1, oc) == 1;
+}
+
+template<typename T>
+std::size_t view32<T>::member_handle::null_bitmap(T const* rows, std::size_t n, std::uint64_t* bits, FLDOCC32 oc) const
+{
+    check(oc);
+    if(compiled_)
+    {
+        return view_detail::null_bitmap(test_, reinterpret_cast<const char*>(rows), sizeof(T), n,
+                                        static_cast<std::size_t>(oc), bits);
+    }
+    std::size_t nulls = 0;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        int rc = Fvnull32(reinterpret_cast<char*>(const_cast<T*>(rows + i)),
+                          const_cast<char*>(name_.c_str()),
+                          oc,
+                          const_cast<char*>(type_name<T>::value()));
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvnull32");
+        }
+        if(bits && i % 64 == 0)
+        {
+            bits[i / 64] = 0;
+        }
+        if(rc == 1)
+        {
+            ++nulls;
+            if(bits)
+            {
+                bits[i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+        }
+    }
+    return nulls;
+}
+
+template<typename T>
+std::vector<std::uint64_t> view32<T>::member_handle::null_bitmap(T const* rows, std::size_t n, FLDOCC32 oc) const
+{
+    std::vector<std::uint64_t> bits((n + 63) / 64);
+    null_bitmap(rows, n, bits.data(), oc);
+    return bits;
+}
+
+template<typename T>
+std::size_t view32<T>::member_handle::count_nulls(T const* rows, std::size_t n, FLDOCC32 oc) const
+{
+    return null_bitmap(rows, n, nullptr, oc);
+}
+
+template<typename T>
+void view32<T>::member_handle::clear(T& x) const
+{
+    clear(&x, 1);
+}
+
+template<typename T>
+void view32<T>::member_handle::clear(T* rows, std::size_t n, std::uint64_t const* mask) const
+{
+    if(compiled_)
+    {
+        view_detail::clear(test_, reinterpret_cast<char*>(rows), sizeof(T), n, mask);
+        return;
+    }
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        if(mask && !((mask[i / 64] >> (i % 64)) & 1))
+        {
+            continue;
+        }
+        int rc = Fvselinit32(reinterpret_cast<char*>(rows + i),
+                             const_cast<char*>(name_.c_str()),
+                             const_cast<char*>(type_name<T>::value()));
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvselinit32");
+        }
+    }
 }
 
 template<typename T>
@@ -465,7 +686,7 @@ void view32<T>::boolean_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        int rc = Fvboolpr32(tree_.get(), f, const_cast<char*>(type_name<T>::value()));
+        int rc = Fvboolpr32(const_cast<char*>(tree_.get()), f, const_cast<char*>(type_name<T>::value()));
         if(rc == -1)
         {
             throw fml32::last_error("Fvboolpr32");
@@ -478,7 +699,7 @@ bool view32<T>::boolean_expression::evaluate(T const& x) const
 {
 
     int result = Fvboolev32(reinterpret_cast<char*>(const_cast<T*>(&x)),
-                            tree_.get(),
+                            const_cast<char*>(tree_.get()),
                             const_cast<char*>(type_name<T>::value()));
     if(result == -1)
     {
@@ -503,46 +724,16 @@ template<typename T>
 void view32<T>::boolean_expression::compile(std::string const& x)
 {
     free();
-    tree_.reset(Fvboolco32(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value())));
-    if(!tree_)
+    tree_ = expression_cache::global().get(view_detail::expression_domain32(type_name<T>::value()), x, [&x]
     {
-        throw fml32::last_error("Fvboolco32");
-    }
-}
-
-template<typename T>
-unsigned view32<T>::boolean_expression::size() const
-{
+        return Fvboolco32(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value()));
+    });
     if(!tree_)
     {
-        return 0;
-    }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
-}
-
-template<typename T>
-view32<T>::arithmetic_expression::arithmetic_expression(view32<T>::arithmetic_expression const& x)
-{
-    if(x.tree_)
-    {
-        unsigned size = x.size();
-        tree_ = reinterpret_cast<char*>(malloc(size));
-        if(!tree_)
-        {
-            throw std::bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
+        throw fml32::last_error("Fvboolco32");
     }
 }
 
-template<typename T>
-typename view32<T>::arithmetic_expression& view32<T>::arithmetic_expression::operator=(view32<T>::arithmetic_expression const& x)
-{
-    view32<T>::arithmetic_expression tmp(x);
-    *this = move(tmp);
-    return *this;
-}
-
 template<typename T>
 view32<T>::arithmetic_expression::arithmetic_expression(std::string const& x)
 {
@@ -561,7 +752,7 @@ void view32<T>::arithmetic_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        int rc = Fvboolpr32(tree_.get(), f, const_cast<char*>(type_name<T>::value()));
+        int rc = Fvboolpr32(const_cast<char*>(tree_.get()), f, const_cast<char*>(type_name<T>::value()));
         if(rc == -1)
         {
             throw fml32::last_error("Fvboolpr32");
@@ -572,7 +763,7 @@ void view32<T>::arithmetic_expression::print(FILE* f) const noexcept
 template<typename T>
 double view32<T>::arithmetic_expression::evaluate(T const& x) const
 {
-    double result = Fvfloatev32(reinterpret_cast<char*>(const_cast<T*>(&x)), tree_.get(), const_cast<char*>(type_name<T>::value()));
+    double result = Fvfloatev32(reinterpret_cast<char*>(const_cast<T*>(&x)), const_cast<char*>(tree_.get()), const_cast<char*>(type_name<T>::value()));
     if(result == -1)
     {
         throw fml32::last_error("Fvfloatev32");
@@ -595,25 +786,16 @@ void view32<T>::arithmetic_expression::free() noexcept
 template<typename T>
 void view32<T>::arithmetic_expression::compile(std::string const& x)
 {
-    tree_.reset(Fvboolco32(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value())));
-    if(!tree_)
+    tree_ = expression_cache::global().get(view_detail::expression_domain32(type_name<T>::value()), x, [&x]
     {
-        throw fml32::last_error("Fvboolco32");
-    }
-}
-
-template<typename T>
-unsigned view32<T>::arithmetic_expression::size() const
-{
+        return Fvboolco32(const_cast<char*>(x.c_str()), const_cast<char*>(type_name<T>::value()));
+    });
     if(!tree_)
     {
-        return 0;
+        throw fml32::last_error("Fvboolco32");
     }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
 }
 
-
-
 template <typename T>
 bool operator==(view32<T> const& a, view32<T> const& b)
 {
@@ -0,0 +1,344 @@
+/** @file view_array.hpp
+@c view_array class and related functions.
+@ingroup buffers */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "tux/buffer.hpp"
+#include "tux/fml32.hpp"
+#include "tux/util.hpp"
+
+namespace tux
+{
+
+/** Models a row set of view structs (@c T), stored contiguously in one
+"CARRAY" typed buffer.
+
+Returning rows one @c FLD_VIEW32 occurrence at a time (fml32::add_view())
+copies each struct into the fielded buffer and pays the per-field
+overhead; a view_array holds them as a plain array behind a small header,
+so a reply is one allocation, and the receiver reads the rows in place:
+@code{.cpp}
+view_array<my_struct> rows;
+rows.reserve(n);
+for(...)
+{
+    my_struct& row = rows.emplace_back(); // null values from the view
+    row.l = ...;
+}
+tpreturn(TPSUCCESS, 0, rows.move_buffer());
+...
+view_array<my_struct> reply(call("ROWS", request));
+for(my_struct const& row : reply) ...
+@endcode
+
+The header (one cache line, so the first row is as aligned as the
+buffer) records the view name, @c sizeof(T) and the row count, and a
+buffer received from elsewhere must match all three.  The rows themselves
+are the structs' bytes: CARRAY buffers aren't converted between machines,
+so both ends must share the architecture and the compiled view.
+add_views() and get_views() move rows between a view_array and the
+occurrences of an @c FLD_VIEW32 field in bulk, for peers which expect
+fielded buffers.
+@ingroup buffers */
+template <typename T>
+class view_array
+{
+public:
+    typedef T value_type; /**< A row. */
+    typedef T* iterator; /**< Iterates over rows. */
+    typedef T const* const_iterator; /**< Iterates over rows. */
+    typedef std::size_t size_type; /**< Row counts and indexes. */
+
+    view_array() noexcept = default; /**< Default construct; no allocation. */
+    view_array(view_array<T> const& x); /**< Copy construct (one allocation, one copy of the rows). */
+    view_array<T>& operator=(view_array<T> const& x); /**< Copy assign. */
+    view_array(view_array<T>&& x) noexcept = default; /**< Move construct. */
+    view_array<T>& operator=(view_array<T>&& x) noexcept = default; /**< Move assign. */
+    ~view_array() = default; /**< Destruct. */
+
+    /** Construct from a buffer, checking its header names this view with rows of @c sizeof(T).
+    @sa cstring::cstring(buffer&&). */
+    view_array(class buffer&& x);
+    /** Assign from buffer.
+    @sa view_array(buffer&&)*/
+    view_array<T>& operator=(class buffer&& x);
+
+    T& operator[](size_type i) noexcept { return begin()[i]; } /**< Returns row @c i (unchecked). */
+    T const& operator[](size_type i) const noexcept { return begin()[i]; } /**< Returns row @c i (unchecked). */
+
+    iterator begin() noexcept; /**< Returns begin iterator. */
+    const_iterator begin() const noexcept; /**< Returns begin iterator. */
+    iterator end() noexcept { return begin() + size(); } /**< Returns end iterator. */
+    const_iterator end() const noexcept { return begin() + size(); } /**< Returns end iterator. */
+
+    size_type size() const noexcept; /**< Returns the number of rows. */
+    bool empty() const noexcept { return size() == 0; } /**< Returns true if there are no rows. */
+    size_type capacity() const; /**< Returns the number of rows the buffer has room for. */
+    void reserve(size_type rows); /**< Makes room for @c rows rows [@c tpalloc, @c tprealloc]. */
+
+    void push_back(T const& x); /**< Appends a copy of @c x (growing the buffer geometrically). */
+    /** Appends a row holding the null values from the view definition [@c Fvsinit32].
+    @returns the new row */
+    T& emplace_back();
+    void clear() noexcept; /**< Removes all rows (keeping the buffer). */
+
+    class buffer& buffer() noexcept { return buffer_; } /**< Access underlying buffer. */
+    class buffer const& buffer() const noexcept { return buffer_; } /**< Access underlying buffer. */
+    /** Move underlying buffer.
+    This can (and usually will) leave @c this in a default (null) state. */
+    class buffer&& move_buffer() noexcept { return std::move(buffer_); }
+
+    explicit operator bool() const noexcept { return (bool)buffer_; } /**< Test for null state. */
+
+private:
+    template <typename U> friend view_array<U> get_views(fml32 const& src, FLDID32 id);
+
+    struct header
+    {
+        char view_name[40];
+        std::uint64_t row_size;
+        std::uint64_t count;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(header) == 64, "the rows should start a cache line into the buffer");
+
+    header* head() noexcept { return reinterpret_cast<header*>(buffer_.data()); }
+    header const* head() const noexcept { return reinterpret_cast<header const*>(buffer_.data()); }
+    static void check(class buffer const& x);
+    void resize(size_type rows) noexcept;
+
+    class buffer buffer_;
+};
+
+/** Adds each row of @c rows as an occurrence of @c id, an @c FLD_VIEW32
+field, growing @c dest once up front [@c Fadd32].
+@relates view_array */
+template <typename T>
+void add_views(fml32& dest, FLDID32 id, view_array<T> const& rows);
+
+/** Gets every occurrence of @c id, an @c FLD_VIEW32 field holding @c T
+structs, into a view_array allocated once, each struct copied straight
+into its row [@c Foccur32, @c Ffind32, @c Fget32].  The view of every
+occurrence is checked before anything is copied.
+@relates view_array */
+template <typename T>
+view_array<T> get_views(fml32 const& src, FLDID32 id);
+
+
+
+
+// --- DEFS ----------------------------------------
+
+template <typename T>
+view_array<T>::view_array(view_array<T> const& x)
+{
+    *this = x;
+}
+
+template <typename T>
+view_array<T>& view_array<T>::operator=(view_array<T> const& x)
+{
+    if(this == &x)
+    {
+        return *this;
+    }
+    if(!x)
+    {
+        buffer_.free();
+        return *this;
+    }
+    clear();
+    reserve(x.size());
+    std::memcpy(begin(), x.begin(), x.size() * sizeof(T));
+    resize(x.size());
+    return *this;
+}
+
+template <typename T>
+view_array<T>::view_array(class buffer&& x)
+{
+    *this = std::move(x);
+}
+
+template <typename T>
+view_array<T>& view_array<T>::operator=(class buffer&& x)
+{
+    if(x)
+    {
+        check(x);
+    }
+    buffer_ = std::move(x);
+    return *this;
+}
+
+template <typename T>
+void view_array<T>::check(class buffer const& x)
+{
+    if(x.type_code() != buffer_type::carray)
+    {
+        throw std::runtime_error("buffer type " + x.type() + " cannot be cast to view_array<" +
+                                 type_name<T>::value() + ">");
+    }
+    long data_size = x.data_size() ? x.data_size() : x.size();
+    header const* h = reinterpret_cast<header const*>(x.data());
+    if(data_size < static_cast<long>(sizeof(header)) ||
+       std::strncmp(h->view_name, type_name<T>::value(), sizeof(h->view_name)) != 0 ||
+       h->row_size != sizeof(T) ||
+       h->count > (static_cast<std::uint64_t>(data_size) - sizeof(header)) / sizeof(T))
+    {
+        throw std::runtime_error("CARRAY buffer is not a view_array<" + std::string(type_name<T>::value()) + ">");
+    }
+}
+
+template <typename T>
+typename view_array<T>::iterator view_array<T>::begin() noexcept
+{
+    return buffer_ ? reinterpret_cast<T*>(buffer_.data() + sizeof(header)) : nullptr;
+}
+
+template <typename T>
+typename view_array<T>::const_iterator view_array<T>::begin() const noexcept
+{
+    return buffer_ ? reinterpret_cast<T const*>(buffer_.data() + sizeof(header)) : nullptr;
+}
+
+template <typename T>
+typename view_array<T>::size_type view_array<T>::size() const noexcept
+{
+    return buffer_ ? static_cast<size_type>(head()->count) : 0;
+}
+
+template <typename T>
+typename view_array<T>::size_type view_array<T>::capacity() const
+{
+    return buffer_ ? static_cast<size_type>(buffer_.size() - static_cast<long>(sizeof(header))) / sizeof(T) : 0;
+}
+
+template <typename T>
+void view_array<T>::reserve(size_type rows)
+{
+    long needed = static_cast<long>(sizeof(header) + std::max<size_type>(rows, 1) * sizeof(T));
+    if(!buffer_)
+    {
+        buffer_.alloc("CARRAY", nullptr, needed);
+        header* h = head();
+        std::memset(h, 0, sizeof(header));
+        tux::set(h->view_name, type_name<T>::value());
+        h->row_size = sizeof(T);
+        resize(0);
+    }
+    else if(rows > capacity())
+    {
+        long data_size = buffer_.data_size();
+        buffer_.realloc(needed);
+        buffer_.data_size(data_size);
+    }
+}
+
+template <typename T>
+void view_array<T>::push_back(T const& x)
+{
+    size_type n = size();
+    if(n == capacity())
+    {
+        reserve(std::max<size_type>(n * 2, 8));
+    }
+    std::memcpy(begin() + n, &x, sizeof(T));
+    resize(n + 1);
+}
+
+template <typename T>
+T& view_array<T>::emplace_back()
+{
+    size_type n = size();
+    if(n == capacity())
+    {
+        reserve(std::max<size_type>(n * 2, 8));
+    }
+    T* row = begin() + n;
+    std::memset(row, 0, sizeof(T));
+    int rc = Fvsinit32(reinterpret_cast<char*>(row), const_cast<char*>(type_name<T>::value()));
+    if(rc == -1)
+    {
+        throw fml32::last_error("Fvsinit32");
+    }
+    resize(n + 1);
+    return *row;
+}
+
+template <typename T>
+void view_array<T>::clear() noexcept
+{
+    if(buffer_)
+    {
+        resize(0);
+    }
+}
+
+template <typename T>
+void view_array<T>::resize(size_type rows) noexcept
+{
+    head()->count = rows;
+    buffer_.data_size(static_cast<long>(sizeof(header) + rows * sizeof(T)));
+}
+
+template <typename T>
+void add_views(fml32& dest, FLDID32 id, view_array<T> const& rows)
+{
+    if(rows.empty())
+    {
+        return;
+    }
+    // each occurrence holds the struct and the view name
+    FLDOCC32 n = static_cast<FLDOCC32>(rows.size());
+    dest.reserve(dest.size() + fml32::bytes_needed(n, static_cast<FLDLEN32>(rows.size() * (sizeof(T) + sizeof(FVIEWFLD)))));
+    for(T const& row : rows)
+    {
+        dest.add_view(id, row);
+    }
+}
+
+template <typename T>
+view_array<T> get_views(fml32 const& src, FLDID32 id)
+{
+    if(fml32::field_type(id) != FLD_VIEW32)
+    {
+        throw std::runtime_error("cannot convert VIEW32 value to/from a " +
+            fml32::field_type_name(id) + " field [" + fml32::field_name(id) + "]");
+    }
+    view_array<T> result;
+    FLDOCC32 n = src ? src.count(id) : 0;
+    result.reserve(static_cast<std::size_t>(n));
+    FBFR32* fbfr = const_cast<FBFR32*>(src.as_fbfr());
+    for(FLDOCC32 oc = 0; oc < n; ++oc)
+    {
+        // check the occurrence's view before Fget32 copies a whole struct of that view into the row
+        FLDLEN32 length = 0;
+        auto found = reinterpret_cast<FVIEWFLD const*>(Ffind32(fbfr, id, oc, &length));
+        if(!found)
+        {
+            throw fml32::last_error("Ffind32");
+        }
+        if(std::strncmp(found->vname, type_name<T>::value(), sizeof(found->vname)) != 0)
+        {
+            throw std::runtime_error(std::string("cannot extract ") + type_name<T>::value() + " value from a " +
+                                     std::string(found->vname, strnlen(found->vname, sizeof(found->vname))) +
+                                     " field [" + fml32::field_name(id) + "]");
+        }
+        auto v = make_default<FVIEWFLD>();
+        v.data = reinterpret_cast<char*>(result.begin() + oc);
+        length = sizeof(v);
+        if(Fget32(fbfr, id, oc, reinterpret_cast<char*>(&v), &length) == -1)
+        {
+            throw fml32::last_error("Fget32");
+        }
+    }
+    result.resize(static_cast<std::size_t>(n));
+    return result;
+}
+
+}
@@ -0,0 +1,153 @@
+/** @file view_traits.hpp
+@c view_traits class template: compile-time descriptions of views, generated by @c viewhpp32 and @c viewhpp16.
+@ingroup buffers */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+// 32 (fml32.h) header must come before 16 (fml16.h)
+#include "tux/fml32.hpp"
+#include "tux/fml16.hpp"
+
+namespace tux
+{
+
+/** Describes one member of a view, as compiled from its view description.
+@sa view_traits @ingroup buffers */
+struct view_member
+{
+    const char* name; /**< The structure member name (cname). */
+    const char* field_name; /**< The mapped field name (fbname), or "-" if it isn't mapped. */
+    long field_id; /**< The mapped field id, or @c BADFLDID. */
+    int type; /**< The member's type (@c FLD_SHORT, @c FLD_INT, ... @c FLD_CARRAY). */
+    std::size_t offset; /**< Offset of the member in the structure. */
+    std::size_t size; /**< Size of one element (for strings and carrays, the declared size). */
+    std::size_t count; /**< Number of elements. */
+    std::ptrdiff_t count_offset; /**< Offset of the C_ count member, or -1 (the @c C flag). */
+    std::ptrdiff_t length_offset; /**< Offset of the L_ length member(s), or -1 (the @c L flag). */
+    /** Mapping direction: @c 'B' both ways, @c 'F' to the fielded buffer
+    only, @c 'S' to the structure only, @c 'N' neither. */
+    char direction;
+    const char* null_value; /**< The null value, as written in the view description ("-" for the default). */
+};
+
+/** Compile-time description of the view for struct @c T, and conversions
+between @c T and @c Fml (fml32 or fml16) which don't interpret the
+compiled view at run time.
+
+The primary template describes nothing (@c generated is false), and
+to_struct() / convert() in convert.hpp then call @c Fvftos32 / @c Fvstof32
+(or @c Fvftos / @c Fvstof) as usual.  @c viewhpp32 and @c viewhpp16
+generate specializations from view description files:
+@code
+viewhpp32 [-i views.h] views views.hpp
+@endcode
+where @c views.h is the header generated by @c viewc32 (by default, the
+input file name with a @c .h extension) and @c FIELDTBLS32 / @c FLDTBLDIR32 name the
+field tables, as for @c viewc32.  Each specialization has
+@arg @c generated (true)
+@arg @c members, a constexpr array of view_member (and @c member_count)
+@arg @c bytes_needed(T const&), the buffer size needed to convert a given struct: the size for the non-null members (strings as long as they are, not as declared) [@c Fneeded32]
+@arg @c to_fml(T const&, Fml&), which makes room for bytes_needed() once, then appends the non-null members, as @c Fvstof32 would to an empty buffer
+@arg @c to_struct(Fml const&, T&), which does what @c Fvftos32 does
+
+Include the generated header (rather than just the @c viewc32 one)
+everywhere the struct is converted.  A translation unit which converts the
+struct without it uses the primary template for a type that has an explicit
+specialization elsewhere, which is undefined behavior (ill-formed, no
+diagnostic required), however the conversions pick between the two paths;
+nothing detects it, at compile or link time.  Views with members the generator doesn't support
+(@c dec_t, mbstring, the @c P flag) get no specialization, and keep
+using Tuxedo's conversions.
+
+@c Unused only lets the generated specializations define @c members in a
+header; leave it defaulted.
+@ingroup buffers */
+template <typename T, typename Fml, typename Unused = void>
+struct view_traits
+{
+    static constexpr bool generated = false; /**< True in generated specializations. */
+};
+
+/** Helpers for the conversions generated by @c viewhpp32 and @c viewhpp16. */
+namespace view_detail
+{
+    /** Appends an occurrence of @c id holding @c value, of the field's own @c type [@c Fadd32].
+    @c len is the length of a carray, or bounds a string which needn't be null terminated.
+    The generator calls add_converted() instead for members whose type isn't the field's. */
+    void add(fml32& f, FLDID32 id, const char* value, FLDLEN32 len, int type);
+    /** Appends an occurrence of @c id holding @c value, converted from @c type to the field's type [@c CFadd32].
+    @c len is as for add(). */
+    void add_converted(fml32& f, FLDID32 id, const char* value, FLDLEN32 len, int type);
+    /** Gets occurrence @c oc of @c id, of the field's own @c type, into the member at @c dest (@c size bytes) [@c Ffind32].
+    Strings are truncated to fit and null terminated; carrays are truncated
+    and zero filled.
+    @returns the number of bytes stored (for strings, including the null terminator), or -1 if there's no such occurrence */
+    long get(fml32 const& f, FLDID32 id, FLDOCC32 oc, char* dest, FLDLEN32 size, int type);
+    /** Gets occurrence @c oc of @c id into the member at @c dest, converted to the member's @c type [@c CFget32].
+    @returns as get() */
+    long get_converted(fml32 const& f, FLDID32 id, FLDOCC32 oc, char* dest, FLDLEN32 size, int type);
+    /** Stores @c len bytes of @c value, of the member's @c type, into the member at @c dest (@c size bytes),
+    truncating and terminating strings, and truncating and zero filling carrays.
+    @returns the number of bytes stored, as get() does */
+    long set(char* dest, std::size_t size, const char* value, std::size_t len, int type) noexcept;
+    /** Room counted in bytes_needed() for a number converted to a string or carray field.
+    add() grows the buffer if the conversion turns out longer. */
+    constexpr long converted_length = 32;
+    /** Makes room in @c f for @c needed more bytes of fields, as returned by @c bytes_needed(),
+    without counting the buffer header twice if @c f is already allocated. */
+    void reserve(fml32& f, long needed);
+    /** @copydoc add(fml32&, FLDID32, const char*, FLDLEN32, int) */
+    void add(fml16& f, FLDID id, const char* value, FLDLEN len, int type);
+    /** @copydoc add_converted(fml32&, FLDID32, const char*, FLDLEN32, int) */
+    void add_converted(fml16& f, FLDID id, const char* value, FLDLEN len, int type);
+    /** @copydoc get(fml32 const&, FLDID32, FLDOCC32, char*, FLDLEN32, int) */
+    long get(fml16 const& f, FLDID id, FLDOCC oc, char* dest, FLDLEN size, int type);
+    /** @copydoc get_converted(fml32 const&, FLDID32, FLDOCC32, char*, FLDLEN32, int) */
+    long get_converted(fml16 const& f, FLDID id, FLDOCC oc, char* dest, FLDLEN size, int type);
+    /** @copydoc reserve(fml32&, long) */
+    void reserve(fml16& f, long needed);
+    /** Returns the length of the string member @c value, which needn't be null terminated within its @c size bytes. */
+    std::size_t string_length(const char* value, std::size_t size) noexcept;
+    /** Returns true if the first @c size bytes of @c value equal @c null,
+    padded with null characters (the null test for carrays). */
+    bool equals_padded(const char* value, std::size_t size, const char* null, std::size_t null_size) noexcept;
+
+    /** Points @c members at the generated description of a view, if there is one. */
+    template <typename Traits>
+    void view_members(view_member const*& members, std::size_t& count, std::true_type) noexcept
+    {
+        members = Traits::members;
+        count = Traits::member_count;
+    }
+    /** @copydoc view_members(view_member const*&, std::size_t&, std::true_type) */
+    template <typename Traits>
+    void view_members(view_member const*&, std::size_t&, std::false_type) noexcept
+    {
+    }
+
+    /** A member's null test, compiled once from its view_member and the
+    null values @c Fvselinit32 stores (see view32::member_handle). */
+    struct null_test
+    {
+        std::size_t offset = 0; /**< Of the member in the structure. */
+        std::size_t size = 0; /**< Of one element. */
+        std::size_t count = 0; /**< Number of elements. */
+        int type = 0; /**< The member's type (@c FLD_SHORT, ... @c FLD_CARRAY). */
+        bool has_null = true; /**< False for a @c NONE null value: the member is never null. */
+        std::string null_image; /**< All elements of the member, cleared. */
+    };
+    /** Tests element @c oc of the member in @c n structs, @c stride bytes
+    apart, setting bit i of @c bits (if not null) when struct i's is null
+    (strings compare as strings, numbers as numbers, carrays byte for byte).
+    @c bits has room for (n + 63) / 64 words.
+    @returns the number of null elements */
+    std::size_t null_bitmap(null_test const& t, const char* rows, std::size_t stride, std::size_t n,
+                            std::size_t oc, std::uint64_t* bits) noexcept;
+    /** Clears the member in the @c n structs, @c stride bytes apart,
+    for which bit i of @c mask is set (all of them, if @c mask is null). */
+    void clear(null_test const& t, char* rows, std::size_t stride, std::size_t n, std::uint64_t const* mask) noexcept;
+}
+
+}
@@ -97,6 +97,7 @@ void admin_call(fml32 const& request, fml32& response)
         response.reserve(0);
     }
     const FBFR32* in = request.as_fbfr();
+    response.modified();
     FBFR32* out = reinterpret_cast<FBFR32*>(response.buffer().release());
     int rc = tpadmcall(const_cast<FBFR32*>(in), &out, TPNOFLAGS);
     response.buffer().acquire(reinterpret_cast<char*>(out));
@@ -1,31 +1,106 @@
+#include "fml32.h" // 32 must come before 16
+#include "fml.h"
 #include "tux/buffer.hpp"
+#include "tux/buffer_pool.hpp"
+#include "tux/compression.hpp"
 #include "tux/util.hpp"
 
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <set>
 
 using namespace std;
 
 namespace tux
 {
+
+namespace
+{
+    struct known_type
+    {
+        const char* name;
+        buffer_type code;
+    };
+
+    const known_type known_types[] = {
+        {"FML32", buffer_type::fml32},
+        {"STRING", buffer_type::string},
+        {"CARRAY", buffer_type::carray},
+        {"VIEW32", buffer_type::view32},
+        {"FML", buffer_type::fml},
+        {"VIEW", buffer_type::view},
+        {"X_C_TYPE", buffer_type::x_c_type},
+        {"X_COMMON", buffer_type::x_common},
+        {"X_OCTET", buffer_type::x_octet},
+        {"XML", buffer_type::xml},
+        {"MBSTRING", buffer_type::mbstring},
+        {"RECORD", buffer_type::record}
+    };
+
+    // returns a pointer which stays valid for the life of the process
+    const char* intern(const char* x)
+    {
+        if(!x || !*x)
+        {
+            return "";
+        }
+        // a thread sees few distinct (sub)types, so remember the last few it
+        // interned rather than take the lock and search the set every time
+        const size_t cache_size = 4;
+        thread_local const char* cache[cache_size] = {};
+        thread_local size_t next = 0;
+        for(const char* cached : cache)
+        {
+            if(cached && strcmp(cached, x) == 0)
+            {
+                return cached;
+            }
+        }
+        static mutex mtx;
+        static std::set<string> interned;
+        const char* result;
+        {
+            lock_guard<mutex> lock(mtx);
+            result = interned.insert(x).first->c_str();
+        }
+        cache[next] = result;
+        next = (next + 1) % cache_size;
+        return result;
+    }
+}
    
 const char* buffer::default_type = "FML32";
 const char* buffer::default_subtype = nullptr;
 long buffer::default_size = 0;
 
-buffer::buffer(buffer&& x) noexcept
+buffer::buffer(buffer&& x) noexcept :
+  data_(x.data_),
+  data_size_(x.data_size_),
+  capacity_(x.capacity_),
+  type_(x.type_),
+  subtype_(x.subtype_),
+  type_code_(x.type_code_)
 {
-  acquire(x.data_, x.data_size_);
   x.data_ = nullptr;
   x.data_size_ = 0;
+  x.reset_metadata();
 }
 
 buffer& buffer::operator=(buffer&& x) noexcept
 {
   if(&x != this)
   {
-    acquire(x.data_, x.data_size_);
+    free();
+    data_ = x.data_;
+    data_size_ = x.data_size_;
+    capacity_ = x.capacity_;
+    type_ = x.type_;
+    subtype_ = x.subtype_;
+    type_code_ = x.type_code_;
     x.data_ = nullptr;
     x.data_size_ = 0;
+    x.reset_metadata();
   }
   return *this;
 }
@@ -39,6 +114,13 @@ buffer::buffer(const char* type,
        const char* subtype,
        long size)
 {
+  buffer_pool* pool = buffer_pool::current();
+  if(pool)
+  {
+    data_ = pool->allocate(type, subtype, size);
+    refresh_metadata();
+    return;
+  }
   //stopwatch s;
   //s.start();
   data_ = tpalloc(const_cast<char*>(type),
@@ -54,6 +136,7 @@ buffer::buffer(const char* type,
   {
     //cout << "tpalloc @" << (void*)data_  << endl;
   }
+  refresh_metadata();
 }
 
 buffer::buffer(char* data, long data_size) noexcept
@@ -76,11 +159,13 @@ void buffer::alloc_default()
 
 void buffer::realloc(long size)
 {
-  data_ = tprealloc(data_, size);
-  if(!data_)
+  char* data = tprealloc(data_, size);
+  if(!data)
   {
     throw last_error("tprealloc");
   }
+  data_ = data;
+  refresh_metadata();
   //cout << "tprealloc @" << (void*)data_ << endl;
 }
 
@@ -89,10 +174,17 @@ void buffer::free() noexcept
   if(data_)
   {
       //cout << "tpfree @" << (void*)data_ << endl;
-      tpfree(data_);
+      buffer_pool* pool = buffer_pool::current();
+      if(!pool ||
+         type_code_ == buffer_type::unknown ||
+         !pool->deallocate(data_, type_, subtype_, capacity_))
+      {
+        tpfree(data_);
+      }
   }
   data_ = nullptr;
   data_size_ = 0;
+  reset_metadata();
 }
 
 void buffer::acquire(char* data, long data_size) noexcept
@@ -100,6 +192,7 @@ void buffer::acquire(char* data, long data_size) noexcept
   free();
   data_ = data;
   data_size_ = data_size;
+  refresh_metadata();
 }
 
 char* buffer::release() noexcept
@@ -108,6 +201,7 @@ char* buffer::release() noexcept
   char* result = data_;
   data_ = nullptr;
   data_size_ = 0;
+  reset_metadata();
   return result;
 }
 
@@ -118,54 +212,104 @@ buffer::operator bool() const noexcept
 
 string buffer::type() const
 {
-  if(!data_)
+  if(type_code_ == buffer_type::unknown)
   {
-    return "";
+    // report the tptypes error
+    string type(8, ' ');
+    if(tptypes(const_cast<char*>(data_), const_cast<char*>(type.data()), nullptr) == -1)
+    {
+      throw last_error("tptypes");
+    }
+    trim_to_null_terminator(type);
+    return type;
   }
-  string type(8, ' ');
-  long rc = tptypes(const_cast<char*>(data_),
-                    const_cast<char*>(type.data()),
-                    nullptr);
-  if(rc == -1)
-  {
-    throw last_error("tptypes");
-  }
-  trim_to_null_terminator(type);
-  return type;
+  return type_;
 }
 
 string buffer::subtype() const
 {
-  if(!data_)
+  if(type_code_ == buffer_type::unknown)
   {
-    return "";
+    // report the tptypes error
+    string subtype(16, ' ');
+    if(tptypes(const_cast<char*>(data_), nullptr, const_cast<char*>(subtype.data())) == -1)
+    {
+      throw last_error("tptypes");
+    }
+    trim_to_null_terminator(subtype);
+    return subtype;
   }
-  string subtype(16, ' ');
-  long rc = tptypes(const_cast<char*>(data_),
-                    nullptr,
-                    const_cast<char*>(subtype.data()));
-  if(rc == -1)
+  return subtype_;
+}
+
+long buffer::size() const
+{
+  if(type_code_ == buffer_type::unknown)
   {
-    throw last_error("tptypes");
+    // report the tptypes error
+    long size = tptypes(const_cast<char*>(data_), nullptr, nullptr);
+    if(size == -1)
+    {
+      throw last_error("tptypes");
+    }
+    return size;
   }
-  trim_to_null_terminator(subtype);
-  return subtype;
+  return capacity_;
 }
 
-long buffer::size() const
+void buffer::refresh_metadata() noexcept
 {
   if(!data_)
   {
-    return 0;
+    reset_metadata();
+    return;
   }
-  long size = tptypes(const_cast<char*>(data_),
-                    nullptr,
-                    nullptr);
+  char type[9] = {};
+  char subtype[17] = {};
+  long size = tptypes(data_, type, subtype);
   if(size == -1)
   {
-    throw last_error("tptypes");
+    reset_metadata();
+    type_code_ = buffer_type::unknown;
+    return;
+  }
+  capacity_ = size;
+  type_code_ = buffer_type::other;
+  type_ = nullptr;
+  for(auto const& k : known_types)
+  {
+    if(strcmp(type, k.name) == 0)
+    {
+      type_code_ = k.code;
+      type_ = k.name;
+      break;
+    }
   }
-  return size;
+  try
+  {
+    if(!type_)
+    {
+      type_ = intern(type);
+    }
+    if(strcmp(subtype_, subtype) != 0) // e.g. unchanged by tprealloc
+    {
+      subtype_ = intern(subtype);
+    }
+  }
+  catch(...)
+  {
+    // out of memory interning; fall back to querying on demand
+    reset_metadata();
+    type_code_ = buffer_type::unknown;
+  }
+}
+
+void buffer::reset_metadata() noexcept
+{
+  capacity_ = 0;
+  type_ = "";
+  subtype_ = "";
+  type_code_ = buffer_type::none;
 }
 
 long buffer::data_size() const noexcept
@@ -185,6 +329,60 @@ void buffer::data_size(long size) noexcept
   }
 }
 
+long buffer::payload_size() const noexcept
+{
+  if(!data_)
+  {
+    return 0;
+  }
+  long result = -1;
+  switch(type_code_)
+  {
+    case buffer_type::fml32:
+      result = Fused32(reinterpret_cast<FBFR32*>(data_));
+      break;
+    case buffer_type::fml:
+      result = Fused(reinterpret_cast<FBFR*>(data_));
+      break;
+    case buffer_type::view32:
+      result = Fvneeded32(const_cast<char*>(subtype_));
+      break;
+    case buffer_type::view:
+    case buffer_type::x_c_type:
+    case buffer_type::x_common:
+      result = Fvneeded(const_cast<char*>(subtype_));
+      break;
+    case buffer_type::string:
+      {
+        const void* terminator = memchr(data_, '\0', capacity_);
+        if(terminator)
+        {
+          result = static_cast<const char*>(terminator) - data_ + 1;
+        }
+      }
+      break;
+    case buffer_type::carray:
+    case buffer_type::x_octet:
+      return data_size_;
+    default:
+      break;
+  }
+  if(result > 0)
+  {
+    return result;
+  }
+  return data_size_ > 0 ? data_size_ : capacity_;
+}
+
+void buffer::shrink_to_fit()
+{
+  long payload = payload_size();
+  if(payload > 0 && payload < size())
+  {
+    realloc(payload);
+  }
+}
+
 /*
 char* buffer::data() noexcept
 {
@@ -196,6 +394,16 @@ const char* buffer::data() const noexcept
    return data_;
 }
 */
+namespace
+{
+    // compressed_base64 output starts with a base64 encoded compress() header
+    bool is_compressed_base64(string const& x)
+    {
+        string header;
+        return x.size() >= 16 && base64_decode(string_ref(x.data(), 16), header) && is_compressed(header);
+    }
+}
+
 std::string export_buffer(buffer const& x, export_mode mode, string&& output)
 {
   if(!x)
@@ -236,6 +444,16 @@ std::string export_buffer(buffer const& x, export_mode mode, string&& output)
     throw last_error("tpexport");
   }
   output.resize(result_size);
+  if(mode == export_mode::compressed)
+  {
+    return compress(output);
+  }
+  if(mode == export_mode::compressed_base64)
+  {
+    string encoded;
+    base64_encode(compress(output), encoded);
+    return encoded;
+  }
   return move(output);
 }
 
@@ -249,11 +467,35 @@ buffer import_buffer(string const& x, export_mode mode, buffer&& output)
   {
     output.alloc_default();
   }
+  // undo compression, leaving plain tpexport output
+  string uncompressed;
+  const string* input = &x;
+  long flags = TPNOFLAGS;
+  if(mode == export_mode::base64 || mode == export_mode::compressed_base64)
+  {
+    flags = TPEX_STRING;
+    if(is_compressed_base64(x))
+    {
+      string decoded;
+      if(!base64_decode(x, decoded))
+      {
+        throw runtime_error("import_buffer: invalid base64");
+      }
+      uncompressed = decompress(decoded);
+      input = &uncompressed;
+      flags = TPNOFLAGS;
+    }
+  }
+  else if(is_compressed(x))
+  {
+    uncompressed = decompress(x);
+    input = &uncompressed;
+  }
+  
   long olen = output.data_size();
   char* o = output.release();
-  long flags = mode == export_mode::base64 ? TPEX_STRING : TPNOFLAGS;
-  int rc = tpimport(const_cast<char*>(x.data()),
-                    x.size(),
+  int rc = tpimport(const_cast<char*>(input->data()),
+                    input->size(),
                     &o,
                     &olen,
                     flags);
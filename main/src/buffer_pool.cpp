@@ -0,0 +1,259 @@
+#include <cstring>
+#include "fml32.h" // 32 must come before 16
+#include "fml.h"
+#include "tux/buffer_pool.hpp"
+#include "tux/util.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    const int min_class = 10; // 1KB, roughly what tpalloc hands out by default
+    const int max_class = 30; // 1GB; 1L << 31 overflows where long is 32 bits
+    const int max_class_overshoot = 2; // serve requests from buffers up to 4x larger
+
+    thread_local buffer_pool* current_pool = nullptr;
+
+    // smallest class whose buffers all hold at least size bytes
+    int request_class(long size) noexcept
+    {
+        int c = min_class;
+        while(c < max_class && (1L << c) < size)
+        {
+            ++c;
+        }
+        return c;
+    }
+
+    // largest class whose size is covered by capacity
+    int capacity_class(long capacity) noexcept
+    {
+        int c = 0;
+        while(c < max_class && (1L << (c + 1)) <= capacity)
+        {
+            ++c;
+        }
+        return c;
+    }
+
+    bool equal(std::string const& a, const char* b) noexcept
+    {
+        return b ? a == b : a.empty();
+    }
+
+    // types reinitialize() can make look freshly allocated; others (e.g.
+    // MBSTRING's encoding, RECORD's layout, custom types) aren't pooled
+    bool poolable(const char* type) noexcept
+    {
+        static const char* const types[] = {"FML32", "FML", "VIEW32", "VIEW", "X_C_TYPE", "X_COMMON",
+                                            "STRING", "CARRAY", "X_OCTET", "XML"};
+        for(const char* t : types)
+        {
+            if(strcmp(type, t) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reinitialize(char* data, long capacity, std::string const& type, std::string const& subtype) noexcept
+    {
+        if(type == "FML32")
+        {
+            Finit32(reinterpret_cast<FBFR32*>(data), static_cast<FLDLEN32>(capacity));
+        }
+        else if(type == "FML")
+        {
+            Finit(reinterpret_cast<FBFR*>(data), static_cast<FLDLEN>(clamp(capacity, 0L, 0xFFFFL)));
+        }
+        else if(type == "VIEW32")
+        {
+            Fvsinit32(data, const_cast<char*>(subtype.c_str()));
+        }
+        else if(type == "VIEW" || type == "X_C_TYPE" || type == "X_COMMON")
+        {
+            Fvsinit(data, const_cast<char*>(subtype.c_str()));
+        }
+        else // STRING, XML, CARRAY, X_OCTET
+        {
+            data[0] = '\0';
+        }
+    }
+}
+
+buffer_pool::buffer_pool(size_t max_per_class) :
+    max_per_class_(max_per_class)
+{
+}
+
+buffer_pool::~buffer_pool() noexcept
+{
+    if(current_pool == this)
+    {
+        current_pool = nullptr;
+    }
+    clear();
+}
+
+char* buffer_pool::allocate(const char* type, const char* subtype, long size)
+{
+    int c = request_class(size);
+    // nothing in the largest class is known to hold more than its class size
+    size_classes* s = size <= (1L << max_class) ? find(type, subtype) : nullptr;
+    if(s)
+    {
+        int last = min(c + max_class_overshoot, max_class);
+        for(int i = c; i <= last; ++i)
+        {
+            auto& idle = s->classes[i];
+            if(!idle.empty())
+            {
+                auto entry = idle.back();
+                idle.pop_back();
+                ++stats_.hits;
+                reinitialize(entry.first, entry.second, s->type, s->subtype);
+                return entry.first;
+            }
+        }
+    }
+
+    ++stats_.misses;
+    char* data = tpalloc(const_cast<char*>(type),
+                         const_cast<char*>(subtype),
+                         max(size, 1L << c));
+    if(!data)
+    {
+        throw last_error("tpalloc");
+    }
+    return data;
+}
+
+bool buffer_pool::deallocate(char* data) noexcept
+{
+    if(!data)
+    {
+        return false;
+    }
+    char type[9] = {};
+    char subtype[17] = {};
+    long capacity = tptypes(data, type, subtype);
+    return deallocate(data, type, subtype, capacity);
+}
+
+bool buffer_pool::deallocate(char* data, const char* type, const char* subtype, long capacity) noexcept
+{
+    if(!data || !type)
+    {
+        return false;
+    }
+    if(capacity < (1L << min_class) || max_per_class_ == 0 || !poolable(type))
+    {
+        ++stats_.discards;
+        return false;
+    }
+
+    try
+    {
+        size_classes* s = find(type, subtype);
+        if(!s)
+        {
+            free_lists_.emplace_back();
+            s = &free_lists_.back();
+            s->type = type;
+            s->subtype = subtype ? subtype : "";
+            s->classes.resize(max_class + 1);
+        }
+        auto& idle = s->classes[capacity_class(capacity)];
+        if(idle.size() >= max_per_class_)
+        {
+            ++stats_.discards;
+            return false;
+        }
+        idle.emplace_back(data, capacity);
+        ++stats_.returns;
+        return true;
+    }
+    catch(...)
+    {
+        ++stats_.discards;
+        return false;
+    }
+}
+
+void buffer_pool::clear() noexcept
+{
+    for(auto& s : free_lists_)
+    {
+        for(auto& idle : s.classes)
+        {
+            for(auto const& entry : idle)
+            {
+                tpfree(entry.first);
+            }
+            idle.clear();
+        }
+    }
+}
+
+size_t buffer_pool::idle() const noexcept
+{
+    size_t result = 0;
+    for(auto const& s : free_lists_)
+    {
+        for(auto const& idle : s.classes)
+        {
+            result += idle.size();
+        }
+    }
+    return result;
+}
+
+buffer_pool::statistics const& buffer_pool::stats() const noexcept
+{
+    return stats_;
+}
+
+void buffer_pool::reset_stats() noexcept
+{
+    stats_ = statistics();
+}
+
+buffer_pool* buffer_pool::current() noexcept
+{
+    return current_pool;
+}
+
+buffer_pool* buffer_pool::make_current(buffer_pool* x) noexcept
+{
+    buffer_pool* previous = current_pool;
+    current_pool = x;
+    return previous;
+}
+
+buffer_pool::size_classes* buffer_pool::find(const char* type, const char* subtype) noexcept
+{
+    for(auto& s : free_lists_)
+    {
+        if(equal(s.type, type) && equal(s.subtype, subtype))
+        {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+buffer_pool_scope::buffer_pool_scope(buffer_pool& x) noexcept :
+    previous_(buffer_pool::make_current(&x))
+{
+}
+
+buffer_pool_scope::~buffer_pool_scope() noexcept
+{
+    buffer_pool::make_current(previous_);
+}
+
+}
@@ -28,7 +28,7 @@ carray::carray(carray const& x)
 
 carray::carray(class buffer&& x)
 {
-    if(x && x.type() != "CARRAY")
+    if(x && x.type_code() != buffer_type::carray)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to carray");
     }
@@ -55,7 +55,7 @@ carray& carray::operator=(carray const& x)
 
 carray& carray::operator=(class buffer&& x)
 {
-    if(x && x.type() != "CARRAY")
+    if(x && x.type_code() != buffer_type::carray)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to carray");
     }
@@ -0,0 +1,266 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "tux/compression.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    const char magic[4] = {'T', 'X', 'Z', '1'};
+    const size_t header_size = sizeof(magic) + 8;
+
+    // LZ4 block format parameters
+    const size_t min_match = 4;
+    const size_t last_literals = 5; // the block always ends with this many literals
+    const size_t match_search_limit = 12; // no match starts in the final 12 bytes
+    const size_t max_offset = 65535;
+    const int hash_bits = 14;
+
+    uint32_t read32(const unsigned char* p) noexcept
+    {
+        uint32_t x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
+
+    uint32_t hash(uint32_t x) noexcept
+    {
+        return (x * 2654435761U) >> (32 - hash_bits);
+    }
+
+    // writes a length continuation (after the 15 in a token nibble)
+    unsigned char* write_length(unsigned char* op, size_t len) noexcept
+    {
+        for(; len >= 255; len -= 255)
+        {
+            *op++ = 255;
+        }
+        *op++ = static_cast<unsigned char>(len);
+        return op;
+    }
+
+    unsigned char* write_sequence(unsigned char* op, const unsigned char* literals, size_t literal_len,
+                                  size_t offset, size_t match_len) noexcept
+    {
+        unsigned char* token = op++;
+        *token = static_cast<unsigned char>((literal_len < 15 ? literal_len : 15) << 4);
+        if(literal_len >= 15)
+        {
+            op = write_length(op, literal_len - 15);
+        }
+        memcpy(op, literals, literal_len);
+        op += literal_len;
+        if(match_len == 0)
+        {
+            return op; // the final literals have no match
+        }
+        *op++ = static_cast<unsigned char>(offset & 0xff);
+        *op++ = static_cast<unsigned char>(offset >> 8);
+        size_t ml = match_len - min_match;
+        *token |= static_cast<unsigned char>(ml < 15 ? ml : 15);
+        if(ml >= 15)
+        {
+            op = write_length(op, ml - 15);
+        }
+        return op;
+    }
+
+    // compresses n bytes at in into out (which must have room for
+    // n + n / 255 + 16 bytes); returns the compressed size
+    size_t compress_block(const unsigned char* in, size_t n, unsigned char* out)
+    {
+        unsigned char* op = out;
+        size_t anchor = 0;
+        if(n > match_search_limit)
+        {
+            vector<uint32_t> table(size_t(1) << hash_bits, 0);
+            const size_t search_end = n - match_search_limit;
+            const size_t match_end = n - last_literals;
+            size_t ip = 0;
+            while(ip < search_end)
+            {
+                uint32_t sequence = read32(in + ip);
+                uint32_t& slot = table[hash(sequence)];
+                size_t ref = slot;
+                slot = static_cast<uint32_t>(ip);
+                if(ref >= ip || ip - ref > max_offset || read32(in + ref) != sequence)
+                {
+                    // skip faster through incompressible data
+                    ip += 1 + ((ip - anchor) >> 6);
+                    continue;
+                }
+
+                while(ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1])
+                {
+                    --ip;
+                    --ref;
+                }
+                size_t len = min_match;
+                while(ip + len < match_end && in[ref + len] == in[ip + len])
+                {
+                    ++len;
+                }
+                op = write_sequence(op, in + anchor, ip - anchor, ip - ref, len);
+                ip += len;
+                anchor = ip;
+                if(ip - 2 < search_end)
+                {
+                    table[hash(read32(in + ip - 2))] = static_cast<uint32_t>(ip - 2);
+                }
+            }
+        }
+        op = write_sequence(op, in + anchor, n - anchor, 0, 0);
+        return static_cast<size_t>(op - out);
+    }
+
+    void malformed()
+    {
+        throw runtime_error("malformed compressed data");
+    }
+
+    size_t read_length(const unsigned char*& ip, const unsigned char* end)
+    {
+        size_t len = 0;
+        unsigned char b;
+        do
+        {
+            if(ip == end)
+            {
+                malformed();
+            }
+            b = *ip++;
+            len += b;
+        } while(b == 255);
+        return len;
+    }
+
+    // decompresses a block into exactly out_size bytes at out
+    void decompress_block(const unsigned char* ip, size_t n, unsigned char* out, size_t out_size)
+    {
+        const unsigned char* end = ip + n;
+        size_t op = 0;
+        while(ip < end)
+        {
+            unsigned token = *ip++;
+            size_t literal_len = token >> 4;
+            if(literal_len == 15)
+            {
+                literal_len += read_length(ip, end);
+            }
+            if(literal_len > static_cast<size_t>(end - ip) || literal_len > out_size - op)
+            {
+                malformed();
+            }
+            memcpy(out + op, ip, literal_len);
+            ip += literal_len;
+            op += literal_len;
+            if(ip == end)
+            {
+                break; // final literals
+            }
+
+            if(end - ip < 2)
+            {
+                malformed();
+            }
+            size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            size_t match_len = token & 15;
+            if(match_len == 15)
+            {
+                match_len += read_length(ip, end);
+            }
+            match_len += min_match;
+            if(offset == 0 || offset > op || match_len > out_size - op)
+            {
+                malformed();
+            }
+            const unsigned char* match = out + op - offset;
+            if(offset >= match_len)
+            {
+                memcpy(out + op, match, match_len);
+            }
+            else
+            {
+                for(size_t i = 0; i < match_len; ++i) // overlapping: a repeating pattern
+                {
+                    out[op + i] = match[i];
+                }
+            }
+            op += match_len;
+        }
+        if(op != out_size)
+        {
+            malformed();
+        }
+    }
+}
+
+string compress(string_ref x)
+{
+    size_t n = x.size();
+    if(n > UINT32_MAX)
+    {
+        throw length_error("cannot compress more than 4GB");
+    }
+    string result(header_size + n + n / 255 + 16, '\0');
+    unsigned char* out = reinterpret_cast<unsigned char*>(&result[0]);
+    memcpy(out, magic, sizeof(magic));
+    for(int i = 0; i < 8; ++i)
+    {
+        out[sizeof(magic) + i] = static_cast<unsigned char>(static_cast<uint64_t>(n) >> (8 * i));
+    }
+    size_t len = compress_block(reinterpret_cast<const unsigned char*>(x.data()), n, out + header_size);
+    result.resize(header_size + len);
+    return result;
+}
+
+string decompress(string_ref x)
+{
+    if(!is_compressed(x) || x.size() < header_size)
+    {
+        malformed();
+    }
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(x.data());
+    uint64_t n = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        n |= static_cast<uint64_t>(in[sizeof(magic) + i]) << (8 * i);
+    }
+    // every compressed byte yields at most 255 + 4 (or so) bytes; this
+    // rejects absurd sizes before allocating
+    size_t body_size = x.size() - header_size;
+    if(n > static_cast<uint64_t>(body_size) * 256 + 16)
+    {
+        malformed();
+    }
+    string result(static_cast<size_t>(n), '\0');
+    if(n == 0)
+    {
+        return result; // compress() emits a single empty token
+    }
+    decompress_block(in + header_size, body_size, reinterpret_cast<unsigned char*>(&result[0]), result.size());
+    return result;
+}
+
+bool is_compressed(string_ref x) noexcept
+{
+    return x.size() >= header_size && memcmp(x.data(), magic, sizeof(magic)) == 0;
+}
+
+void compress(carray& x)
+{
+    x = compress(string_ref(x.data(), static_cast<size_t>(x.size())));
+}
+
+void decompress(carray& x)
+{
+    x = decompress(string_ref(x.data(), static_cast<size_t>(x.size())));
+}
+
+}
@@ -1,4 +1,5 @@
 #include "tux/context.hpp"
+#include "tux/field_table.hpp"
 #include "tux/util.hpp"
 #include <iostream>
 
@@ -47,6 +48,7 @@ void initialize(init_request const& x,
             throw last_error("tpinit");
         }
     }
+    field_table::preload(); // on failure, Tuxedo loads them lazily as usual
 }
 
 void terminate(context_mode mode)
@@ -59,7 +59,7 @@ void conversation::connect(string const& service_name,
     closed_gracefully_ = false;
     int rc = tpconnect(const_cast<char*>(service_name.c_str()),
                        const_cast<char*>(data.data()),
-                       data.data_size(),
+                       data.payload_size(),
                        flags);
     if(rc == -1)
     {
@@ -95,7 +95,7 @@ void conversation::send(buffer const& data,
     long revent = 0; // TODO figure this out
     int rc = tpsend(cd_,
                     const_cast<char*>(data.data()),
-                    data.data_size(),
+                    data.payload_size(),
                     flags,
                     &revent);
     if(rc == -1)
@@ -59,6 +59,7 @@ void convert(record const& src, fml32& dest, int mode, std::string const& field_
         {
             dest.reserve(0);
         }
+        dest.modified();
         int rc = Fvrtof32(dest.as_fbfr(),
                          const_cast<RECORD*>(src.as_record()),
                          field_name.empty() ? nullptr : const_cast<char*>(field_name.c_str()),
@@ -27,7 +27,7 @@ cstring::cstring(cstring const& x)
 
 cstring::cstring(class buffer&& x)
 {
-    if(x && x.type() != "STRING")
+    if(x && x.type_code() != buffer_type::string)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to cstring");
     }
@@ -54,7 +54,7 @@ cstring& cstring::operator=(cstring const& x)
 
 cstring& cstring::operator=(class buffer&& x)
 {
-    if(x && x.type() != "STRING")
+    if(x && x.type_code() != buffer_type::string)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to cstring");
     }
@@ -0,0 +1,109 @@
+#include "tux/expression_cache.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+expression_cache::expression_cache(size_t capacity) :
+    capacity_(capacity)
+{
+}
+
+void expression_cache::clear() noexcept
+{
+    lock_guard<mutex> lock(mutex_);
+    index_.clear();
+    lru_.clear();
+}
+
+size_t expression_cache::size() const noexcept
+{
+    lock_guard<mutex> lock(mutex_);
+    return lru_.size();
+}
+
+size_t expression_cache::capacity() const noexcept
+{
+    lock_guard<mutex> lock(mutex_);
+    return capacity_;
+}
+
+void expression_cache::set_capacity(size_t capacity)
+{
+    lock_guard<mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict_to(capacity_);
+}
+
+expression_cache::statistics expression_cache::stats() const noexcept
+{
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+void expression_cache::reset_stats() noexcept
+{
+    lock_guard<mutex> lock(mutex_);
+    stats_ = statistics();
+}
+
+expression_cache& expression_cache::global()
+{
+    static expression_cache instance;
+    return instance;
+}
+
+string expression_cache::make_key(string const& domain, string const& text)
+{
+    string key;
+    key.reserve(domain.size() + 1 + text.size());
+    key += domain;
+    key += '\0'; // can't appear in a domain
+    key += text;
+    return key;
+}
+
+expression_cache::tree expression_cache::find(string const& key)
+{
+    lock_guard<mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if(it == index_.end())
+    {
+        ++stats_.misses;
+        return tree();
+    }
+    ++stats_.hits;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+expression_cache::tree expression_cache::insert(string key, tree x)
+{
+    lock_guard<mutex> lock(mutex_);
+    if(capacity_ == 0)
+    {
+        return x;
+    }
+    auto it = index_.find(key);
+    if(it != index_.end())
+    {
+        return it->second->second;
+    }
+    lru_.emplace_front(move(key), x);
+    index_.emplace(lru_.front().first, lru_.begin());
+    evict_to(capacity_);
+    return x;
+}
+
+void expression_cache::evict_to(size_t capacity) noexcept
+{
+    while(lru_.size() > capacity)
+    {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+}
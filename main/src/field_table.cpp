@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include "atmi.h"
+#include "tux/field_table.hpp"
+#include "tux/hash.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    const struct { const char* name; int type; } field_types[] =
+    {
+        {"short", FLD_SHORT}, {"long", FLD_LONG}, {"char", FLD_CHAR},
+        {"float", FLD_FLOAT}, {"double", FLD_DOUBLE}, {"string", FLD_STRING},
+        {"carray", FLD_CARRAY}, {"mbstring", FLD_MBSTRING}, {"ptr", FLD_PTR},
+        {"fml32", FLD_FML32}, {"view32", FLD_VIEW32}
+    };
+
+    int field_type_from_name(string_ref name) noexcept
+    {
+        for(auto const& t : field_types)
+        {
+            if(name == t.name)
+            {
+                return t.type;
+            }
+        }
+        return -1;
+    }
+
+    // splits a line into (up to n) whitespace separated words
+    size_t split_words(string const& line, string_ref* words, size_t n) noexcept
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < line.size() && count < n; )
+        {
+            while(i < line.size() && isspace(static_cast<unsigned char>(line[i])))
+            {
+                ++i;
+            }
+            size_t start = i;
+            while(i < line.size() && !isspace(static_cast<unsigned char>(line[i])))
+            {
+                ++i;
+            }
+            if(i > start)
+            {
+                words[count++] = string_ref(line.data() + start, i - start);
+            }
+        }
+        return count;
+    }
+
+    bool parse_number(string_ref x, long& result)
+    {
+        string s(x.data(), x.size());
+        char* end = nullptr;
+        result = strtol(s.c_str(), &end, 0);
+        return !s.empty() && *end == '\0';
+    }
+
+    // reads a field table [see the FML documentation for the format]
+    void read_field_table(string const& path, vector<field_table::entry>& entries)
+    {
+        ifstream is(path);
+        if(!is)
+        {
+            throw runtime_error("cannot read field table " + path);
+        }
+        string line;
+        long base = 0;
+        for(int line_number = 1; getline(is, line); ++line_number)
+        {
+            if(line.empty() || line[0] == '#' || line[0] == '$')
+            {
+                continue; // comments, and lines for mkfldhdr32
+            }
+            string_ref words[3];
+            size_t count = split_words(line, words, 3);
+            if(count == 0)
+            {
+                continue;
+            }
+            if(words[0] == "*base")
+            {
+                if(count < 2 || !parse_number(words[1], base))
+                {
+                    throw runtime_error(path + ":" + to_string(line_number) + ": malformed *base");
+                }
+                continue;
+            }
+            long number = 0;
+            int type = count == 3 ? field_type_from_name(words[2]) : -1;
+            FLDID32 id = type != -1 && parse_number(words[1], number) ?
+                         Fmkfldid32(type, static_cast<FLDID32>(base + number)) : BADFLDID;
+            if(id == BADFLDID)
+            {
+                throw runtime_error(path + ":" + to_string(line_number) + ": malformed field definition");
+            }
+            entries.push_back(field_table::entry{id, string(words[0].data(), words[0].size())});
+        }
+    }
+
+    vector<string> split(string const& x, char delimiter)
+    {
+        vector<string> result;
+        stringstream s(x);
+        string item;
+        while(getline(s, item, delimiter))
+        {
+            if(!item.empty())
+            {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
+
+    string get_env(const char* name, const char* default_value)
+    {
+        const char* value = tuxgetenv(const_cast<char*>(name));
+        return value && *value ? value : default_value;
+    }
+
+    // slot_count is a power of 2, and the step is odd, so successive
+    // displacements visit every slot
+    uint64_t slot_of(uint64_t h, uint32_t displacement, size_t slot_count) noexcept
+    {
+        return ((h >> 32) + static_cast<uint64_t>(displacement) * (static_cast<uint32_t>(h) | 1)) & (slot_count - 1);
+    }
+
+    string_ref id_key(FLDID32 const& id) noexcept
+    {
+        return string_ref(reinterpret_cast<const char*>(&id), sizeof(id));
+    }
+
+    atomic<field_table const*> current_table(nullptr);
+    mutex loaded_tables_mutex;
+    vector<unique_ptr<field_table>> loaded_tables; // keeps every published table alive
+    string failed_configuration; // FLDTBLDIR32 and FIELDTBLS32 when preload() last failed, guarded as above
+
+    string configuration()
+    {
+        return get_env("FLDTBLDIR32", ".") + '\n' + get_env("FIELDTBLS32", "fld.tbl");
+    }
+}
+
+constexpr uint32_t field_table::perfect_hash::empty_slot;
+
+// Hash and displace: keys are hashed into small buckets, then, largest
+// bucket first, each bucket gets the first displacement that puts all its
+// keys into free slots.  Lookups hash once, and need no probing.
+template <typename KeyOf>
+void field_table::perfect_hash::build(vector<uint32_t> const& members, KeyOf key_of)
+{
+    const size_t n = members.size();
+    const size_t bucket_count = n / 4 + 1;
+    size_t slot_count = 1;
+    while(slot_count < n + n / 4 + 1)
+    {
+        slot_count *= 2;
+    }
+    const uint32_t max_displacement = static_cast<uint32_t>(slot_count * 8);
+    vector<uint64_t> hashes(n);
+    vector<vector<uint32_t>> buckets;
+    vector<uint64_t> positions;
+    for(seed = 0; seed < 32; ++seed)
+    {
+        buckets.assign(bucket_count, vector<uint32_t>());
+        for(size_t i = 0; i < n; ++i)
+        {
+            string_ref key = key_of(members[i]);
+            hashes[i] = hash_bytes(key.data(), key.size(), seed);
+            buckets[hashes[i] % bucket_count].push_back(static_cast<uint32_t>(i));
+        }
+        vector<uint32_t> order(bucket_count);
+        for(size_t b = 0; b < bucket_count; ++b)
+        {
+            order[b] = static_cast<uint32_t>(b);
+        }
+        stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b)
+        {
+            return buckets[a].size() > buckets[b].size();
+        });
+        displacements.assign(bucket_count, 0);
+        slots.assign(slot_count, empty_slot);
+
+        bool placed_all = true;
+        for(uint32_t b : order)
+        {
+            auto const& bucket = buckets[b];
+            if(bucket.empty())
+            {
+                break; // and so are the rest
+            }
+            bool placed = false;
+            for(uint32_t d = 0; d < max_displacement && !placed; ++d)
+            {
+                positions.clear();
+                placed = true;
+                for(uint32_t i : bucket)
+                {
+                    uint64_t p = slot_of(hashes[i], d, slot_count);
+                    if(slots[p] != empty_slot || std::find(positions.begin(), positions.end(), p) != positions.end())
+                    {
+                        placed = false;
+                        break;
+                    }
+                    positions.push_back(p);
+                }
+                if(placed)
+                {
+                    displacements[b] = d;
+                    for(size_t k = 0; k < bucket.size(); ++k)
+                    {
+                        slots[positions[k]] = members[bucket[k]];
+                    }
+                }
+            }
+            if(!placed)
+            {
+                placed_all = false; // e.g. two keys with the same 64 bit hash: try another seed
+                break;
+            }
+        }
+        if(placed_all)
+        {
+            return;
+        }
+    }
+    throw runtime_error("cannot index field table");
+}
+
+uint32_t field_table::perfect_hash::find(string_ref key) const noexcept
+{
+    if(slots.empty())
+    {
+        return empty_slot;
+    }
+    uint64_t h = hash_bytes(key.data(), key.size(), seed);
+    return slots[slot_of(h, displacements[h % displacements.size()], slots.size())];
+}
+
+field_table::field_table(vector<string> const& files) :
+    files_(files)
+{
+    auto start = chrono::steady_clock::now();
+    for(auto const& f : files_)
+    {
+        read_field_table(f, entries_);
+    }
+    if(entries_.size() >= perfect_hash::empty_slot)
+    {
+        throw runtime_error("too many fields");
+    }
+
+    // index the first definition of each name and id
+    vector<uint32_t> first_names;
+    vector<uint32_t> first_ids;
+    {
+        vector<uint32_t> order(entries_.size());
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        auto by_name = order;
+        stable_sort(by_name.begin(), by_name.end(), [this](uint32_t a, uint32_t b)
+        {
+            return entries_[a].name < entries_[b].name;
+        });
+        for(size_t i = 0; i < by_name.size(); ++i)
+        {
+            if(i == 0 || entries_[by_name[i]].name != entries_[by_name[i - 1]].name)
+            {
+                first_names.push_back(by_name[i]);
+            }
+        }
+        auto by_id = order;
+        stable_sort(by_id.begin(), by_id.end(), [this](uint32_t a, uint32_t b)
+        {
+            return entries_[a].id < entries_[b].id;
+        });
+        for(size_t i = 0; i < by_id.size(); ++i)
+        {
+            if(i == 0 || entries_[by_id[i]].id != entries_[by_id[i - 1]].id)
+            {
+                first_ids.push_back(by_id[i]);
+            }
+        }
+    }
+    name_index_.build(first_names, [this](uint32_t i) { return string_ref(entries_[i].name); });
+    id_index_.build(first_ids, [this](uint32_t i) { return id_key(entries_[i].id); });
+    load_time_ = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+}
+
+FLDID32 field_table::id(string_ref name) const noexcept
+{
+    uint32_t i = name_index_.find(name);
+    if(i == perfect_hash::empty_slot)
+    {
+        return BADFLDID;
+    }
+    string const& candidate = entries_[i].name;
+    return candidate.size() == name.size() && memcmp(candidate.data(), name.data(), name.size()) == 0 ?
+           entries_[i].id : BADFLDID;
+}
+
+const char* field_table::name(FLDID32 id) const noexcept
+{
+    uint32_t i = id_index_.find(id_key(id));
+    return i != perfect_hash::empty_slot && entries_[i].id == id ? entries_[i].name.c_str() : nullptr;
+}
+
+size_t field_table::size() const noexcept
+{
+    return entries_.size();
+}
+
+vector<field_table::entry> const& field_table::entries() const noexcept
+{
+    return entries_;
+}
+
+vector<string> const& field_table::files() const noexcept
+{
+    return files_;
+}
+
+chrono::microseconds field_table::load_time() const noexcept
+{
+    return load_time_;
+}
+
+vector<string> field_table::configured_files()
+{
+#ifdef _WIN32
+    const char path_separator = ';';
+#else
+    const char path_separator = ':';
+#endif
+    vector<string> directories = split(get_env("FLDTBLDIR32", "."), path_separator);
+    vector<string> result;
+    for(auto const& name : split(get_env("FIELDTBLS32", "fld.tbl"), ','))
+    {
+        string path = name;
+        bool absolute = name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':');
+        if(!absolute)
+        {
+            for(auto const& d : directories)
+            {
+                string candidate = d + "/" + name;
+                if(ifstream(candidate))
+                {
+                    path = candidate;
+                    break;
+                }
+            }
+        }
+        result.push_back(path);
+    }
+    return result;
+}
+
+void field_table::load()
+{
+    unique_ptr<field_table> table(new field_table(configured_files()));
+    lock_guard<mutex> lock(loaded_tables_mutex);
+    loaded_tables.push_back(move(table));
+    current_table.store(loaded_tables.back().get(), memory_order_release);
+}
+
+bool field_table::preload() noexcept
+{
+    if(current())
+    {
+        return true;
+    }
+    string tried;
+    try
+    {
+        // every context::initialize() calls this: don't search for and
+        // parse the same unreadable tables again
+        tried = configuration();
+        {
+            lock_guard<mutex> lock(loaded_tables_mutex);
+            if(tried == failed_configuration)
+            {
+                return false;
+            }
+        }
+        load();
+        return true;
+    }
+    catch(...)
+    {
+        lock_guard<mutex> lock(loaded_tables_mutex);
+        failed_configuration = tried;
+        return false;
+    }
+}
+
+field_table const* field_table::current() noexcept
+{
+    return current_table.load(memory_order_acquire);
+}
+
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstring>
 #include "tux/fml16.hpp"
 #include "Uunix.h"
 
@@ -186,7 +187,7 @@ fml16& fml16::operator=(fml16 const& x) // Fcpy (or Fmove?)
 
 fml16::fml16(class buffer&& x)
 {
-    if(x && x.type() != "FML") // we could also permit malloced buffers (but that might be dangerous)
+    if(x && x.type_code() != buffer_type::fml) // we could also permit malloced buffers (but that might be dangerous)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to FML");   
     }
@@ -930,29 +931,115 @@ bool fml16::next_field(field_info& x) const
     return rc;
 }
 
-
-fml16::boolean_expression::boolean_expression(fml16::boolean_expression const& x)
+namespace
 {
-    if(x.tree_)
+    // values aren't guaranteed to be aligned for T
+    template <typename T> T read_value(const char* p) noexcept
     {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
-        {
-            throw bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
+        T x;
+        memcpy(&x, p, sizeof(x));
+        return x;
     }
 }
 
+fml16::const_iterator fml16::begin() const
+{
+    return buffer_ ? const_iterator(this) : end();
+}
 
-fml16::boolean_expression& fml16::boolean_expression::operator=(fml16::boolean_expression const& x)
+fml16::const_iterator fml16::end() const noexcept
 {
-    fml16::boolean_expression tmp(x);
-    *this = move(tmp);
+    return const_iterator();
+}
+
+fml16::const_iterator::const_iterator(const fml16* owner)
+{
+    ref_.owner_ = owner;
+    ref_.id_ = FIRSTFLDID;
+    ++*this;
+}
+
+fml16::const_iterator& fml16::const_iterator::operator++()
+{
+    // Fnext can only copy values out, so ask for the id and occurrence
+    // only, and leave the value to be found in place on demand
+    int rc = Fnext(const_cast<FBFR*>(ref_.owner_->as_fbfr()), &ref_.id_, &ref_.oc_, nullptr, nullptr);
+    if(rc == -1)
+    {
+        throw last_error("Fnext");
+    }
+    if(rc == 0)
+    {
+        ref_ = field_ref();
+    }
+    ref_.value_ = nullptr;
+    ref_.len_ = 0;
     return *this;
 }
 
+void fml16::field_ref::locate() const
+{
+    if(!value_)
+    {
+        value_ = owner_->find_value(id_, oc_, &len_);
+    }
+}
+
+const char* fml16::field_ref::data() const
+{
+    locate();
+    return value_;
+}
+
+FLDLEN fml16::field_ref::size() const
+{
+    locate();
+    return len_;
+}
+
+short fml16::field_ref::as_short() const
+{
+    return type() == FLD_SHORT ? read_value<short>(data()) : owner_->get_short(id_, oc_);
+}
+
+long fml16::field_ref::as_long() const
+{
+    return type() == FLD_LONG ? read_value<long>(data()) : owner_->get_long(id_, oc_);
+}
+
+char fml16::field_ref::as_char() const
+{
+    return type() == FLD_CHAR ? *data() : owner_->get_char(id_, oc_);
+}
+
+float fml16::field_ref::as_float() const
+{
+    return type() == FLD_FLOAT ? read_value<float>(data()) : owner_->get_float(id_, oc_);
+}
+
+double fml16::field_ref::as_double() const
+{
+    return type() == FLD_DOUBLE ? read_value<double>(data()) : owner_->get_double(id_, oc_);
+}
+
+string_ref fml16::field_ref::as_string_ref() const
+{
+    int t = type();
+    if(t != FLD_STRING && t != FLD_CARRAY)
+    {
+        throw error(FTYPERR, "as_string_ref - " + field_type_name(id_) + " field");
+    }
+    locate();
+    return string_ref(value_, t == FLD_STRING && len_ > 0 ? len_ - 1 : len_);
+}
+
+string fml16::field_ref::as_string() const
+{
+    int t = type();
+    return t == FLD_STRING || t == FLD_CARRAY ? as_string_ref().str() : owner_->get_string(id_, oc_);
+}
+
+
 fml16::boolean_expression::boolean_expression(std::string const& x)
 {
     compile(x);
@@ -968,13 +1055,13 @@ void fml16::boolean_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        Fboolpr(tree_.get(), f);
+        Fboolpr(const_cast<char*>(tree_.get()), f);
     }
 }
 
 bool fml16::boolean_expression::evaluate(fml16 const& x) const
 {
-    int result = Fboolev(const_cast<FBFR*>(x.as_fbfr()), tree_.get());
+    int result = Fboolev(const_cast<FBFR*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
     if(result == -1)
     {
         throw last_error("Fboolev");
@@ -995,45 +1082,16 @@ void fml16::boolean_expression::free() noexcept
 
 void fml16::boolean_expression::compile(std::string const& x)
 {
-    tree_.reset(Fboolco(const_cast<char*>(x.c_str())));
-    if(!tree_)
+    tree_ = expression_cache::global().get("FML16", x, [&x]
     {
-        throw last_error("Fboolco");
-    }
-}
-
-unsigned fml16::boolean_expression::size() const
-{
+        return Fboolco(const_cast<char*>(x.c_str()));
+    });
     if(!tree_)
     {
-        return 0;
-    }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
-}
-
-
-fml16::arithmetic_expression::arithmetic_expression(fml16::arithmetic_expression const& x)
-{
-    if(x.tree_)
-    {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
-        {
-            throw bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
+        throw last_error("Fboolco");
     }
 }
 
-
-fml16::arithmetic_expression& fml16::arithmetic_expression::operator=(fml16::arithmetic_expression const& x)
-{
-    fml16::arithmetic_expression tmp(x);
-    *this = move(tmp);
-    return *this;
-}
-
 fml16::arithmetic_expression::arithmetic_expression(std::string const& x)
 {
     compile(x);
@@ -1049,13 +1107,13 @@ void fml16::arithmetic_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        Fboolpr(tree_.get(), f);
+        Fboolpr(const_cast<char*>(tree_.get()), f);
     }
 }
 
 double fml16::arithmetic_expression::evaluate(fml16 const& x) const
 {
-    double result = Ffloatev(const_cast<FBFR*>(x.as_fbfr()), tree_.get());
+    double result = Ffloatev(const_cast<FBFR*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
     if(result == -1)
     {
         throw last_error("Ffloatev");
@@ -1075,22 +1133,128 @@ void fml16::arithmetic_expression::free() noexcept
 
 void fml16::arithmetic_expression::compile(std::string const& x)
 {
-    tree_.reset(Fboolco(const_cast<char*>(x.c_str())));
+    tree_ = expression_cache::global().get("FML16", x, [&x]
+    {
+        return Fboolco(const_cast<char*>(x.c_str()));
+    });
     if(!tree_)
     {
         throw last_error("Fboolco");
     }
 }
 
-unsigned fml16::arithmetic_expression::size() const
+
+//---------------------TYPED FIELDS----------------------------------------
+// the field type is known at compile time, so skip check_field_type
+// and the CF conversion functions
+
+namespace
 {
-    if(!tree_)
+    bool is_carray(FLDID id) noexcept
     {
-        return 0;
+        return static_cast<int>(id >> 13) == FLD_CARRAY;
     }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
 }
 
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, short& x) const
+{
+    FLDLEN len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, long& x) const
+{
+    FLDLEN len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, char& x) const
+{
+    FLDLEN len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, float& x) const
+{
+    FLDLEN len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, double& x) const
+{
+    FLDLEN len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml16::typed_get(FLDID fieldid, FLDOCC oc, string& x) const
+{
+    FLDLEN len = 0;
+    char* loc = find_value(fieldid, oc, &len);
+    if(is_carray(fieldid))
+    {
+        x.assign(loc, len);
+    }
+    else
+    {
+        x.assign(loc);
+    }
+}
+
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, short x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, long x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, char x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, float x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, double x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, const char* x)
+{
+    FLDLEN len = strlen(x);
+    set(fieldid, x, is_carray(fieldid) ? len : len + 1, oc);
+}
+void fml16::typed_set(FLDID fieldid, FLDOCC oc, string const& x)
+{
+    // FLD_STRING values must be null terminated, which c_str() guarantees
+    set(fieldid, x.c_str(), is_carray(fieldid) ? x.size() : x.size() + 1, oc);
+}
+
+void fml16::typed_add(FLDID fieldid, short x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml16::typed_add(FLDID fieldid, long x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml16::typed_add(FLDID fieldid, char x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml16::typed_add(FLDID fieldid, float x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml16::typed_add(FLDID fieldid, double x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml16::typed_add(FLDID fieldid, const char* x)
+{
+    FLDLEN len = strlen(x);
+    add(fieldid, x, is_carray(fieldid) ? len : len + 1);
+}
+void fml16::typed_add(FLDID fieldid, string const& x)
+{
+    add(fieldid, x.c_str(), is_carray(fieldid) ? x.size() : x.size() + 1);
+}
 
 //---------------------PRIVATE----------------------------------------
 
@@ -1154,7 +1318,6 @@ void fml16::get_and_convert(FLDID fieldid, FLDOCC oc, char* buf, FLDLEN* len, in
 
 void fml16::get(FLDID fieldid, FLDOCC oc, char* buf, FLDLEN* len) const
 {
-    string raw(buf,*len);
     int rc = Fget(const_cast<FBFR*>(as_fbfr()), fieldid, oc, buf, len);
     if(rc == -1)
     {
@@ -1,5 +1,10 @@
 #include <algorithm>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <unordered_map>
 #include <limits.h> // this may not be portable
+#include "tux/field_table.hpp"
 #include "tux/fml32.hpp"
 #include "Uunix.h"
 
@@ -234,6 +239,14 @@ string fml32::field_type_name_from_type(int type)
 
 FLDID32 fml32::field_id(const string &name)
 {
+    if(field_table const* table = field_table::current())
+    {
+        FLDID32 id = table->id(name);
+        if(id != BADFLDID)
+        {
+            return id;
+        }
+    }
     FLDID32 result = Fldid32(const_cast<char*>(name.c_str()));
     if(result == BADFLDID)
     {
@@ -244,6 +257,13 @@ FLDID32 fml32::field_id(const string &name)
 
 string fml32::field_name(FLDID32 id)
 {
+    if(field_table const* table = field_table::current())
+    {
+        if(const char* name = table->name(id))
+        {
+            return name;
+        }
+    }
     const char* result = Fname32(id);
     if(!result)
     {
@@ -330,9 +350,33 @@ fml32& fml32::operator=(fml32 const& x) // Fcpy (or Fmove?)
     return *this;
 }
 
+fml32::fml32(fml32&& x) noexcept :
+    buffer_(move(x.buffer_)),
+    generation_(move(x.generation_)), // the data doesn't move, so outstanding views stay valid
+    side_index_(move(x.side_index_)) // likewise
+{
+}
+
+fml32& fml32::operator=(fml32&& x) noexcept
+{
+    if(this != &x)
+    {
+        modified();
+        buffer_ = move(x.buffer_);
+        generation_ = move(x.generation_);
+        side_index_ = move(x.side_index_);
+    }
+    return *this;
+}
+
+fml32::~fml32() noexcept
+{
+    modified();
+}
+
 fml32::fml32(class buffer&& x)
 {
-    if(x && x.type() != "FML32") // we could also permit malloced buffers (but that might be dangerous)
+    if(x && x.type_code() != buffer_type::fml32) // we could also permit malloced buffers (but that might be dangerous)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to FML32");   
     }
@@ -371,11 +415,13 @@ class buffer& fml32::buffer() noexcept
 
 class buffer&& fml32::move_buffer() noexcept
 {
+    modified();
     return move(buffer_);
 }
 
 void fml32::reserve(long size)
 {
+    modified();
     if(!buffer_)
     {
         buffer_.alloc("FML32", nullptr, size);
@@ -437,6 +483,7 @@ void fml32::print_to_stdout() const // Fprint
 
 void fml32::extread(FILE* input, long size_hint) // Fextread
 {
+    modified();
     reserve(size_hint);
     int rc = Fextread32(as_fbfr(), input);
     if(rc == -1 && Ferror32 == FNOSPACE)
@@ -461,6 +508,7 @@ void fml32::write(FILE* output) const // Fwrite
 
 void fml32::read(FILE* input, long size_hint) // Fread
 {
+    modified();
     reserve(size_hint);
     int rc = Fread32(as_fbfr(), input);
     if(rc == -1 && Ferror32 == FNOSPACE)
@@ -477,6 +525,7 @@ void fml32::read(FILE* input, long size_hint) // Fread
 //------------------------INDEXING------------------------------------
 void fml32::index(FLDOCC32 interval) // Findex
 {
+    modified();
     if(buffer_)
     {
         int rc = Findex32(as_fbfr(), interval);
@@ -489,6 +538,7 @@ void fml32::index(FLDOCC32 interval) // Findex
 
 FLDOCC32 fml32::unindex() // Funindex
 {
+    modified();
     if(!buffer_)
     {
         return 0; 
@@ -503,6 +553,7 @@ FLDOCC32 fml32::unindex() // Funindex
 
 void fml32::restore_index(FLDOCC32 index_element_count) // Frstrindex
 {
+    modified();
     if(buffer_)
     {
         int rc = Frstrindex32(as_fbfr(), index_element_count);
@@ -513,6 +564,89 @@ void fml32::restore_index(FLDOCC32 index_element_count) // Frstrindex
     }
 }
 
+// occurrences of a field are contiguous in an FML32 buffer, so each field
+// maps to a run of slots; values are recorded as offsets into the buffer
+struct fml32::side_index
+{
+    struct slot
+    {
+        FLDID32 id; // so that iterators can walk the slots in buffer order
+        FLDOCC32 oc;
+        size_t offset;
+        FLDLEN32 len;
+    };
+    struct run
+    {
+        size_t first;
+        size_t count;
+    };
+    unordered_map<FLDID32, run> fields;
+    vector<slot> slots;
+};
+
+void fml32::build_side_index()
+{
+    side_index_.reset();
+    const FBFR32* f = static_cast<fml32 const&>(*this).as_fbfr(); // not a modification
+    if(!f)
+    {
+        return;
+    }
+    auto x = make_shared<side_index>();
+    FBFR32* fbfr = const_cast<FBFR32*>(f);
+    x->slots.reserve(Fnum32(fbfr));
+    const char* base = buffer_.data();
+    FLDID32 id = FIRSTFLDID;
+    FLDOCC32 oc = 0;
+    side_index::run* current = nullptr;
+    int rc;
+    while((rc = Fnext32(fbfr, &id, &oc, nullptr, nullptr)) == 1)
+    {
+        FLDLEN32 len = 0;
+        const char* value = Ffind32(fbfr, id, oc, &len); // Fnext32 only copies values
+        if(!value)
+        {
+            throw last_error("Ffind32");
+        }
+        if(oc == 0)
+        {
+            current = &(x->fields[id] = side_index::run{x->slots.size(), 0});
+        }
+        x->slots.push_back(side_index::slot{id, oc, static_cast<size_t>(value - base), len});
+        ++current->count;
+    }
+    if(rc == -1)
+    {
+        throw last_error("Fnext32");
+    }
+    side_index_ = move(x);
+}
+
+void fml32::drop_side_index() noexcept
+{
+    side_index_.reset();
+}
+
+bool fml32::has_side_index() const noexcept
+{
+    return static_cast<bool>(side_index_);
+}
+
+const char* fml32::find_indexed(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const noexcept
+{
+    auto it = side_index_->fields.find(id);
+    if(it == side_index_->fields.end() || oc < 0 || static_cast<size_t>(oc) >= it->second.count)
+    {
+        return nullptr;
+    }
+    auto const& slot = side_index_->slots[it->second.first + oc];
+    if(len)
+    {
+        *len = slot.len;
+    }
+    return buffer_.data() + slot.offset;
+}
+
 
 //----------------------------BYTES USED-----------------------------------
 
@@ -628,6 +762,7 @@ long fml32::field_value_size(FLDID32 id, FLDOCC32 oc) const
 //-------------------ELEMENT REMOVAL------------------------------
 bool fml32::erase(FLDID32 id, FLDOCC32 oc) // Fdel
 {
+    modified();
     if(!buffer_)
     {
         return false;
@@ -647,6 +782,7 @@ bool fml32::erase(FLDID32 id, FLDOCC32 oc) // Fdel
 
 bool fml32::erase(FLDID32 id) // Fdelall
 {
+    modified();
     if(!buffer_)
     {
         return false;
@@ -666,6 +802,7 @@ bool fml32::erase(FLDID32 id) // Fdelall
 
 void fml32::erase(vector<FLDID32> ids) // Fdelete
 {
+    modified();
     if(buffer_ && !ids.empty())
     {
         ids.push_back(BADFLDID);
@@ -679,6 +816,7 @@ void fml32::erase(vector<FLDID32> ids) // Fdelete
 
 void fml32::erase_all_but(vector<FLDID32> ids) // Fproj
 {
+    modified();
     if(buffer_)
     {
         ids.push_back(BADFLDID);
@@ -692,6 +830,7 @@ void fml32::erase_all_but(vector<FLDID32> ids) // Fproj
 
 void fml32::clear() // Finit
 {
+    modified();
     if(buffer_)
     {
         int rc = Finit32(as_fbfr(), size());
@@ -705,6 +844,7 @@ void fml32::clear() // Finit
 //-------------------OPERATIONS ON ENTIRE DATA STRUCTURES----------------------
 fml32& fml32::operator +=(fml32 const& x) // Fconcat
 {
+    modified();
     if(x)
     {
         reserve(used_size() + x.used_size());
@@ -719,6 +859,7 @@ fml32& fml32::operator +=(fml32 const& x) // Fconcat
 
 void fml32::join(fml32 const& x) // Fjoin
 {
+    modified();
     if(x)
     {
         reserve(used_size() + x.used_size());
@@ -736,6 +877,7 @@ void fml32::join(fml32 const& x) // Fjoin
 
 void fml32::outer_join(fml32 const& x) // Fojoin
 {
+    modified();
     if(x)
     {
         reserve(used_size() + x.used_size());
@@ -765,6 +907,7 @@ fml32 fml32::project(vector<FLDID32> ids) const // Fprojcpy
 
 void fml32::update(fml32 const& x) // Fupdate
 {
+    modified();
     if(x)
     {
         reserve(used_size() + x.used_size());
@@ -776,6 +919,257 @@ void fml32::update(fml32 const& x) // Fupdate
     }
 }
 
+constexpr FLDID32 fml32::patch_field;
+
+namespace
+{
+    struct occurrence
+    {
+        FLDID32 id;
+        const char* value;
+        FLDLEN32 len;
+    };
+    
+    // every occurrence in f (except those of skip), in field id order
+    vector<occurrence> occurrences_of(FBFR32* f, FLDID32 skip = BADFLDID)
+    {
+        vector<occurrence> result;
+        if(f)
+        {
+            result.reserve(Fnum32(f));
+            FLDID32 id = FIRSTFLDID;
+            FLDOCC32 oc = 0;
+            int rc;
+            while((rc = Fnext32(f, &id, &oc, nullptr, nullptr)) == 1)
+            {
+                if(id != skip)
+                {
+                    FLDLEN32 len = 0;
+                    const char* value = Ffind32(f, id, oc, &len); // Fnext32 only copies values
+                    result.push_back(occurrence{id, value, len});
+                }
+            }
+            if(rc == -1)
+            {
+                throw fml32::last_error("Fnext32");
+            }
+        }
+        return result;
+    }
+    
+    vector<occurrence> occurrences_of(fml32 const& x, FLDID32 skip = BADFLDID)
+    {
+        return occurrences_of(const_cast<FBFR32*>(x.as_fbfr()), skip);
+    }
+    
+    // number of consecutive occurrences of id starting at x[i]
+    size_t run_length(vector<occurrence> const& x, size_t i, FLDID32 id) noexcept
+    {
+        size_t n = 0;
+        while(i + n < x.size() && x[i + n].id == id)
+        {
+            ++n;
+        }
+        return n;
+    }
+    
+    // nested fml32 values are compared field by field: equal buffers can
+    // differ in their unused space and index
+    bool same_value(occurrence const& a, occurrence const& b)
+    {
+        if(Fldtype32(a.id) != FLD_FML32)
+        {
+            return a.len == b.len && memcmp(a.value, b.value, a.len) == 0;
+        }
+        vector<occurrence> x = occurrences_of(reinterpret_cast<FBFR32*>(const_cast<char*>(a.value)));
+        vector<occurrence> y = occurrences_of(reinterpret_cast<FBFR32*>(const_cast<char*>(b.value)));
+        if(x.size() != y.size())
+        {
+            return false;
+        }
+        for(size_t i = 0; i < x.size(); ++i)
+        {
+            if(x[i].id != y[i].id || !same_value(x[i], y[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // for messages which mustn't fail on an unknown field name
+    string describe_field(FLDID32 id)
+    {
+        const char* name = Fname32(id);
+        return name ? string(name) : "id " + to_string(id);
+    }
+}
+
+// For each changed field, patch_field holds: the field id, the field's new
+// occurrence count, the number of changed occurrences, and their indexes.
+// The field's values in the patch are the changed occurrences (in index
+// order) followed by any added occurrences.  A count lower than the base's
+// means the trailing occurrences were deleted.
+fml32 fml32::diff(fml32 const& base, fml32 const& next)
+{
+    // the patch couldn't tell its bookkeeping from the buffers' own values
+    if(base.has(patch_field) || next.has(patch_field))
+    {
+        throw runtime_error("cannot diff fml32 buffers holding field id " + to_string(patch_field) +
+                            " (fml32::patch_field is reserved for patches)");
+    }
+    vector<occurrence> before = occurrences_of(base);
+    vector<occurrence> after = occurrences_of(next);
+    vector<long> operations;
+    vector<occurrence> values;
+    FLDLEN32 value_bytes = 0;
+    
+    size_t i = 0;
+    size_t j = 0;
+    while(i < before.size() || j < after.size())
+    {
+        FLDID32 id = j == after.size() || (i < before.size() && before[i].id < after[j].id) ? before[i].id : after[j].id;
+        size_t m = run_length(before, i, id);
+        size_t k = run_length(after, j, id);
+        size_t first_operation = operations.size();
+        size_t first_value = values.size();
+        operations.push_back(static_cast<long>(id));
+        operations.push_back(static_cast<long>(k));
+        operations.push_back(0);
+        for(size_t oc = 0; oc < min(m, k); ++oc)
+        {
+            if(!same_value(before[i + oc], after[j + oc]))
+            {
+                operations.push_back(static_cast<long>(oc));
+                values.push_back(after[j + oc]);
+            }
+        }
+        operations[first_operation + 2] = static_cast<long>(values.size() - first_value);
+        for(size_t oc = m; oc < k; ++oc)
+        {
+            values.push_back(after[j + oc]);
+        }
+        if(m == k && values.size() == first_value)
+        {
+            operations.resize(first_operation); // unchanged
+        }
+        for(size_t v = first_value; v < values.size(); ++v)
+        {
+            value_bytes += values[v].len;
+        }
+        i += m;
+        j += k;
+    }
+    
+    // values are already in field id order; slot the bookkeeping in
+    // so the buffer can be appended (and indexed) in one pass
+    fml32 patch(static_cast<FLDOCC32>(values.size() + operations.size()),
+                static_cast<FLDLEN32>(value_bytes + operations.size() * sizeof(long)));
+    auto split = lower_bound(values.begin(), values.end(), patch_field, [](occurrence const& x, FLDID32 id)
+    {
+        return x.id < id;
+    });
+    for(auto v = values.begin(); v != split; ++v)
+    {
+        patch.append(v->id, v->value, v->len);
+    }
+    for(long x : operations)
+    {
+        patch.append(patch_field, reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+    for(auto v = split; v != values.end(); ++v)
+    {
+        patch.append(v->id, v->value, v->len);
+    }
+    patch.index();
+    return patch;
+}
+
+void fml32::apply_patch(fml32 const& patch)
+{
+    assert(&patch != this);
+    if(has(patch_field))
+    {
+        throw runtime_error("cannot apply a patch to an fml32 holding field id " + to_string(patch_field) +
+                            " (fml32::patch_field is reserved for patches)");
+    }
+    vector<long> operations;
+    if(patch.has(patch_field))
+    {
+        patch.get_all(patch_field, operations);
+    }
+    vector<occurrence> values = occurrences_of(patch, patch_field);
+    
+    // check everything before changing anything
+    struct field_change
+    {
+        FLDID32 id;
+        size_t count; // before
+        size_t new_count;
+        size_t first_index; // into operations
+        size_t changed;
+        size_t first_value; // into values
+        size_t added;
+    };
+    vector<field_change> changes;
+    size_t v = 0;
+    size_t o = 0;
+    while(o < operations.size())
+    {
+        if(operations.size() - o < 3 || operations[o + 1] < 0 || operations[o + 2] < 0 ||
+           static_cast<size_t>(operations[o + 2]) > operations.size() - o - 3)
+        {
+            throw runtime_error("malformed fml32 patch");
+        }
+        field_change c;
+        c.id = static_cast<FLDID32>(operations[o]);
+        c.count = static_cast<size_t>(count(c.id));
+        c.new_count = static_cast<size_t>(operations[o + 1]);
+        c.changed = static_cast<size_t>(operations[o + 2]);
+        c.first_index = o + 3;
+        c.first_value = v;
+        c.added = c.new_count > c.count ? c.new_count - c.count : 0;
+        bool applies = run_length(values, v, c.id) == c.changed + c.added;
+        for(size_t x = c.first_index; x < c.first_index + c.changed; ++x)
+        {
+            applies = applies && operations[x] >= 0 && static_cast<size_t>(operations[x]) < min(c.count, c.new_count);
+        }
+        if(!applies)
+        {
+            throw runtime_error("fml32 patch does not apply: occurrences of field " +
+                                describe_field(c.id) + " differ from the base");
+        }
+        changes.push_back(c);
+        o = c.first_index + c.changed;
+        v += c.changed + c.added;
+    }
+    if(v != values.size())
+    {
+        throw runtime_error("malformed fml32 patch");
+    }
+    
+    for(auto const& c : changes)
+    {
+        size_t value = c.first_value;
+        for(size_t x = c.first_index; x < c.first_index + c.changed; ++x, ++value)
+        {
+            set(c.id, values[value].value, values[value].len, static_cast<FLDOCC32>(operations[x]));
+        }
+        if(c.new_count == 0 && c.count > 0)
+        {
+            erase(c.id);
+        }
+        for(size_t oc = c.count; oc > c.new_count && c.new_count > 0; --oc)
+        {
+            erase(c.id, static_cast<FLDOCC32>(oc - 1));
+        }
+        for(size_t x = 0; x < c.added; ++x, ++value)
+        {
+            add(c.id, values[value].value, values[value].len);
+        }
+    }
+}
+
 
 bool fml32::is_fielded() const noexcept
 {
@@ -811,6 +1205,7 @@ string fml32::get_encoding_name() const
 
 void fml32::set_encoding_name(string const& encoding)
 {
+    modified();
     if(!buffer_)
     {
         reserve(0);
@@ -826,6 +1221,7 @@ void fml32::set_encoding_name(string const& encoding)
 
 void fml32::clear_encoding_name()
 {
+    modified();
     if(buffer_)
     {
         int rc = tpsetmbenc(buffer_.data(),
@@ -841,6 +1237,7 @@ void fml32::clear_encoding_name()
 
 void fml32::convert_mbstrings(string const& target_encoding, long flags) // tpconvfmb32
 {
+    modified();
     if(buffer_)
     {
         FBFR32* f = reinterpret_cast<FBFR32*>(buffer_.release());
@@ -858,6 +1255,7 @@ void fml32::convert_mbstrings(string const& target_encoding, long flags) // tpco
 
 void fml32::convert_mbstrings(vector<FLDID32> fields, string const& target_encoding, long flags) // tpconvfmb32
 {
+    modified();
     if(buffer_ && !fields.empty())
     {
         fields.push_back(BADFLDID);
@@ -925,6 +1323,15 @@ void fml32::add_ptr(FLDID32 id, const void* x)
     add(id, reinterpret_cast<char*>(const_cast<void*>(x)), sizeof(x));
 }
 
+void fml32::add_view(FLDID32 id, string const& view_name, const void* data)
+{
+    check_field_type(id, FLD_VIEW32);
+    auto f = make_default<FVIEWFLD>();
+    tux::set(f.vname, view_name);
+    f.data = reinterpret_cast<char*>(const_cast<void*>(data));
+    add(id, reinterpret_cast<char*>(&f), sizeof(f));
+}
+
 void fml32::append(FLDID32 id, short x)
 {
     check_field_type(id, FLD_SHORT);
@@ -1071,22 +1478,16 @@ double fml32::get_double(FLDID32 id, FLDOCC32 oc) const
     return x;
 }
 
-string fml32::get_string(FLDID32 id, FLDOCC32 oc) const
+namespace
 {
-    int type = field_type(id);
-    if(type == FLD_CARRAY || type == FLD_STRING)
-    {
-        FLDLEN32 len = 0;
-        char* loc = find_value(id, oc, &len);
-        return type == FLD_CARRAY ? string(loc, len) : string(loc); 
-    }
-    else
+    // a value of any type, converted to a string [@c CFget32]
+    string convert_to_string(FBFR32* f, FLDID32 id, FLDOCC32 oc)
     {
         string x;
         FLDLEN32 len = 18; // likely within small buffer optimization limit
         x.resize(len);
-        
-        int rc = CFget32(const_cast<FBFR32*>(as_fbfr()),
+    
+        int rc = CFget32(f,
                          id,
                          oc,
                          const_cast<char*>(x.data()),
@@ -1097,7 +1498,7 @@ string fml32::get_string(FLDID32 id, FLDOCC32 oc) const
             // must be a big number
             len = 36;
             x.resize(len);
-            rc = CFget32(const_cast<FBFR32*>(as_fbfr()),
+            rc = CFget32(f,
                         id,
                         oc,
                         const_cast<char*>(x.data()),
@@ -1106,14 +1507,56 @@ string fml32::get_string(FLDID32 id, FLDOCC32 oc) const
         }
         if(rc == -1)
         {
-            throw last_error("CFget32");
+            throw fml32::last_error("CFget32");
         }
         trim_to_null_terminator(x);
         return x;
     }
 }
 
+string fml32::get_string(FLDID32 id, FLDOCC32 oc) const
+{
+    int type = field_type(id);
+    if(type == FLD_CARRAY || type == FLD_STRING)
+    {
+        FLDLEN32 len = 0;
+        char* loc = find_value(id, oc, &len);
+        return type == FLD_CARRAY ? string(loc, len) : string(loc); 
+    }
+    else
+    {
+        return convert_to_string(const_cast<FBFR32*>(as_fbfr()), id, oc);
+    }
+}
+
+
+
+fml32::value_ref fml32::get_string_view(FLDID32 id, FLDOCC32 oc) const
+{
+    int type = field_type(id);
+    if(type != FLD_STRING && type != FLD_CARRAY)
+    {
+        throw error(FTYPERR, "get_string_view - " + field_type_name(id) + " field");
+    }
+    FLDLEN32 len = 0;
+    char* loc = find_value(id, oc, &len);
+    if(type == FLD_STRING && len > 0)
+    {
+        --len; // null terminator
+    }
+    return make_value_ref(loc, len);
+}
 
+fml32::value_ref fml32::get_carray_view(FLDID32 id, FLDOCC32 oc) const
+{
+    if(field_type(id) != FLD_CARRAY)
+    {
+        throw error(FTYPERR, "get_carray_view - " + field_type_name(id) + " field");
+    }
+    FLDLEN32 len = 0;
+    char* loc = find_value(id, oc, &len);
+    return make_value_ref(loc, len);
+}
 
 unpacked_mbstring fml32::get_mbstring(FLDID32 id, FLDOCC32 oc) const
 {
@@ -1175,6 +1618,13 @@ void fml32::get_fml(FLDID32 id, FLDOCC32 oc, fml32& output) const
     */
 }
 
+const_fml32_view fml32::get_fml_view(FLDID32 id, FLDOCC32 oc) const
+{
+    check_field_type(id, FLD_FML32);
+    char* loc = find_value(id, oc, nullptr);
+    return const_fml32_view(reinterpret_cast<const FBFR32*>(loc), generation());
+}
+
 void* fml32::get_ptr(FLDID32 id, FLDOCC32 oc) const
 {
     check_field_type(id, FLD_PTR);
@@ -1333,120 +1783,415 @@ std::pair<FLDOCC32,void*> fml32::get_last_ptr(FLDID32 id) const
     return {oc,x};
 }
 
-bool fml32::next_field(field_info& x) const
+//------------------ALL OCCURRENCES----------------------------------------
+namespace
 {
-    int rc = Fnext32(const_cast<FBFR32*>(as_fbfr()), &x.id, &x.oc, nullptr, nullptr);
-    if(rc == -1)
+    // Fnext32 (like Ffind32) locates the occurrence it's given before stepping
+    // past it, so there's nothing to gain by walking with it; instead each value
+    // is read in place, straight from the side index if there is one.
+    // find(oc, &len) returns occurrence oc [fml32::find_value]
+    template <typename Find, typename T>
+    void get_all_numbers(fml32 const& f, FLDID32 id, int type, vector<T>& out, T (fml32::*convert)(FLDID32, FLDOCC32) const, Find find)
     {
-        throw last_error("Fnext32");
+        FLDOCC32 n = f.count(id);
+        out.resize(n);
+        if(n == 0)
+        {
+            return;
+        }
+        if(fml32::field_type(id) != type)
+        {
+            for(FLDOCC32 oc = 0; oc < n; ++oc)
+            {
+                out[oc] = (f.*convert)(id, oc); // CFget32
+            }
+            return;
+        }
+        for(FLDOCC32 oc = 0; oc < n; ++oc)
+        {
+            FLDLEN32 len = 0;
+            memcpy(&out[oc], find(oc, &len), sizeof(T)); // values aren't guaranteed to be aligned for T
+        }
     }
-    return rc;
 }
 
-
-fml32::boolean_expression::boolean_expression(fml32::boolean_expression const& x)
+void fml32::get_all_values(FLDID32 id, vector<short>& out) const
 {
-    if(x.tree_)
-    {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
-        {
-            throw bad_alloc{};
-        }
-        memmove(tree_.get(), x.tree_.get(), size);
-    }
+    get_all_numbers(*this, id, FLD_SHORT, out, &fml32::get_short, [&](FLDOCC32 oc, FLDLEN32* len) { return find_value(id, oc, len); });
 }
 
+void fml32::get_all_values(FLDID32 id, vector<long>& out) const
+{
+    get_all_numbers(*this, id, FLD_LONG, out, &fml32::get_long, [&](FLDOCC32 oc, FLDLEN32* len) { return find_value(id, oc, len); });
+}
 
-fml32::boolean_expression& fml32::boolean_expression::operator=(fml32::boolean_expression const& x)
+void fml32::get_all_values(FLDID32 id, vector<char>& out) const
 {
-    fml32::boolean_expression tmp(x);
-    *this = move(tmp);
-    return *this;
+    get_all_numbers(*this, id, FLD_CHAR, out, &fml32::get_char, [&](FLDOCC32 oc, FLDLEN32* len) { return find_value(id, oc, len); });
 }
 
-fml32::boolean_expression::boolean_expression(std::string const& x)
+void fml32::get_all_values(FLDID32 id, vector<float>& out) const
 {
-    compile(x);
+    get_all_numbers(*this, id, FLD_FLOAT, out, &fml32::get_float, [&](FLDOCC32 oc, FLDLEN32* len) { return find_value(id, oc, len); });
 }
 
-fml32::boolean_expression& fml32::boolean_expression::operator=(std::string const& x)
+void fml32::get_all_values(FLDID32 id, vector<double>& out) const
 {
-    compile(x);
-    return *this;
+    get_all_numbers(*this, id, FLD_DOUBLE, out, &fml32::get_double, [&](FLDOCC32 oc, FLDLEN32* len) { return find_value(id, oc, len); });
 }
 
-void fml32::boolean_expression::print(FILE* f) const noexcept
+void fml32::get_all_values(FLDID32 id, vector<string>& out) const
 {
-    if(tree_ && f)
+    FLDOCC32 n = count(id);
+    out.resize(n);
+    if(n == 0)
+    {
+        return;
+    }
+    int type = field_type(id);
+    if(type != FLD_STRING && type != FLD_CARRAY)
+    {
+        for(FLDOCC32 oc = 0; oc < n; ++oc)
+        {
+            out[oc] = get_string(id, oc);
+        }
+        return;
+    }
+    // read in place: no scratch copy, whatever the size of the buffer
+    for(FLDOCC32 oc = 0; oc < n; ++oc)
     {
-        Fboolpr32(tree_.get(), f);
+        FLDLEN32 len = 0;
+        const char* value = find_value(id, oc, &len);
+        out[oc].assign(value, type == FLD_STRING && len > 0 ? len - 1 : len);
     }
 }
 
-bool fml32::boolean_expression::evaluate(fml32 const& x) const
+bool fml32::next_field(field_info& x) const
 {
-    int result = Fboolev32(const_cast<FBFR32*>(x.as_fbfr()), tree_.get());
-    if(result == -1)
+    int rc = Fnext32(const_cast<FBFR32*>(as_fbfr()), &x.id, &x.oc, nullptr, nullptr);
+    if(rc == -1)
     {
-        throw last_error("Fboolev32");
+        throw last_error("Fnext32");
     }
-    return result;
+    return rc;
 }
 
-bool fml32::boolean_expression::operator()(fml32 const& x) const
+namespace
 {
-    return evaluate(x);
+    // values aren't guaranteed to be aligned for T
+    template <typename T> T read_value(const char* p) noexcept
+    {
+        T x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
 }
 
-
-void fml32::boolean_expression::free() noexcept
+fml32::const_iterator fml32::begin() const
 {
-    tree_.reset();
+    return buffer_ ? const_iterator(this) : end();
 }
 
-void fml32::boolean_expression::compile(std::string const& x)
+fml32::const_iterator fml32::end() const noexcept
 {
-    tree_.reset(Fboolco32(const_cast<char*>(x.c_str())));
-    if(!tree_)
-    {
-        throw last_error("Fboolco32");
-    }
+    return const_iterator();
 }
 
-unsigned fml32::boolean_expression::size() const
+fml32::const_iterator::const_iterator(const fml32* owner)
 {
-    if(!tree_)
-    {
-        return 0;
-    }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
+    ref_.owner_ = owner;
+    ref_.fbfr_ = owner->as_fbfr();
+    ref_.id_ = FIRSTFLDID;
+    index_ = owner->side_index_;
+    ++*this;
 }
 
+fml32::const_iterator::const_iterator(const FBFR32* f, shared_ptr<const atomic<unsigned long>> generation)
+{
+    ref_.fbfr_ = f;
+    ref_.generation_ = move(generation);
+    ref_.id_ = FIRSTFLDID;
+    ++*this;
+}
 
-fml32::arithmetic_expression::arithmetic_expression(fml32::arithmetic_expression const& x)
+fml32::const_iterator& fml32::const_iterator::operator++()
 {
-    if(x.tree_)
+    if(index_)
     {
-        unsigned size = x.size();
-        tree_.reset(reinterpret_cast<char*>(malloc(size)));
-        if(!tree_)
+        // the side index already records every occurrence and where its value is
+        if(next_slot_ == index_->slots.size())
+        {
+            ref_ = field_ref();
+            index_.reset();
+            next_slot_ = 0;
+            return *this;
+        }
+        auto const& slot = index_->slots[next_slot_++];
+        ref_.id_ = slot.id;
+        ref_.oc_ = slot.oc;
+        ref_.value_ = ref_.owner_->buffer_.data() + slot.offset;
+        ref_.len_ = slot.len;
+        return *this;
+    }
+    // Fnext32 copies the value out in the same call, so nothing need be
+    // found again; a view32 value is copied through an FVIEWFLD whose data
+    // follows it, the rest at the start of the copy
+    FBFR32* f = const_cast<FBFR32*>(ref_.fbfr_);
+    vector<char>& copy = ref_.copy_;
+    if(copy.empty())
+    {
+        copy.resize(sizeof(FVIEWFLD) + 256);
+    }
+    FLDID32 id = ref_.id_;
+    FLDOCC32 oc = ref_.oc_;
+    FLDLEN32 len = 0;
+    int rc;
+    for(bool grown = false; ; grown = true)
+    {
+        FVIEWFLD v = {};
+        v.data = copy.data() + sizeof(FVIEWFLD);
+        memcpy(copy.data(), &v, sizeof(v));
+        len = static_cast<FLDLEN32>(copy.size() - sizeof(FVIEWFLD));
+        rc = Fnext32(f, &id, &oc, copy.data(), &len);
+        if(rc != -1 || Ferror32 != FNOSPACE || grown)
         {
-            throw bad_alloc{};
+            break;
         }
-        memmove(tree_.get(), x.tree_.get(), size);
+        // no value can be larger than the buffer holding it
+        id = ref_.id_;
+        oc = ref_.oc_;
+        copy.resize(sizeof(FVIEWFLD) + static_cast<size_t>(Fused32(f)));
     }
+    if(rc == -1)
+    {
+        throw last_error("Fnext32");
+    }
+    if(rc == 0)
+    {
+        ref_ = field_ref();
+        return *this;
+    }
+    ref_.id_ = id;
+    ref_.oc_ = oc;
+    ref_.value_ = nullptr;
+    ref_.len_ = len;
+    return *this;
 }
 
+const_fml32_view fml32::field_ref::view() const
+{
+    return const_fml32_view(fbfr_, generation_);
+}
 
-fml32::arithmetic_expression& fml32::arithmetic_expression::operator=(fml32::arithmetic_expression const& x)
+short fml32::field_ref::as_short() const
 {
-    fml32::arithmetic_expression tmp(x);
-    *this = move(tmp);
+    return type() == FLD_SHORT ? read_value<short>(data()) : owner_ ? owner_->get_short(id_, oc_) : view().get_short(id_, oc_);
+}
+
+long fml32::field_ref::as_long() const
+{
+    return type() == FLD_LONG ? read_value<long>(data()) : owner_ ? owner_->get_long(id_, oc_) : view().get_long(id_, oc_);
+}
+
+char fml32::field_ref::as_char() const
+{
+    return type() == FLD_CHAR ? *data() : owner_ ? owner_->get_char(id_, oc_) : view().get_char(id_, oc_);
+}
+
+float fml32::field_ref::as_float() const
+{
+    return type() == FLD_FLOAT ? read_value<float>(data()) : owner_ ? owner_->get_float(id_, oc_) : view().get_float(id_, oc_);
+}
+
+double fml32::field_ref::as_double() const
+{
+    return type() == FLD_DOUBLE ? read_value<double>(data()) : owner_ ? owner_->get_double(id_, oc_) : view().get_double(id_, oc_);
+}
+
+string_ref fml32::field_ref::as_string_ref() const
+{
+    int t = type();
+    if(t != FLD_STRING && t != FLD_CARRAY)
+    {
+        throw error(FTYPERR, "as_string_ref - " + field_type_name(id_) + " field");
+    }
+    return string_ref(data(), t == FLD_STRING && len_ > 0 ? len_ - 1 : len_);
+}
+
+string fml32::field_ref::as_string() const
+{
+    int t = type();
+    if(t == FLD_STRING || t == FLD_CARRAY)
+    {
+        return as_string_ref().str();
+    }
+    return owner_ ? owner_->get_string(id_, oc_) : view().get_string(id_, oc_);
+}
+
+fml32 fml32::field_ref::as_fml() const
+{
+    return owner_ ? owner_->get_fml(id_, oc_) : view().get_fml(id_, oc_);
+}
+
+const_fml32_view fml32::field_ref::as_fml_view() const
+{
+    check_field_type(id_, FLD_FML32);
+    return const_fml32_view(reinterpret_cast<const FBFR32*>(data()), owner_ ? owner_->generation() : generation_);
+}
+
+
+namespace
+{
+    // smallest share of a batch worth starting a thread for
+    const size_t min_batch_per_thread = 4096;
+
+    // calls work(first, last) on contiguous ranges covering [0, count), on up
+    // to threads threads; range boundaries are multiples of 64
+    template <typename F>
+    void run_batch(size_t count, unsigned threads, F const& work)
+    {
+        if(threads == 0)
+        {
+            threads = max(thread::hardware_concurrency(), 1u);
+        }
+        size_t workers = min<size_t>(threads, (count + min_batch_per_thread - 1) / min_batch_per_thread);
+        if(workers <= 1)
+        {
+            work(0, count);
+            return;
+        }
+        
+        size_t chunk = ((count + workers - 1) / workers + 63) & ~size_t(63);
+        vector<exception_ptr> errors(workers);
+        vector<thread> pool;
+        pool.reserve(workers - 1);
+        auto run = [&work, &errors](size_t index, size_t first, size_t last)
+        {
+            try
+            {
+                work(first, last);
+            }
+            catch(...)
+            {
+                errors[index] = current_exception();
+            }
+        };
+        try
+        {
+            // the calling thread takes the first range
+            for(size_t index = 1; index * chunk < count; ++index)
+            {
+                pool.emplace_back(run, index, index * chunk, min(count, (index + 1) * chunk));
+            }
+            run(0, 0, min(count, chunk));
+        }
+        catch(...)
+        {
+            errors[0] = current_exception(); // couldn't start a thread
+        }
+        for(auto& t : pool)
+        {
+            t.join();
+        }
+        for(auto const& e : errors)
+        {
+            if(e)
+            {
+                rethrow_exception(e);
+            }
+        }
+    }
+}
+
+fml32::boolean_expression::boolean_expression(std::string const& x)
+{
+    compile(x);
+}
+
+fml32::boolean_expression& fml32::boolean_expression::operator=(std::string const& x)
+{
+    compile(x);
     return *this;
 }
 
+void fml32::boolean_expression::print(FILE* f) const noexcept
+{
+    if(tree_ && f)
+    {
+        Fboolpr32(const_cast<char*>(tree_.get()), f);
+    }
+}
+
+bool fml32::boolean_expression::evaluate(fml32 const& x) const
+{
+    int result = Fboolev32(const_cast<FBFR32*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
+    if(result == -1)
+    {
+        throw last_error("Fboolev32");
+    }
+    return result;
+}
+
+bool fml32::boolean_expression::operator()(fml32 const& x) const
+{
+    return evaluate(x);
+}
+
+bool fml32::boolean_expression::evaluate(const_fml32_view const& x) const
+{
+    int result = Fboolev32(const_cast<FBFR32*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
+    if(result == -1)
+    {
+        throw last_error("Fboolev32");
+    }
+    return result;
+}
+
+bool fml32::boolean_expression::operator()(const_fml32_view const& x) const
+{
+    return evaluate(x);
+}
+
+
+void fml32::boolean_expression::evaluate_batch(fml32 const* buffers, size_t count, vector<uint64_t>& bitmap, unsigned threads) const
+{
+    bitmap.assign((count + 63) / 64, 0);
+    run_batch(count, threads, [this, buffers, &bitmap](size_t first, size_t last)
+    {
+        // first is a multiple of 64, so each word belongs to one worker
+        for(size_t i = first; i < last; i += 64)
+        {
+            uint64_t word = 0;
+            size_t n = min<size_t>(64, last - i);
+            for(size_t j = 0; j < n; ++j)
+            {
+                if(evaluate(buffers[i + j]))
+                {
+                    word |= uint64_t(1) << j;
+                }
+            }
+            bitmap[i / 64] = word;
+        }
+    });
+}
+
+void fml32::boolean_expression::free() noexcept
+{
+    tree_.reset();
+}
+
+void fml32::boolean_expression::compile(std::string const& x)
+{
+    tree_ = expression_cache::global().get("FML32", x, [&x]
+    {
+        return Fboolco32(const_cast<char*>(x.c_str()));
+    });
+    if(!tree_)
+    {
+        throw last_error("Fboolco32");
+    }
+}
+
 fml32::arithmetic_expression::arithmetic_expression(std::string const& x)
 {
     compile(x);
@@ -1462,13 +2207,13 @@ void fml32::arithmetic_expression::print(FILE* f) const noexcept
 {
     if(tree_ && f)
     {
-        Fboolpr32(tree_.get(), f);
+        Fboolpr32(const_cast<char*>(tree_.get()), f);
     }
 }
 
 double fml32::arithmetic_expression::evaluate(fml32 const& x) const
 {
-    double result = Ffloatev32(const_cast<FBFR32*>(x.as_fbfr()), tree_.get());
+    double result = Ffloatev32(const_cast<FBFR32*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
     if(result == -1)
     {
         throw last_error("Ffloatev32");
@@ -1481,6 +2226,33 @@ double fml32::arithmetic_expression::operator()(fml32 const& x) const
     return evaluate(x);
 }
 
+double fml32::arithmetic_expression::evaluate(const_fml32_view const& x) const
+{
+    double result = Ffloatev32(const_cast<FBFR32*>(x.as_fbfr()), const_cast<char*>(tree_.get()));
+    if(result == -1)
+    {
+        throw last_error("Ffloatev32");
+    }
+    return result;
+}
+
+double fml32::arithmetic_expression::operator()(const_fml32_view const& x) const
+{
+    return evaluate(x);
+}
+
+void fml32::arithmetic_expression::evaluate_batch(fml32 const* buffers, size_t count, vector<double>& results, unsigned threads) const
+{
+    results.resize(count);
+    run_batch(count, threads, [this, buffers, &results](size_t first, size_t last)
+    {
+        for(size_t i = first; i < last; ++i)
+        {
+            results[i] = evaluate(buffers[i]);
+        }
+    });
+}
+
 void fml32::arithmetic_expression::free() noexcept
 {
     tree_.reset();
@@ -1488,22 +2260,364 @@ void fml32::arithmetic_expression::free() noexcept
 
 void fml32::arithmetic_expression::compile(std::string const& x)
 {
-    tree_.reset(Fboolco32(const_cast<char*>(x.c_str())));
+    tree_ = expression_cache::global().get("FML32", x, [&x]
+    {
+        return Fboolco32(const_cast<char*>(x.c_str()));
+    });
     if(!tree_)
     {
         throw last_error("Fboolco32");
     }
 }
 
-unsigned fml32::arithmetic_expression::size() const
+
+//---------------------TYPED FIELDS----------------------------------------
+// the field type is known at compile time, so skip check_field_type
+// and the CF conversion functions
+
+namespace
 {
-    if(!tree_)
+    bool is_carray(FLDID32 id) noexcept
+    {
+        return static_cast<int>(id >> 25) == FLD_CARRAY;
+    }
+}
+
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, short& x) const
+{
+    FLDLEN32 len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, long& x) const
+{
+    FLDLEN32 len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, char& x) const
+{
+    FLDLEN32 len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, float& x) const
+{
+    FLDLEN32 len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, double& x) const
+{
+    FLDLEN32 len = sizeof(x);
+    get(fieldid, oc, reinterpret_cast<char*>(&x), &len);
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, string& x) const
+{
+    FLDLEN32 len = 0;
+    char* loc = find_value(fieldid, oc, &len);
+    if(is_carray(fieldid))
+    {
+        x.assign(loc, len);
+    }
+    else
+    {
+        x.assign(loc);
+    }
+}
+void fml32::typed_get(FLDID32 fieldid, FLDOCC32 oc, fml32& x) const
+{
+    FLDLEN32 len = 0;
+    char* loc = find_value(fieldid, oc, &len);
+    x.reserve(len);
+    memcpy(x.as_fbfr(), loc, len);
+}
+
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, short x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, long x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, char x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, float x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, double x)
+{
+    set(fieldid, reinterpret_cast<char*>(&x), sizeof(x), oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, const char* x)
+{
+    FLDLEN32 len = strlen(x);
+    set(fieldid, x, is_carray(fieldid) ? len : len + 1, oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, string const& x)
+{
+    // FLD_STRING values must be null terminated, which c_str() guarantees
+    set(fieldid, x.c_str(), is_carray(fieldid) ? x.size() : x.size() + 1, oc);
+}
+void fml32::typed_set(FLDID32 fieldid, FLDOCC32 oc, fml32 const& x)
+{
+    set(fieldid, x.buffer().data(), x.used_size(), oc);
+}
+
+void fml32::typed_add(FLDID32 fieldid, short x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml32::typed_add(FLDID32 fieldid, long x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml32::typed_add(FLDID32 fieldid, char x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml32::typed_add(FLDID32 fieldid, float x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml32::typed_add(FLDID32 fieldid, double x)
+{
+    add(fieldid, reinterpret_cast<char*>(&x), sizeof(x));
+}
+void fml32::typed_add(FLDID32 fieldid, const char* x)
+{
+    FLDLEN32 len = strlen(x);
+    add(fieldid, x, is_carray(fieldid) ? len : len + 1);
+}
+void fml32::typed_add(FLDID32 fieldid, string const& x)
+{
+    add(fieldid, x.c_str(), is_carray(fieldid) ? x.size() : x.size() + 1);
+}
+void fml32::typed_add(FLDID32 fieldid, fml32 const& x)
+{
+    add(fieldid, x.buffer().data(), x.used_size());
+}
+
+//---------------------CONST VIEW-------------------------------------
+
+const_fml32_view::const_fml32_view(fml32 const& x) :
+    const_fml32_view(x.as_fbfr(), x.generation())
+{
+}
+
+const_fml32_view::operator bool() const noexcept
+{
+    if(!fbfr_)
+    {
+        return false;
+    }
+    fml32::field_info info;
+    return Fnext32(fbfr(), &info.id, &info.oc, nullptr, nullptr) == 1;
+}
+
+const FBFR32* const_fml32_view::as_fbfr() const noexcept
+{
+    check();
+    return fbfr_;
+}
+
+fml32 const_fml32_view::copy() const
+{
+    fml32 result;
+    if(fbfr_)
+    {
+        // Fcpy32 would copy Fsizeof32 bytes, but a nested or mapped FBFR32 may
+        // only hold its Fused32 bytes, so copy the fields instead
+        result.reserve(used_size());
+        if(Fconcat32(result.as_fbfr(), fbfr()) == -1)
+        {
+            throw fml32::last_error("Fconcat32");
+        }
+    }
+    return result;
+}
+
+long const_fml32_view::used_size() const
+{
+    if(!fbfr_)
     {
         return 0;
     }
-    return make_16bit_unsigned(tree_.get()[0], tree_.get()[1]);
+    long result = Fused32(fbfr());
+    if(result == -1)
+    {
+        throw fml32::last_error("Fused32");
+    }
+    return result;
+}
+
+FLDOCC32 const_fml32_view::field_count() const
+{
+    if(!fbfr_)
+    {
+        return 0;
+    }
+    FLDOCC32 result = Fnum32(fbfr());
+    if(result == -1)
+    {
+        throw fml32::last_error("Fnum32");
+    }
+    return result;
+}
+
+FLDOCC32 const_fml32_view::count(FLDID32 id) const
+{
+    if(!fbfr_)
+    {
+        return 0;
+    }
+    FLDOCC32 result = Foccur32(fbfr(), id);
+    if(result == -1)
+    {
+        throw fml32::last_error("Foccur32");
+    }
+    return result;
+}
+
+bool const_fml32_view::has(FLDID32 id, FLDOCC32 oc) const
+{
+    return fbfr_ && Fpres32(fbfr(), id, oc);
+}
+
+long const_fml32_view::field_value_size(FLDID32 id, FLDOCC32 oc) const
+{
+    if(!fbfr_)
+    {
+        throw fml32::error(FNOTPRES, "field_value_size - null buffer");
+    }
+    long result = Flen32(fbfr(), id, oc);
+    if(result == -1)
+    {
+        throw fml32::last_error("Flen32");
+    }
+    return result;
+}
+
+namespace
+{
+    template <typename T>
+    T get_converted(FBFR32* f, FLDID32 id, FLDOCC32 oc, int type)
+    {
+        T x = 0;
+        FLDLEN32 len = sizeof(x);
+        if(CFget32(f, id, oc, reinterpret_cast<char*>(&x), &len, type) == -1)
+        {
+            throw fml32::last_error("CFget32");
+        }
+        return x;
+    }
+}
+
+short const_fml32_view::get_short(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_converted<short>(fbfr(), id, oc, FLD_SHORT);
+}
+
+long const_fml32_view::get_long(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_converted<long>(fbfr(), id, oc, FLD_LONG);
+}
+
+char const_fml32_view::get_char(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_converted<char>(fbfr(), id, oc, FLD_CHAR);
+}
+
+float const_fml32_view::get_float(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_converted<float>(fbfr(), id, oc, FLD_FLOAT);
+}
+
+double const_fml32_view::get_double(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_converted<double>(fbfr(), id, oc, FLD_DOUBLE);
+}
+
+string const_fml32_view::get_string(FLDID32 id, FLDOCC32 oc) const
+{
+    int type = fml32::field_type(id);
+    if(type == FLD_CARRAY || type == FLD_STRING)
+    {
+        FLDLEN32 len = 0;
+        char* loc = find_value(id, oc, &len);
+        return type == FLD_CARRAY ? string(loc, len) : string(loc);
+    }
+    return convert_to_string(fbfr(), id, oc);
 }
 
+fml32::value_ref const_fml32_view::get_string_view(FLDID32 id, FLDOCC32 oc) const
+{
+    int type = fml32::field_type(id);
+    if(type != FLD_STRING && type != FLD_CARRAY)
+    {
+        throw fml32::error(FTYPERR, "get_string_view - " + fml32::field_type_name(id) + " field");
+    }
+    FLDLEN32 len = 0;
+    char* loc = find_value(id, oc, &len);
+    if(type == FLD_STRING && len > 0)
+    {
+        --len; // null terminator
+    }
+    return fml32::value_ref(string_ref(loc, len), generation_);
+}
+
+fml32::value_ref const_fml32_view::get_carray_view(FLDID32 id, FLDOCC32 oc) const
+{
+    if(fml32::field_type(id) != FLD_CARRAY)
+    {
+        throw fml32::error(FTYPERR, "get_carray_view - " + fml32::field_type_name(id) + " field");
+    }
+    FLDLEN32 len = 0;
+    char* loc = find_value(id, oc, &len);
+    return fml32::value_ref(string_ref(loc, len), generation_);
+}
+
+fml32 const_fml32_view::get_fml(FLDID32 id, FLDOCC32 oc) const
+{
+    return get_fml_view(id, oc).copy();
+}
+
+const_fml32_view const_fml32_view::get_fml_view(FLDID32 id, FLDOCC32 oc) const
+{
+    fml32::check_field_type(id, FLD_FML32);
+    char* loc = find_value(id, oc, nullptr);
+    return const_fml32_view(reinterpret_cast<const FBFR32*>(loc), generation_);
+}
+
+bool const_fml32_view::next_field(fml32::field_info& x) const
+{
+    int rc = Fnext32(fbfr(), &x.id, &x.oc, nullptr, nullptr);
+    if(rc == -1)
+    {
+        throw fml32::last_error("Fnext32");
+    }
+    return rc;
+}
+
+fml32::const_iterator const_fml32_view::begin() const
+{
+    return fbfr_ ? fml32::const_iterator(fbfr(), generation_) : end();
+}
+
+fml32::const_iterator const_fml32_view::end() const noexcept
+{
+    return fml32::const_iterator();
+}
+
+char* const_fml32_view::find_value(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const
+{
+    char* result = Ffind32(fbfr(), id, oc, len);
+    if(!result)
+    {
+        throw fml32::last_error("Ffind32");
+    }
+    return result;
+}
 
 //---------------------PRIVATE----------------------------------------
 
@@ -1520,6 +2634,7 @@ void fml32::check_field_type(FLDID32 fieldid, int expected_type)
 
 void fml32::convert_and_add(FLDID32 fieldid, const char* value, FLDLEN32 len, int type)
 {
+    modified();
     if(!buffer_)
     {
         reserve(1, len);
@@ -1539,6 +2654,7 @@ void fml32::convert_and_add(FLDID32 fieldid, const char* value, FLDLEN32 len, in
 
 void fml32::add(FLDID32 fieldid, const char* value, FLDLEN32 len)
 {
+    modified();
     if(!buffer_)
     {
         reserve(1, len);
@@ -1558,6 +2674,17 @@ void fml32::add(FLDID32 fieldid, const char* value, FLDLEN32 len)
 
 void fml32::get_and_convert(FLDID32 fieldid, FLDOCC32 oc, char* buf, FLDLEN32* len, int type) const
 {
+    if(side_index_ && field_type(fieldid) == type)
+    {
+        FLDLEN32 value_len = 0;
+        const char* value = find_indexed(fieldid, oc, &value_len);
+        if(value && value_len <= *len)
+        {
+            memcpy(buf, value, value_len); // no conversion needed
+            *len = value_len;
+            return;
+        }
+    }
     int rc = CFget32(const_cast<FBFR32*>(as_fbfr()), fieldid, oc, buf, len, type);
     if(rc == -1)
     {
@@ -1567,7 +2694,6 @@ void fml32::get_and_convert(FLDID32 fieldid, FLDOCC32 oc, char* buf, FLDLEN32* l
 
 void fml32::get(FLDID32 fieldid, FLDOCC32 oc, char* buf, FLDLEN32* len) const
 {
-    string raw(buf,*len);
     int rc = Fget32(const_cast<FBFR32*>(as_fbfr()), fieldid, oc, buf, len);
     if(rc == -1)
     {
@@ -1577,6 +2703,7 @@ void fml32::get(FLDID32 fieldid, FLDOCC32 oc, char* buf, FLDLEN32* len) const
 
 void fml32::append(FLDID32 fieldid, const char* value, FLDLEN32 len)
 {
+    modified();
     if(!buffer_)
     {
         reserve(1, len);
@@ -1596,6 +2723,7 @@ void fml32::append(FLDID32 fieldid, const char* value, FLDLEN32 len)
 
 void fml32::convert_and_set(FLDID32 fieldid, const char* value, FLDLEN32 len, FLDOCC32 oc, int type)
 {
+    modified();
     if(!buffer_)
     {
         reserve(1, len);
@@ -1614,6 +2742,7 @@ void fml32::convert_and_set(FLDID32 fieldid, const char* value, FLDLEN32 len, FL
 }
 void fml32::set(FLDID32 fieldid, const char* value, FLDLEN32 len, FLDOCC32 oc)
 {
+    modified();
     if(!buffer_)
     {
         reserve(1, len);
@@ -1634,6 +2763,15 @@ void fml32::set(FLDID32 fieldid, const char* value, FLDLEN32 len, FLDOCC32 oc)
 
 char* fml32::find_value(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const
 {
+    if(side_index_)
+    {
+        const char* indexed = find_indexed(id, oc, len);
+        if(indexed)
+        {
+            return const_cast<char*>(indexed);
+        }
+        // fall through for Ffind32's error
+    }
     char* result = Ffind32(const_cast<FBFR32*>(as_fbfr()), id, oc, len);
     if(!result)
     {
@@ -1642,6 +2780,37 @@ char* fml32::find_value(FLDID32 id, FLDOCC32 oc, FLDLEN32* len) const
     return result;
 }
 
+fml32::value_ref fml32::make_value_ref(const char* data, size_t size) const
+{
+    return value_ref(string_ref(data, size), generation());
+}
+
+shared_ptr<const atomic<unsigned long>> fml32::generation() const
+{
+#ifndef NDEBUG
+    // const, so other threads may be reading this fml32 too: the first to
+    // make a view publishes the counter, and the rest share it
+    auto current = atomic_load(&generation_);
+    if(!current)
+    {
+        auto fresh = make_shared<atomic<unsigned long>>(0);
+        current = atomic_compare_exchange_strong(&generation_, &current, fresh) ? fresh : current;
+    }
+    return current;
+#else
+    return nullptr;
+#endif
+}
+
+void fml32::modified() noexcept
+{
+    if(generation_)
+    {
+        ++*generation_;
+    }
+    side_index_.reset();
+}
+
 FLDOCC32 fml32::get_last(FLDID32 fieldid, char* buf, FLDLEN32* len) const
 {
     FLDOCC32 oc = -1;
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "tux/fml32_builder.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    // values are stored aligned so nested FBFR32s (and doubles) can be
+    // handed to Fappend32 in place
+    const size_t value_alignment = 8;
+
+    size_t align(size_t x) noexcept
+    {
+        return (x + value_alignment - 1) & ~(value_alignment - 1);
+    }
+}
+
+fml32_builder::fml32_builder(size_t field_count, size_t value_bytes)
+{
+    reserve(field_count, value_bytes);
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, short x)
+{
+    check_field_type(id, FLD_SHORT);
+    push(id, &x, sizeof(x));
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, long x)
+{
+    check_field_type(id, FLD_LONG);
+    push(id, &x, sizeof(x));
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, char x)
+{
+    check_field_type(id, FLD_CHAR);
+    push(id, &x, sizeof(x));
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, float x)
+{
+    check_field_type(id, FLD_FLOAT);
+    push(id, &x, sizeof(x));
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, double x)
+{
+    check_field_type(id, FLD_DOUBLE);
+    push(id, &x, sizeof(x));
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, string_ref x)
+{
+    int type = fml32::field_type(id);
+    if(type != FLD_STRING && type != FLD_CARRAY)
+    {
+        throw runtime_error("string type does not match field type " +
+            fml32::field_type_name(id) + " field [" +
+            fml32::field_name(id) + "]");
+    }
+    push(id, x.data(), static_cast<FLDLEN32>(x.size()), type == FLD_STRING);
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, packed_mbstring const& x)
+{
+    check_field_type(id, FLD_MBSTRING);
+    push(id, x.data(), x.size());
+    return *this;
+}
+
+fml32_builder& fml32_builder::add(FLDID32 id, fml32 const& x)
+{
+    check_field_type(id, FLD_FML32);
+    push(id, x.buffer().data(), x.used_size());
+    return *this;
+}
+
+void fml32_builder::reserve(size_t field_count, size_t value_bytes)
+{
+    entries_.reserve(field_count);
+    arena_.reserve(value_bytes + field_count * value_alignment);
+}
+
+size_t fml32_builder::field_count() const noexcept
+{
+    return entries_.size();
+}
+
+long fml32_builder::bytes_needed() const
+{
+    return fml32::bytes_needed(static_cast<FLDOCC32>(max<size_t>(entries_.size(), 1)),
+                               static_cast<FLDLEN32>(value_bytes_));
+}
+
+void fml32_builder::clear() noexcept
+{
+    entries_.clear();
+    arena_.clear();
+    value_bytes_ = 0;
+    sorted_ = true;
+}
+
+fml32 fml32_builder::finish()
+{
+    if(!sorted_)
+    {
+        // Fappend32 doesn't order fields; keep them in field id order
+        // (and occurrences in insertion order) as Fadd32 would have
+        stable_sort(entries_.begin(), entries_.end(), [](entry const& a, entry const& b)
+        {
+            return a.id < b.id;
+        });
+    }
+
+    fml32 result(bytes_needed()); // the one and only tpalloc
+    FBFR32* f = result.as_fbfr();
+    static char nothing = '\0'; // for empty carrays, when nothing else was stored
+    for(auto const& e : entries_)
+    {
+        // e.offset can be arena_.size() (even 0) for an empty carray, so no operator[]
+        char* value = arena_.empty() ? &nothing : arena_.data() + e.offset;
+        int rc = Fappend32(f, e.id, value, e.len);
+        if(rc == -1 && Ferror32 == FNOSPACE)
+        {
+            // shouldn't happen; Fneeded32 accounts for per-field overhead
+            long current_size = result.size();
+            result.reserve(max(current_size + fml32::bytes_needed(1, e.len), 2 * current_size));
+            f = result.as_fbfr();
+            rc = Fappend32(f, e.id, value, e.len);
+        }
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fappend32");
+        }
+    }
+    result.index();
+    clear();
+    return result;
+}
+
+void fml32_builder::check_field_type(FLDID32 id, int expected_type)
+{
+    if(fml32::field_type(id) != expected_type)
+    {
+        throw runtime_error("cannot convert " + fml32::field_type_name_from_type(expected_type) + " value to a " +
+            fml32::field_type_name(id) + " field [" +
+            fml32::field_name(id) + "]");
+    }
+}
+
+void fml32_builder::push(FLDID32 id, const void* value, FLDLEN32 len, bool null_terminate)
+{
+    size_t offset = align(arena_.size());
+    FLDLEN32 stored_len = null_terminate ? len + 1 : len;
+    arena_.resize(offset + stored_len);
+    if(len > 0)
+    {
+        memcpy(arena_.data() + offset, value, len);
+    }
+    if(null_terminate)
+    {
+        arena_[offset + len] = '\0';
+    }
+    if(!entries_.empty() && id < entries_.back().id)
+    {
+        sorted_ = false;
+    }
+    entries_.push_back(entry{id, stored_len, offset});
+    value_bytes_ += stored_len;
+}
+
+}
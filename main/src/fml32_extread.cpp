@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include "tux/field_table.hpp"
+#include "tux/fml32_extread.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    // smallest share of the text worth starting a thread for
+    const size_t min_chunk_size = 256 * 1024;
+
+    int hex_digit(char c) noexcept
+    {
+        if(c >= '0' && c <= '9') { return c - '0'; }
+        if(c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+        if(c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+        return -1;
+    }
+
+    // Parses the buffers in [begin, end), which starts at a buffer boundary.
+    // base is the start of the whole text, for line numbers in errors.
+    // Names are resolved only through table, so a parser can run in any
+    // thread; without a table (only in the calling thread) Tuxedo's are used.
+    class extread_parser
+    {
+    public:
+        extread_parser(field_table const* table, const char* base, const char* begin, const char* end) noexcept :
+            table_(table), base_(base), p_(begin), end_(end)
+        {
+        }
+
+        void parse(vector<fml32>& out)
+        {
+            while(p_ != end_)
+            {
+                // one allocation, from an upper bound on the buffer's binary size
+                const char* boundary = find_boundary(p_);
+                long lines = static_cast<long>(count(p_, boundary, '\n')) + 1;
+                fml32 f(fml32::bytes_needed(static_cast<FLDOCC32>(lines),
+                                            static_cast<FLDLEN32>((boundary - p_) + lines * sizeof(double))));
+                parse_fields(f, 0);
+                if(p_ != end_)
+                {
+                    ++p_; // the empty line
+                }
+                out.push_back(move(f));
+            }
+        }
+
+    private:
+        field_table const* table_;
+        const char* base_;
+        const char* p_; // the start of the next line
+        const char* line_ = nullptr; // the start of the line being parsed
+        const char* end_;
+        string value_;
+        deque<fml32> nested_; // one scratch buffer per level of nesting (deque: growing keeps references valid)
+
+        [[noreturn]] void fail(string const& what) const
+        {
+            size_t line = 1 + static_cast<size_t>(count(base_, line_ ? line_ : p_, '\n'));
+            throw runtime_error("extread: line " + to_string(line) + ": " + what);
+        }
+
+        FLDID32 lookup(string_ref name) const
+        {
+            if(!table_)
+            {
+                return fml32::field_id(name.str()); // [Fldid32]
+            }
+            FLDID32 id = table_->id(name);
+            if(id == BADFLDID)
+            {
+                fail("unknown field " + name.str());
+            }
+            return id;
+        }
+
+        string name_of(FLDID32 id) const
+        {
+            if(!table_)
+            {
+                return fml32::field_name(id); // [Fname32]
+            }
+            const char* name = table_->name(id);
+            return name ? name : to_string(id);
+        }
+
+        // returns the end of the buffer starting at p: the empty line ending it, or end_
+        const char* find_boundary(const char* p) const noexcept
+        {
+            if(p != end_ && *p == '\n')
+            {
+                return p; // an empty buffer
+            }
+            for(;;)
+            {
+                const char* nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end_ - p)));
+                if(!nl || nl + 1 == end_)
+                {
+                    return end_;
+                }
+                if(nl[1] == '\n')
+                {
+                    return nl + 1;
+                }
+                p = nl + 1;
+            }
+        }
+
+        const char* line_end() const noexcept
+        {
+            const char* nl = static_cast<const char*>(memchr(p_, '\n', static_cast<size_t>(end_ - p_)));
+            return nl ? nl : end_;
+        }
+
+        void next_line(const char* eol) noexcept
+        {
+            p_ = eol == end_ ? end_ : eol + 1;
+        }
+
+        // copies a string, carray or char value into value_, decoding escapes
+        void unescape(const char* first, const char* last)
+        {
+            value_.clear();
+            while(first != last)
+            {
+                const char* backslash = static_cast<const char*>(memchr(first, '\\', static_cast<size_t>(last - first)));
+                if(!backslash)
+                {
+                    value_.append(first, last);
+                    return;
+                }
+                value_.append(first, backslash);
+                if(last - backslash >= 2 && backslash[1] == '\\')
+                {
+                    value_ += '\\';
+                    first = backslash + 2;
+                    continue;
+                }
+                int high = last - backslash >= 3 ? hex_digit(backslash[1]) : -1;
+                int low = high != -1 ? hex_digit(backslash[2]) : -1;
+                if(low == -1)
+                {
+                    fail("invalid escape in value");
+                }
+                value_ += static_cast<char>(high * 16 + low);
+                first = backslash + 3;
+            }
+        }
+
+        // parses lines indented by depth tabs into f, stopping before a
+        // line indented less (or at the empty line ending the buffer)
+        void parse_fields(fml32& f, size_t depth)
+        {
+            while(p_ != end_ && *p_ != '\n')
+            {
+                const char* eol = line_end();
+                const char* s = line_ = p_;
+                while(s != eol && *s == '\t')
+                {
+                    ++s;
+                }
+                size_t indent = static_cast<size_t>(s - p_);
+                if(indent < depth)
+                {
+                    return; // the end of a nested buffer
+                }
+                if(indent > depth)
+                {
+                    fail("unexpected indentation");
+                }
+                if(s != eol && *s == '#')
+                {
+                    next_line(eol);
+                    continue;
+                }
+                char flag = s != eol && (*s == '+' || *s == '-' || *s == '=') ? *s++ : '\0';
+                const char* tab = static_cast<const char*>(memchr(s, '\t', static_cast<size_t>(eol - s)));
+                const char* name_end = tab ? tab : eol;
+                if(name_end == s || (!tab && flag != '-'))
+                {
+                    fail("expected a field name, a tab, and a value");
+                }
+                FLDID32 id = lookup(string_ref(s, static_cast<size_t>(name_end - s)));
+                const char* value = tab ? tab + 1 : eol;
+                next_line(eol);
+                apply(f, flag, id, value, eol, depth);
+            }
+        }
+
+        void apply(fml32& f, char flag, FLDID32 id, const char* value, const char* value_end, size_t depth)
+        {
+            if(flag == '-')
+            {
+                if(!f.erase(id, 0))
+                {
+                    fail("no " + name_of(id) + " to delete");
+                }
+                return;
+            }
+            if(flag == '=')
+            {
+                copy_field(f, id, lookup(string_ref(value, static_cast<size_t>(value_end - value))));
+                return;
+            }
+            switch(fml32::field_type(id))
+            {
+                case FLD_SHORT:
+                case FLD_LONG:
+                case FLD_FLOAT:
+                case FLD_DOUBLE:
+                    value_.assign(value, value_end); // converted from text [CFadd32]
+                    break;
+                case FLD_CHAR:
+                case FLD_STRING:
+                case FLD_CARRAY:
+                    unescape(value, value_end);
+                    break;
+                case FLD_FML32:
+                {
+                    if(nested_.size() <= depth)
+                    {
+                        nested_.resize(depth + 1);
+                    }
+                    fml32& nested = nested_[depth];
+                    nested.reserve(fml32::bytes_needed(0, 0));
+                    nested.clear();
+                    parse_fields(nested, depth + 1);
+                    if(flag == '+')
+                    {
+                        f.set(id, nested, 0);
+                    }
+                    else
+                    {
+                        f.add(id, nested);
+                    }
+                    return;
+                }
+                default:
+                    fail("unsupported " + fml32::field_type_name_from_type(fml32::field_type(id)) + " field " + name_of(id));
+            }
+            if(flag == '+')
+            {
+                f.set(id, value_, 0);
+            }
+            else
+            {
+                f.add(id, value_);
+            }
+        }
+
+        // assigns occurrence 0 of id the value of occurrence 0 of source
+        void copy_field(fml32& f, FLDID32 id, FLDID32 source)
+        {
+            FLDLEN32 len = 0;
+            const char* value = f ? Ffind32(const_cast<FBFR32*>(f.as_fbfr()), source, 0, &len) : nullptr;
+            if(!value)
+            {
+                fail("no " + name_of(source) + " to assign from");
+            }
+            value_.assign(value, len); // f may move as it grows
+            int type = fml32::field_type(source);
+            f.modified();
+            int rc = CFchg32(f.as_fbfr(), id, 0, &value_[0], len, type);
+            if(rc == -1 && Ferror32 == FNOSPACE)
+            {
+                f.reserve(f.size() * 2 + fml32::bytes_needed(1, len));
+                rc = CFchg32(f.as_fbfr(), id, 0, &value_[0], len, type);
+            }
+            if(rc == -1)
+            {
+                throw fml32::last_error("CFchg32");
+            }
+        }
+    };
+
+    // the start of the first buffer at or after p (begin < p): each
+    // buffer ends with an empty line, so this follows the first empty line
+    // at or after p - 1
+    const char* next_boundary(const char* begin, const char* p, const char* end) noexcept
+    {
+        if(p == end)
+        {
+            return end;
+        }
+        if(p - begin == 1)
+        {
+            return *begin == '\n' ? p : next_boundary(begin, p + 1, end);
+        }
+        for(p -= 2; p + 1 < end; ++p)
+        {
+            p = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+            if(!p || p + 1 == end)
+            {
+                break;
+            }
+            if(p[1] == '\n')
+            {
+                return p + 2;
+            }
+        }
+        return end;
+    }
+}
+
+vector<fml32> extread_all(string_ref text, unsigned threads)
+{
+    field_table const* table = field_table::preload() ? field_table::current() : nullptr;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if(threads == 0)
+    {
+        threads = max(thread::hardware_concurrency(), 1u);
+    }
+    size_t workers = min<size_t>(threads, text.size() / min_chunk_size);
+    vector<fml32> result;
+    if(workers <= 1 || !table)
+    {
+        extread_parser(table, begin, begin, end).parse(result);
+        return result;
+    }
+
+    // split on buffer boundaries, and parse the chunks in parallel
+    vector<const char*> bounds(1, begin);
+    for(size_t i = 1; i < workers; ++i)
+    {
+        const char* b = next_boundary(begin, max(begin + text.size() * i / workers, bounds.back() + 1), end);
+        if(b != end)
+        {
+            bounds.push_back(b);
+        }
+    }
+    bounds.push_back(end);
+    size_t chunks = bounds.size() - 1;
+    vector<vector<fml32>> parsed(chunks);
+    vector<exception_ptr> errors(chunks);
+    auto run = [&](size_t i)
+    {
+        try
+        {
+            extread_parser(table, begin, bounds[i], bounds[i + 1]).parse(parsed[i]);
+        }
+        catch(...)
+        {
+            errors[i] = current_exception();
+        }
+    };
+    vector<thread> pool;
+    pool.reserve(chunks - 1);
+    try
+    {
+        for(size_t i = 1; i < chunks; ++i)
+        {
+            pool.emplace_back(run, i);
+        }
+    }
+    catch(...)
+    {
+        for(auto& t : pool)
+        {
+            t.join();
+        }
+        throw;
+    }
+    run(0);
+    for(auto& t : pool)
+    {
+        t.join();
+    }
+    for(auto const& e : errors)
+    {
+        if(e)
+        {
+            rethrow_exception(e); // the earliest in the text
+        }
+    }
+
+    size_t total = 0;
+    for(auto const& p : parsed)
+    {
+        total += p.size();
+    }
+    result.reserve(total);
+    for(auto& p : parsed)
+    {
+        move(p.begin(), p.end(), back_inserter(result));
+    }
+    return result;
+}
+
+vector<fml32> extread_all(FILE* input, unsigned threads)
+{
+    string text;
+    char block[65536];
+    size_t n;
+    while((n = fread(block, 1, sizeof(block), input)) > 0)
+    {
+        text.append(block, n);
+    }
+    if(ferror(input))
+    {
+        throw runtime_error("extread_all - read error");
+    }
+    return extread_all(string_ref(text), threads);
+}
+
+}
@@ -0,0 +1,281 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "tux/fml32_file.hpp"
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace tux
+{
+
+// File layout, in native byte order:
+//   header   "TUXFML32", version (uint32), byte order mark (uint32)
+//   buffers  the used bytes of each buffer, each padded to a multiple of 8
+//   index    offset and size (uint64 each) of every buffer
+//   trailer  buffer count (uint64), index offset (uint64), "FML32IDX"
+namespace
+{
+    const char header_magic[8] = {'T', 'U', 'X', 'F', 'M', 'L', '3', '2'};
+    const char trailer_magic[8] = {'F', 'M', 'L', '3', '2', 'I', 'D', 'X'};
+    const uint32_t format_version = 1;
+    const uint32_t byte_order_mark = 0x01020304;
+    const size_t header_size = 16;
+    const size_t trailer_size = 24;
+    const size_t alignment = 8;
+
+    size_t padding(uint64_t size) noexcept
+    {
+        return static_cast<size_t>((alignment - size % alignment) % alignment);
+    }
+
+    runtime_error file_error(string const& what, string const& path)
+    {
+        return runtime_error(what + " " + path + ": " + strerror(errno));
+    }
+}
+
+//-----------------------------------WRITER------------------------------------------
+fml32_file_writer::fml32_file_writer(string const& path, size_t buffer_size) :
+    path_(path),
+    capacity_(buffer_size > header_size ? buffer_size : header_size)
+{
+    file_ = fopen(path.c_str(), "wb");
+    if(!file_)
+    {
+        throw file_error("cannot create", path);
+    }
+    pending_.reserve(capacity_);
+    write(header_magic, sizeof(header_magic));
+    write(&format_version, sizeof(format_version));
+    write(&byte_order_mark, sizeof(byte_order_mark));
+}
+
+fml32_file_writer::~fml32_file_writer() noexcept
+{
+    try
+    {
+        close();
+    }
+    catch(...)
+    {
+        if(file_)
+        {
+            fclose(file_);
+        }
+    }
+}
+
+void fml32_file_writer::append(const_fml32_view x)
+{
+    if(!file_)
+    {
+        throw runtime_error("fml32_file_writer::append - " + path_ + " is closed");
+    }
+    uint64_t size = x.as_fbfr() ? static_cast<uint64_t>(x.used_size()) : 0;
+    index_.push_back(offset_);
+    index_.push_back(size);
+    write(x.as_fbfr(), static_cast<size_t>(size));
+    static const char zeros[alignment] = {};
+    write(zeros, padding(size));
+}
+
+void fml32_file_writer::close()
+{
+    if(!file_)
+    {
+        return;
+    }
+    uint64_t index_offset = offset_;
+    uint64_t count = index_.size() / 2;
+    write(index_.data(), index_.size() * sizeof(uint64_t));
+    write(&count, sizeof(count));
+    write(&index_offset, sizeof(index_offset));
+    write(trailer_magic, sizeof(trailer_magic));
+    flush();
+    FILE* f = file_;
+    file_ = nullptr;
+    if(fclose(f) != 0)
+    {
+        throw file_error("cannot write", path_);
+    }
+}
+
+size_t fml32_file_writer::size() const noexcept
+{
+    return index_.size() / 2;
+}
+
+void fml32_file_writer::flush()
+{
+    if(!pending_.empty() && fwrite(pending_.data(), 1, pending_.size(), file_) != pending_.size())
+    {
+        throw file_error("cannot write", path_);
+    }
+    pending_.clear();
+}
+
+void fml32_file_writer::write(const void* data, size_t size)
+{
+    if(size == 0)
+    {
+        return;
+    }
+    if(pending_.size() + size > capacity_)
+    {
+        flush();
+    }
+    if(size >= capacity_)
+    {
+        // too big to batch
+        if(fwrite(data, 1, size, file_) != size)
+        {
+            throw file_error("cannot write", path_);
+        }
+    }
+    else
+    {
+        const char* p = static_cast<const char*>(data);
+        pending_.insert(pending_.end(), p, p + size);
+    }
+    offset_ += size;
+}
+
+//-----------------------------------READER------------------------------------------
+fml32_file_reader::fml32_file_reader(string const& path)
+{
+#ifdef _WIN32
+    ifstream is(path, ios::binary);
+    if(!is)
+    {
+        throw file_error("cannot open", path);
+    }
+    contents_.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+    data_ = contents_.data();
+    size_ = contents_.size();
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+    {
+        throw file_error("cannot open", path);
+    }
+    struct stat info;
+    if(fstat(fd, &info) == -1)
+    {
+        int e = errno;
+        ::close(fd);
+        errno = e;
+        throw file_error("cannot stat", path);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if(size_ > 0)
+    {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED)
+        {
+            int e = errno;
+            ::close(fd);
+            errno = e;
+            throw file_error("cannot map", path);
+        }
+        data_ = static_cast<const char*>(p);
+        madvise(p, size_, MADV_SEQUENTIAL); // scans are the common case
+    }
+    ::close(fd); // the mapping keeps the file open
+#endif
+
+    // check the structure up front, so views can be handed out unchecked
+    try
+    {
+        if(size_ < header_size + trailer_size ||
+           memcmp(data_, header_magic, sizeof(header_magic)) != 0)
+        {
+            throw runtime_error("not an fml32 file: " + path);
+        }
+        uint32_t version;
+        uint32_t mark;
+        memcpy(&version, data_ + 8, sizeof(version));
+        memcpy(&mark, data_ + 12, sizeof(mark));
+        if(version != format_version || mark != byte_order_mark)
+        {
+            throw runtime_error("unsupported fml32 file version or byte order: " + path);
+        }
+        const char* trailer = data_ + size_ - trailer_size;
+        uint64_t count;
+        uint64_t index_offset;
+        memcpy(&count, trailer, sizeof(count));
+        memcpy(&index_offset, trailer + 8, sizeof(index_offset));
+        if(memcmp(trailer + 16, trailer_magic, sizeof(trailer_magic)) != 0 ||
+           index_offset < header_size || index_offset % alignment != 0 ||
+           count > size_ / 16 || index_offset + count * 16 != size_ - trailer_size)
+        {
+            throw runtime_error("incomplete or corrupt fml32 file: " + path);
+        }
+        index_ = reinterpret_cast<const uint64_t*>(data_ + index_offset);
+        count_ = static_cast<size_t>(count);
+        const uint64_t smallest = static_cast<uint64_t>(Fneeded32(0, 0)); // an FBFR32 with no fields
+        for(size_t i = 0; i < count_; ++i)
+        {
+            uint64_t offset = index_[2 * i];
+            uint64_t size = index_[2 * i + 1];
+            if(offset < header_size || offset % alignment != 0 || size > index_offset || offset > index_offset - size)
+            {
+                throw runtime_error("corrupt fml32 file index: " + path);
+            }
+            if(size == 0)
+            {
+                continue; // a null buffer
+            }
+            // the buffer's own header mustn't claim more than its entry holds
+            long used = size < smallest ? -1 : Fused32(reinterpret_cast<FBFR32*>(const_cast<char*>(data_ + offset)));
+            if(used == -1 || static_cast<uint64_t>(used) > size)
+            {
+                throw runtime_error("corrupt fml32 file buffer " + to_string(i) + ": " + path);
+            }
+        }
+    }
+    catch(...)
+    {
+#ifndef _WIN32
+        if(data_)
+        {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+        throw;
+    }
+}
+
+fml32_file_reader::~fml32_file_reader() noexcept
+{
+#ifndef _WIN32
+    if(data_)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+const_fml32_view fml32_file_reader::operator[](size_t i) const noexcept
+{
+    return index_[2 * i + 1] == 0 ? const_fml32_view() :
+           const_fml32_view(reinterpret_cast<const FBFR32*>(data_ + index_[2 * i]));
+}
+
+const_fml32_view fml32_file_reader::at(size_t i) const
+{
+    if(i >= count_)
+    {
+        throw out_of_range("fml32_file_reader::at - no buffer " + to_string(i));
+    }
+    return (*this)[i];
+}
+
+}
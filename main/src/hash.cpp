@@ -0,0 +1,350 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "fml32.h"
+#include "fml.h"
+#include "tux/hash.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    // XXH64 primes
+    const uint64_t prime1 = 11400714785074694791ULL;
+    const uint64_t prime2 = 14029467366897019727ULL;
+    const uint64_t prime3 = 1609587929392839161ULL;
+    const uint64_t prime4 = 9650029242287828579ULL;
+    const uint64_t prime5 = 2870177450012600261ULL;
+
+    uint64_t rotl(uint64_t x, int r) noexcept
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // little endian regardless of platform, so hashes are portable
+    uint64_t read64(const unsigned char* p) noexcept
+    {
+        uint64_t x = 0;
+        for(int i = 7; i >= 0; --i)
+        {
+            x = (x << 8) | p[i];
+        }
+        return x;
+    }
+
+    uint64_t read32(const unsigned char* p) noexcept
+    {
+        return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) |
+               (static_cast<uint64_t>(p[2]) << 16) | (static_cast<uint64_t>(p[3]) << 24);
+    }
+
+    uint64_t xxh_round(uint64_t acc, uint64_t input) noexcept
+    {
+        return rotl(acc + input * prime2, 31) * prime1;
+    }
+
+    uint64_t merge_round(uint64_t acc, uint64_t value) noexcept
+    {
+        return (acc ^ xxh_round(0, value)) * prime1 + prime4;
+    }
+
+    // mixes one 64 bit word into a running hash (the XXH64 tail step)
+    uint64_t step(uint64_t h, uint64_t x) noexcept
+    {
+        return rotl(h ^ xxh_round(0, x), 27) * prime1 + prime4;
+    }
+
+    uint64_t avalanche(uint64_t h) noexcept
+    {
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    // numbers are hashed as fixed width little endian integers, whatever the
+    // platform's long and byte order
+    uint64_t hash_integer(int64_t x, uint64_t seed) noexcept
+    {
+        unsigned char bytes[8];
+        uint64_t u = static_cast<uint64_t>(x);
+        for(int i = 0; i < 8; ++i)
+        {
+            bytes[i] = static_cast<unsigned char>(u >> (8 * i));
+        }
+        return hash_bytes(bytes, sizeof(bytes), seed);
+    }
+
+    template <typename T>
+    T read_value(const char* p) noexcept
+    {
+        T x;
+        memcpy(&x, p, sizeof(x)); // copies needn't be aligned for T
+        return x;
+    }
+
+    // the fml and fml32 functions the walk below needs
+    struct fml32_traits
+    {
+        typedef FBFR32 fbfr;
+        typedef FLDID32 fldid;
+        typedef FLDOCC32 fldocc;
+        typedef FLDLEN32 fldlen;
+        typedef fml32 error_source;
+        static int next(fbfr* f, fldid* id, fldocc* oc, char* value, fldlen* len) { return Fnext32(f, id, oc, value, len); }
+        static int type(fldid id) noexcept { return Fldtype32(id); }
+        static std::string type_name(fldid id) { return fml32::field_type_name(id); }
+        static long used(fbfr* f) noexcept { return Fused32(f); }
+        static int error() noexcept { return Ferror32; }
+        static const char* next_name() noexcept { return "Fnext32"; }
+    };
+
+    struct fml16_traits
+    {
+        typedef FBFR fbfr;
+        typedef FLDID fldid;
+        typedef FLDOCC fldocc;
+        typedef FLDLEN fldlen;
+        typedef fml16 error_source;
+        static int next(fbfr* f, fldid* id, fldocc* oc, char* value, fldlen* len) { return Fnext(f, id, oc, value, len); }
+        static int type(fldid id) noexcept { return Fldtype(id); }
+        static std::string type_name(fldid id) { return fml16::field_type_name(id); }
+        static long used(fbfr* f) noexcept { return Fused(f); }
+        static int error() noexcept { return Ferror; }
+        static const char* next_name() noexcept { return "Fnext"; }
+    };
+
+    template <typename Traits>
+    uint64_t hash_fml(typename Traits::fbfr* f, uint64_t seed, hash_mode mode);
+
+    uint64_t hash_view(const FVIEWFLD* v, uint64_t seed, hash_mode mode);
+
+    // hashes one value by what it means rather than how it's laid out in memory
+    template <typename Traits>
+    uint64_t hash_value(typename Traits::fldid id, const char* value, size_t len, uint64_t seed, hash_mode mode)
+    {
+        switch(Traits::type(id))
+        {
+            case FLD_SHORT:
+                return hash_integer(read_value<short>(value), seed);
+            case FLD_LONG:
+                return hash_integer(read_value<long>(value), seed);
+            case FLD_INT:
+                return hash_integer(read_value<int>(value), seed);
+            case FLD_CHAR:
+                return hash_bytes(value, 1, seed);
+            case FLD_FLOAT:
+            {
+                uint32_t bits;
+                static_assert(sizeof(bits) == sizeof(float), "float should be IEEE single precision");
+                memcpy(&bits, value, sizeof(bits));
+                return hash_integer(bits, seed);
+            }
+            case FLD_DOUBLE:
+            {
+                uint64_t bits;
+                static_assert(sizeof(bits) == sizeof(double), "double should be IEEE double precision");
+                memcpy(&bits, value, sizeof(bits));
+                return hash_integer(static_cast<int64_t>(bits), seed);
+            }
+            case FLD_STRING:
+            case FLD_CARRAY:
+            case FLD_MBSTRING:
+                return hash_bytes(value, len, seed);
+            case FLD_FML32:
+                return hash_fml<fml32_traits>(reinterpret_cast<FBFR32*>(const_cast<char*>(value)), seed, mode);
+            case FLD_FML:
+                return hash_fml<fml16_traits>(reinterpret_cast<FBFR*>(const_cast<char*>(value)), seed, mode);
+            case FLD_VIEW32:
+                return hash_view(reinterpret_cast<const FVIEWFLD*>(value), seed, mode);
+            default: // pointers, decimals
+                throw runtime_error("cannot hash a " + Traits::type_name(id) + " field");
+        }
+    }
+
+    // Walks the occurrences in buffer order, which FML keeps sorted by field
+    // id; so all the occurrences of a field are adjacent, and canonical mode
+    // can combine them order-independently (by summing their hashes) as it goes.
+    // Each Fnext call copies the value out too, so nothing is looked up twice;
+    // a view32 value is copied through an FVIEWFLD whose data follows it.
+    template <typename Traits>
+    uint64_t hash_fml(typename Traits::fbfr* f, uint64_t seed, hash_mode mode)
+    {
+        uint64_t h = seed + prime5;
+        uint64_t count = 0;
+        if(f)
+        {
+            vector<char> copy(sizeof(FVIEWFLD) + 256);
+            typename Traits::fldid id = 0; // first field
+            typename Traits::fldocc oc = 0;
+            uint64_t field_count = 0;
+            uint64_t field_sum = 0;
+            int rc;
+            for(;;)
+            {
+                typename Traits::fldid next_id = id;
+                typename Traits::fldocc next_oc = oc;
+                typename Traits::fldlen len;
+                for(bool grown = false; ; grown = true)
+                {
+                    FVIEWFLD v = {};
+                    v.data = copy.data() + sizeof(FVIEWFLD);
+                    memcpy(copy.data(), &v, sizeof(v));
+                    len = static_cast<typename Traits::fldlen>(copy.size() - sizeof(FVIEWFLD));
+                    rc = Traits::next(f, &next_id, &next_oc, copy.data(), &len);
+                    if(rc != -1 || Traits::error() != FNOSPACE || grown)
+                    {
+                        break;
+                    }
+                    // no value can be larger than the buffer holding it
+                    next_id = id;
+                    next_oc = oc;
+                    copy.resize(sizeof(FVIEWFLD) + static_cast<size_t>(Traits::used(f)));
+                }
+                if(rc != 1)
+                {
+                    break;
+                }
+                id = next_id;
+                oc = next_oc;
+                uint64_t v = hash_value<Traits>(id, copy.data(), static_cast<size_t>(len), seed, mode);
+                ++count;
+                if(mode == hash_mode::exact)
+                {
+                    h = step(step(h, static_cast<uint64_t>(id)), v);
+                }
+                else
+                {
+                    if(oc == 0 && field_count > 0)
+                    {
+                        h = step(step(h, field_count), field_sum);
+                        field_count = 0;
+                        field_sum = 0;
+                    }
+                    if(oc == 0)
+                    {
+                        h = step(h, static_cast<uint64_t>(id));
+                    }
+                    ++field_count;
+                    field_sum += v;
+                }
+            }
+            if(rc == -1)
+            {
+                throw Traits::error_source::last_error(Traits::next_name());
+            }
+            if(field_count > 0)
+            {
+                h = step(step(h, field_count), field_sum);
+            }
+        }
+        return avalanche(h ^ count);
+    }
+
+    // a view's members by content, as the fields they map to [Fvstof32],
+    // so neither padding nor the platform's layout of the struct counts
+    uint64_t hash_view(const FVIEWFLD* v, uint64_t seed, hash_mode mode)
+    {
+        char* name = const_cast<char*>(v->vname);
+        fml32 members;
+        members.reserve(Fvneeded32(name) * 4 + 1024);
+        int rc;
+        while((rc = Fvstof32(members.as_fbfr(), v->data, FUPDATE, name)) == -1 && Ferror32 == FNOSPACE)
+        {
+            members.reserve(members.size() * 2);
+        }
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvstof32");
+        }
+        uint64_t h = hash_bytes(name, strnlen(name, sizeof(v->vname)), seed);
+        return step(h, hash_fml<fml32_traits>(members.as_fbfr(), seed, mode));
+    }
+}
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) noexcept
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t h;
+    if(size >= 32)
+    {
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        for(const unsigned char* limit = end - 32; p <= limit; p += 32)
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + prime5;
+    }
+    h += static_cast<uint64_t>(size);
+
+    for(; end - p >= 8; p += 8)
+    {
+        h = step(h, read64(p));
+    }
+    if(end - p >= 4)
+    {
+        h = rotl(h ^ (read32(p) * prime1), 23) * prime2 + prime3;
+        p += 4;
+    }
+    for(; p < end; ++p)
+    {
+        h = rotl(h ^ (*p * prime5), 11) * prime1;
+    }
+    return avalanche(h);
+}
+
+uint64_t hash(buffer const& x, uint64_t seed) noexcept
+{
+    return x ? hash_bytes(x.data(), static_cast<size_t>(x.payload_size()), seed) : hash_bytes(nullptr, 0, seed);
+}
+
+uint64_t hash(cstring const& x, uint64_t seed) noexcept
+{
+    return x ? hash_bytes(x.data(), static_cast<size_t>(x.size()), seed) : hash_bytes(nullptr, 0, seed);
+}
+
+uint64_t hash(carray const& x, uint64_t seed) noexcept
+{
+    return x ? hash_bytes(x.data(), static_cast<size_t>(x.size()), seed) : hash_bytes(nullptr, 0, seed);
+}
+
+uint64_t hash(fml32 const& x, uint64_t seed, hash_mode mode)
+{
+    return hash_fml<fml32_traits>(const_cast<FBFR32*>(x.as_fbfr()), seed, mode);
+}
+
+uint64_t hash(fml16 const& x, uint64_t seed, hash_mode mode)
+{
+    return hash_fml<fml16_traits>(const_cast<FBFR*>(x.as_fbfr()), seed, mode);
+}
+
+#if TUXEDO_VERSION >= 1222
+uint64_t hash(record const& x, uint64_t seed)
+{
+    string data = x.get_data();
+    return hash_bytes(data.data(), data.size(), seed);
+}
+#endif
+
+}
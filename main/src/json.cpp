@@ -0,0 +1,713 @@
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <clocale>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "fml32.h"
+#include "tux/field_table.hpp"
+#include "tux/fml32_builder.hpp"
+#include "tux/json.hpp"
+
+using namespace std;
+
+namespace tux
+{
+
+namespace
+{
+    const int max_depth = 64; // of nested objects
+
+    // Returns the length of the leading run of bytes that need no escaping
+    // in a JSON string: anything but '"', '\\' and control characters.
+    // Tests eight bytes at a time (SWAR) until a word contains one.
+    size_t plain_run(const char* p, size_t n) noexcept
+    {
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            uint64_t v;
+            memcpy(&v, p + i, sizeof(v));
+            uint64_t quote = v ^ (ones * '"');
+            uint64_t backslash = v ^ (ones * '\\');
+            uint64_t special = ((quote - ones) & ~quote) |
+                               ((backslash - ones) & ~backslash) |
+                               ((v - ones * 0x20) & ~v);
+            if(special & highs)
+            {
+                break; // locate it below
+            }
+        }
+        for(; i < n; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(p[i]);
+            if(c == '"' || c == '\\' || c < 0x20)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+
+    //-------------------------------------writing-----------------------------------------
+    const char hex_digits[] = "0123456789abcdef";
+
+    void write_escape(unsigned char c, string& out)
+    {
+        out += "\\u00";
+        out += hex_digits[c >> 4];
+        out += hex_digits[c & 15];
+    }
+
+    void write_string(string_ref x, string& out)
+    {
+        out += '"';
+        const char* p = x.data();
+        size_t n = x.size();
+        while(n > 0)
+        {
+            size_t run = plain_run(p, n);
+            out.append(p, run);
+            p += run;
+            n -= run;
+            if(n == 0)
+            {
+                break;
+            }
+            unsigned char c = static_cast<unsigned char>(*p);
+            switch(c)
+            {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default:
+                    write_escape(c, out);
+            }
+            ++p;
+            --n;
+        }
+        out += '"';
+    }
+
+    // a char is a byte, not UTF-8: one above 0x7f is written as the
+    // code point it has in Latin-1, so the text stays valid UTF-8
+    void write_char(char x, string& out)
+    {
+        unsigned char c = static_cast<unsigned char>(x);
+        if(c < 0x80)
+        {
+            write_string(string_ref(&x, 1), out);
+            return;
+        }
+        out += '"';
+        write_escape(c, out);
+        out += '"';
+    }
+
+    void write_integer(long x, string& out)
+    {
+        char digits[24];
+        char* p = digits + sizeof(digits);
+        unsigned long n = x < 0 ? 0UL - static_cast<unsigned long>(x) : static_cast<unsigned long>(x);
+        do
+        {
+            *--p = static_cast<char>('0' + n % 10);
+            n /= 10;
+        } while(n > 0);
+        if(x < 0)
+        {
+            *--p = '-';
+        }
+        out.append(p, digits + sizeof(digits) - p);
+    }
+
+    // snprintf and strtod use the current C locale's decimal point; JSON's is
+    // always '.', so numbers are translated on the way out and the way in
+    char decimal_point() noexcept
+    {
+        const char* point = localeconv()->decimal_point;
+        return point && point[0] ? point[0] : '.';
+    }
+
+    void replace_char(char* text, char from, char to) noexcept
+    {
+        if(from != to)
+        {
+            for(char* p = strchr(text, from); p; p = strchr(p + 1, from))
+            {
+                *p = to;
+            }
+        }
+    }
+
+    // shortest of the usual precisions that reads back exactly
+    template <typename T>
+    void write_real(T x, int short_precision, int full_precision, string& out)
+    {
+        if(!std::isfinite(x))
+        {
+            throw runtime_error("cannot convert a non-finite number to JSON");
+        }
+        char text[32];
+        snprintf(text, sizeof(text), "%.*g", short_precision, static_cast<double>(x));
+        if(static_cast<T>(strtod(text, nullptr)) != x)
+        {
+            snprintf(text, sizeof(text), "%.*g", full_precision, static_cast<double>(x));
+        }
+        replace_char(text, decimal_point(), '.');
+        out += text;
+    }
+
+    const char* name_of(FLDID32 id)
+    {
+        field_table const* table = field_table::current();
+        const char* name = table ? table->name(id) : nullptr;
+        if(!name)
+        {
+            name = Fname32(id);
+            if(!name)
+            {
+                throw fml32::last_error("Fname32");
+            }
+        }
+        return name;
+    }
+
+    void write_object(const_fml32_view f, string& out, int depth);
+
+    void write_view(FBFR32* f, FLDID32 id, FLDOCC32 oc, string& out, int depth)
+    {
+        FLDLEN32 len = 0;
+        unique_ptr<char, decltype(&std::free)> value(Fgetalloc32(f, id, oc, &len), &std::free);
+        if(!value)
+        {
+            throw fml32::last_error("Fgetalloc32");
+        }
+        FVIEWFLD* v = reinterpret_cast<FVIEWFLD*>(value.get());
+        fml32 members;
+        members.reserve(Fvneeded32(v->vname) * 4 + 1024);
+        int rc;
+        while((rc = Fvstof32(members.as_fbfr(), v->data, FUPDATE, v->vname)) == -1 && Ferror32 == FNOSPACE)
+        {
+            members.reserve(members.size() * 2);
+        }
+        if(rc == -1)
+        {
+            throw fml32::last_error("Fvstof32");
+        }
+        string object;
+        write_object(members, object, depth + 1);
+        out += "{\"@view\":";
+        write_string(v->vname, out);
+        if(object.size() > 2)
+        {
+            out += ',';
+            out.append(object, 1, string::npos);
+        }
+        else
+        {
+            out += '}';
+        }
+    }
+
+    void write_value(const_fml32_view f, fml32::field_ref const& field, string& out, int depth)
+    {
+        FLDID32 id = field.id();
+        const char* value = field.data();
+        FLDLEN32 len = field.size();
+        switch(field.type())
+        {
+            case FLD_SHORT:
+            {
+                short x;
+                memcpy(&x, value, sizeof(x)); // values aren't guaranteed to be aligned
+                write_integer(x, out);
+                break;
+            }
+            case FLD_LONG:
+            {
+                long x;
+                memcpy(&x, value, sizeof(x));
+                write_integer(x, out);
+                break;
+            }
+            case FLD_CHAR:
+                write_char(*value, out);
+                break;
+            case FLD_FLOAT:
+            {
+                float x;
+                memcpy(&x, value, sizeof(x));
+                write_real(x, 7, 9, out);
+                break;
+            }
+            case FLD_DOUBLE:
+            {
+                double x;
+                memcpy(&x, value, sizeof(x));
+                write_real(x, 15, 17, out);
+                break;
+            }
+            case FLD_STRING:
+                write_string(string_ref(value, len > 0 ? len - 1 : 0), out);
+                break;
+            case FLD_CARRAY:
+                out += '"';
+                base64_encode(string_ref(value, len), out);
+                out += '"';
+                break;
+            case FLD_FML32:
+                write_object(field.as_fml_view(), out, depth + 1);
+                break;
+            case FLD_VIEW32:
+                write_view(const_cast<FBFR32*>(f.as_fbfr()), id, field.oc(), out, depth);
+                break;
+            default:
+                throw runtime_error("cannot convert " + fml32::field_type_name(id) + " field [" +
+                                    name_of(id) + "] to JSON");
+        }
+    }
+
+    void write_object(const_fml32_view f, string& out, int depth)
+    {
+        if(depth > max_depth)
+        {
+            throw runtime_error("fml32 nested too deeply for JSON");
+        }
+        out += '{';
+        bool first = true;
+        for(auto const& field : f)
+        {
+            if(field.oc() == 0) // occurrences of a field are adjacent
+            {
+                if(!first)
+                {
+                    out += "],";
+                }
+                first = false;
+                write_string(name_of(field.id()), out);
+                out += ":[";
+            }
+            else
+            {
+                out += ',';
+            }
+            write_value(f, field, out, depth);
+        }
+        if(!first)
+        {
+            out += ']';
+        }
+        out += '}';
+    }
+
+    //-------------------------------------parsing-----------------------------------------
+    struct view_value
+    {
+        FLDID32 id;
+        string name;
+        vector<char> data;
+    };
+
+    class parser
+    {
+    public:
+        explicit parser(string_ref text) noexcept :
+            begin_(text.data()), p_(text.data()), end_(text.data() + text.size())
+        {
+        }
+
+        fml32 parse()
+        {
+            skip_whitespace();
+            fml32 result = parse_object(0, nullptr);
+            skip_whitespace();
+            if(p_ != end_)
+            {
+                fail("unexpected text after the object");
+            }
+            return result;
+        }
+
+    private:
+        const char* begin_;
+        const char* p_;
+        const char* end_;
+        string scratch_;
+
+        [[noreturn]] void fail(const char* what) const
+        {
+            throw runtime_error("invalid JSON at offset " + to_string(p_ - begin_) + ": " + what);
+        }
+
+        void skip_whitespace() noexcept
+        {
+            while(p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t'))
+            {
+                ++p_;
+            }
+        }
+
+        bool consume(char c) noexcept
+        {
+            skip_whitespace();
+            if(p_ != end_ && *p_ == c)
+            {
+                ++p_;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c, const char* what)
+        {
+            if(!consume(c))
+            {
+                fail(what);
+            }
+        }
+
+        unsigned parse_hex4()
+        {
+            if(end_ - p_ < 4)
+            {
+                fail("truncated \\u escape");
+            }
+            unsigned x = 0;
+            for(int i = 0; i < 4; ++i)
+            {
+                char c = *p_++;
+                x <<= 4;
+                if(c >= '0' && c <= '9') { x |= c - '0'; }
+                else if(c >= 'a' && c <= 'f') { x |= c - 'a' + 10; }
+                else if(c >= 'A' && c <= 'F') { x |= c - 'A' + 10; }
+                else { fail("invalid \\u escape"); }
+            }
+            return x;
+        }
+
+        static void append_utf8(unsigned cp, string& out)
+        {
+            if(cp < 0x80)
+            {
+                out += static_cast<char>(cp);
+            }
+            else if(cp < 0x800)
+            {
+                out += static_cast<char>(0xc0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+            else if(cp < 0x10000)
+            {
+                out += static_cast<char>(0xe0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+            else
+            {
+                out += static_cast<char>(0xf0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+        }
+
+        // parses a string into out (replacing its contents); \u0000 would
+        // end a string field early, so only a char field may contain it
+        void parse_string(string& out, bool allow_null = false)
+        {
+            out.clear();
+            if(!consume('"'))
+            {
+                fail("expected a string");
+            }
+            for(;;)
+            {
+                size_t run = plain_run(p_, static_cast<size_t>(end_ - p_));
+                out.append(p_, run);
+                p_ += run;
+                if(p_ == end_)
+                {
+                    fail("unterminated string");
+                }
+                char c = *p_++;
+                if(c == '"')
+                {
+                    return;
+                }
+                if(c != '\\')
+                {
+                    --p_;
+                    fail("control character in string");
+                }
+                if(p_ == end_)
+                {
+                    fail("unterminated string");
+                }
+                switch(*p_++)
+                {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u':
+                    {
+                        unsigned cp = parse_hex4();
+                        if(cp >= 0xdc00 && cp < 0xe000)
+                        {
+                            fail("unpaired low surrogate");
+                        }
+                        if(cp >= 0xd800 && cp < 0xdc00)
+                        {
+                            if(end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u')
+                            {
+                                fail("unpaired high surrogate");
+                            }
+                            p_ += 2;
+                            unsigned low = parse_hex4();
+                            if(low < 0xdc00 || low >= 0xe000)
+                            {
+                                fail("invalid surrogate pair");
+                            }
+                            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                        }
+                        if(cp == 0 && !allow_null)
+                        {
+                            fail("\\u0000 in a string");
+                        }
+                        append_utf8(cp, out);
+                        break;
+                    }
+                    default:
+                        --p_;
+                        fail("invalid escape");
+                }
+            }
+        }
+
+        // returns the text of a number
+        string_ref parse_number()
+        {
+            skip_whitespace();
+            const char* start = p_;
+            while(p_ != end_ && (isdigit(static_cast<unsigned char>(*p_)) ||
+                  *p_ == '-' || *p_ == '+' || *p_ == '.' || *p_ == 'e' || *p_ == 'E'))
+            {
+                ++p_;
+            }
+            if(p_ == start || p_ - start > 64)
+            {
+                fail("expected a number");
+            }
+            return string_ref(start, static_cast<size_t>(p_ - start));
+        }
+
+        long parse_integer(long min, long max)
+        {
+            string_ref text = parse_number();
+            char digits[72];
+            memcpy(digits, text.data(), text.size());
+            digits[text.size()] = '\0';
+            char* end = nullptr;
+            errno = 0;
+            long x = strtol(digits, &end, 10);
+            if(*end != '\0' || errno == ERANGE || x < min || x > max)
+            {
+                fail("expected an integer in the field's range");
+            }
+            return x;
+        }
+
+        double parse_real()
+        {
+            string_ref text = parse_number();
+            char digits[72];
+            memcpy(digits, text.data(), text.size());
+            digits[text.size()] = '\0';
+            replace_char(digits, '.', decimal_point());
+            char* end = nullptr;
+            double x = strtod(digits, &end);
+            if(*end != '\0')
+            {
+                fail("expected a number");
+            }
+            return x;
+        }
+
+        // the byte a one character string stands for, as write_char() writes it:
+        // one byte, or a UTF-8 encoded code point up to U+00FF (Latin-1)
+        char parse_char(string const& text)
+        {
+            if(text.size() == 1)
+            {
+                return text[0];
+            }
+            unsigned char lead = text.size() == 2 ? static_cast<unsigned char>(text[0]) : 0;
+            unsigned char trail = text.size() == 2 ? static_cast<unsigned char>(text[1]) : 0;
+            if((lead != 0xc2 && lead != 0xc3) || (trail & 0xc0) != 0x80)
+            {
+                fail("expected a one character string");
+            }
+            return static_cast<char>(((lead & 0x1f) << 6) | (trail & 0x3f));
+        }
+
+        void parse_value(FLDID32 id, fml32_builder& b, vector<view_value>& views, int depth)
+        {
+            switch(Fldtype32(id))
+            {
+                case FLD_SHORT:
+                    b.add(id, static_cast<short>(parse_integer(SHRT_MIN, SHRT_MAX)));
+                    break;
+                case FLD_LONG:
+                    b.add(id, parse_integer(LONG_MIN, LONG_MAX));
+                    break;
+                case FLD_CHAR:
+                    parse_string(scratch_, true);
+                    b.add(id, parse_char(scratch_));
+                    break;
+                case FLD_FLOAT:
+                    b.add(id, static_cast<float>(parse_real()));
+                    break;
+                case FLD_DOUBLE:
+                    b.add(id, parse_real());
+                    break;
+                case FLD_STRING:
+                    parse_string(scratch_);
+                    b.add(id, string_ref(scratch_));
+                    break;
+                case FLD_CARRAY:
+                {
+                    parse_string(scratch_);
+                    string bytes;
+                    if(!base64_decode(scratch_, bytes))
+                    {
+                        fail("expected a base64 string");
+                    }
+                    b.add(id, string_ref(bytes));
+                    break;
+                }
+                case FLD_FML32:
+                    b.add(id, parse_object(depth + 1, nullptr));
+                    break;
+                case FLD_VIEW32:
+                {
+                    string view_name;
+                    fml32 members = parse_object(depth + 1, &view_name);
+                    if(view_name.empty())
+                    {
+                        fail("view32 object without an @view member");
+                    }
+                    long size = Fvneeded32(const_cast<char*>(view_name.c_str()));
+                    if(size == -1)
+                    {
+                        throw fml32::last_error("Fvneeded32");
+                    }
+                    view_value v{id, view_name, vector<char>(static_cast<size_t>(size))};
+                    char* data = v.data.data();
+                    char* name = const_cast<char*>(view_name.c_str());
+                    if(Fvsinit32(data, name) == -1)
+                    {
+                        throw fml32::last_error("Fvsinit32");
+                    }
+                    if(members && Fvftos32(members.as_fbfr(), data, name) == -1)
+                    {
+                        throw fml32::last_error("Fvftos32");
+                    }
+                    views.push_back(move(v));
+                    break;
+                }
+                default:
+                    throw runtime_error("cannot convert JSON to a " + fml32::field_type_name(id) + " field [" +
+                                        fml32::field_name(id) + "]");
+            }
+        }
+
+        // parses an object of fields; view_name, if given, receives an "@view" member
+        fml32 parse_object(int depth, string* view_name)
+        {
+            if(depth > max_depth)
+            {
+                fail("objects nested too deeply");
+            }
+            expect('{', "expected an object");
+            fml32_builder b;
+            vector<view_value> views;
+            if(!consume('}'))
+            {
+                string name;
+                do
+                {
+                    parse_string(name);
+                    expect(':', "expected ':'");
+                    if(view_name && name == "@view")
+                    {
+                        parse_string(*view_name);
+                        continue;
+                    }
+                    FLDID32 id = fml32::field_id(name);
+                    if(consume('['))
+                    {
+                        if(!consume(']'))
+                        {
+                            do
+                            {
+                                parse_value(id, b, views, depth);
+                            } while(consume(','));
+                            expect(']', "expected ',' or ']'");
+                        }
+                    }
+                    else
+                    {
+                        parse_value(id, b, views, depth);
+                    }
+                } while(consume(','));
+                expect('}', "expected ',' or '}'");
+            }
+            fml32 result = b.finish();
+            for(auto const& v : views)
+            {
+                result.add_view(v.id, v.name, v.data.data());
+            }
+            return result;
+        }
+    };
+}
+
+void to_json(fml32 const& x, string& out)
+{
+    write_object(x, out, 0);
+}
+
+string to_json(fml32 const& x)
+{
+    string result;
+    if(x)
+    {
+        result.reserve(static_cast<size_t>(x.used_size()) * 2);
+    }
+    to_json(x, result);
+    return result;
+}
+
+fml32 to_fml32(string_ref json)
+{
+    return parser(json).parse();
+}
+
+}
@@ -30,7 +30,7 @@ mbstring::mbstring(mbstring const& x)
 
 mbstring::mbstring(class buffer&& x)
 {
-    if(x && x.type() != "MBSTRING")
+    if(x && x.type_code() != buffer_type::mbstring)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to mbstring");
     }
@@ -57,7 +57,7 @@ mbstring& mbstring::operator=(mbstring const& x)
 
 mbstring& mbstring::operator=(class buffer&& x)
 {
-    if(x && x.type() != "MBSTRING")
+    if(x && x.type_code() != buffer_type::mbstring)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to mbstring");
     }
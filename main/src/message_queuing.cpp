@@ -39,7 +39,7 @@ void enqueue(string const& queue_space,
                        const_cast<char*>(queue_name.c_str()),
                        &ctl,
                        const_cast<char*>(input.data()),
-                       input.size(),
+                       input.payload_size(),
                        flags);
     if(rc == -1)
     {
@@ -53,6 +53,20 @@ void enqueue(string const& queue_space,
     }
 }
 
+void enqueue(string const& queue_space,
+             string const& queue_name,
+             TPQCTL& ctl,
+             buffer& input,
+             long flags,
+             bool shrink_to_fit)
+{
+    if(shrink_to_fit)
+    {
+        input.shrink_to_fit();
+    }
+    enqueue(queue_space, queue_name, ctl, static_cast<buffer const&>(input), flags);
+}
+
 optional<buffer> private_dequeue(bool throw_on_block,
                          string const& queue_space,
                          string const& queue_name,
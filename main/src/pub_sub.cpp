@@ -14,7 +14,7 @@ void post(string const& event_name,
 {
     int rc = tppost(const_cast<char*>(event_name.c_str()),
                     const_cast<char*>(data.data()),
-                    data.size(),
+                    data.payload_size(),
                     flags);
     if(rc == -1)
     {
@@ -37,7 +37,7 @@ record& record::operator=(record const& x)
     
 record::record(class buffer&& x)
 {
-    if(x && x.type() != "RECORD")
+    if(x && x.type_code() != buffer_type::record)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to record");
     }
@@ -46,7 +46,7 @@ record::record(class buffer&& x)
 
 record& record::operator=(class buffer&& x)
 {
-    if(x && x.type() != "RECORD")
+    if(x && x.type_code() != buffer_type::record)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to record");
     }
@@ -131,7 +131,7 @@ expected<service_reply, error> try_call(std::string const& service,
     
     // tpcall
     const char* i = input.data();
-    long ilen = input.data_size();
+    long ilen = input.payload_size();
     long olen = output.data_size();
     char* o = output.release();
     long reply_data_size = 0;
@@ -191,7 +191,7 @@ buffer call(string const& service,
     
     // tpcall
     const char* i = input.data();
-    long ilen = input.data_size();
+    long ilen = input.payload_size();
     long olen = output.data_size();
     char* o = output.release();
     long reply_data_size = 0;
@@ -289,7 +289,7 @@ void async_call::start(string const& service,
         service_name_ = service;
         int rc = tpacall(const_cast<char*>(service_name_.c_str()),
                const_cast<char*>(input.data()),
-               input.data_size(),
+               input.payload_size(),
                flags);
         if(rc == -1 && tperrno == TPELIMIT)
         {
@@ -297,7 +297,7 @@ void async_call::start(string const& service,
             process_pending_async_calls();
             rc = tpacall(const_cast<char*>(service_name_.c_str()),
                         const_cast<char*>(input.data()),
-                        input.data_size(),
+                        input.payload_size(),
                         flags);
         }
         if(rc == -1)
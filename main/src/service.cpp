@@ -12,11 +12,11 @@ service::~service() noexcept
     static const long flags = 0;
     if(forward_service_name_[0] != '\0')
     {
-        tpforward(forward_service_name_, output_.data(), output_.data_size(), flags);
+        tpforward(forward_service_name_, output_.data(), output_.payload_size(), flags);
     }
     else
     {
-        tpreturn(rval_, rcode_, output_.data(), output_.data_size(), flags);
+        tpreturn(rval_, rcode_, output_.data(), output_.payload_size(), flags);
     }
 }
    
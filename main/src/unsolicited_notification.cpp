@@ -12,7 +12,7 @@ void notify(CLIENTID const& clientid,
 {
     int rc = tpnotify(const_cast<CLIENTID*>(&clientid),
                       const_cast<char*>(data.data()),
-                      data.size(),
+                      data.payload_size(),
                       flags);
     if(rc == -1)
     {
@@ -30,7 +30,7 @@ void broadcast(std::string const& lmid,
                          username.empty() ? nullptr : const_cast<char*>(username.c_str()),
                          clientname.empty() ? nullptr : const_cast<char*>(clientname.c_str()),
                          const_cast<char*>(data.data()),
-                         data.size(),
+                         data.payload_size(),
                          flags);
     if(rc == -1)
     {
@@ -69,12 +69,91 @@ string cstr_to_string(const char* ptr)
     return ptr ? string{ptr} : string{};
 }
 
+const size_t string_ref::npos;
+
 //---------------------------BYTES-------------------------------  
 uint16_t make_16bit_unsigned(uint8_t least_significant_byte, uint8_t most_significant_byte)
 {
     return uint16_t((most_significant_byte << 8) | least_significant_byte);
 }
 
+namespace
+{
+    const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+void base64_encode(string_ref x, string& out)
+{
+    out.reserve(out.size() + (x.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for(; i + 2 < x.size(); i += 3)
+    {
+        unsigned long n = (static_cast<unsigned long>(static_cast<unsigned char>(x[i])) << 16) |
+                          (static_cast<unsigned char>(x[i + 1]) << 8) |
+                          static_cast<unsigned char>(x[i + 2]);
+        out += base64_alphabet[(n >> 18) & 63];
+        out += base64_alphabet[(n >> 12) & 63];
+        out += base64_alphabet[(n >> 6) & 63];
+        out += base64_alphabet[n & 63];
+    }
+    if(i < x.size())
+    {
+        unsigned long n = static_cast<unsigned long>(static_cast<unsigned char>(x[i])) << 16;
+        if(i + 1 < x.size())
+        {
+            n |= static_cast<unsigned char>(x[i + 1]) << 8;
+        }
+        out += base64_alphabet[(n >> 18) & 63];
+        out += base64_alphabet[(n >> 12) & 63];
+        out += i + 1 < x.size() ? base64_alphabet[(n >> 6) & 63] : '=';
+        out += '=';
+    }
+}
+
+bool base64_decode(string_ref x, string& out)
+{
+    static const struct table
+    {
+        signed char values[256];
+        table()
+        {
+            memset(values, -1, sizeof(values));
+            for(int i = 0; i < 64; ++i)
+            {
+                values[static_cast<unsigned char>(base64_alphabet[i])] = static_cast<signed char>(i);
+            }
+        }
+    } decoding;
+    out.clear();
+    out.reserve(x.size() / 4 * 3);
+    unsigned long n = 0;
+    int bits = 0;
+    size_t i = 0;
+    for(; i < x.size() && x[i] != '='; ++i)
+    {
+        int value = decoding.values[static_cast<unsigned char>(x[i])];
+        if(value < 0)
+        {
+            return false;
+        }
+        n = (n << 6) | static_cast<unsigned long>(value);
+        bits += 6;
+        if(bits >= 8)
+        {
+            bits -= 8;
+            out += static_cast<char>((n >> bits) & 0xff);
+        }
+    }
+    for(; i < x.size(); ++i)
+    {
+        if(x[i] != '=')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 //----------------------------------ENV------------------------------------------------
 std::string get_env(std::string const& name)
 {
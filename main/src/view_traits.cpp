@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "tux/view_traits.hpp"
+
+using namespace std;
+
+namespace tux
+{
+namespace view_detail
+{
+
+namespace
+{
+    // a string member may fill its array without a null terminator
+    const char* terminated(const char* value, size_t len, string& copy)
+    {
+        if(memchr(value, '\0', len))
+        {
+            return value;
+        }
+        copy.assign(value, len);
+        return copy.c_str();
+    }
+
+    // room for any value converted from a field of len bytes [CFget32]
+    const size_t conversion_slack = 64;
+
+    template <typename V>
+    V value_at(const char* p) noexcept
+    {
+        V x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
+
+    // builds the bitmap a word at a time, without branching on each element
+    template <typename IsNull>
+    size_t scan(const char* element, size_t stride, size_t n, uint64_t* bits, IsNull is_null) noexcept
+    {
+        size_t nulls = 0;
+        for(size_t first = 0; first < n; first += 64)
+        {
+            size_t last = min(n, first + 64);
+            uint64_t word = 0;
+            for(size_t i = first; i < last; ++i)
+            {
+                uint64_t null = is_null(element + i * stride) ? 1 : 0;
+                word |= null << (i - first);
+                nulls += static_cast<size_t>(null);
+            }
+            if(bits)
+            {
+                bits[first / 64] = word;
+            }
+        }
+        return nulls;
+    }
+
+    template <typename V>
+    size_t scan_values(const char* element, size_t stride, size_t n, uint64_t* bits, const char* null) noexcept
+    {
+        V null_value = value_at<V>(null);
+        return scan(element, stride, n, bits, [null_value](const char* p) { return value_at<V>(p) == null_value; });
+    }
+}
+
+//-----------------------------------FML32------------------------------------------
+namespace
+{
+    // the generated code knows whether the member's type is the field's
+    void add_value(fml32& f, FLDID32 id, const char* value, FLDLEN32 len, int type, bool same)
+    {
+        string copy;
+        if(type == FLD_STRING)
+        {
+            value = terminated(value, len, copy);
+        }
+        if(!f)
+        {
+            f.reserve(1, len);
+        }
+        char* p = const_cast<char*>(value);
+        f.modified();
+        int rc = same ? Fadd32(f.as_fbfr(), id, p, len) : CFadd32(f.as_fbfr(), id, p, len, type);
+        if(rc == -1 && Ferror32 == FNOSPACE)
+        {
+            long current_size = f.size();
+            f.reserve(max(current_size + fml32::bytes_needed(1, len), 2 * current_size));
+            rc = same ? Fadd32(f.as_fbfr(), id, p, len) : CFadd32(f.as_fbfr(), id, p, len, type);
+        }
+        if(rc == -1)
+        {
+            throw fml32::last_error(same ? "Fadd32" : "CFadd32");
+        }
+    }
+
+    long get_value(fml32 const& f, FLDID32 id, FLDOCC32 oc, char* dest, FLDLEN32 size, int type, bool same)
+    {
+        FBFR32* fbfr = const_cast<FBFR32*>(f.as_fbfr());
+        FLDLEN32 len = 0;
+        const char* value = fbfr ? Ffind32(fbfr, id, oc, &len) : nullptr;
+        if(!value)
+        {
+            return -1;
+        }
+        string converted;
+        if(!same)
+        {
+            converted.resize(len + conversion_slack);
+            len = static_cast<FLDLEN32>(converted.size());
+            if(CFget32(fbfr, id, oc, &converted[0], &len, type) == -1)
+            {
+                throw fml32::last_error("CFget32");
+            }
+            value = converted.data();
+        }
+        return set(dest, size, value, len, type);
+    }
+}
+
+void add(fml32& f, FLDID32 id, const char* value, FLDLEN32 len, int type)
+{
+    add_value(f, id, value, len, type, true);
+}
+
+void add_converted(fml32& f, FLDID32 id, const char* value, FLDLEN32 len, int type)
+{
+    add_value(f, id, value, len, type, false);
+}
+
+long get(fml32 const& f, FLDID32 id, FLDOCC32 oc, char* dest, FLDLEN32 size, int type)
+{
+    return get_value(f, id, oc, dest, size, type, true);
+}
+
+long get_converted(fml32 const& f, FLDID32 id, FLDOCC32 oc, char* dest, FLDLEN32 size, int type)
+{
+    return get_value(f, id, oc, dest, size, type, false);
+}
+
+void reserve(fml32& f, long needed)
+{
+    long allocated = f.size();
+    if(allocated == 0)
+    {
+        f.reserve(needed);
+        return;
+    }
+    // needed includes a buffer header, which f already has
+    long missing = needed - fml32::bytes_needed(0, 0) - f.unused_size();
+    if(missing > 0)
+    {
+        f.reserve(allocated + missing);
+    }
+}
+
+//-----------------------------------FML16------------------------------------------
+namespace
+{
+    void add_value(fml16& f, FLDID id, const char* value, FLDLEN len, int type, bool same)
+    {
+        string copy;
+        if(type == FLD_STRING)
+        {
+            value = terminated(value, len, copy);
+        }
+        if(!f)
+        {
+            f.reserve(1, len);
+        }
+        char* p = const_cast<char*>(value);
+        int rc = same ? Fadd(f.as_fbfr(), id, p, len) : CFadd(f.as_fbfr(), id, p, len, type);
+        if(rc == -1 && Ferror == FNOSPACE)
+        {
+            long current_size = f.size();
+            f.reserve(max(current_size + fml16::bytes_needed(1, len), 2 * current_size));
+            rc = same ? Fadd(f.as_fbfr(), id, p, len) : CFadd(f.as_fbfr(), id, p, len, type);
+        }
+        if(rc == -1)
+        {
+            throw fml16::last_error(same ? "Fadd" : "CFadd");
+        }
+    }
+
+    long get_value(fml16 const& f, FLDID id, FLDOCC oc, char* dest, FLDLEN size, int type, bool same)
+    {
+        FBFR* fbfr = const_cast<FBFR*>(f.as_fbfr());
+        FLDLEN len = 0;
+        const char* value = fbfr ? Ffind(fbfr, id, oc, &len) : nullptr;
+        if(!value)
+        {
+            return -1;
+        }
+        string converted;
+        if(!same)
+        {
+            converted.resize(len + conversion_slack);
+            len = static_cast<FLDLEN>(converted.size());
+            if(CFget(fbfr, id, oc, &converted[0], &len, type) == -1)
+            {
+                throw fml16::last_error("CFget");
+            }
+            value = converted.data();
+        }
+        return set(dest, size, value, len, type);
+    }
+}
+
+void add(fml16& f, FLDID id, const char* value, FLDLEN len, int type)
+{
+    add_value(f, id, value, len, type, true);
+}
+
+void add_converted(fml16& f, FLDID id, const char* value, FLDLEN len, int type)
+{
+    add_value(f, id, value, len, type, false);
+}
+
+long get(fml16 const& f, FLDID id, FLDOCC oc, char* dest, FLDLEN size, int type)
+{
+    return get_value(f, id, oc, dest, size, type, true);
+}
+
+long get_converted(fml16 const& f, FLDID id, FLDOCC oc, char* dest, FLDLEN size, int type)
+{
+    return get_value(f, id, oc, dest, size, type, false);
+}
+
+void reserve(fml16& f, long needed)
+{
+    long allocated = f.size();
+    if(allocated == 0)
+    {
+        f.reserve(needed);
+        return;
+    }
+    // needed includes a buffer header, which f already has
+    long missing = needed - fml16::bytes_needed(0, 0) - f.unused_size();
+    if(missing > 0)
+    {
+        f.reserve(allocated + missing);
+    }
+}
+
+//-----------------------------------MEMBERS----------------------------------------
+long set(char* dest, size_t size, const char* value, size_t len, int type) noexcept
+{
+    switch(type)
+    {
+        case FLD_STRING:
+        {
+            const char* end = static_cast<const char*>(memchr(value, '\0', len));
+            size_t n = min(end ? static_cast<size_t>(end - value) : len, size - 1);
+            memcpy(dest, value, n);
+            dest[n] = '\0';
+            return static_cast<long>(n + 1);
+        }
+        case FLD_CARRAY:
+        {
+            size_t n = min(len, size);
+            memcpy(dest, value, n);
+            memset(dest + n, 0, size - n);
+            return static_cast<long>(n);
+        }
+        default:
+            memcpy(dest, value, size);
+            return static_cast<long>(size);
+    }
+}
+
+size_t string_length(const char* value, size_t size) noexcept
+{
+    auto end = static_cast<const char*>(memchr(value, '\0', size));
+    return end ? static_cast<size_t>(end - value) : size;
+}
+
+size_t null_bitmap(null_test const& t, const char* rows, size_t stride, size_t n, size_t oc, uint64_t* bits) noexcept
+{
+    const char* element = rows + t.offset + oc * t.size;
+    const char* null = t.null_image.data() + oc * t.size;
+    size_t size = t.size;
+    if(!t.has_null)
+    {
+        return scan(element, stride, n, bits, [](const char*) { return false; });
+    }
+    switch(t.type)
+    {
+        case FLD_SHORT: return scan_values<short>(element, stride, n, bits, null);
+        case FLD_INT: return scan_values<int>(element, stride, n, bits, null);
+        case FLD_LONG: return scan_values<long>(element, stride, n, bits, null);
+        case FLD_CHAR: return scan_values<char>(element, stride, n, bits, null);
+        case FLD_FLOAT: return scan_values<float>(element, stride, n, bits, null);
+        case FLD_DOUBLE: return scan_values<double>(element, stride, n, bits, null);
+        case FLD_STRING:
+            return scan(element, stride, n, bits, [null, size](const char* p) { return strncmp(p, null, size) == 0; });
+        default:
+            return scan(element, stride, n, bits, [null, size](const char* p) { return memcmp(p, null, size) == 0; });
+    }
+}
+
+void clear(null_test const& t, char* rows, size_t stride, size_t n, uint64_t const* mask) noexcept
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        if(!mask || (mask[i / 64] >> (i % 64)) & 1)
+        {
+            memcpy(rows + i * stride + t.offset, t.null_image.data(), t.null_image.size());
+        }
+    }
+}
+
+bool equals_padded(const char* value, size_t size, const char* null, size_t null_size) noexcept
+{
+    size_t n = min(size, null_size);
+    if(memcmp(value, null, n) != 0)
+    {
+        return false;
+    }
+    return all_of(value + n, value + size, [](char c) { return c == '\0'; });
+}
+
+}
+}
@@ -28,7 +28,7 @@ xml::xml(xml const& x)
 
 xml::xml(class buffer&& x)
 {
-    if(x && x.type() != "XML")
+    if(x && x.type_code() != buffer_type::xml)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to xml");
     }
@@ -55,7 +55,7 @@ xml& xml::operator=(xml const& x)
 
 xml& xml::operator=(class buffer&& x)
 {
-    if(x && x.type() != "XML")
+    if(x && x.type_code() != buffer_type::xml)
     {
         throw runtime_error("buffer type " + x.type() + " cannot be cast to xml");
     }
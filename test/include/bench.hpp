@@ -0,0 +1,40 @@
+/* Minimal timing helpers for the bench_runner target. */
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace bench
+{
+
+/* Prevents the optimizer from discarding a computed value. */
+template <typename T>
+inline void keep(T const& x)
+{
+    static const void* volatile sink;
+    sink = &x;
+    (void)sink;
+}
+
+/* Runs f() iterations times and prints the mean cost per call.
+Returns nanoseconds per iteration. */
+template <typename F>
+double measure(std::string const& name, long iterations, F f)
+{
+    // warm up
+    for(long i = 0; i < iterations / 10 + 1; ++i)
+    {
+        f();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(long i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+    std::printf("%-48s %12.1f ns/op  (%ld iterations)\n", name.c_str(), ns, iterations);
+    return ns;
+}
+
+}
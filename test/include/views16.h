@@ -17,3 +17,13 @@ struct string_info {
 
 ENABLE_TYPE_NAME(string_info)
 
+struct long_strings {
+	short	C_text;
+	char	text[8][1000];		/* null="\0" */
+	unsigned short	L_blob;
+	char	blob[4000];		/* null="\0" */
+	long	total;		/* null=0 */
+};
+
+ENABLE_TYPE_NAME(long_strings)
+
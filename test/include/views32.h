@@ -17,3 +17,30 @@ struct string_info {
 
 ENABLE_TYPE_NAME(string_info)
 
+struct mixed_struct {
+	short	s;		/* null=-1 */
+	int	i;		/* null=0 */
+	long	C_l;
+	long	l[3];		/* null=0 */
+	char	c;		/* null='x' */
+	double	d[2];		/* null=0.000000 */
+	long	C_str;
+	char	str[2][20];		/* null="none" */
+	unsigned long	L_bytes;
+	char	bytes[8];		/* null="\0" */
+	long	converted;		/* null=0 */
+	long	local;		/* null=0 */
+};
+
+ENABLE_TYPE_NAME(mixed_struct)
+
+struct long_strings {
+	long	C_text;
+	char	text[8][1000];		/* null="\0" */
+	unsigned long	L_blob;
+	char	blob[4000];		/* null="\0" */
+	long	total;		/* null=0 */
+};
+
+ENABLE_TYPE_NAME(long_strings)
+
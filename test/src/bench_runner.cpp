@@ -0,0 +1,7 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+/*
+Performance benchmarks.  Each TEST_CASE prints its timings via bench::measure.
+Run with e.g. ./bench_runner -ts="buffer_pool"
+*/
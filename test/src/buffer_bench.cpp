@@ -0,0 +1,183 @@
+#include <string>
+#include "doctest.h"
+#include "bench.hpp"
+#include "tux/buffer.hpp"
+#include "tux/compression.hpp"
+#include "tux/fml32.hpp"
+#include "tux/hash.hpp"
+#include "tux/cstring.hpp"
+#include "tux/util.hpp"
+#include "tux/view32.hpp"
+#include "fields32.h"
+#include "views32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("buffer");
+
+namespace
+{
+    // what a cast used to cost: tptypes plus a std::string
+    string uncached_type(buffer const& x)
+    {
+        string type(8, ' ');
+        tptypes(const_cast<char*>(x.data()), const_cast<char*>(type.data()), nullptr);
+        trim_to_null_terminator(type);
+        return type;
+    }
+}
+
+TEST_CASE("buffer bench type check")
+{
+    const long n = 1000000;
+    buffer b("FML32");
+
+    double before = bench::measure("type check (tptypes + std::string)", n, [&]
+    {
+        bench::keep(uncached_type(b) != "FML32");
+    });
+    double after = bench::measure("type check (cached type_code)", n, [&]
+    {
+        bench::keep(b.type_code() != buffer_type::fml32);
+    });
+    printf("  speedup %.1fx\n", before / after);
+
+    bench::measure("size (cached)", n, [&]
+    {
+        bench::keep(b.size());
+    });
+}
+
+TEST_CASE("buffer bench view32 allocation")
+{
+    const long n = 1000000;
+
+    double before = bench::measure("view size by name (Fvneeded32)", n, [&]
+    {
+        bench::keep(view_size32("my_struct"));
+    });
+    double after = bench::measure("view size by type (cached)", n, [&]
+    {
+        bench::keep(view_size32<my_struct>());
+    });
+    printf("  speedup %.1fx\n", before / after);
+
+    // what view32<T>::alloc did before caching the size
+    before = bench::measure("alloc VIEW32 my_struct (Fvneeded32 each time)", n, [&]
+    {
+        buffer b;
+        b.alloc("VIEW32", "my_struct", view_size32("my_struct"));
+        Fvsinit32(b.data(), const_cast<char*>("my_struct"));
+        bench::keep(b.data());
+    });
+    after = bench::measure("view32<my_struct>::alloc", n, [&]
+    {
+        view32<my_struct> v;
+        v.alloc();
+        bench::keep(v.get());
+    });
+    printf("  speedup %.1fx\n", before / after);
+}
+
+TEST_CASE("buffer bench cast")
+{
+    const long n = 1000000;
+    fml32 f;
+    f.reserve(0);
+    cstring s("hello");
+
+    bench::measure("buffer -> fml32 -> buffer", n, [&]
+    {
+        fml32 tmp(f.move_buffer());
+        f = move(tmp);
+    });
+    bench::measure("buffer -> cstring -> buffer", n, [&]
+    {
+        cstring tmp(s.move_buffer());
+        s = move(tmp);
+    });
+}
+
+TEST_CASE("buffer bench compressed export")
+{
+    // a document shaped like the fml32 test fixtures
+    fml32 f;
+    for(long i = 0; i < 2000; ++i)
+    {
+        f.add(A_SHORT_FIELD, static_cast<short>(i % 100));
+        f.add(A_LONG_FIELD, i * 37);
+        f.add(A_DOUBLE_FIELD, i * 1.25);
+        f.add(A_STRING_FIELD, "customer " + to_string(i % 250) + " of branch 42");
+        f.add(A_CARRAY_FIELD, "hello dolly");
+    }
+    string plain = export_buffer(f.buffer());
+    string compressed = compress(plain);
+    std::printf("%-48s %12.2f x (%zu -> %zu bytes)\n", "compression ratio", 
+                static_cast<double>(plain.size()) / compressed.size(), plain.size(), compressed.size());
+    
+    double ns = bench::measure("compress exported fml32", 200, [&]
+    {
+        bench::keep(compress(plain));
+    });
+    std::printf("%-48s %12.1f MB/s\n", "compress", plain.size() / ns * 1000);
+    ns = bench::measure("decompress exported fml32", 200, [&]
+    {
+        bench::keep(decompress(compressed));
+    });
+    std::printf("%-48s %12.1f MB/s\n", "decompress", plain.size() / ns * 1000);
+    
+    bench::measure("export_buffer binary", 200, [&]
+    {
+        bench::keep(export_buffer(f.buffer(), export_mode::binary));
+    });
+    bench::measure("export_buffer compressed", 200, [&]
+    {
+        bench::keep(export_buffer(f.buffer(), export_mode::compressed));
+    });
+    string exported = export_buffer(f.buffer(), export_mode::compressed);
+    bench::measure("import_buffer compressed", 200, [&]
+    {
+        bench::keep(import_buffer(exported));
+    });
+}
+
+TEST_CASE("buffer bench hash")
+{
+    string bytes(1 << 20, '\0');
+    for(size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<char>(i * 2654435761U >> 13);
+    }
+    double ns = bench::measure("hash_bytes 1MB", 200, [&]
+    {
+        bench::keep(hash_bytes(bytes.data(), bytes.size()));
+    });
+    std::printf("%-48s %12.1f MB/s\n", "hash_bytes", bytes.size() / ns * 1000);
+    bench::measure("hash_bytes 16 bytes", 1000000, [&]
+    {
+        bench::keep(hash_bytes(bytes.data(), 16));
+    });
+
+    fml32 f;
+    for(long i = 0; i < 2000; ++i)
+    {
+        f.add(A_LONG_FIELD, i * 37);
+        f.add(A_DOUBLE_FIELD, i * 1.25);
+        f.add(A_STRING_FIELD, "customer " + to_string(i % 250) + " of branch 42");
+    }
+    long used = f.used_size();
+    ns = bench::measure("hash(fml32) 6000 occurrences", 200, [&]
+    {
+        bench::keep(tux::hash(f));
+    });
+    std::printf("%-48s %12.1f MB/s\n", "hash(fml32)", used / ns * 1000);
+    bench::measure("hash(fml32) 6000 occurrences, canonical", 200, [&]
+    {
+        bench::keep(tux::hash(f, 0, hash_mode::canonical));
+    });
+    bench::measure("fml32::checksum 6000 occurrences", 200, [&]
+    {
+        bench::keep(f.checksum());
+    });
+}
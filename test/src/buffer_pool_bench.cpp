@@ -0,0 +1,60 @@
+#include "doctest.h"
+#include "bench.hpp"
+#include "tux/buffer_pool.hpp"
+#include "tux/fml32.hpp"
+#include "tux/cstring.hpp"
+#include "tux/request_response.hpp"
+#include "fields32.hpp"
+
+using namespace std;
+using namespace tux;
+using namespace field32;
+
+TEST_SUITE("buffer_pool");
+
+namespace
+{
+    void build_and_discard_request()
+    {
+        fml32 f;
+        for(long i = 0; i < 10; ++i)
+        {
+            f.add(A_LONG_FIELD, i);
+            f.add(A_STRING_FIELD, "some request data");
+        }
+        bench::keep(f.used_size());
+    }
+
+    void call_toupper()
+    {
+        cstring request("hello");
+        cstring reply = call("TOUPPER", request.buffer());
+        bench::keep(reply.size());
+    }
+}
+
+TEST_CASE("buffer_pool bench local request loop")
+{
+    const long n = 200000;
+    double unpooled = bench::measure("fml32 build/discard (tpalloc)", n, build_and_discard_request);
+
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+    double pooled = bench::measure("fml32 build/discard (buffer_pool)", n, build_and_discard_request);
+    printf("  speedup %.2fx, hits=%llu misses=%llu\n", unpooled / pooled,
+           pool.stats().hits, pool.stats().misses);
+    CHECK(pool.stats().hits > pool.stats().misses);
+}
+
+TEST_CASE("buffer_pool bench call loop")
+{
+    const long n = 20000;
+    double unpooled = bench::measure("call TOUPPER (tpalloc)", n, call_toupper);
+
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+    double pooled = bench::measure("call TOUPPER (buffer_pool)", n, call_toupper);
+    printf("  speedup %.2fx, hits=%llu misses=%llu\n", unpooled / pooled,
+           pool.stats().hits, pool.stats().misses);
+    CHECK(pool.stats().hits > pool.stats().misses);
+}
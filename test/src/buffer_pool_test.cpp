@@ -0,0 +1,143 @@
+#include "doctest.h"
+#include "tux/buffer_pool.hpp"
+#include "tux/buffer.hpp"
+#include "tux/fml32.hpp"
+#include "tux/cstring.hpp"
+#include "fields32.hpp"
+
+using namespace std;
+using namespace tux;
+using namespace field32;
+
+TEST_SUITE("buffer_pool");
+
+TEST_CASE("buffer_pool not installed by default")
+{
+    CHECK(buffer_pool::current() == nullptr);
+    buffer_pool pool;
+    {
+        buffer_pool_scope scope(pool);
+        CHECK(buffer_pool::current() == &pool);
+    }
+    CHECK(buffer_pool::current() == nullptr);
+}
+
+TEST_CASE("buffer_pool reuses freed buffers")
+{
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+
+    buffer b("FML32");
+    CHECK(pool.stats().misses == 1);
+    CHECK(pool.stats().hits == 0);
+    char* first = b.data();
+    b.free();
+    CHECK(pool.stats().returns == 1);
+    CHECK(pool.idle() == 1);
+
+    b.alloc("FML32");
+    CHECK(b.data() == first);
+    CHECK(pool.stats().hits == 1);
+    CHECK(pool.idle() == 0);
+
+    // different type is a miss
+    buffer s("STRING", nullptr, 100);
+    CHECK(s.data() != first);
+    CHECK(pool.stats().misses == 2);
+}
+
+TEST_CASE("buffer_pool reinitializes reused buffers")
+{
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+
+    {
+        fml32 f;
+        f.set(A_LONG_FIELD, 42L);
+        f.set(A_STRING_FIELD, "hello");
+        CHECK(f.field_count() == 2);
+    }
+    {
+        fml32 f;
+        f.reserve(0);
+        CHECK(pool.stats().hits == 1);
+        CHECK(f.field_count() == 0);
+        CHECK(!f.has(A_LONG_FIELD));
+    }
+    {
+        cstring s("abc");
+        s.buffer().free();
+        cstring t;
+        t.reserve(10);
+        CHECK(t.size() == 0);
+    }
+}
+
+TEST_CASE("buffer_pool size classes")
+{
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+
+    buffer small("FML32", nullptr, 1024);
+    buffer big("FML32", nullptr, 64 * 1024);
+    CHECK(small.size() >= 1024);
+    CHECK(big.size() >= 64 * 1024);
+    small.free();
+    big.free();
+    CHECK(pool.idle() == 2);
+
+    // a large request can't be served by a small buffer
+    buffer b("FML32", nullptr, 32 * 1024);
+    CHECK(pool.stats().hits == 1);
+    CHECK(b.size() >= 32 * 1024);
+    CHECK(pool.idle() == 1);
+}
+
+TEST_CASE("buffer_pool only pools types it can reinitialize")
+{
+    buffer_pool pool;
+    buffer_pool_scope scope(pool);
+
+    // an MBSTRING carries its encoding, which a leading null wouldn't reset
+    buffer m("MBSTRING", nullptr, 2000);
+    m.free();
+    CHECK(pool.idle() == 0);
+    CHECK(pool.stats().discards == 1);
+
+    buffer c("CARRAY", nullptr, 2000);
+    c.free();
+    CHECK(pool.idle() == 1);
+}
+
+TEST_CASE("buffer_pool limits idle buffers per class")
+{
+    buffer_pool pool(1);
+    buffer_pool_scope scope(pool);
+
+    buffer a("STRING", nullptr, 2000);
+    buffer b("STRING", nullptr, 2000);
+    a.free();
+    b.free();
+    CHECK(pool.idle() == 1);
+    CHECK(pool.stats().returns == 1);
+    CHECK(pool.stats().discards == 1);
+
+    pool.clear();
+    CHECK(pool.idle() == 0);
+    pool.reset_stats();
+    CHECK(pool.stats().returns == 0);
+}
+
+TEST_CASE("buffer_pool buffers outlive scope")
+{
+    buffer b;
+    {
+        buffer_pool pool;
+        buffer_pool_scope scope(pool);
+        b.alloc("FML32");
+    }
+    // not pooled anymore, so this is a plain tpfree
+    CHECK((bool)b);
+    b.free();
+    CHECK(!b);
+}
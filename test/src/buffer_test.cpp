@@ -1,6 +1,13 @@
 #include "doctest.h"
 #include "tux/buffer.hpp"
+#include "tux/fml32.hpp"
+#include "tux/cstring.hpp"
+#include "tux/carray.hpp"
+#include "tux/compression.hpp"
+#include "tux/view32.hpp"
 #include "tux/util.hpp"
+#include "fields32.hpp"
+#include "views32.h"
 
 using namespace std;
 using namespace tux;
@@ -159,6 +166,118 @@ TEST_CASE("buffer move operations")
     CHECK(a.type() == "");
 }
 
+TEST_CASE("buffer cached type metadata")
+{
+    buffer a;
+    CHECK(a.type_code() == buffer_type::none);
+    CHECK(string(a.type_c_str()) == "");
+    CHECK(string(a.subtype_c_str()) == "");
+
+    a.alloc("FML32");
+    CHECK(a.type_code() == buffer_type::fml32);
+    CHECK(string(a.type_c_str()) == "FML32");
+    
+    a.alloc("STRING", "MYSUBTYPE", 100);
+    CHECK(a.type_code() == buffer_type::string);
+    CHECK(string(a.subtype_c_str()) == "MYSUBTYPE");
+    CHECK(a.subtype() == "MYSUBTYPE");
+    
+    // subtypes are interned
+    buffer b("STRING", "MYSUBTYPE", 100);
+    CHECK(a.subtype_c_str() == b.subtype_c_str());
+    
+    // capacity tracks realloc
+    long original_size = a.size();
+    a.realloc(original_size * 4);
+    CHECK(a.size() >= original_size * 4);
+    CHECK(a.size() == tptypes(a.data(), nullptr, nullptr));
+    CHECK(a.type_code() == buffer_type::string);
+    
+    // metadata moves with the buffer
+    b = move(a);
+    CHECK(b.type_code() == buffer_type::string);
+    CHECK(b.size() >= original_size * 4);
+    CHECK(a.type_code() == buffer_type::none);
+    CHECK(a.size() == 0);
+    
+    // and is refreshed on acquire
+    char* raw = tpalloc(const_cast<char*>("CARRAY"), nullptr, 64);
+    b.acquire(raw, 10);
+    CHECK(b.type_code() == buffer_type::carray);
+    CHECK(b.size() >= 64);
+    CHECK(b.data_size() == 10);
+    tpfree(b.release());
+    CHECK(b.type_code() == buffer_type::none);
+}
+
+TEST_CASE("buffer payload size")
+{
+    SUBCASE("null")
+    {
+        buffer b;
+        CHECK(b.payload_size() == 0);
+    }
+    
+    SUBCASE("FML32")
+    {
+        fml32 f;
+        f.reserve(64 * 1024);
+        f.set(field32::A_STRING_FIELD, "hello");
+        CHECK(f.buffer().payload_size() == f.used_size());
+        CHECK(f.buffer().payload_size() < f.buffer().size());
+    }
+    
+    SUBCASE("STRING")
+    {
+        cstring s("hello");
+        s.reserve(4096);
+        CHECK(s.buffer().payload_size() == 6);
+        CHECK(s.buffer().size() >= 4096);
+    }
+    
+    SUBCASE("CARRAY")
+    {
+        carray c("abc");
+        c.reserve(1024);
+        CHECK(c.buffer().payload_size() == c.size());
+        CHECK(c.buffer().payload_size() == 3);
+        
+        buffer empty("CARRAY", nullptr, 256);
+        CHECK(empty.payload_size() == 0);
+    }
+    
+    SUBCASE("VIEW32")
+    {
+        view32<my_struct> v;
+        CHECK(v.buffer().payload_size() == (long)sizeof(my_struct));
+    }
+    
+    SUBCASE("other")
+    {
+        buffer x("XML", nullptr, 1024);
+        CHECK(x.payload_size() == x.size());
+        x.data_size(10);
+        CHECK(x.payload_size() == 10);
+    }
+}
+
+TEST_CASE("buffer shrink_to_fit")
+{
+    fml32 f;
+    f.reserve(64 * 1024);
+    f.set(field32::A_LONG_FIELD, 1L);
+    f.buffer().shrink_to_fit();
+    CHECK(f.buffer().size() < 64 * 1024);
+    CHECK(f.buffer().size() >= f.used_size());
+    CHECK(f.get_long(field32::A_LONG_FIELD) == 1L);
+    
+    cstring s("hello");
+    s.reserve(4096);
+    s.buffer().shrink_to_fit();
+    CHECK(s.buffer().size() < 4096);
+    CHECK(s == "hello");
+}
+
 TEST_CASE("buffer binary export/import")
 {
     buffer a("STRING", nullptr, 32);
@@ -216,6 +335,45 @@ TEST_CASE("buffer base64 export/import")
     CHECK(string(c.data()) == "foo");
 }
 
+TEST_CASE("buffer compressed export/import")
+{
+    fml32 a;
+    for(int i = 0; i < 200; ++i)
+    {
+        a.add(field32::A_STRING_FIELD, "a fairly repetitive string value");
+        a.add(field32::A_LONG_FIELD, i);
+    }
+    
+    string plain = export_buffer(a.buffer(), export_mode::binary);
+    string compressed = export_buffer(a.buffer(), export_mode::compressed);
+    CHECK(is_compressed(compressed));
+    CHECK(compressed.size() < plain.size() / 2);
+    CHECK(decompress(compressed) == plain);
+    
+    // detected transparently, whichever binary mode is given
+    fml32 b(import_buffer(compressed, export_mode::compressed));
+    CHECK(b == a);
+    fml32 c(import_buffer(compressed, export_mode::binary));
+    CHECK(c == a);
+    fml32 d(import_buffer(plain, export_mode::compressed));
+    CHECK(d == a);
+    
+    // base64
+    string encoded = export_buffer(a.buffer(), export_mode::compressed_base64);
+    CHECK(encoded.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=") == string::npos);
+    CHECK(encoded.size() < export_buffer(a.buffer(), export_mode::base64).size() / 2);
+    fml32 e(import_buffer(encoded, export_mode::compressed_base64));
+    CHECK(e == a);
+    fml32 f(import_buffer(encoded, export_mode::base64));
+    CHECK(f == a);
+    fml32 g(import_buffer(export_buffer(a.buffer(), export_mode::base64), export_mode::compressed_base64));
+    CHECK(g == a);
+    
+    // corrupt
+    compressed.resize(compressed.size() - 1);
+    CHECK_THROWS(import_buffer(compressed, export_mode::compressed));
+}
+
 TEST_CASE("buffer export/import null buffer")
 {
     buffer a;
@@ -0,0 +1,94 @@
+#include <string>
+#include "doctest.h"
+#include "tux/compression.hpp"
+#include "tux/carray.hpp"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("compression");
+
+namespace
+{
+    // deterministic, so failures reproduce
+    string sample(size_t n, int kind)
+    {
+        string x(n, '\0');
+        unsigned long seed = 42;
+        for(size_t i = 0; i < n; ++i)
+        {
+            seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+            char r = static_cast<char>(seed >> 56);
+            switch(kind)
+            {
+                case 0: x[i] = r; break; // incompressible
+                case 1: x[i] = "abcab"[static_cast<unsigned char>(r) % 5]; break; // small alphabet
+                case 2: x[i] = static_cast<char>('a' + i % 37); break; // periodic
+                default: x[i] = (seed >> 40) % 10 ? 'x' : r; // long runs
+            }
+        }
+        return x;
+    }
+}
+
+TEST_CASE("compress/decompress round trip")
+{
+    for(size_t n : {0, 1, 5, 12, 13, 16, 100, 4096, 70000, 300000})
+    {
+        for(int kind = 0; kind < 4; ++kind)
+        {
+            string x = sample(n, kind);
+            string c = compress(x);
+            CHECK(is_compressed(c));
+            CHECK(decompress(c) == x);
+            CHECK(c.size() <= x.size() + x.size() / 255 + 28);
+        }
+    }
+    
+    string runs(100000, 'z');
+    CHECK(compress(runs).size() < 1000);
+    CHECK(decompress(compress(runs)) == runs);
+}
+
+TEST_CASE("decompress rejects malformed input")
+{
+    CHECK(!is_compressed(""));
+    CHECK(!is_compressed("TXZ1"));
+    CHECK_THROWS(decompress("not compressed at all"));
+    
+    string c = compress(sample(5000, 1));
+    CHECK_THROWS(decompress(c.substr(0, c.size() - 1))); // truncated
+    string bigger = c;
+    bigger[4] = static_cast<char>(bigger[4] + 1); // size in the header is wrong
+    CHECK_THROWS(decompress(bigger));
+    
+    // corruption may or may not be detected, but must never overrun
+    for(size_t i = 12; i < c.size(); i += 7)
+    {
+        string corrupt = c;
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x5a);
+        try
+        {
+            decompress(corrupt);
+        }
+        catch(std::runtime_error const&)
+        {
+        }
+    }
+}
+
+TEST_CASE("compress/decompress carray in place")
+{
+    string payload = sample(10000, 3);
+    carray x(payload);
+    compress(x);
+    CHECK(x.size() < static_cast<long>(payload.size()));
+    CHECK(is_compressed(string_ref(x.data(), x.size())));
+    decompress(x);
+    CHECK(x == payload);
+    
+    carray plain("plain");
+    CHECK_THROWS(decompress(plain));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "doctest.h"
+#include "tux/expression_cache.hpp"
+#include "tux/fml32.hpp"
+#include "tux/view32.hpp"
+#include "fields32.h"
+#include "views32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("expression_cache");
+
+namespace
+{
+    // stands in for Fboolco32 etc.
+    char* fake_compile(string const& x, int& calls)
+    {
+        ++calls;
+        char* result = static_cast<char*>(malloc(x.size() + 1));
+        strcpy(result, x.c_str());
+        return result;
+    }
+}
+
+TEST_CASE("expression_cache hits, misses, and evictions")
+{
+    expression_cache cache(2);
+    int calls = 0;
+    auto compile = [&](string const& x) { return [&calls, x]() { return fake_compile(x, calls); }; };
+    
+    auto a = cache.get("FML32", "A == 1", compile("A == 1"));
+    REQUIRE(static_cast<bool>(a));
+    CHECK(string(a.get()) == "A == 1");
+    CHECK((cache.get("FML32", "A == 1", compile("A == 1")) == a));
+    CHECK(calls == 1);
+    
+    // same text, different domain
+    CHECK((cache.get("FML16", "A == 1", compile("A == 1")) != a));
+    CHECK(calls == 2);
+    CHECK(cache.size() == 2);
+    
+    // FML32 "A == 1" is least recently used
+    cache.get("FML32", "B == 2", compile("B == 2"));
+    CHECK(cache.size() == 2);
+    auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 3);
+    CHECK(stats.evictions == 1);
+    
+    // evicted, but still alive for its user
+    CHECK(string(a.get()) == "A == 1");
+    CHECK((cache.get("FML32", "A == 1", compile("A == 1")) != a));
+    CHECK(calls == 4);
+    
+    // failed compiles aren't cached
+    CHECK(!cache.get("FML32", "bad", []() -> char* { return nullptr; }));
+    CHECK(cache.size() == 2);
+    
+    cache.set_capacity(0);
+    CHECK(cache.size() == 0);
+    cache.get("FML32", "A == 1", compile("A == 1"));
+    CHECK(cache.size() == 0);
+    
+    cache.reset_stats();
+    CHECK(cache.stats().misses == 0);
+}
+
+TEST_CASE("expression_cache shared by expressions")
+{
+    auto& cache = expression_cache::global();
+    cache.reset_stats();
+    
+    fml32 f;
+    f.add(A_LONG_FIELD, 17);
+    
+    fml32::boolean_expression e1("A_LONG_FIELD < 18");
+    fml32::boolean_expression e2("A_LONG_FIELD < 18");
+    CHECK(cache.stats().hits >= 1);
+    CHECK(e1(f));
+    CHECK(e2(f));
+    
+    // copies share the tree, which outlives the cache entry
+    fml32::boolean_expression e3(e1);
+    cache.clear();
+    e1 = fml32::boolean_expression();
+    CHECK(e3(f));
+    
+    fml32::arithmetic_expression a1("A_LONG_FIELD + 1");
+    fml32::arithmetic_expression a2 = a1;
+    CHECK(a2(f) == doctest::Approx(18));
+    
+    view32<my_struct>::arithmetic_expression v1("d / 4");
+    view32<my_struct>::arithmetic_expression v2(v1);
+    my_struct s = make_default<my_struct>();
+    s.d = 100.0;
+    CHECK(v2(s) == doctest::Approx(25.0));
+    
+    CHECK_THROWS(fml32::boolean_expression("A_LONG_FIELD <"));
+}
+
+TEST_CASE("expression_cache view expressions recompile after refresh")
+{
+    auto& cache = expression_cache::global();
+    view32<my_struct>::boolean_expression e1("l > 3");
+    cache.reset_stats();
+    view32<my_struct>::boolean_expression e2("l > 3");
+    CHECK(cache.stats().hits == 1);
+    
+    // the tree compiled against the old definitions isn't handed out again
+    refresh_view32_definitions();
+    view32<my_struct>::boolean_expression e3("l > 3");
+    CHECK(cache.stats().misses == 1);
+    view32<my_struct>::boolean_expression e4("l > 3");
+    CHECK(cache.stats().hits == 2);
+    
+    my_struct s = make_default<my_struct>();
+    s.l = 4;
+    CHECK(e1(s));
+    CHECK(e4(s));
+}
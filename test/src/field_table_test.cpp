@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "doctest.h"
+#include "tux/field_table.hpp"
+#include "tux/fml32.hpp"
+#include "fields32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("field_table");
+
+TEST_CASE("field_table matches Fldid32/Fname32")
+{
+    field_table t(field_table::configured_files());
+    REQUIRE(t.size() > 0);
+    CHECK(t.id("A_LONG_FIELD") == A_LONG_FIELD);
+    CHECK(string(t.name(A_CARRAY_FIELD)) == "A_CARRAY_FIELD");
+
+    // every configured field (tpadm has plenty) round trips like Tuxedo's tables
+    size_t mismatches = 0;
+    for(auto const& e : t.entries())
+    {
+        if(t.id(e.name) != Fldid32(const_cast<char*>(e.name.c_str())) ||
+           t.name(e.id) == nullptr || string(t.name(e.id)) != Fname32(e.id))
+        {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    CHECK(t.id("NO_SUCH_FIELD") == BADFLDID);
+    CHECK(t.id("") == BADFLDID);
+    CHECK(t.id("A_LONG_FIEL") == BADFLDID);
+    CHECK(t.name(fml32::field_id(FLD_LONG, 999999)) == nullptr);
+    CHECK(t.load_time().count() >= 0);
+}
+
+TEST_CASE("field_table file format")
+{
+    const char* fname = "tmp_field_table_test";
+    ofstream os(fname);
+    os << "# a comment\n"
+          "$ /* passed through by mkfldhdr32 */\n"
+          "*base 100\n"
+          "\n"
+          "FIRST      1  long    a comment\n"
+          "SECOND     2  string\n"
+          "*base 200\n"
+          "THIRD      1  fml32\n"
+          "FIRST      5  short   redefined\n"
+          "ALIAS      2  string\n";
+    os.close();
+
+    field_table t(vector<string>{fname});
+    CHECK(t.size() == 5);
+    CHECK(t.id("FIRST") == fml32::field_id(FLD_LONG, 101)); // first definition
+    CHECK(t.id("SECOND") == fml32::field_id(FLD_STRING, 102));
+    CHECK(t.id("THIRD") == fml32::field_id(FLD_FML32, 201));
+    CHECK(t.id("ALIAS") == fml32::field_id(FLD_STRING, 202));
+    CHECK(string(t.name(fml32::field_id(FLD_SHORT, 205))) == "FIRST");
+    CHECK(string(t.name(fml32::field_id(FLD_STRING, 102))) == "SECOND");
+
+    os.open(fname);
+    os << "BROKEN 1 notatype\n";
+    os.close();
+    CHECK_THROWS(field_table(vector<string>{fname}));
+    remove(fname);
+    CHECK_THROWS(field_table(vector<string>{fname}));
+
+    field_table empty(vector<string>{});
+    CHECK(empty.size() == 0);
+    CHECK(empty.id("FIRST") == BADFLDID);
+    CHECK(empty.name(A_LONG_FIELD) == nullptr);
+}
+
+TEST_CASE("field_table current")
+{
+    CHECK(field_table::preload());
+    field_table const* t = field_table::current();
+    REQUIRE(t != nullptr);
+    CHECK(field_table::preload());
+    CHECK(field_table::current() == t); // preload doesn't reload
+
+    // fml32 lookups go through the table now
+    CHECK(fml32::field_id("A_STRING_FIELD") == A_STRING_FIELD);
+    CHECK(fml32::field_name(A_STRING_FIELD) == "A_STRING_FIELD");
+    CHECK_THROWS(fml32::field_id("NO_SUCH_FIELD"));
+
+    field_table::load();
+    CHECK(field_table::current() != t);
+    CHECK(t->id("A_STRING_FIELD") == A_STRING_FIELD); // still valid
+}
@@ -1531,6 +1531,61 @@ TEST_CASE("fml16 next_field")
     CHECK(fields[8].oc == 0);
 }
 
+TEST_CASE("fml16 iterators")
+{
+    fml f;
+    CHECK(f.begin() == f.end());
+    
+    f.add(A_SHORT_FIELD, 2);
+    f.add(A_SHORT_FIELD, 5);
+    f.add(A_LONG_FIELD, 100);
+    f.add(A_CHAR_FIELD, 'b');
+    f.add(A_DOUBLE_FIELD, 4096.5);
+    f.add(A_STRING_FIELD, "hello");
+    f.add(A_CARRAY_FIELD, "hello dolly");
+    
+    vector<fml::field_info> expected;
+    fml::field_info field;
+    while(f.next_field(field))
+    {
+        expected.push_back(field);
+    }
+    
+    size_t i = 0;
+    for(auto const& x : f)
+    {
+        REQUIRE(i < expected.size());
+        CHECK(x.id() == expected[i].id);
+        CHECK(x.oc() == expected[i].oc);
+        CHECK(x.size() == f.field_value_size(x.id(), x.oc()));
+        ++i;
+    }
+    CHECK(i == expected.size());
+    
+    auto it = f.begin();
+    CHECK(it->as_short() == 2);
+    CHECK((it++)->as_short() == 2);
+    CHECK(it->oc() == 1);
+    CHECK(it->as_long() == 5); // converted
+    ++it;
+    CHECK(it->type() == FLD_LONG);
+    CHECK(it->as_long() == 100);
+    CHECK(it->as_string() == "100");
+    ++it;
+    CHECK(it->as_char() == 'b');
+    ++it;
+    CHECK(it->as_double() == doctest::Approx(4096.5));
+    CHECK_THROWS(it->as_string_ref());
+    ++it;
+    CHECK(it->name() == "A_STRING_FIELD");
+    CHECK(it->as_string_ref() == "hello");
+    CHECK(it->as_string_ref().data() == it->data());
+    ++it;
+    CHECK(it->as_string_ref() == "hello dolly");
+    CHECK(it->as_string() == "hello dolly");
+    CHECK(++it == f.end());
+}
+
 TEST_CASE("fml16 boolean_expression")
 {
     fml f;
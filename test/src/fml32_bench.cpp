@@ -0,0 +1,718 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "doctest.h"
+#include "bench.hpp"
+#include "tux/fml32.hpp"
+#include "tux/fml32_builder.hpp"
+#include "tux/fml32_extread.hpp"
+#include "tux/fml32_file.hpp"
+#include "tux/convert.hpp"
+#include "tux/expression_cache.hpp"
+#include "tux/field_table.hpp"
+#include "tux/json.hpp"
+#include "tux/predicate.hpp"
+#include "tux/view32.hpp"
+#include "tux/view_array.hpp"
+#include "fields32.h"
+#include "views32.hpp"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("fml32");
+
+TEST_CASE("bench fml32 get_string vs get_string_view")
+{
+    fml32 f;
+    f.add(A_STRING_FIELD, string(64, 'x')); // too long for the small string optimization
+    string copy(64, 'x');
+    
+    bench::measure("fml32 get_string (64 bytes)", 1000000, [&]
+    {
+        bench::keep(f.get_string(A_STRING_FIELD) == copy);
+    });
+    bench::measure("fml32 get_string_view (64 bytes)", 1000000, [&]
+    {
+        bench::keep(f.get_string_view(A_STRING_FIELD) == string_ref(copy));
+    });
+}
+
+TEST_CASE("bench fml32 add vs fml32_builder")
+{
+    const string value = "some string value";
+    for(long n : {10L, 100L, 10000L})
+    {
+        long iterations = 1000000 / n;
+        bench::measure("fml32::add x" + to_string(n), iterations, [&]
+        {
+            fml32 f;
+            for(long i = 0; i < n; ++i)
+            {
+                f.add(A_LONG_FIELD, i);
+                f.add(A_STRING_FIELD, value);
+            }
+            bench::keep(f);
+        });
+        fml32_builder b;
+        bench::measure("fml32_builder x" + to_string(n), iterations, [&]
+        {
+            for(long i = 0; i < n; ++i)
+            {
+                b.add(A_LONG_FIELD, i);
+                b.add(A_STRING_FIELD, value);
+            }
+            bench::keep(b.finish());
+        });
+    }
+}
+
+TEST_CASE("bench fml32 next_field vs iterator")
+{
+    fml32 f;
+    for(long i = 0; i < 100; ++i)
+    {
+        f.add(A_LONG_FIELD, i);
+        f.add(A_STRING_FIELD, "some string value");
+    }
+    
+    bench::measure("fml32 next_field + get_string x200", 10000, [&]
+    {
+        size_t total = 0;
+        fml32::field_info field;
+        while(f.next_field(field))
+        {
+            total += f.get_string(field.id, field.oc).size();
+        }
+        bench::keep(total);
+    });
+    bench::measure("fml32 iterator + as_string_ref x200", 10000, [&]
+    {
+        size_t total = 0;
+        for(auto const& x : f)
+        {
+            total += x.type() == FLD_STRING ? x.as_string_ref().size() : x.size();
+        }
+        bench::keep(total);
+    });
+    f.build_side_index();
+    bench::measure("fml32 iterator + as_string_ref, side index x200", 10000, [&]
+    {
+        size_t total = 0;
+        for(auto const& x : f)
+        {
+            total += x.type() == FLD_STRING ? x.as_string_ref().size() : x.size();
+        }
+        bench::keep(total);
+    });
+}
+
+TEST_CASE("bench fml32 get_long loop vs get_all")
+{
+    const long n = 10000;
+    vector<long> values(n);
+    for(long i = 0; i < n; ++i)
+    {
+        values[i] = i;
+    }
+    
+    bench::measure("fml32 add loop x10000", 20, [&]
+    {
+        fml32 f;
+        for(long x : values)
+        {
+            f.add(A_LONG_FIELD, x);
+        }
+        bench::keep(f);
+    });
+    bench::measure("fml32 set_all x10000", 20, [&]
+    {
+        fml32 f;
+        f.set_all(A_LONG_FIELD, values.begin(), values.end());
+        bench::keep(f);
+    });
+    
+    fml32 f;
+    f.set_all(A_LONG_FIELD, values.begin(), values.end());
+    vector<long> out(n);
+    bench::measure("fml32 get_long loop x10000", 20, [&]
+    {
+        for(long oc = 0; oc < n; ++oc)
+        {
+            out[oc] = f.get_long(A_LONG_FIELD, oc);
+        }
+        bench::keep(out);
+    });
+    bench::measure("fml32 get_all x10000", 20, [&]
+    {
+        f.get_all(A_LONG_FIELD, out);
+        bench::keep(out);
+    });
+    f.build_side_index();
+    bench::measure("fml32 get_all with a side index x10000", 20, [&]
+    {
+        f.get_all(A_LONG_FIELD, out);
+        bench::keep(out);
+    });
+}
+
+TEST_CASE("bench fml32 boolean_expression compile per request")
+{
+    fml32 f;
+    f.add(A_LONG_FIELD, 17);
+    f.add(A_STRING_FIELD, "hello");
+    const string filter = "A_LONG_FIELD < 18 && A_STRING_FIELD == 'hello'";
+    auto& cache = expression_cache::global();
+    size_t capacity = cache.capacity();
+    
+    cache.set_capacity(0);
+    bench::measure("boolean_expression uncached", 100000, [&]
+    {
+        bench::keep(fml32::boolean_expression(filter)(f));
+    });
+    cache.set_capacity(capacity);
+    bench::measure("boolean_expression cached", 100000, [&]
+    {
+        bench::keep(fml32::boolean_expression(filter)(f));
+    });
+}
+
+TEST_CASE("bench fml32 boolean_expression vs predicate")
+{
+    fml32 f;
+    f.add(A_LONG_FIELD, 42);
+    f.add(A_STRING_FIELD, "NY");
+    f.add(A_DOUBLE_FIELD, 1.5);
+    
+    fml32::boolean_expression compiled("A_LONG_FIELD >= 18 && A_STRING_FIELD == 'NY' && A_DOUBLE_FIELD < 2");
+    bench::measure("boolean_expression evaluate", 1000000, [&]
+    {
+        bench::keep(compiled(f));
+    });
+    
+    constexpr fml32::field<A_LONG_FIELD, long> age {};
+    constexpr fml32::field<A_STRING_FIELD, string> state {};
+    constexpr fml32::field<A_DOUBLE_FIELD, double> score {};
+    auto native = where(age >= 18 && state == "NY" && score < 2);
+    bench::measure("predicate evaluate", 1000000, [&]
+    {
+        bench::keep(native(f));
+    });
+}
+
+TEST_CASE("bench fml32 evaluate_batch scaling")
+{
+    vector<fml32> batch(100000);
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        batch[i].add(A_LONG_FIELD, static_cast<long>(i));
+        batch[i].add(A_STRING_FIELD, i % 3 ? "NY" : "NJ");
+    }
+    fml32::boolean_expression e("A_LONG_FIELD >= 18 && A_STRING_FIELD == 'NY'");
+    vector<uint64_t> bitmap;
+    unsigned cores = max(thread::hardware_concurrency(), 1u);
+    for(unsigned threads = 1; ; threads = min(2 * threads, cores))
+    {
+        bench::measure("evaluate_batch 100k, " + to_string(threads) + " threads", 10, [&]
+        {
+            e.evaluate_batch(batch, bitmap, threads);
+            bench::keep(bitmap);
+        });
+        if(threads == cores)
+        {
+            break;
+        }
+    }
+}
+
+TEST_CASE("bench fml32 diff/apply_patch")
+{
+    // 500 occurrences, 5 of which change between sends
+    fml32 base;
+    for(long i = 0; i < 100; ++i)
+    {
+        base.add(A_SHORT_FIELD, static_cast<short>(i));
+        base.add(A_LONG_FIELD, i * 1000);
+        base.add(A_DOUBLE_FIELD, i * 0.5);
+        base.add(A_STRING_FIELD, "customer name " + to_string(i));
+        base.add(A_CARRAY_FIELD, "opaque payload " + to_string(i));
+    }
+    fml32 next(base);
+    next.set(A_LONG_FIELD, 1L, 10);
+    next.set(A_LONG_FIELD, 2L, 20);
+    next.set(A_STRING_FIELD, string("renamed"), 30);
+    next.set(A_DOUBLE_FIELD, 99.5, 40);
+    next.erase(A_CARRAY_FIELD, 99);
+    
+    fml32 patch = fml32::diff(base, next);
+    printf("%-48s %12ld bytes (full buffer %ld bytes)\n", "diff patch size, 5 of 500 changed", patch.used_size(), next.used_size());
+    
+    bench::measure("diff 500 occurrences", 10000, [&]
+    {
+        bench::keep(fml32::diff(base, next));
+    });
+    fml32 received;
+    bench::measure("copy + apply_patch 500 occurrences", 10000, [&]
+    {
+        received = base;
+        received.apply_patch(patch);
+        bench::keep(received);
+    });
+    bench::measure("copy full buffer 500 occurrences", 10000, [&]
+    {
+        received = next;
+        bench::keep(received);
+    });
+}
+
+TEST_CASE("bench fml32 random access with and without side index")
+{
+    for(long n : {1000L, 10000L, 100000L})
+    {
+        fml32 f;
+        f.reserve(static_cast<FLDOCC32>(2 * n), static_cast<FLDLEN32>(n * (sizeof(long) + 16)));
+        for(long i = 0; i < n; ++i)
+        {
+            f.add(A_LONG_FIELD, i);
+            f.add(A_STRING_FIELD, "value " + to_string(i));
+        }
+        unsigned long seed = 1;
+        auto next_oc = [&seed, n]
+        {
+            seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+            return static_cast<FLDOCC32>((seed >> 33) % n);
+        };
+        
+        bench::measure("get_long random oc, " + to_string(n) + " occurrences", 100000, [&]
+        {
+            bench::keep(f.get_long(A_LONG_FIELD, next_oc()));
+        });
+        f.build_side_index();
+        bench::measure("get_long random oc, side index, " + to_string(n), 100000, [&]
+        {
+            bench::keep(f.get_long(A_LONG_FIELD, next_oc()));
+        });
+        bench::measure("get_string_view random oc, side index, " + to_string(n), 100000, [&]
+        {
+            bench::keep(f.get_string_view(A_STRING_FIELD, next_oc()).size());
+        });
+        bench::measure("build_side_index, " + to_string(2 * n) + " fields", 10, [&]
+        {
+            f.build_side_index();
+        });
+    }
+}
+
+TEST_CASE("bench fml32 field name lookups, Tuxedo vs field_table")
+{
+    double ns = bench::measure("field_table load (all configured tables)", 5, [&]
+    {
+        field_table t(field_table::configured_files());
+        bench::keep(t.size());
+    });
+    field_table t(field_table::configured_files());
+    std::printf("%-48s %12lu fields, %.1f us per load\n", "field_table", 
+                static_cast<unsigned long>(t.size()), ns / 1000);
+
+    const int n = 100000;
+    bench::measure("Fldid32", n, [&]
+    {
+        bench::keep(Fldid32(const_cast<char*>("A_STRING_FIELD")));
+    });
+    bench::measure("field_table::id", n, [&]
+    {
+        bench::keep(t.id("A_STRING_FIELD"));
+    });
+    bench::measure("Fname32", n, [&]
+    {
+        bench::keep(Fname32(A_STRING_FIELD));
+    });
+    bench::measure("field_table::name", n, [&]
+    {
+        bench::keep(t.name(A_STRING_FIELD));
+    });
+}
+
+TEST_CASE("bench fml32 json vs xml")
+{
+    fml32 f;
+    for(int i = 0; i < 100; ++i)
+    {
+        f.add(A_LONG_FIELD, i * 1000);
+        f.add(A_DOUBLE_FIELD, i * 0.25);
+        f.add(A_STRING_FIELD, "a typical string value, #" + to_string(i));
+    }
+    string json = to_json(f);
+    xml x = to_xml(f);
+    auto report = [](const char* name, double ns, size_t bytes)
+    {
+        std::printf("%-48s %12.1f MB/s\n", name, bytes / ns * 1000);
+    };
+
+    report("to_json", bench::measure("to_json, 300 fields", 2000, [&]
+    {
+        string out;
+        to_json(f, out);
+        bench::keep(out.size());
+    }), json.size());
+    report("to_xml", bench::measure("to_xml, 300 fields", 2000, [&]
+    {
+        bench::keep(to_xml(f).size());
+    }), x.size());
+    report("to_fml32(json)", bench::measure("to_fml32(json), 300 fields", 2000, [&]
+    {
+        bench::keep(to_fml32(json).used_size());
+    }), json.size());
+    report("to_fml32(xml)", bench::measure("to_fml32(xml), 300 fields", 2000, [&]
+    {
+        bench::keep(to_fml32(x).first.used_size());
+    }), x.size());
+}
+
+TEST_CASE("bench fml32 get_fml vs get_fml_view")
+{
+    // three levels of nesting, each with some bulk alongside the child
+    fml32 f;
+    f.add(A_LONG_FIELD, 42);
+    for(int level = 0; level < 3; ++level)
+    {
+        fml32 parent;
+        for(int i = 0; i < 50; ++i)
+        {
+            parent.add(A_STRING_FIELD, string(64, 'x'));
+        }
+        parent.add(AN_FML32_FIELD, f);
+        f = move(parent);
+    }
+    bench::measure("get_fml x3 + get_long", 100000, [&]
+    {
+        bench::keep(f.get_fml(AN_FML32_FIELD).get_fml(AN_FML32_FIELD).get_fml(AN_FML32_FIELD).get_long(A_LONG_FIELD));
+    });
+    bench::measure("get_fml_view x3 + get_long", 100000, [&]
+    {
+        bench::keep(f.get_fml_view(AN_FML32_FIELD).get_fml_view(AN_FML32_FIELD).get_fml_view(AN_FML32_FIELD).get_long(A_LONG_FIELD));
+    });
+}
+
+TEST_CASE("bench fml32 Fread32 vs fml32_file_reader")
+{
+    const int n = 10000;
+    fml32 f;
+    f.add(A_LONG_FIELD, 1);
+    for(int i = 0; i < 10; ++i)
+    {
+        f.add(A_STRING_FIELD, string(100, 'x'));
+    }
+    const char* fname = "tmp_fml32_file_bench";
+    {
+        FILE* out = fopen(fname, "wb");
+        for(int i = 0; i < n; ++i)
+        {
+            f.write(out);
+        }
+        fclose(out);
+    }
+    bench::measure("fml32::read (Fread32) x10000", 5, [&]
+    {
+        FILE* in = fopen(fname, "rb");
+        long total = 0;
+        fml32 g;
+        for(int i = 0; i < n; ++i)
+        {
+            g.read(in, f.used_size());
+            total += g.get_long(A_LONG_FIELD);
+        }
+        fclose(in);
+        bench::keep(total);
+    });
+    {
+        fml32_file_writer w(fname);
+        for(int i = 0; i < n; ++i)
+        {
+            w.append(f);
+        }
+    }
+    bench::measure("fml32_file_reader x10000", 5, [&]
+    {
+        fml32_file_reader r(fname);
+        long total = 0;
+        for(auto v : r)
+        {
+            total += v.get_long(A_LONG_FIELD);
+        }
+        bench::keep(total);
+    });
+    remove(fname);
+}
+
+TEST_CASE("bench fml32 Fextread32 vs extread_all")
+{
+    const int n = 20000;
+    string text;
+    for(int i = 0; i < n; ++i)
+    {
+        text += "A_LONG_FIELD\t" + to_string(i) + "\nA_DOUBLE_FIELD\t13.7\n";
+        for(int j = 0; j < 5; ++j)
+        {
+            text += "A_STRING_FIELD\t" + string(40, 'a' + j) + "\n";
+        }
+        text += "\n";
+    }
+    const char* fname = "tmp_fml32_extread_bench";
+    {
+        FILE* out = fopen(fname, "w");
+        fwrite(text.data(), 1, text.size(), out);
+        fclose(out);
+    }
+    bench::measure("fml32::extread (Fextread32) x20000", 3, [&]
+    {
+        FILE* in = fopen(fname, "r");
+        long total = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            fml32 f;
+            f.extread(in);
+            total += f.get_long(A_LONG_FIELD);
+        }
+        fclose(in);
+        bench::keep(total);
+    });
+    remove(fname);
+    for(unsigned threads : {1u, 4u})
+    {
+        bench::measure("extread_all x20000, " + to_string(threads) + " threads", 3, [&]
+        {
+            auto buffers = extread_all(string_ref(text), threads);
+            bench::keep(buffers.back().get_long(A_LONG_FIELD));
+        });
+    }
+}
+
+TEST_CASE("bench fml32 Fvstof32/Fvftos32 vs generated view_traits")
+{
+    mixed_struct x;
+    memset(&x, 0, sizeof(x));
+    x.s = 7;
+    x.i = 123456;
+    x.C_l = 3;
+    x.l[0] = 1; x.l[1] = 2; x.l[2] = 3;
+    x.c = 'q';
+    x.d[0] = 1.5; x.d[1] = -2.25;
+    x.C_str = 2;
+    strcpy(x.str[0], "first");
+    strcpy(x.str[1], "second");
+    memcpy(x.bytes, "abcde", 5);
+    x.L_bytes = 5;
+    x.converted = 42;
+    char* view_name = const_cast<char*>("mixed_struct");
+    const long n = 100000;
+
+    fml32 f(20, 512);
+    bench::measure("Fvstof32", n, [&]
+    {
+        f.clear();
+        Fvstof32(f.as_fbfr(), reinterpret_cast<char*>(&x), FUPDATE, view_name);
+        bench::keep(f.field_count());
+    });
+    bench::measure("view_traits<mixed_struct, fml32>::to_fml", n, [&]
+    {
+        f.clear();
+        view_traits<mixed_struct, fml32>::to_fml(x, f);
+        bench::keep(f.field_count());
+    });
+
+    mixed_struct y;
+    bench::measure("Fvftos32", n, [&]
+    {
+        Fvftos32(f.as_fbfr(), reinterpret_cast<char*>(&y), view_name);
+        bench::keep(y.l[2]);
+    });
+    bench::measure("view_traits<mixed_struct, fml32>::to_struct", n, [&]
+    {
+        view_traits<mixed_struct, fml32>::to_struct(f, y);
+        bench::keep(y.l[2]);
+    });
+}
+
+namespace
+{
+    // the buffer convert() used to size for Fvstof32: the default size, then sizeof(T) * 4 on FNOSPACE
+    template <typename T>
+    fml32 previous_to_fml32(T const& x, const char* view_name)
+    {
+        fml32 f;
+        f.reserve(0);
+        char* p = reinterpret_cast<char*>(const_cast<T*>(&x));
+        if(Fvstof32(f.as_fbfr(), p, FUPDATE, const_cast<char*>(view_name)) == -1 && Ferror32 == FNOSPACE)
+        {
+            f.reserve(sizeof(T) * 4);
+            Fvstof32(f.as_fbfr(), p, FUPDATE, const_cast<char*>(view_name));
+        }
+        return f;
+    }
+
+    template <typename T>
+    void print_buffer_sizes(T const& x, const char* view_name)
+    {
+        fml32 previous = previous_to_fml32(x, view_name);
+        fml32 exact = to_fml32(x);
+        std::printf("%-48s %12ld bytes per struct (was %ld, saved %ld; %ld used)\n", view_name, exact.size(),
+                    previous.size(), previous.size() - exact.size(), exact.used_size());
+    }
+}
+
+TEST_CASE("bench fml32 struct->fml32 buffer sizing")
+{
+    mixed_struct m;
+    memset(&m, 0, sizeof(m));
+    m.s = 7;
+    m.C_str = 2;
+    strcpy(m.str[0], "first");
+    strcpy(m.str[1], "second");
+    m.converted = 42;
+    print_buffer_sizes(m, "mixed_struct");
+
+    long_strings x;
+    memset(&x, 0, sizeof(x));
+    x.C_text = 8;
+    for(auto& text : x.text)
+    {
+        strcpy(text, "a typical 32 character long name");
+    }
+    x.total = 8;
+    print_buffer_sizes(x, "long_strings, 32 character strings");
+
+    const long n = 100000;
+    bench::measure("previous sizing, Fvstof32(long_strings)", n, [&]
+    {
+        bench::keep(previous_to_fml32(x, "long_strings").field_count());
+    });
+    bench::measure("exact sizing, to_fml32(long_strings)", n, [&]
+    {
+        bench::keep(to_fml32(x).field_count());
+    });
+}
+
+TEST_CASE("bench fml32 add_view rows vs view_array")
+{
+    const long rows = 1000;
+    const long n = 100;
+    auto x = make_default<my_struct>();
+    x.d = 2.5;
+
+    bench::measure("fml32 add_view, 1000 rows", n, [&]
+    {
+        fml32 f;
+        for(long i = 0; i < rows; ++i)
+        {
+            x.l = i;
+            f.add_view(A_VIEW32_FIELD, x);
+        }
+        bench::keep(f.used_size());
+    });
+    bench::measure("view_array push_back, 1000 rows", n, [&]
+    {
+        view_array<my_struct> v;
+        v.reserve(rows);
+        for(long i = 0; i < rows; ++i)
+        {
+            x.l = i;
+            v.push_back(x);
+        }
+        bench::keep(v.buffer().data_size());
+    });
+
+    fml32 f;
+    view_array<my_struct> v;
+    for(long i = 0; i < rows; ++i)
+    {
+        x.l = i;
+        f.add_view(A_VIEW32_FIELD, x);
+        v.push_back(x);
+    }
+    std::printf("%-48s %12ld bytes (fml32 %ld bytes)\n", "view_array payload, 1000 rows", v.buffer().data_size(), f.used_size());
+    bench::measure("fml32 get_view, 1000 rows", n, [&]
+    {
+        long sum = 0;
+        for(FLDOCC32 i = 0; i < rows; ++i)
+        {
+            sum += f.get_view<my_struct>(A_VIEW32_FIELD, i).l;
+        }
+        bench::keep(sum);
+    });
+    bench::measure("get_views, 1000 rows", n, [&]
+    {
+        long sum = 0;
+        for(auto const& row : get_views<my_struct>(f, A_VIEW32_FIELD))
+        {
+            sum += row.l;
+        }
+        bench::keep(sum);
+    });
+    bench::measure("view_array copy, 1000 rows", n, [&]
+    {
+        view_array<my_struct> copy(v);
+        bench::keep(copy[rows - 1].l);
+    });
+}
+
+TEST_CASE("bench fml32 Fvnull32 vs view32::member_handle")
+{
+    const size_t rows = 100000;
+    mixed_struct x;
+    memset(&x, 0, sizeof(x));
+    x.s = -1;
+    x.c = 'x';
+    x.C_str = 2;
+    strcpy(x.str[0], "none");
+    strcpy(x.str[1], "none");
+    vector<mixed_struct> data(rows, x);
+    for(size_t i = 0; i < rows; i += 3)
+    {
+        data[i].d[0] = 1.5;
+        strcpy(data[i].str[0], "set");
+    }
+    char* view_name = const_cast<char*>("mixed_struct");
+
+    for(const char* member : {"d", "str"})
+    {
+        view32<mixed_struct>::member_handle handle(member);
+        string name = member;
+        bench::measure("Fvnull32 " + name + ", 100000 rows", 10, [&]
+        {
+            size_t nulls = 0;
+            for(auto& row : data)
+            {
+                nulls += static_cast<size_t>(Fvnull32(reinterpret_cast<char*>(&row), const_cast<char*>(member), 0, view_name));
+            }
+            bench::keep(nulls);
+        });
+        bench::measure("member_handle::count_nulls " + name + ", 100000 rows", 10, [&]
+        {
+            bench::keep(handle.count_nulls(data.data(), data.size()));
+        });
+        vector<uint64_t> bits((rows + 63) / 64);
+        bench::measure("member_handle::null_bitmap " + name + ", 100000 rows", 10, [&]
+        {
+            bench::keep(handle.null_bitmap(data.data(), data.size(), bits.data()));
+        });
+    }
+
+    view32<mixed_struct>::member_handle d("d");
+    auto copy = data;
+    bench::measure("Fvselinit32 d, 100000 rows", 10, [&]
+    {
+        for(auto& row : copy)
+        {
+            Fvselinit32(reinterpret_cast<char*>(&row), const_cast<char*>("d"), view_name);
+        }
+        bench::keep(copy[0].d[0]);
+    });
+    bench::measure("member_handle::clear d, 100000 rows", 10, [&]
+    {
+        d.clear(copy.data(), copy.size());
+        bench::keep(copy[0].d[0]);
+    });
+}
@@ -0,0 +1,82 @@
+#include <string>
+#include "doctest.h"
+#include "tux/fml32_builder.hpp"
+#include "fields32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("fml32_builder");
+
+TEST_CASE("fml32_builder finish")
+{
+    fml32 nested;
+    nested.add(A_LONG_FIELD, 7);
+    
+    fml32_builder b(8, 64);
+    b.add(A_STRING_FIELD, "hello")
+     .add(A_LONG_FIELD, 2)
+     .add(A_STRING_FIELD, string("world"))
+     .add(A_SHORT_FIELD, short(1))
+     .add(A_CHAR_FIELD, 'c')
+     .add(A_FLOAT_FIELD, 3.5f)
+     .add(A_DOUBLE_FIELD, 4.5)
+     .add(A_CARRAY_FIELD, string_ref("car\0ray", 7))
+     .add(AN_FML32_FIELD, nested);
+    CHECK(b.field_count() == 9);
+    CHECK(b.bytes_needed() >= fml32::bytes_needed(9, 0));
+    
+    fml32 expected;
+    expected.add(A_STRING_FIELD, "hello");
+    expected.add(A_LONG_FIELD, 2);
+    expected.add(A_STRING_FIELD, string("world"));
+    expected.add(A_SHORT_FIELD, short(1));
+    expected.add(A_CHAR_FIELD, 'c');
+    expected.add(A_FLOAT_FIELD, 3.5f);
+    expected.add(A_DOUBLE_FIELD, 4.5);
+    expected.add(A_CARRAY_FIELD, string("car\0ray", 7));
+    expected.add(AN_FML32_FIELD, nested);
+    
+    long bytes_needed = b.bytes_needed();
+    fml32 f = b.finish();
+    CHECK(f.size() >= bytes_needed);
+    CHECK(f == expected);
+    CHECK(f.get_string(A_STRING_FIELD, 0) == "hello");
+    CHECK(f.get_string(A_STRING_FIELD, 1) == "world");
+    CHECK(f.get_string(A_CARRAY_FIELD) == string("car\0ray", 7));
+    CHECK(f.get_fml(AN_FML32_FIELD).get_long(A_LONG_FIELD) == 7);
+    
+    // finish() resets the builder
+    CHECK(b.field_count() == 0);
+    CHECK(b.finish().field_count() == 0);
+}
+
+TEST_CASE("fml32_builder empty carrays")
+{
+    // nothing else stored, so the arena is empty
+    fml32_builder b;
+    b.add(A_CARRAY_FIELD, string_ref("", 0));
+    fml32 f = b.finish();
+    CHECK(f.count(A_CARRAY_FIELD) == 1);
+    CHECK(f.get_string(A_CARRAY_FIELD).empty());
+    
+    // and last, at the end of the arena
+    b.add(A_LONG_FIELD, 1)
+     .add(A_CARRAY_FIELD, string_ref("", 0));
+    f = b.finish();
+    CHECK(f.get_long(A_LONG_FIELD) == 1);
+    CHECK(f.field_value_size(A_CARRAY_FIELD) == 0);
+}
+
+TEST_CASE("fml32_builder type mismatch")
+{
+    fml32_builder b;
+    CHECK_THROWS(b.add(A_LONG_FIELD, "hello"));
+    CHECK_THROWS(b.add(A_STRING_FIELD, 35));
+    CHECK_THROWS(b.add(A_SHORT_FIELD, 3.5));
+    CHECK(b.field_count() == 0);
+    
+    b.add(A_LONG_FIELD, 3);
+    b.clear();
+    CHECK(b.field_count() == 0);
+}
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "doctest.h"
+#include "tux/fml32_extread.hpp"
+#include "fields32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("fml32_extread");
+
+namespace
+{
+    // what repeated fml32::extread calls make of the same text
+    vector<fml32> extread_each(string const& text, size_t n)
+    {
+        const char* fname = "tmp_fml32_extread_test";
+        ofstream os(fname);
+        os << text;
+        os.close();
+        vector<fml32> result;
+        FILE* file = fopen(fname, "r");
+        for(size_t i = 0; i < n; ++i)
+        {
+            fml32 f;
+            f.extread(file);
+            result.push_back(move(f));
+        }
+        fclose(file);
+        remove(fname);
+        return result;
+    }
+}
+
+TEST_CASE("fml32 extread_all matches Fextread32")
+{
+    string text =
+        "A_SHORT_FIELD\t2\n"
+        "A_LONG_FIELD\t100\n"
+        "A_LONG_FIELD\t101\n"
+        "A_DOUBLE_FIELD\t13.7\n"
+        "A_STRING_FIELD\thello world\n"
+        "A_CARRAY_FIELD\tback\\\\slash and new\\0aline\n"
+        "\n"
+        "# a comment\n"
+        "A_LONG_FIELD\t1\n"
+        "+A_LONG_FIELD\t2\n"
+        "A_STRING_FIELD\tcopied\n"
+        "=ORIGINAL_STRING\tA_STRING_FIELD\n"
+        "A_CHAR_FIELD\tx\n"
+        "-A_CHAR_FIELD\n"
+        "\n";
+    auto expected = extread_each(text, 2);
+    auto actual = extread_all(string_ref(text), 1);
+    REQUIRE(actual.size() == 2);
+    CHECK(actual[0] == expected[0]);
+    CHECK(actual[1] == expected[1]);
+    CHECK(actual[0].count(A_LONG_FIELD) == 2);
+    CHECK(actual[0].get_carray_view(A_CARRAY_FIELD).str() == "back\\slash and new\nline");
+    CHECK(actual[1].get_long(A_LONG_FIELD) == 2);
+    CHECK(actual[1].get_string(ORIGINAL_STRING) == "copied");
+    CHECK(!actual[1].has(A_CHAR_FIELD));
+
+    // the last buffer may end without an empty line
+    CHECK(extread_all(string_ref("A_LONG_FIELD\t7\n"), 1).at(0).get_long(A_LONG_FIELD) == 7);
+    CHECK(extread_all(string_ref(""), 1).empty());
+    CHECK(extread_all(string_ref("\n\n"), 1).size() == 2);
+}
+
+TEST_CASE("fml32 extread_all reads Fprint32 output")
+{
+    vector<fml32> expected;
+    for(int i = 0; i < 20; ++i)
+    {
+        fml32 f;
+        f.add(A_LONG_FIELD, i);
+        f.add(A_FLOAT_FIELD, i * 0.5);
+        f.add(A_STRING_FIELD, string(i, 'a' + i));
+        f.add(A_CARRAY_FIELD, string("\x01\t\\\x7f", 4));
+        if(i % 5 == 0)
+        {
+            fml32 inner;
+            inner.add(A_SHORT_FIELD, static_cast<short>(i));
+            fml32 innermost;
+            innermost.add(A_STRING_FIELD, "deep");
+            inner.add(AN_FML32_FIELD, innermost);
+            f.add(AN_FML32_FIELD, inner);
+        }
+        expected.push_back(move(f));
+    }
+
+    const char* fname = "tmp_fml32_extread_test";
+    FILE* out = fopen(fname, "w");
+    for(auto& f : expected)
+    {
+        Ffprint32(f.as_fbfr(), out);
+    }
+    fclose(out);
+    FILE* in = fopen(fname, "r");
+    auto actual = extread_all(in);
+    fclose(in);
+    remove(fname);
+    CHECK(actual == expected);
+}
+
+TEST_CASE("fml32 extread_all in parallel")
+{
+    string text;
+    size_t n = 0;
+    while(text.size() < 2 * 1024 * 1024)
+    {
+        text += "A_LONG_FIELD\t" + to_string(n) + "\nA_STRING_FIELD\t" + string(n % 300, 'x') + "\n\n";
+        ++n;
+        if(n % 97 == 0)
+        {
+            text += "\n"; // an empty buffer
+            ++n;
+        }
+    }
+    auto sequential = extread_all(string_ref(text), 1);
+    auto parallel = extread_all(string_ref(text), 4);
+    REQUIRE(sequential.size() == n);
+    CHECK(parallel == sequential);
+}
+
+TEST_CASE("fml32 extread_all errors")
+{
+    CHECK_THROWS(extread_all(string_ref("\tA_LONG_FIELD\t1\n"), 1)); // indented
+    CHECK_THROWS(extread_all(string_ref("A_STRING_FIELD\tbad \\x escape\n"), 1));
+    CHECK_THROWS(extread_all(string_ref("NO_SUCH_FIELD\t1\n"), 1));
+    CHECK_THROWS(extread_all(string_ref("A_LONG_FIELD\n"), 1)); // no value
+    CHECK_THROWS(extread_all(string_ref("-A_LONG_FIELD\n"), 1)); // nothing to delete
+    CHECK_THROWS(extread_all(string_ref("=A_LONG_FIELD\tA_SHORT_FIELD\n"), 1)); // nothing to assign
+    CHECK_THROWS(extread_all(string_ref("A_PTR_FIELD\t0\n"), 1));
+    CHECK_THROWS(extread_all(string_ref("A_VIEW32_FIELD\t\n"), 1));
+    try
+    {
+        extread_all(string_ref("A_LONG_FIELD\t1\n\nA_LONG_FIELD\n"), 1);
+        CHECK(false);
+    }
+    catch(runtime_error const& e)
+    {
+        CHECK(string(e.what()).find("line 3") != string::npos);
+    }
+}
+
+TEST_CASE("fml32 extread_all unknown names in parallel")
+{
+    // resolved through the field table in the workers, and reported by line
+    string text;
+    size_t lines = 0;
+    while(text.size() < 2 * 1024 * 1024)
+    {
+        text += "A_LONG_FIELD\t1\n\n";
+        lines += 2;
+    }
+    text += "NO_SUCH_FIELD\t1\n";
+    try
+    {
+        extread_all(string_ref(text), 4);
+        CHECK(false);
+    }
+    catch(runtime_error const& e)
+    {
+        CHECK(string(e.what()).find("line " + to_string(lines + 1)) != string::npos);
+        CHECK(string(e.what()).find("NO_SUCH_FIELD") != string::npos);
+    }
+}
@@ -0,0 +1,117 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include "doctest.h"
+#include "tux/fml32_file.hpp"
+#include "fields32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("fml32_file");
+
+TEST_CASE("fml32_file round trip")
+{
+    const char* fname = "tmp_fml32_file_test";
+    vector<fml32> expected;
+    {
+        fml32_file_writer w(fname, 256); // small, so some buffers bypass the batch
+        for(int i = 0; i < 100; ++i)
+        {
+            fml32 f;
+            f.add(A_LONG_FIELD, i);
+            f.add(A_STRING_FIELD, string(i * 5, 'a' + i % 26));
+            if(i % 10 == 0)
+            {
+                fml32 inner;
+                inner.add(A_SHORT_FIELD, static_cast<short>(i));
+                f.add(AN_FML32_FIELD, inner);
+            }
+            w.append(f);
+            expected.push_back(f);
+        }
+        w.append(fml32());
+        CHECK(w.size() == 101);
+        w.close();
+        CHECK_THROWS(w.append(expected[0]));
+    }
+
+    fml32_file_reader r(fname);
+    REQUIRE(r.size() == 101);
+    for(size_t i = 0; i < 100; ++i)
+    {
+        auto v = r[i];
+        CHECK(reinterpret_cast<uintptr_t>(v.as_fbfr()) % 8 == 0);
+        CHECK(v.get_long(A_LONG_FIELD) == static_cast<long>(i));
+        CHECK(v.get_string_view(A_STRING_FIELD).size() == i * 5);
+        CHECK(v.copy() == expected[i]);
+    }
+    CHECK(r[50].get_fml_view(AN_FML32_FIELD).get_short(A_SHORT_FIELD) == 50);
+    CHECK(!r[100]);
+    CHECK_THROWS(r.at(101));
+
+    fml32::boolean_expression even("A_LONG_FIELD % 2 == 0");
+    size_t n = 0;
+    size_t evens = 0;
+    for(auto v : r)
+    {
+        if(v)
+        {
+            evens += even(v);
+        }
+        ++n;
+    }
+    CHECK(n == 101);
+    CHECK(evens == 50);
+    remove(fname);
+}
+
+TEST_CASE("fml32_file rejects other files")
+{
+    const char* fname = "tmp_fml32_file_test";
+    CHECK_THROWS(fml32_file_reader{fname}); // missing
+
+    ofstream os(fname);
+    os << "not an fml32 file, but long enough to have a header and trailer";
+    os.close();
+    CHECK_THROWS(fml32_file_reader{fname});
+
+    {
+        fml32_file_writer w(fname);
+        fml32 f;
+        f.add(A_LONG_FIELD, 1);
+        w.append(f);
+    } // closed by the destructor
+    fml32_file_reader(fname).at(0); // complete
+
+    // truncated (e.g. the writer died before close)
+    ifstream is(fname, ios::binary);
+    string contents((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+    is.close();
+    os.open(fname, ios::binary);
+    os << contents.substr(0, contents.size() - 10);
+    os.close();
+    CHECK_THROWS(fml32_file_reader{fname});
+
+    // an index entry smaller than the buffer's own header claims
+    uint64_t index_offset;
+    memcpy(&index_offset, contents.data() + contents.size() - 16, sizeof(index_offset));
+    uint64_t size;
+    memcpy(&size, contents.data() + index_offset + 8, sizeof(size));
+    for(uint64_t shrunk : {size - 8, uint64_t(8)})
+    {
+        memcpy(&contents[static_cast<size_t>(index_offset + 8)], &shrunk, sizeof(shrunk));
+        os.open(fname, ios::binary);
+        os << contents;
+        os.close();
+        CHECK_THROWS(fml32_file_reader{fname});
+    }
+
+    {
+        fml32_file_writer w(fname);
+    }
+    CHECK(fml32_file_reader(fname).size() == 0);
+    remove(fname);
+}
@@ -729,6 +729,204 @@ TEST_CASE("fml32 update")
     CHECK(f1.get_string(A_CARRAY_FIELD) == "asdasd");
 }
 
+TEST_CASE("fml32 diff/apply_patch")
+{
+    fml base;
+    base.add(A_SHORT_FIELD, 1);
+    base.add(A_LONG_FIELD, 100);
+    base.add(A_LONG_FIELD, 200);
+    base.add(A_LONG_FIELD, 300);
+    base.add(A_STRING_FIELD, "hello");
+    base.add(A_STRING_FIELD, "world");
+    base.add(A_DOUBLE_FIELD, 1.5);
+    
+    fml next(base);
+    next.set(A_LONG_FIELD, 250, 1); // changed
+    next.erase(A_LONG_FIELD, 2); // deleted
+    next.add(A_STRING_FIELD, "again"); // added
+    next.erase(A_DOUBLE_FIELD); // deleted
+    next.add(A_CARRAY_FIELD, string("a\0b", 3)); // added
+    
+    fml patch = fml::diff(base, next);
+    CHECK(patch.count(A_SHORT_FIELD) == 0); // unchanged fields aren't sent
+    CHECK(patch.count(A_LONG_FIELD) == 1);
+    CHECK(patch.get_long(A_LONG_FIELD) == 250);
+    CHECK(patch.count(A_STRING_FIELD) == 1);
+    CHECK(patch.count(A_DOUBLE_FIELD) == 0);
+    CHECK(patch.used_size() < next.used_size());
+    
+    fml received(base);
+    received.apply_patch(patch);
+    CHECK(received == next);
+    
+    // identical buffers give an empty patch
+    fml nothing = fml::diff(next, next);
+    CHECK(nothing.field_count() == 0);
+    received.apply_patch(nothing);
+    CHECK(received == next);
+    
+    // from and to nothing
+    fml empty;
+    fml all = fml::diff(empty, next);
+    empty.apply_patch(all);
+    CHECK(empty == next);
+    fml none = fml::diff(next, fml());
+    received.apply_patch(none);
+    CHECK(received.field_count() == 0);
+    
+    // a patch only applies to its base (occurrence counts must match)
+    fml other;
+    other.add(A_LONG_FIELD, 1);
+    fml before(other);
+    CHECK_THROWS(other.apply_patch(patch));
+    CHECK(other == before);
+    
+    // patch_field is reserved: buffers holding it can't be diffed or patched
+    fml colliding(next);
+    colliding.add(fml::patch_field, 7L);
+    CHECK_THROWS(fml::diff(base, colliding));
+    CHECK_THROWS(fml::diff(colliding, next));
+    fml colliding_before(colliding);
+    CHECK_THROWS(colliding.apply_patch(patch));
+    CHECK(colliding == colliding_before);
+    
+    // nested buffers are compared by their fields, not their bytes
+    fml inner;
+    inner.add(A_LONG_FIELD, 1);
+    inner.add(A_STRING_FIELD, "x");
+    fml roomier;
+    roomier.reserve(4096);
+    roomier.add(A_STRING_FIELD, "x");
+    roomier.add(A_LONG_FIELD, 1);
+    fml outer;
+    outer.add(AN_FML32_FIELD, inner);
+    fml same;
+    same.add(AN_FML32_FIELD, roomier);
+    CHECK(fml::diff(outer, same).count(AN_FML32_FIELD) == 0);
+    roomier.set(A_LONG_FIELD, 2L);
+    same.set(AN_FML32_FIELD, roomier);
+    CHECK(fml::diff(outer, same).count(AN_FML32_FIELD) == 1);
+}
+
+TEST_CASE("fml32 diff/apply_patch round trip")
+{
+    // random edits of random buffers must survive diff and apply_patch
+    unsigned long seed = 12345;
+    auto random = [&seed](unsigned long n)
+    {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        return (seed >> 33) % n;
+    };
+    const char* strings[] = {"", "a", "hello", "world", "hello world"};
+    auto random_buffer = [&]
+    {
+        fml x;
+        for(unsigned long i = random(6); i > 0; --i) { x.add(A_SHORT_FIELD, static_cast<short>(random(3))); }
+        for(unsigned long i = random(6); i > 0; --i) { x.add(A_LONG_FIELD, static_cast<long>(random(3))); }
+        for(unsigned long i = random(6); i > 0; --i) { x.add(A_DOUBLE_FIELD, random(3) / 2.0); }
+        for(unsigned long i = random(6); i > 0; --i) { x.add(A_STRING_FIELD, strings[random(5)]); }
+        for(unsigned long i = random(6); i > 0; --i) { x.add(A_CARRAY_FIELD, strings[random(5)]); }
+        return x;
+    };
+    
+    int failures = 0;
+    for(int trial = 0; trial < 500; ++trial)
+    {
+        fml base = random_buffer();
+        fml next = trial % 2 ? random_buffer() : base;
+        if(trial % 2 == 0 && next.count(A_LONG_FIELD) > 0)
+        {
+            next.set(A_LONG_FIELD, 7L, static_cast<FLDOCC32>(random(next.count(A_LONG_FIELD))));
+        }
+        fml patch = fml::diff(base, next);
+        fml received(base);
+        received.apply_patch(patch);
+        failures += received != next;
+    }
+    CHECK(failures == 0);
+}
+
+TEST_CASE("fml32 side index")
+{
+    fml f;
+    for(long i = 0; i < 100; ++i)
+    {
+        f.add(A_LONG_FIELD, i);
+        f.add(A_SHORT_FIELD, static_cast<short>(-i));
+        f.add(A_STRING_FIELD, to_string(i));
+    }
+    f.add(A_CARRAY_FIELD, string("a\0b", 3));
+    f.add(A_DOUBLE_FIELD, 2.5);
+    CHECK_FALSE(f.has_side_index());
+    
+    f.build_side_index();
+    CHECK(f.has_side_index());
+    CHECK(f.get_long(A_LONG_FIELD, 0) == 0);
+    CHECK(f.get_long(A_LONG_FIELD, 57) == 57);
+    CHECK(f.get_short(A_SHORT_FIELD, 99) == -99);
+    CHECK(f.get_string(A_STRING_FIELD, 42) == "42");
+    CHECK(f.get_string_view(A_STRING_FIELD, 7) == "7");
+    CHECK(f.get_string(A_CARRAY_FIELD) == string("a\0b", 3));
+    CHECK(f.get_double(A_DOUBLE_FIELD) == 2.5);
+    CHECK(f.get_double(A_LONG_FIELD, 3) == 3.0); // converted, not served from the index
+    CHECK_THROWS(f.get_long(A_LONG_FIELD, 100)); // not present
+    CHECK_THROWS(f.get_long(A_FLOAT_FIELD));
+    CHECK(f.has_side_index()); // reads don't discard it
+    f.as_fbfr();
+    f.buffer();
+    CHECK(f.has_side_index()); // nor does access
+    
+    // iterators walk it, in buffer order, with the values already located
+    fml unindexed(f);
+    auto it = unindexed.begin();
+    for(auto const& x : f)
+    {
+        REQUIRE(it != unindexed.end());
+        CHECK(x.id() == it->id());
+        CHECK(x.oc() == it->oc());
+        CHECK(x.size() == it->size());
+        if(x.type() == FLD_STRING)
+        {
+            CHECK(x.as_string_ref().data() == f.get_string_view(x.id(), x.oc()).data());
+        }
+        ++it;
+    }
+    CHECK(it == unindexed.end());
+    CHECK(f.has_side_index());
+    
+    // moves keep it; copies don't
+    fml g(move(f));
+    CHECK(g.has_side_index());
+    CHECK(g.get_long(A_LONG_FIELD, 12) == 12);
+    fml h(g);
+    CHECK_FALSE(h.has_side_index());
+    
+    // any modification discards it
+    g.set(A_LONG_FIELD, 1000, 12);
+    CHECK_FALSE(g.has_side_index());
+    CHECK(g.get_long(A_LONG_FIELD, 12) == 1000);
+    g.build_side_index();
+    g.erase(A_LONG_FIELD, 0);
+    CHECK_FALSE(g.has_side_index());
+    CHECK(g.get_long(A_LONG_FIELD, 11) == 1000);
+    g.build_side_index();
+    g.reserve(g.size() * 4);
+    CHECK_FALSE(g.has_side_index());
+    g.build_side_index();
+    g.add(A_FLOAT_FIELD, 1.5f);
+    CHECK_FALSE(g.has_side_index());
+    g.build_side_index();
+    g.modified();
+    CHECK_FALSE(g.has_side_index());
+    g.build_side_index();
+    g.drop_side_index();
+    CHECK_FALSE(g.has_side_index());
+    
+    fml empty;
+    empty.build_side_index();
+    CHECK_FALSE(empty.has_side_index());
+}
+
 TEST_CASE("fml32 get/set/clear encoding_name")
 {
     fml f;
@@ -1607,6 +1805,140 @@ TEST_CASE("fml32 get_string")
     CHECK(f.get_string(A_CARRAY_FIELD) == "world");
 }
 
+TEST_CASE("fml32 get_string_view")
+{
+    fml f;
+    f.add(A_LONG_FIELD, 2);
+    f.add(A_STRING_FIELD, "hello");
+    f.add(A_STRING_FIELD, "");
+    f.add(A_CARRAY_FIELD, string("wor\0ld", 6));
+    
+    auto s = f.get_string_view(A_STRING_FIELD);
+    CHECK(s.size() == 5);
+    CHECK(s == "hello");
+    CHECK(s.str() == "hello");
+    CHECK(f.get_string_view(A_STRING_FIELD, 1).empty());
+    CHECK(f.get_string_view(A_CARRAY_FIELD) == string_ref("wor\0ld", 6));
+    CHECK(f.get_carray_view(A_CARRAY_FIELD).size() == 6);
+    CHECK_THROWS(f.get_string_view(A_LONG_FIELD));
+    CHECK_THROWS(f.get_carray_view(A_STRING_FIELD));
+    CHECK_THROWS(f.get_string_view(A_STRING_FIELD, 2));
+    
+    // views point into the buffer, so they survive a move of the fml32
+    fml g(move(f));
+    CHECK(s.valid());
+    CHECK(s == "hello");
+    
+#ifndef NDEBUG
+    g.as_fbfr(); // access alone isn't a modification
+    CHECK(s.valid());
+    g.set(A_LONG_FIELD, 3);
+    CHECK(!s.valid());
+    auto c = g.get_carray_view(A_CARRAY_FIELD);
+    CHECK(c.valid());
+    g.modified(); // as after changing the FBFR32 directly
+    CHECK(!c.valid());
+    c = g.get_carray_view(A_CARRAY_FIELD);
+    g = fml();
+    CHECK(!c.valid());
+#endif
+}
+
+TEST_CASE("fml32 get_fml_view")
+{
+    fml inner;
+    inner.add(A_LONG_FIELD, 42);
+    inner.add(A_STRING_FIELD, "inner");
+    inner.add(A_CARRAY_FIELD, string("a\0b", 3));
+    
+    fml middle;
+    middle.add(A_SHORT_FIELD, 7);
+    middle.add(AN_FML32_FIELD, inner);
+    
+    fml f;
+    f.add(A_LONG_FIELD, 1);
+    f.add(AN_FML32_FIELD, middle);
+    f.add(AN_FML32_FIELD, fml());
+    
+    CHECK_THROWS(f.get_fml_view(A_LONG_FIELD));
+    CHECK_THROWS(f.get_fml_view(AN_FML32_FIELD, 5));
+    
+    auto m = f.get_fml_view(AN_FML32_FIELD);
+    CHECK(m);
+    CHECK(m.valid());
+    CHECK(m.get_short(A_SHORT_FIELD) == 7);
+    CHECK(m.get_long(A_SHORT_FIELD) == 7); // converted
+    CHECK(m.get_string(A_SHORT_FIELD) == "7");
+    CHECK(m.field_count() == 2);
+    CHECK(m.count(AN_FML32_FIELD) == 1);
+    CHECK(m.has(AN_FML32_FIELD));
+    CHECK(!m.has(A_LONG_FIELD));
+    
+    // views of views point into the outermost buffer
+    auto i = m.get_fml_view(AN_FML32_FIELD);
+    const char* begin = f.buffer().data();
+    const char* end = begin + f.used_size();
+    const char* p = reinterpret_cast<const char*>(i.as_fbfr());
+    CHECK((p > begin && p < end));
+    CHECK(i.get_long(A_LONG_FIELD) == 42);
+    CHECK(i.get_double(A_LONG_FIELD) == 42.0);
+    CHECK(i.get_string(A_STRING_FIELD) == "inner");
+    CHECK(i.get_string_view(A_STRING_FIELD) == "inner");
+    CHECK(i.get_carray_view(A_CARRAY_FIELD) == string_ref("a\0b", 3));
+    CHECK(i.field_value_size(A_CARRAY_FIELD) == 3);
+    CHECK_THROWS(i.get_long(A_SHORT_FIELD));
+    CHECK_THROWS(i.get_string_view(A_LONG_FIELD));
+    
+    fml::field_info info;
+    int n = 0;
+    while(i.next_field(info))
+    {
+        ++n;
+    }
+    CHECK(n == 3);
+    
+    CHECK(i.copy() == inner);
+    CHECK(m.get_fml(AN_FML32_FIELD) == inner);
+    CHECK(f.get_fml_view(AN_FML32_FIELD, 1).field_count() == 0);
+    CHECK(!f.get_fml_view(AN_FML32_FIELD, 1));
+    
+    // expressions evaluate in place
+    fml::boolean_expression is_answer("A_LONG_FIELD == 42");
+    CHECK(is_answer(i));
+    CHECK(!is_answer(m));
+    fml::arithmetic_expression twice("A_LONG_FIELD * 2");
+    CHECK(twice(i) == doctest::Approx(84));
+    
+    // from iterators, and from an entire fml32
+    for(auto const& x : f)
+    {
+        if(x.type() == FLD_FML32 && x.oc() == 0)
+        {
+            CHECK(x.as_fml_view().get_short(A_SHORT_FIELD) == 7);
+        }
+    }
+    const_fml32_view whole(f);
+    CHECK(whole.get_long(A_LONG_FIELD) == 1);
+    CHECK(whole.copy() == f);
+    
+    const_fml32_view null_view;
+    CHECK(!null_view);
+    CHECK(null_view.field_count() == 0);
+    CHECK(!null_view.has(A_LONG_FIELD));
+    CHECK(null_view.copy().field_count() == 0);
+    
+    // views survive a move of the fml32, but not a modification
+    fml g(move(f));
+    CHECK(i.valid());
+    CHECK(i.get_long(A_LONG_FIELD) == 42);
+#ifndef NDEBUG
+    g.set(A_LONG_FIELD, 2);
+    CHECK(!m.valid());
+    CHECK(!i.valid());
+    CHECK(!whole.valid());
+#endif
+}
+
 TEST_CASE("fml32 get_mbstring")
 {
     fml f;
@@ -2193,6 +2525,62 @@ TEST_CASE("fml32 get_last_view")
     CHECK_THROWS(f.get_last_view<string_info>(A_CHAR_FIELD));
 }
 
+TEST_CASE("fml32 get_all/set_all")
+{
+    fml f;
+    f.add(A_SHORT_FIELD, 1);
+    f.add(A_STRING_FIELD, "z");
+    
+    vector<long> longs;
+    f.get_all(A_LONG_FIELD, longs);
+    CHECK(longs.empty());
+    
+    vector<long> in = {5, 6, 7, 8};
+    f.set_all(A_LONG_FIELD, in.begin(), in.end());
+    CHECK(f.count(A_LONG_FIELD) == 4);
+    CHECK(f.get_long(A_LONG_FIELD, 3) == 8);
+    f.get_all<long>(A_LONG_FIELD, longs);
+    CHECK(longs == in);
+    
+    // replaces existing occurrences, leaves other fields alone
+    vector<long> fewer = {9, 10};
+    f.set_all(A_LONG_FIELD, fewer.begin(), fewer.end());
+    f.get_all(A_LONG_FIELD, longs);
+    CHECK(longs == fewer);
+    CHECK(f.get_short(A_SHORT_FIELD) == 1);
+    CHECK(f.get_string(A_STRING_FIELD) == "z");
+    
+    // converted when the type doesn't match
+    vector<double> doubles;
+    f.get_all(A_LONG_FIELD, doubles);
+    CHECK(doubles.size() == 2);
+    CHECK(doubles[1] == doctest::Approx(10));
+    
+    vector<string> strings = {"a", "", "hello world"};
+    f.set_all(A_STRING_FIELD, strings.begin(), strings.end());
+    vector<string> out;
+    f.get_all(A_STRING_FIELD, out);
+    CHECK(out == strings);
+    f.get_all(A_LONG_FIELD, out);
+    CHECK((out == vector<string>{"9", "10"}));
+    
+    vector<string> carrays = {string("a\0b", 3), "c"};
+    f.set_all(A_CARRAY_FIELD, carrays.begin(), carrays.end());
+    f.get_all(A_CARRAY_FIELD, out);
+    CHECK(out == carrays);
+    
+    // read from the side index when there is one
+    f.build_side_index();
+    f.get_all(A_STRING_FIELD, out);
+    CHECK(out == strings);
+    f.get_all(A_LONG_FIELD, longs);
+    CHECK(longs == fewer);
+    
+    f.set_all(A_LONG_FIELD, fewer.end(), fewer.end());
+    CHECK(!f.has(A_LONG_FIELD));
+    CHECK_THROWS(f.set_all(A_SHORT_FIELD, fewer.begin(), fewer.end()));
+}
+
 TEST_CASE("fml32 next_field")
 {
     fml f;
@@ -2242,6 +2630,103 @@ TEST_CASE("fml32 next_field")
     CHECK(fields[8].oc == 0);
 }
 
+TEST_CASE("fml32 iterators")
+{
+    fml f;
+    CHECK(f.begin() == f.end());
+    
+    f.add(A_SHORT_FIELD, 2);
+    f.add(A_SHORT_FIELD, 5);
+    f.add(A_LONG_FIELD, 100);
+    f.add(A_CHAR_FIELD, 'b');
+    f.add(A_DOUBLE_FIELD, 4096.5);
+    f.add(A_STRING_FIELD, "hello");
+    f.add(A_CARRAY_FIELD, "hello dolly");
+    
+    vector<fml::field_info> expected;
+    fml::field_info field;
+    while(f.next_field(field))
+    {
+        expected.push_back(field);
+    }
+    
+    size_t i = 0;
+    for(auto const& x : f)
+    {
+        REQUIRE(i < expected.size());
+        CHECK(x.id() == expected[i].id);
+        CHECK(x.oc() == expected[i].oc);
+        CHECK(x.size() == f.field_value_size(x.id(), x.oc()));
+        ++i;
+    }
+    CHECK(i == expected.size());
+    
+    auto it = f.begin();
+    CHECK(it->as_short() == 2);
+    CHECK((it++)->as_short() == 2);
+    CHECK(it->oc() == 1);
+    CHECK(it->as_long() == 5); // converted
+    ++it;
+    CHECK(it->type() == FLD_LONG);
+    CHECK(it->as_long() == 100);
+    CHECK(it->as_string() == "100");
+    ++it;
+    CHECK(it->as_char() == 'b');
+    ++it;
+    CHECK(it->as_double() == doctest::Approx(4096.5));
+    CHECK_THROWS(it->as_string_ref());
+    ++it;
+    CHECK(it->name() == "A_STRING_FIELD");
+    CHECK(it->as_string_ref() == "hello");
+    CHECK(it->as_string_ref().data() == it->data());
+    ++it;
+    CHECK(it->as_string_ref() == "hello dolly");
+    CHECK(it->as_string() == "hello dolly");
+    CHECK(++it == f.end());
+    
+    // values larger than the iterator's storage so far
+    string large(5000, 'x');
+    f.add(A_STRING_FIELD, large);
+    f.add(A_LONG_FIELD, 7);
+    size_t seen = 0;
+    for(auto const& x : f)
+    {
+        if(x.id() == A_STRING_FIELD && x.oc() == 1)
+        {
+            CHECK(x.as_string_ref() == large);
+            CHECK(x.size() == large.size() + 1);
+        }
+        ++seen;
+    }
+    CHECK(seen == expected.size() + 2);
+}
+
+TEST_CASE("fml32 const_fml32_view iterators")
+{
+    CHECK(const_fml32_view().begin() == const_fml32_view().end());
+    
+    fml inner;
+    inner.add(A_LONG_FIELD, 7);
+    inner.add(A_STRING_FIELD, "inner");
+    fml f;
+    f.add(A_SHORT_FIELD, 2);
+    f.add(AN_FML32_FIELD, inner);
+    
+    const_fml32_view v(f);
+    auto it = v.begin();
+    CHECK(it->as_short() == 2);
+    ++it;
+    REQUIRE(it->id() == AN_FML32_FIELD);
+    auto nested = it->as_fml_view();
+    auto jt = nested.begin();
+    CHECK(jt->as_long() == 7);
+    CHECK(jt->as_string() == "7"); // converted through the view
+    ++jt;
+    CHECK(jt->as_string_ref() == "inner");
+    CHECK(++jt == nested.end());
+    CHECK(++it == v.end());
+}
+
 TEST_CASE("fml32 boolean_expression")
 {
     fml f;
@@ -2376,6 +2861,49 @@ TEST_CASE("fml32 arithmetic_expression")
     CHECK((int)ex.evaluate(f) == 10);
 }
 
+TEST_CASE("fml32 evaluate_batch")
+{
+    vector<fml> batch(10000);
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        batch[i].add(A_LONG_FIELD, static_cast<long>(i));
+    }
+    
+    fml::boolean_expression is_odd("A_LONG_FIELD % 2 == 1");
+    fml::arithmetic_expression doubled("A_LONG_FIELD * 2");
+    for(unsigned threads : {1u, 3u, 0u})
+    {
+        vector<uint64_t> bitmap;
+        is_odd.evaluate_batch(batch, bitmap, threads);
+        REQUIRE(bitmap.size() == (batch.size() + 63) / 64);
+        size_t mismatches = 0;
+        for(size_t i = 0; i < batch.size(); ++i)
+        {
+            bool bit = (bitmap[i / 64] >> (i % 64)) & 1;
+            mismatches += bit != is_odd(batch[i]);
+        }
+        CHECK(mismatches == 0);
+        CHECK((bitmap.back() >> (batch.size() % 64)) == 0); // unused bits are clear
+        
+        vector<double> results;
+        doubled.evaluate_batch(batch, results, threads);
+        REQUIRE(results.size() == batch.size());
+        CHECK(results[0] == 0);
+        CHECK(results[4097] == 8194);
+        CHECK(results.back() == 19998);
+    }
+    
+    vector<uint64_t> bitmap(3, 1);
+    is_odd.evaluate_batch(nullptr, 0, bitmap);
+    CHECK(bitmap.empty());
+    
+    // errors propagate from the workers
+    batch[9000] = fml(); // no buffer
+    vector<double> results;
+    CHECK_THROWS(is_odd.evaluate_batch(batch, bitmap, 4));
+    CHECK_THROWS(doubled.evaluate_batch(batch, results, 4));
+}
+
 
 TEST_CASE("fml32 comparisons")
 {
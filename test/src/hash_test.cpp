@@ -0,0 +1,211 @@
+#include <cstring>
+#include <string>
+#include "doctest.h"
+#include "tux/hash.hpp"
+#include "tux/util.hpp"
+#include "fields32.h"
+#include "views32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("hash");
+
+TEST_CASE("hash_bytes reference values")
+{
+    // XXH64 test vectors
+    CHECK(hash_bytes("", 0) == 0xEF46DB3751D8E999ULL);
+    CHECK(hash_bytes("a", 1) == 0xD24EC4F1A98C6E5BULL);
+    CHECK(hash_bytes("abc", 3) == 0x44BC2CF5AD770999ULL);
+    const char* long_input = "Nobody inspects the spammish repetition"; // > 32 bytes
+    CHECK(hash_bytes(long_input, strlen(long_input)) == 0xFBCEA83C8A378BF1ULL);
+
+    CHECK(tux::hash(string("abc")) == 0x44BC2CF5AD770999ULL);
+    CHECK(tux::hash("abc", 1) != tux::hash("abc"));
+    CHECK(tux::hash("abc", 1) == tux::hash("abc", 1));
+}
+
+TEST_CASE("hash string buffers")
+{
+    cstring a("hello dolly");
+    cstring b("hello dolly");
+    CHECK(tux::hash(a) == tux::hash(b));
+    CHECK(tux::hash(a) == tux::hash("hello dolly"));
+    b += "!";
+    CHECK(tux::hash(a) != tux::hash(b));
+    CHECK(tux::hash(cstring()) == tux::hash(""));
+
+    carray c(string("a\0b", 3));
+    CHECK(tux::hash(c) == tux::hash(string("a\0b", 3)));
+    CHECK(tux::hash(c) != tux::hash(carray(string("a\0c", 3))));
+    CHECK(tux::hash(c, 42) != tux::hash(c));
+}
+
+TEST_CASE("hash locally built buffers")
+{
+    // data_size() was never set on these: the used portion still counts
+    buffer s1("STRING", nullptr, 64);
+    buffer s2("STRING", nullptr, 64);
+    strcpy(s1.data(), "hello");
+    strcpy(s2.data(), "world");
+    CHECK(s1.data_size() == 0);
+    CHECK(tux::hash(s1) != tux::hash(s2));
+    strcpy(s2.data(), "hello");
+    CHECK(tux::hash(s1) == tux::hash(s2));
+
+    fml32 a;
+    fml32 b;
+    a.add(A_LONG_FIELD, 1L);
+    b.add(A_LONG_FIELD, 2L);
+    buffer f1 = a.move_buffer();
+    buffer f2 = b.move_buffer();
+    CHECK(tux::hash(f1) != tux::hash(f2));
+}
+
+TEST_CASE("hash fml32")
+{
+    fml32 a;
+    a.add(A_LONG_FIELD, 42);
+    a.add(A_STRING_FIELD, "NY");
+    a.add(A_STRING_FIELD, "NJ");
+    a.add(A_DOUBLE_FIELD, 2.5);
+
+    // content, not layout or capacity
+    fml32 b(10000);
+    b.add(A_DOUBLE_FIELD, 2.5);
+    b.add(A_STRING_FIELD, "NY");
+    b.add(A_STRING_FIELD, "NJ");
+    b.add(A_LONG_FIELD, 42);
+    CHECK(tux::hash(a) == tux::hash(b));
+    CHECK(tux::hash(a, 7) == tux::hash(b, 7));
+    CHECK(tux::hash(a, 7) != tux::hash(a));
+
+    b.set(A_LONG_FIELD, 43);
+    CHECK(tux::hash(a) != tux::hash(b));
+    b.set(A_LONG_FIELD, 42);
+    CHECK(tux::hash(a) == tux::hash(b));
+
+    // a value can't migrate between fields unnoticed
+    fml32 c;
+    c.add(A_STRING_FIELD, "x");
+    fml32 d;
+    d.add(A_CARRAY_FIELD, string("x\0", 2));
+    CHECK(tux::hash(c) != tux::hash(d));
+
+    // null and empty
+    CHECK(tux::hash(fml32()) == tux::hash(fml32(1024)));
+    CHECK(tux::hash(fml32()) != tux::hash(a));
+
+    // nested buffers by content
+    fml32 outer1;
+    outer1.add(AN_FML32_FIELD, a);
+    fml32 outer2;
+    outer2.add(AN_FML32_FIELD, b);
+    CHECK(tux::hash(outer1) == tux::hash(outer2));
+    b.set(A_DOUBLE_FIELD, 3.5);
+    fml32 outer3;
+    outer3.add(AN_FML32_FIELD, b);
+    CHECK(tux::hash(outer1) != tux::hash(outer3));
+}
+
+TEST_CASE("hash fml32 views and pointers")
+{
+    // view32 fields by member, so padding doesn't count
+    string_info s = make_default<string_info>();
+    s.byte_count = 11;
+    set(s.original_string, "hello world");
+    string_info t = s;
+    memset(t.original_string + 12, 'x', sizeof(t.original_string) - 12); // past the terminator
+    fml32 a;
+    a.add_view(A_VIEW32_FIELD, s);
+    fml32 b;
+    b.add_view(A_VIEW32_FIELD, t);
+    CHECK(tux::hash(a) == tux::hash(b));
+    t.byte_count = 12;
+    fml32 c;
+    c.add_view(A_VIEW32_FIELD, t);
+    CHECK(tux::hash(a) != tux::hash(c));
+
+    // values larger than the walk's first copy
+    fml32 d;
+    d.add(A_STRING_FIELD, string(5000, 'x'));
+    fml32 e;
+    e.add(A_STRING_FIELD, string(5000, 'x') + "y");
+    CHECK(tux::hash(d) != tux::hash(e));
+
+    // an address means nothing elsewhere
+    fml32 p;
+    cstring target("hello");
+    p.add_ptr(A_PTR_FIELD, target.data());
+    CHECK_THROWS(tux::hash(p));
+    p.erase(A_PTR_FIELD); // freeing p mustn't free target too
+}
+
+TEST_CASE("hash fml32 canonical mode")
+{
+    fml32 a;
+    a.add(A_STRING_FIELD, "NY");
+    a.add(A_STRING_FIELD, "NJ");
+    a.add(A_LONG_FIELD, 1);
+    a.add(A_LONG_FIELD, 2);
+
+    fml32 b;
+    b.add(A_LONG_FIELD, 2);
+    b.add(A_STRING_FIELD, "NJ");
+    b.add(A_LONG_FIELD, 1);
+    b.add(A_STRING_FIELD, "NY");
+
+    CHECK(tux::hash(a) != tux::hash(b));
+    CHECK(tux::hash(a, 0, hash_mode::canonical) == tux::hash(b, 0, hash_mode::canonical));
+
+    // still sensitive to values, their fields, and how many there are
+    b.set(A_STRING_FIELD, "CT", 1);
+    CHECK(tux::hash(a, 0, hash_mode::canonical) != tux::hash(b, 0, hash_mode::canonical));
+    b.set(A_STRING_FIELD, "NY", 1);
+    b.add(A_STRING_FIELD, "NY");
+    CHECK(tux::hash(a, 0, hash_mode::canonical) != tux::hash(b, 0, hash_mode::canonical));
+
+    fml32 c;
+    c.add(A_LONG_FIELD, 1);
+    fml32 d;
+    d.add(A_SHORT_FIELD, 1);
+    CHECK(tux::hash(c, 0, hash_mode::canonical) != tux::hash(d, 0, hash_mode::canonical));
+
+    // canonical nested buffers
+    fml32 outer1;
+    outer1.add(AN_FML32_FIELD, a);
+    fml32 outer2;
+    b.erase(A_STRING_FIELD, 2);
+    outer2.add(AN_FML32_FIELD, b);
+    CHECK(tux::hash(outer1) != tux::hash(outer2));
+    CHECK(tux::hash(outer1, 0, hash_mode::canonical) == tux::hash(outer2, 0, hash_mode::canonical));
+}
+
+TEST_CASE("hash fml16")
+{
+    const FLDID long_field = 9194; // A_LONG_FIELD in fields16.h, whose names clash with fields32.h
+    fml16 a;
+    a.add(long_field, 1);
+    a.add(long_field, 2);
+    fml16 b;
+    b.add(long_field, 2);
+    b.add(long_field, 1);
+    CHECK(tux::hash(a) != tux::hash(b));
+    CHECK(tux::hash(a, 0, hash_mode::canonical) == tux::hash(b, 0, hash_mode::canonical));
+    b.set(long_field, 1, 0);
+    b.set(long_field, 2, 1);
+    CHECK(tux::hash(a) == tux::hash(b));
+    CHECK(tux::hash(fml16()) == tux::hash(fml32()));
+}
+
+TEST_CASE("hash view32")
+{
+    view32<string_info> a;
+    view32<string_info> b;
+    a->byte_count = 10;
+    b->byte_count = 10;
+    CHECK(tux::hash(a) == tux::hash(b));
+    b->ascii_sum = 1;
+    CHECK(tux::hash(a) != tux::hash(b));
+    CHECK(tux::hash(view32<string_info>()) == tux::hash(""));
+}
@@ -0,0 +1,185 @@
+#include <clocale>
+#include <limits>
+#include <string>
+#include "doctest.h"
+#include "tux/convert.hpp"
+#include "tux/json.hpp"
+#include "tux/util.hpp"
+#include "fields32.hpp"
+#include "views32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("json");
+
+namespace
+{
+    fml32 make_sample()
+    {
+        fml32 inner;
+        inner.add(field32::A_LONG_FIELD, 7);
+        inner.add(field32::A_STRING_FIELD, "inner");
+
+        fml32 f;
+        f.add(field32::A_SHORT_FIELD, static_cast<short>(-12));
+        f.add(field32::A_LONG_FIELD, 100);
+        f.add(field32::A_LONG_FIELD, -2000000000);
+        f.add(field32::A_CHAR_FIELD, 'x');
+        f.add(field32::A_DOUBLE_FIELD, 0.1);
+        f.add(field32::A_DOUBLE_FIELD, 1e300);
+        f.add(field32::A_STRING_FIELD, "hello");
+        f.add(field32::A_STRING_FIELD, "world");
+        f.add(field32::AN_FML32_FIELD, inner);
+        return f;
+    }
+}
+
+TEST_CASE("json to_json")
+{
+    fml32 f;
+    f.add(field32::A_LONG_FIELD, 100);
+    f.add(field32::A_STRING_FIELD, "hello");
+    f.add(field32::A_STRING_FIELD, "world");
+    CHECK(to_json(f) == R"({"A_LONG_FIELD":[100],"A_STRING_FIELD":["hello","world"]})");
+
+    CHECK(to_json(fml32()) == "{}");
+
+    string out = "[";
+    to_json(f, out); // appends
+    out += "]";
+    CHECK(out == R"([{"A_LONG_FIELD":[100],"A_STRING_FIELD":["hello","world"]}])");
+
+    fml32 g;
+    g.add(field32::A_STRING_FIELD, "quote\" backslash\\ tab\t newline\n bell\a long enough to scan a word or two");
+    CHECK(to_json(g) == R"({"A_STRING_FIELD":["quote\" backslash\\ tab\t newline\n bell\u0007 long enough to scan a word or two"]})");
+
+    fml32 h;
+    h.add(field32::A_FLOAT_FIELD, 0.5f);
+    h.add(field32::A_DOUBLE_FIELD, 0.1);
+    h.add(field32::A_CARRAY_FIELD, string("\0\1\2", 3));
+    CHECK(to_json(h) == R"({"A_FLOAT_FIELD":[0.5],"A_DOUBLE_FIELD":[0.1],"A_CARRAY_FIELD":["AAEC"]})");
+
+    h.add(field32::A_DOUBLE_FIELD, numeric_limits<double>::infinity());
+    CHECK_THROWS(to_json(h));
+}
+
+TEST_CASE("json round trip")
+{
+    fml32 f = make_sample();
+    f.add(field32::A_FLOAT_FIELD, 3.14159f);
+    f.add(field32::A_CARRAY_FIELD, string("bytes\0with\xff nulls", 17));
+    f.add(field32::A_STRING_FIELD, "\xc3\xa9t\xc3\xa9"); // UTF-8 passes through
+    f.add(field32::A_STRING_FIELD, "");
+
+    fml32 g = to_fml32(to_json(f));
+    CHECK(g == f);
+    CHECK(g.get_double(field32::A_DOUBLE_FIELD, 0) == 0.1);
+    CHECK(g.get_float(field32::A_FLOAT_FIELD) == 3.14159f);
+    CHECK(g.get_string(field32::A_CARRAY_FIELD) == string("bytes\0with\xff nulls", 17));
+    CHECK(to_json(g) == to_json(f));
+}
+
+TEST_CASE("json ignores the C locale")
+{
+    fml32 f;
+    f.add(field32::A_FLOAT_FIELD, 0.5f);
+    f.add(field32::A_DOUBLE_FIELD, 1234.25);
+    string numeric = setlocale(LC_NUMERIC, nullptr);
+    // any locale with a decimal comma will do; the C locale is checked regardless
+    for(const char* name : {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "C"})
+    {
+        if(setlocale(LC_NUMERIC, name))
+        {
+            break;
+        }
+    }
+    string json = to_json(f);
+    fml32 g = to_fml32(R"({"A_DOUBLE_FIELD":[0.125]})");
+    setlocale(LC_NUMERIC, numeric.c_str());
+    CHECK(json == R"({"A_FLOAT_FIELD":[0.5],"A_DOUBLE_FIELD":[1234.25]})");
+    CHECK(g.get_double(field32::A_DOUBLE_FIELD) == 0.125);
+}
+
+TEST_CASE("json view32")
+{
+    string_info s = make_default<string_info>();
+    s.byte_count = 11;
+    s.ascii_sum = 1116;
+    s.most_frequent_char = 'l';
+    set(s.original_string, "hello world");
+
+    fml32 f;
+    f.add_view(field32::A_VIEW32_FIELD, s);
+    string json = to_json(f);
+    CHECK(json == R"({"A_VIEW32_FIELD":[{"@view":"string_info","BYTE_COUNT":[11],"ASCII_SUM":[1116],)"
+                   R"("MOST_FREQUENT_CHAR":["l"],"ORIGINAL_STRING":["hello world"]}]})");
+
+    fml32 g = to_fml32(json);
+    auto t = g.get_view<string_info>(field32::A_VIEW32_FIELD);
+    CHECK(string(t.original_string) == "hello world");
+    CHECK(t.byte_count == 11);
+    CHECK(t.ascii_sum == 1116);
+    CHECK(t.most_frequent_char == 'l');
+
+    CHECK_THROWS(to_fml32(R"({"A_VIEW32_FIELD":[{"BYTE_COUNT":[11]}]})")); // no @view
+    CHECK_THROWS(to_fml32(R"({"@view":"string_info"})")); // only inside a view
+}
+
+TEST_CASE("json matches the xml conversion")
+{
+    fml32 f = make_sample();
+    fml32 from_xml = to_fml32(to_xml(f)).first;
+    fml32 from_json = to_fml32(to_json(f));
+    CHECK(from_json == f);
+    CHECK(from_json == from_xml);
+    CHECK(to_json(from_xml) == to_json(f));
+}
+
+TEST_CASE("json char values")
+{
+    fml32 f;
+    f.add(field32::A_CHAR_FIELD, '\xe9');
+    f.add(field32::A_CHAR_FIELD, '\0');
+    f.add(field32::A_CHAR_FIELD, 'x');
+    string json = to_json(f);
+    CHECK(json == R"({"A_CHAR_FIELD":["\u00e9","\u0000","x"]})");
+    fml32 g = to_fml32(json);
+    CHECK(g.get_char(field32::A_CHAR_FIELD, 0) == '\xe9');
+    CHECK(g.get_char(field32::A_CHAR_FIELD, 1) == '\0');
+    CHECK(g.get_char(field32::A_CHAR_FIELD, 2) == 'x');
+    // the UTF-8 character means the same
+    CHECK(to_fml32("{\"A_CHAR_FIELD\":\"\xc3\xa9\"}").get_char(field32::A_CHAR_FIELD) == '\xe9');
+}
+
+TEST_CASE("json parsing")
+{
+    fml32 f = to_fml32(" {\n\t\"A_LONG_FIELD\" : 5 , \"A_STRING_FIELD\":[ \"a\\u00e9\\ud83d\\ude00\\/\" ] ,"
+                       "\"A_SHORT_FIELD\":[], \"AN_FML32_FIELD\":{\"A_CHAR_FIELD\":\"c\"} } ");
+    CHECK(f.get_long(field32::A_LONG_FIELD) == 5); // a value in place of an array
+    CHECK(f.get_string(field32::A_STRING_FIELD) == "a\xc3\xa9\xf0\x9f\x98\x80/");
+    CHECK(f.count(field32::A_SHORT_FIELD) == 0);
+    CHECK(f.get_fml(field32::AN_FML32_FIELD).get_char(field32::A_CHAR_FIELD) == 'c');
+
+    CHECK(to_fml32("{}").field_count() == 0);
+
+    CHECK_THROWS(to_fml32(""));
+    CHECK_THROWS(to_fml32("[]"));
+    CHECK_THROWS(to_fml32("{"));
+    CHECK_THROWS(to_fml32("{} x"));
+    CHECK_THROWS(to_fml32(R"({"A_LONG_FIELD":[1,]})"));
+    CHECK_THROWS(to_fml32(R"({"A_LONG_FIELD":1.5})"));
+    CHECK_THROWS(to_fml32(R"({"A_SHORT_FIELD":40000})"));
+    CHECK_THROWS(to_fml32(R"({"A_CHAR_FIELD":"ab"})"));
+    CHECK_THROWS(to_fml32(R"({"A_CHAR_FIELD":"\u0100"})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"lone \ud83d high"})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"\ud83d"})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"lone \ude00 low"})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"nul \u0000 inside"})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":5})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"unterminated})"));
+    CHECK_THROWS(to_fml32(R"({"A_STRING_FIELD":"bad \q escape"})"));
+    CHECK_THROWS(to_fml32(R"({"A_CARRAY_FIELD":"not base64!"})"));
+    CHECK_THROWS(to_fml32(R"({"NO_SUCH_FIELD":1})"));
+    CHECK_THROWS(to_fml32(string(1000, '{')));
+}
@@ -5,7 +5,11 @@
 #include <unistd.h>
 #include "doctest.h"
 #include "tux/message_queuing.hpp"
+#include "tux/carray.hpp"
 #include "tux/cstring.hpp"
+#include "tux/fml32.hpp"
+#include "tux/xml.hpp"
+#include "fields32.h"
 
 using namespace std;
 using namespace tux;
@@ -41,6 +45,79 @@ TEST_CASE("message_queuing enqueue")
     CHECK(reply == "HELLO");
 }
 
+TEST_CASE("message_queuing enqueue shrink_to_fit")
+{
+    cstring request("hello");
+    request.reserve(4096);
+    auto qctl = make_default<TPQCTL>();
+    set(qctl.replyqueue, "REPLY1");
+    set(qctl.corrid, make_correlation_id());
+    qctl.flags = TPQCORRID | TPQREPLYQ;
+    
+    enqueue("myqueuespace", "TOUPPER", qctl, request.buffer(), TPNOFLAGS, true);
+    CHECK(request.buffer().size() < 4096);
+    CHECK(request == "hello");
+    
+    qctl.flags = TPQGETBYCORRID;
+    
+    cstring reply = dequeue("myqueuespace", "REPLY1", qctl);
+    
+    CHECK(reply == "HELLO");
+}
+
+TEST_CASE("message_queuing enqueue sends the payload")
+{
+    // enqueued and dequeued straight back, to see the length stored
+    auto round_trip = [](buffer const& message)
+    {
+        auto qctl = make_default<TPQCTL>();
+        set(qctl.corrid, make_correlation_id());
+        qctl.flags = TPQCORRID;
+        enqueue("myqueuespace", "REPLY1", qctl, message);
+        qctl.flags = TPQGETBYCORRID;
+        return dequeue("myqueuespace", "REPLY1", qctl);
+    };
+    
+    SUBCASE("STRING")
+    {
+        cstring s("hello");
+        s.reserve(4096);
+        cstring reply = round_trip(s.buffer());
+        CHECK(reply.buffer().data_size() == 6);
+        CHECK(reply == "hello");
+    }
+    
+    SUBCASE("CARRAY")
+    {
+        carray c("abc");
+        c.reserve(1024);
+        buffer reply = round_trip(c.buffer());
+        CHECK(reply.data_size() == 3);
+        
+        // data_size 0 sends no bytes, so nothing comes back
+        buffer empty("CARRAY", nullptr, 256);
+        CHECK(!round_trip(empty));
+    }
+    
+    SUBCASE("FML32")
+    {
+        fml32 f;
+        f.reserve(64 * 1024);
+        f.set(A_STRING_FIELD, "hello");
+        fml32 reply = round_trip(f.buffer());
+        CHECK(reply.buffer().data_size() < 64 * 1024);
+        CHECK(reply == f);
+    }
+    
+    SUBCASE("XML")
+    {
+        xml x("<root>hello</root>");
+        x.reserve(4096);
+        buffer reply = round_trip(x.buffer());
+        CHECK(reply.data_size() == x.buffer().data_size());
+    }
+}
+
 TEST_CASE("message_queuing dequeue_nonblocking")
 {
     cstring request("hello");
@@ -0,0 +1,133 @@
+#include <vector>
+#include "doctest.h"
+#include "typed_fields32.hpp"
+#include "tux/predicate.hpp"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("predicate");
+
+namespace
+{
+    vector<fml32> sample_buffers()
+    {
+        using namespace field32;
+        vector<fml32> buffers;
+
+        fml32 f;
+        f.add(A_SHORT_FIELD, 2);
+        f.add(A_SHORT_FIELD, 5);
+        f.add(A_LONG_FIELD, 100);
+        f.add(A_CHAR_FIELD, 'b');
+        f.add(A_FLOAT_FIELD, 13.5f);
+        f.add(A_DOUBLE_FIELD, 4096.25);
+        f.add(A_STRING_FIELD, "hello");
+        f.add(A_STRING_FIELD, "world");
+        f.add(A_CARRAY_FIELD, "hello dolly");
+        buffers.push_back(f);
+
+        fml32 g;
+        g.add(A_SHORT_FIELD, -7);
+        g.add(A_LONG_FIELD, 18);
+        g.add(A_LONG_FIELD, 17);
+        g.add(A_STRING_FIELD, "NY");
+        buffers.push_back(g);
+
+        fml32 h;
+        h.add(A_LONG_FIELD, 17);
+        h.add(A_STRING_FIELD, "NJ");
+        h.add(A_STRING_FIELD, "NY");
+        h.add(A_DOUBLE_FIELD, -1.0);
+        buffers.push_back(h);
+
+        fml32 empty;
+        empty.add(A_CHAR_FIELD, 'z');
+        buffers.push_back(empty);
+
+        return buffers;
+    }
+
+    // one '0' or '1' per sample buffer
+    template <typename P>
+    string results(P const& p)
+    {
+        string x;
+        for(auto const& f : sample_buffers())
+        {
+            x += p(f) ? '1' : '0';
+        }
+        return x;
+    }
+}
+
+TEST_CASE("predicate conformance with boolean_expression")
+{
+    using namespace field32;
+    // every predicate must agree with its Fboolev32 equivalent on every sample
+
+    // comparisons
+    CHECK(results(where(A_LONG_FIELD == 100)) == results(fml32::boolean_expression("A_LONG_FIELD == 100")));
+    CHECK(results(where(A_LONG_FIELD != 100)) == results(fml32::boolean_expression("A_LONG_FIELD != 100")));
+    CHECK(results(where(A_LONG_FIELD < 18)) == results(fml32::boolean_expression("A_LONG_FIELD < 18")));
+    CHECK(results(where(A_LONG_FIELD <= 18)) == results(fml32::boolean_expression("A_LONG_FIELD <= 18")));
+    CHECK(results(where(A_LONG_FIELD > 18)) == results(fml32::boolean_expression("A_LONG_FIELD > 18")));
+    CHECK(results(where(A_LONG_FIELD >= 18)) == results(fml32::boolean_expression("A_LONG_FIELD >= 18")));
+    CHECK(results(where(A_SHORT_FIELD < 0)) == results(fml32::boolean_expression("A_SHORT_FIELD < 0")));
+    CHECK(results(where(A_FLOAT_FIELD > 13)) == results(fml32::boolean_expression("A_FLOAT_FIELD > 13")));
+    CHECK(results(where(A_DOUBLE_FIELD >= 4096.25)) == results(fml32::boolean_expression("A_DOUBLE_FIELD >= 4096.25")));
+    CHECK(results(where(A_DOUBLE_FIELD < 0)) == results(fml32::boolean_expression("A_DOUBLE_FIELD < 0")));
+
+    // strings and carrays
+    CHECK(results(where(A_STRING_FIELD == "NY")) == results(fml32::boolean_expression("A_STRING_FIELD == 'NY'")));
+    CHECK(results(where(A_STRING_FIELD != "NY")) == results(fml32::boolean_expression("A_STRING_FIELD != 'NY'")));
+    CHECK(results(where(A_STRING_FIELD < "NY")) == results(fml32::boolean_expression("A_STRING_FIELD < 'NY'")));
+    CHECK(results(where(A_STRING_FIELD >= string("hello"))) == results(fml32::boolean_expression("A_STRING_FIELD >= 'hello'")));
+    CHECK(results(where(A_CARRAY_FIELD == "hello dolly")) == results(fml32::boolean_expression("A_CARRAY_FIELD == 'hello dolly'")));
+    CHECK(results(where(A_CARRAY_FIELD > "hello")) == results(fml32::boolean_expression("A_CARRAY_FIELD > 'hello'")));
+
+    // occurrences
+    CHECK(results(where(at(A_SHORT_FIELD, 1) == 5)) == results(fml32::boolean_expression("A_SHORT_FIELD[1] == 5")));
+    CHECK(results(where(at(A_LONG_FIELD, 1) < 18)) == results(fml32::boolean_expression("A_LONG_FIELD[1] < 18")));
+    CHECK(results(where(any(A_SHORT_FIELD) > 3)) == results(fml32::boolean_expression("A_SHORT_FIELD[?] > 3")));
+    CHECK(results(where(any(A_STRING_FIELD) == "NY")) == results(fml32::boolean_expression("A_STRING_FIELD[?] == 'NY'")));
+
+    // presence
+    CHECK(results(where(has(A_LONG_FIELD))) == results(fml32::boolean_expression("A_LONG_FIELD")));
+    CHECK(results(where(has(at(A_STRING_FIELD, 1)))) == results(fml32::boolean_expression("A_STRING_FIELD[1]")));
+    CHECK(results(where(!has(A_SHORT_FIELD))) == results(fml32::boolean_expression("!A_SHORT_FIELD")));
+
+    // logical
+    CHECK(results(where(A_LONG_FIELD >= 18 && A_STRING_FIELD == "NY")) == results(fml32::boolean_expression("A_LONG_FIELD >= 18 && A_STRING_FIELD == 'NY'")));
+    CHECK(results(where(A_LONG_FIELD >= 18 || any(A_STRING_FIELD) == "NY")) == results(fml32::boolean_expression("A_LONG_FIELD >= 18 || A_STRING_FIELD[?] == 'NY'")));
+    CHECK(results(where(!(A_LONG_FIELD < 18))) == results(fml32::boolean_expression("!(A_LONG_FIELD < 18)")));
+    CHECK(results(where((A_FLOAT_FIELD < 0 || A_FLOAT_FIELD > 13) && A_CARRAY_FIELD == "hello dolly")) ==
+          results(fml32::boolean_expression("(A_FLOAT_FIELD < 0 || A_FLOAT_FIELD > 13) && A_CARRAY_FIELD == 'hello dolly'")));
+}
+
+TEST_CASE("predicate evaluation")
+{
+    using namespace field32;
+    fml32 person;
+    person.add(A_LONG_FIELD, 42);
+    person.add(A_STRING_FIELD, "NY");
+
+    auto adult_in_ny = where(A_LONG_FIELD >= 18 && A_STRING_FIELD == "NY");
+    CHECK(adult_in_ny(person));
+    CHECK(adult_in_ny.evaluate(person));
+
+    person.set(A_STRING_FIELD, "NJ");
+    CHECK_FALSE(adult_in_ny(person));
+
+    // missing fields are false, whatever the operator
+    fml32 empty;
+    CHECK_FALSE(where(A_LONG_FIELD == 0)(empty));
+    CHECK_FALSE(where(A_LONG_FIELD != 0)(empty));
+    CHECK(where(!has(A_LONG_FIELD))(empty));
+
+    // strings compare in full, embedded nulls included for carrays
+    fml32 f;
+    f.add(A_CARRAY_FIELD, string("a\0b", 3));
+    CHECK(where(A_CARRAY_FIELD == string("a\0b", 3))(f));
+    CHECK_FALSE(where(A_CARRAY_FIELD == "a")(f));
+}
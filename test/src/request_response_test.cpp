@@ -2,10 +2,15 @@
 #include <thread>
 #include "doctest.h"
 #include "tux/request_response.hpp"
+#include "tux/carray.hpp"
 #include "tux/cstring.hpp"
+#include "tux/fml32.hpp"
+#include "tux/view32.hpp"
 #include "tux/xml.hpp"
 #include "tux/init_request.hpp"
 #include "tux/context.hpp"
+#include "fields32.h"
+#include "views32.h"
 
 
 using namespace std;
@@ -73,6 +78,57 @@ TEST_CASE("request_response call")
     }
 }
 
+TEST_CASE("request_response call sends the payload")
+{
+    // REQUEST_LENGTH replies with the length the service received
+    auto received = [](buffer const& request)
+    {
+        cstring reply = call("REQUEST_LENGTH", request);
+        return stol(reply.data());
+    };
+    
+    SUBCASE("STRING")
+    {
+        cstring s("hello");
+        s.reserve(4096);
+        CHECK(received(s.buffer()) == 6);
+    }
+    
+    SUBCASE("CARRAY")
+    {
+        carray c("abc");
+        c.reserve(1024);
+        CHECK(received(c.buffer()) == 3);
+    }
+    
+    SUBCASE("FML32")
+    {
+        fml32 f;
+        f.reserve(64 * 1024);
+        f.set(A_STRING_FIELD, "hello");
+        CHECK(received(f.buffer()) < 64 * 1024);
+    }
+    
+    SUBCASE("VIEW32")
+    {
+        view32<my_struct> v;
+        CHECK(received(v.buffer()) == (long)sizeof(my_struct));
+    }
+    
+    SUBCASE("XML")
+    {
+        xml x("<root>hello</root>");
+        x.reserve(4096);
+        CHECK(received(x.buffer()) == x.buffer().data_size());
+        
+        // without a data_size, the whole capacity is sent
+        buffer b("XML", nullptr, 1024);
+        memset(b.data(), ' ', static_cast<size_t>(b.size()));
+        memcpy(b.data(), "<root/>", 7);
+        CHECK(received(b) == b.size());
+    }
+}
+
 TEST_CASE("request_response async_call default construct")
 {
     async_call acall;
@@ -17,6 +17,10 @@ int tpsvrinit(int argc, char** argv)
 {
 	try
 	{
+		field_table::load();
+		log("INFO: %lu fields loaded in %ld us [tpsvrinit]",
+		    static_cast<unsigned long>(field_table::current()->size()),
+		    static_cast<long>(field_table::current()->load_time().count()));
 		//open_resource_manager();
 		//string svc_name = "NOTIFY" + to_string(getpid());
 		//advertisex("NOTIFY" + to_string(getpid()), NOTIFY);
@@ -294,6 +298,21 @@ extern "C" void ECHO_CLIENTID(TPSVCINFO* info)
 	}
 }
 
+extern "C" void REQUEST_LENGTH(TPSVCINFO* info)
+{
+	// replies with the length Tuxedo delivered, for checking what callers send
+	service svc(info);
+	try
+	{
+		svc.reply(TPSUCCESS, cstring(to_string(info->len)).move_buffer());
+	}
+	catch(exception const& e)
+	{
+		log("ERROR: %s [REQUEST_LENGTH]", e.what());
+		svc.reply(TPFAIL);
+	}
+}
+
 extern "C" void FORWARDING_SVC(TPSVCINFO* info)
 {
 	service svc(info);
@@ -15,6 +15,7 @@ extern void FORWARD_TARGET _((TPSVCINFO *));
 extern void HIDE_SECRET _((TPSVCINFO *));
 extern void NOTIFY _((TPSVCINFO *));
 extern void NO_REPLY_SVC _((TPSVCINFO *));
+extern void REQUEST_LENGTH _((TPSVCINFO *));
 extern void REVEAL_SECRET _((TPSVCINFO *));
 extern void REVERSE _((TPSVCINFO *));
 extern void SECRET_SVC _((TPSVCINFO *));
@@ -38,15 +39,16 @@ static struct tmdsptchtbl_t _tmdsptchtbl[] = {
 	{ (char*)"HIDE_SECRET", (char*)"HIDE_SECRET", (void (*) _((TPSVCINFO *))) HIDE_SECRET, 6, 0 },
 	{ (char*)"", (char*)"NOTIFY", (void (*) _((TPSVCINFO *))) NOTIFY, 7, 0 },
 	{ (char*)"NO_REPLY_SVC", (char*)"NO_REPLY_SVC", (void (*) _((TPSVCINFO *))) NO_REPLY_SVC, 8, 0 },
-	{ (char*)"REVEAL_SECRET", (char*)"REVEAL_SECRET", (void (*) _((TPSVCINFO *))) REVEAL_SECRET, 9, 0 },
-	{ (char*)"REVERSE", (char*)"REVERSE", (void (*) _((TPSVCINFO *))) REVERSE, 10, 0 },
-	{ (char*)"", (char*)"SECRET_SVC", (void (*) _((TPSVCINFO *))) SECRET_SVC, 11, 0 },
-	{ (char*)"SLOW_TOUPPER", (char*)"SLOW_TOUPPER", (void (*) _((TPSVCINFO *))) SLOW_TOUPPER, 12, 0 },
-	{ (char*)"TOUPPER", (char*)"TOUPPER", (void (*) _((TPSVCINFO *))) TOUPPER, 13, 0 },
-	{ (char*)"TRIGGER_BROADCAST", (char*)"TRIGGER_BROADCAST", (void (*) _((TPSVCINFO *))) TRIGGER_BROADCAST, 14, 0 },
-	{ (char*)"TRIGGER_NOTIFY", (char*)"TRIGGER_NOTIFY", (void (*) _((TPSVCINFO *))) TRIGGER_NOTIFY, 15, 0 },
-	{ (char*)"TRIGGER_NOTIFY_TWICE", (char*)"TRIGGER_NOTIFY_TWICE", (void (*) _((TPSVCINFO *))) TRIGGER_NOTIFY_TWICE, 16, 0 },
-	{ (char*)"VERY_SLOW_SVC", (char*)"VERY_SLOW_SVC", (void (*) _((TPSVCINFO *))) VERY_SLOW_SVC, 17, 0 },
+	{ (char*)"REQUEST_LENGTH", (char*)"REQUEST_LENGTH", (void (*) _((TPSVCINFO *))) REQUEST_LENGTH, 9, 0 },
+	{ (char*)"REVEAL_SECRET", (char*)"REVEAL_SECRET", (void (*) _((TPSVCINFO *))) REVEAL_SECRET, 10, 0 },
+	{ (char*)"REVERSE", (char*)"REVERSE", (void (*) _((TPSVCINFO *))) REVERSE, 11, 0 },
+	{ (char*)"", (char*)"SECRET_SVC", (void (*) _((TPSVCINFO *))) SECRET_SVC, 12, 0 },
+	{ (char*)"SLOW_TOUPPER", (char*)"SLOW_TOUPPER", (void (*) _((TPSVCINFO *))) SLOW_TOUPPER, 13, 0 },
+	{ (char*)"TOUPPER", (char*)"TOUPPER", (void (*) _((TPSVCINFO *))) TOUPPER, 14, 0 },
+	{ (char*)"TRIGGER_BROADCAST", (char*)"TRIGGER_BROADCAST", (void (*) _((TPSVCINFO *))) TRIGGER_BROADCAST, 15, 0 },
+	{ (char*)"TRIGGER_NOTIFY", (char*)"TRIGGER_NOTIFY", (void (*) _((TPSVCINFO *))) TRIGGER_NOTIFY, 16, 0 },
+	{ (char*)"TRIGGER_NOTIFY_TWICE", (char*)"TRIGGER_NOTIFY_TWICE", (void (*) _((TPSVCINFO *))) TRIGGER_NOTIFY_TWICE, 17, 0 },
+	{ (char*)"VERY_SLOW_SVC", (char*)"VERY_SLOW_SVC", (void (*) _((TPSVCINFO *))) VERY_SLOW_SVC, 18, 0 },
 	{ NULL, NULL, NULL, 0, 0 }
 };
 
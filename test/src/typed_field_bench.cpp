@@ -0,0 +1,98 @@
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "doctest.h"
+#include "bench.hpp"
+#include "tux/fml32.hpp"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("typed_field");
+
+namespace
+{
+    const int field_count = 50;
+    const FLDID32 first_number = 5000;
+    
+    // even fields are longs, odd fields are strings
+    template <int N> struct bench_field
+    {
+        typedef typename conditional<N % 2 == 0, long, string>::type value_type;
+        typedef fml32::field<(static_cast<FLDID32>(N % 2 == 0 ? FLD_LONG : FLD_STRING) << 25) | (first_number + N), value_type> type;
+    };
+    
+    long value(long*, int n) { return n; }
+    const char* value(string*, int) { return "some string value"; }
+    size_t weight(long x) { return x; }
+    size_t weight(string const& x) { return x.size(); }
+    
+    template <int N> struct typed_loop
+    {
+        static void set(fml32& f)
+        {
+            typedef typename bench_field<N - 1>::type field;
+            f.set(field(), value(static_cast<typename field::value_type*>(nullptr), N));
+            typed_loop<N - 1>::set(f);
+        }
+        static size_t get(fml32 const& f)
+        {
+            typedef typename bench_field<N - 1>::type field;
+            return weight(f.get(field())) + typed_loop<N - 1>::get(f);
+        }
+    };
+    template <> struct typed_loop<0>
+    {
+        static void set(fml32&) {}
+        static size_t get(fml32 const&) { return 0; }
+    };
+}
+
+TEST_CASE("typed_field bench 50 field get/set")
+{
+    const long n = 20000;
+    vector<FLDID32> ids;
+    for(int i = 0; i < field_count; ++i)
+    {
+        ids.push_back(fml32::field_id(i % 2 == 0 ? FLD_LONG : FLD_STRING, first_number + i));
+    }
+    fml32 f;
+    f.reserve(field_count, field_count * 32);
+    
+    double untyped_set = bench::measure("50 fields set (untyped)", n, [&]
+    {
+        for(int i = 0; i < field_count; ++i)
+        {
+            if(i % 2 == 0)
+            {
+                f.set(ids[i], static_cast<long>(i));
+            }
+            else
+            {
+                f.set(ids[i], string("some string value"));
+            }
+        }
+    });
+    double typed_set = bench::measure("50 fields set (typed)", n, [&]
+    {
+        typed_loop<field_count>::set(f);
+    });
+    printf("  speedup %.2fx\n", untyped_set / typed_set);
+    
+    double untyped_get = bench::measure("50 fields get (untyped)", n, [&]
+    {
+        size_t total = 0;
+        for(int i = 0; i < field_count; ++i)
+        {
+            total += i % 2 == 0 ? weight(f.get_long(ids[i])) : weight(f.get_string(ids[i]));
+        }
+        bench::keep(total);
+    });
+    double typed_get = bench::measure("50 fields get (typed)", n, [&]
+    {
+        bench::keep(typed_loop<field_count>::get(f));
+    });
+    printf("  speedup %.2fx\n", untyped_get / typed_get);
+    
+    CHECK(f.field_count() == field_count);
+}
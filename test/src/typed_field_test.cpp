@@ -0,0 +1,113 @@
+#include "doctest.h"
+#include "typed_fields32.hpp" // 32 must come before 16
+#include "typed_fields16.hpp"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("typed_field");
+
+// descriptors are checked against the FLD_ type encoded in the id
+static_assert(fml32_value_traits<long>::accepts(FLD_LONG), "");
+static_assert(!fml32_value_traits<long>::accepts(FLD_STRING), "");
+static_assert(fml32_value_traits<std::string>::accepts(FLD_CARRAY), "");
+static_assert(!fml32_value_traits<int>::accepts(FLD_LONG), "");
+static_assert(fml16_value_traits<double>::accepts(FLD_DOUBLE), "");
+static_assert(std::is_same<std::remove_const<decltype(field32::A_LONG_FIELD)>::type::value_type, long>::value, "");
+
+TEST_CASE("typed_field fml32 get/set")
+{
+    using namespace field32;
+    fml32 f;
+    f.set(A_SHORT_FIELD, 3);
+    f.set(A_LONG_FIELD, 42);
+    f.set(A_CHAR_FIELD, 'x');
+    f.set(A_FLOAT_FIELD, 1.5f);
+    f.set(A_DOUBLE_FIELD, 2.25);
+    f.set(A_STRING_FIELD, "hello");
+    f.set(A_CARRAY_FIELD, string("a\0b", 3));
+    
+    CHECK(f.get(A_SHORT_FIELD) == 3);
+    CHECK(f.get(A_LONG_FIELD) == 42L);
+    CHECK(f.get(A_CHAR_FIELD) == 'x');
+    CHECK(f.get(A_FLOAT_FIELD) == 1.5f);
+    CHECK(f.get(A_DOUBLE_FIELD) == 2.25);
+    CHECK(f.get(A_STRING_FIELD) == "hello");
+    CHECK(f.get(A_CARRAY_FIELD) == string("a\0b", 3));
+    
+    // interoperates with the untyped api
+    CHECK(f.get_long(A_LONG_FIELD) == 42L);
+    CHECK(f.get_string(A_STRING_FIELD) == "hello");
+    CHECK(f.get_string(A_CARRAY_FIELD) == string("a\0b", 3));
+    CHECK(f.has(A_LONG_FIELD));
+    CHECK(f.count(A_STRING_FIELD) == 1);
+    
+    // overwrite
+    f.set(A_STRING_FIELD, string("goodbye"));
+    CHECK(f.get(A_STRING_FIELD) == "goodbye");
+}
+
+TEST_CASE("typed_field fml32 add/occurrences")
+{
+    using namespace field32;
+    fml32 f;
+    for(long i = 0; i < 100; ++i)
+    {
+        f.add(A_LONG_FIELD, i);
+    }
+    f.add(A_STRING_FIELD, "one");
+    f.add(A_STRING_FIELD, string("two"));
+    CHECK(f.count(A_LONG_FIELD) == 100);
+    CHECK(f.get(A_LONG_FIELD, 99) == 99L);
+    CHECK(f.get(A_STRING_FIELD, 1) == "two");
+    
+    f.set(A_LONG_FIELD, -1, 50);
+    CHECK(f.get(A_LONG_FIELD, 50) == -1L);
+}
+
+TEST_CASE("typed_field fml32 nested")
+{
+    using namespace field32;
+    fml32 inner;
+    inner.set(A_LONG_FIELD, 7);
+    fml32 outer;
+    outer.set(AN_FML32_FIELD, inner);
+    outer.add(AN_FML32_FIELD, inner);
+    CHECK(outer.count(AN_FML32_FIELD) == 2);
+    fml32 x = outer.get(AN_FML32_FIELD, 1);
+    CHECK(x.get(A_LONG_FIELD) == 7L);
+}
+
+TEST_CASE("typed_field fml32 errors")
+{
+    using namespace field32;
+    fml32 f;
+    f.set(A_LONG_FIELD, 1);
+    CHECK_THROWS(f.get(A_LONG_FIELD, 1));
+    CHECK_THROWS(f.get(A_STRING_FIELD));
+}
+
+TEST_CASE("typed_field fml16 get/set")
+{
+    using namespace field16;
+    fml16 f;
+    f.set(A_SHORT_FIELD, 3);
+    f.set(A_LONG_FIELD, 42);
+    f.add(A_LONG_FIELD, 43);
+    f.set(A_CHAR_FIELD, 'x');
+    f.set(A_FLOAT_FIELD, 1.5f);
+    f.set(A_DOUBLE_FIELD, 2.25);
+    f.set(A_STRING_FIELD, "hello");
+    f.set(A_CARRAY_FIELD, string("a\0b", 3));
+    
+    CHECK(f.get(A_SHORT_FIELD) == 3);
+    CHECK(f.get(A_LONG_FIELD) == 42L);
+    CHECK(f.get(A_LONG_FIELD, 1) == 43L);
+    CHECK(f.get(A_CHAR_FIELD) == 'x');
+    CHECK(f.get(A_FLOAT_FIELD) == 1.5f);
+    CHECK(f.get(A_DOUBLE_FIELD) == 2.25);
+    CHECK(f.get(A_STRING_FIELD) == "hello");
+    CHECK(f.get(A_CARRAY_FIELD) == string("a\0b", 3));
+    CHECK(f.get_long(A_LONG_FIELD) == 42L);
+    CHECK_THROWS(f.get(A_LONG_FIELD, 2));
+}
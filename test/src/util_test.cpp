@@ -112,6 +112,35 @@ TEST_CASE("util compare")
     }
 }
 
+TEST_CASE("util string_ref")
+{
+    string_ref empty;
+    CHECK(empty.empty());
+    CHECK(empty.str() == "");
+    CHECK(string_ref(nullptr).empty());
+    
+    string s = "hello world";
+    string_ref r(s);
+    CHECK(r.size() == 11);
+    CHECK(r.data() == s.data());
+    CHECK(r == "hello world");
+    CHECK(r != "hello");
+    CHECK(r.substr(6) == "world");
+    CHECK(r.substr(0, 5) == string_ref("hello, there", 5));
+    CHECK_THROWS(r.substr(12));
+    CHECK(r.find('o') == 4);
+    CHECK(r.find('o', 5) == 7);
+    CHECK(r.find('z') == string_ref::npos);
+    CHECK(string(r.begin(), r.end()) == s);
+    CHECK(static_cast<string>(r) == s);
+    
+    CHECK(string_ref("abc") < string_ref("abd"));
+    CHECK(string_ref("ab") < string_ref("abc"));
+    CHECK(string_ref("b") > string_ref("abc"));
+    CHECK(string_ref("abc").compare("abc") == 0);
+    CHECK(string_ref("a\0b", 3) != string_ref("a\0c", 3));
+}
+
 TEST_CASE("util cstr_to_string")
 {
     CHECK(cstr_to_string("hello world") == string{"hello world"});
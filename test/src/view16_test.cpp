@@ -16,6 +16,24 @@ TEST_CASE("view16 size by name")
     CHECK(view_size16(string("string_info")) == sizeof(string_info));
 }
 
+TEST_CASE("view16 size by type")
+{
+    CHECK(view_size16<my_struct>() == sizeof(my_struct));
+    CHECK(view_size16<string_info>() == sizeof(string_info));
+    CHECK(view_size16<my_struct>() == sizeof(my_struct)); // cached
+    refresh_view16_definitions();
+    CHECK(view_size16<my_struct>() == sizeof(my_struct)); // looked up again
+    
+    // stands in for a size looked up before the definitions changed
+    view_detail::view_size16_cache<my_struct>().store(view_detail::pack_view_size16(view16_definitions_epoch(), 1));
+    CHECK(view_size16<my_struct>() == 1);
+    refresh_view16_definitions();
+    CHECK(view_size16<my_struct>() == sizeof(my_struct));
+    view<my_struct> v;
+    v.alloc();
+    CHECK(v.buffer().size() >= static_cast<long>(sizeof(my_struct)));
+}
+
 // refresh definitions
 // ... kind of tough to test ... would have to run system commands?
 // (edit file, recompile ...)
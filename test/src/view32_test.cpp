@@ -1,3 +1,4 @@
+#include <vector>
 #include "doctest.h"
 #include "tux/view32.hpp"
 #include "tux/util.hpp"
@@ -16,6 +17,24 @@ TEST_CASE("view32 size by name")
     CHECK(view_size32(string("string_info")) == sizeof(string_info));
 }
 
+TEST_CASE("view32 size by type")
+{
+    CHECK(view_size32<my_struct>() == sizeof(my_struct));
+    CHECK(view_size32<string_info>() == sizeof(string_info));
+    CHECK(view_size32<my_struct>() == sizeof(my_struct)); // cached
+    refresh_view32_definitions();
+    CHECK(view_size32<my_struct>() == sizeof(my_struct)); // looked up again
+    
+    // stands in for a size looked up before the definitions changed
+    view_detail::view_size32_cache<my_struct>().store(view_detail::pack_view_size32(view32_definitions_epoch(), 1));
+    CHECK(view_size32<my_struct>() == 1);
+    refresh_view32_definitions();
+    CHECK(view_size32<my_struct>() == sizeof(my_struct));
+    view<my_struct> v;
+    v.alloc();
+    CHECK(v.buffer().size() >= static_cast<long>(sizeof(my_struct)));
+}
+
 // refresh definitions
 // ... kind of tough to test ... would have to run system commands?
 // (edit file, recompile ...)
@@ -320,5 +339,34 @@ TEST_CASE("view32 comparison")
     CHECK(v1 == v2);
 }
 
+TEST_CASE("view32::member_handle")
+{
+    // no generated view_traits here: the handle calls Fvnull32/Fvselinit32
+    view<my_struct>::member_handle l("l");
+    CHECK(l.name() == "l");
+    CHECK_THROWS(view<my_struct>::member_handle{"no_such_member"});
+
+    vector<my_struct> rows(100, make_default<my_struct>());
+    for(size_t i = 0; i < rows.size(); ++i)
+    {
+        rows[i].l = i % 3 == 0 ? 0 : static_cast<long>(i);
+    }
+    CHECK(l.count_nulls(rows.data(), rows.size()) == 34);
+    CHECK(l.is_null(rows[3]));
+    CHECK_FALSE(l.is_null(rows[4]));
+
+    auto nulls = l.null_bitmap(rows.data(), rows.size());
+    REQUIRE(nulls.size() == 2);
+    CHECK((nulls[0] & 0xf) == 0x9); // rows 0 and 3
+    CHECK(((nulls[1] >> (99 - 64)) & 1) == 1);
+
+    // clear the non-null ones
+    for(auto& word : nulls)
+    {
+        word = ~word;
+    }
+    l.clear(rows.data(), rows.size(), nulls.data());
+    CHECK(l.count_nulls(rows.data(), rows.size()) == 100);
+}
 
 TEST_SUITE_END(); 
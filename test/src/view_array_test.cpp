@@ -0,0 +1,136 @@
+#include <string>
+#include "doctest.h"
+#include "tux/carray.hpp"
+#include "tux/view_array.hpp"
+#include "tux/util.hpp"
+#include "fields32.h"
+#include "views32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("view_array");
+
+namespace
+{
+    my_struct row(long l)
+    {
+        auto x = make_default<my_struct>();
+        x.f = 1.5f;
+        x.d = static_cast<double>(l) / 4;
+        x.l = l;
+        return x;
+    }
+}
+
+TEST_CASE("view_array default constructor")
+{
+    view_array<my_struct> rows;
+    CHECK((bool)rows == false);
+    CHECK(rows.empty());
+    CHECK(rows.size() == 0);
+    CHECK(rows.capacity() == 0);
+    CHECK(rows.begin() == rows.end());
+}
+
+TEST_CASE("view_array push_back and emplace_back")
+{
+    view_array<my_struct> rows;
+    rows.reserve(10);
+    CHECK((bool)rows);
+    CHECK(rows.empty());
+    CHECK(rows.capacity() >= 10);
+
+    for(long i = 0; i < 1000; ++i) // grows past the reservation
+    {
+        rows.push_back(row(i));
+    }
+    my_struct& last = rows.emplace_back();
+    CHECK(last.l == 0);
+    last.l = 1000;
+
+    REQUIRE(rows.size() == 1001);
+    CHECK(rows.buffer().data_size() == static_cast<long>(64 + 1001 * sizeof(my_struct)));
+    CHECK(rows[0].l == 0);
+    CHECK(rows[999].d == doctest::Approx(249.75));
+    long expected = 0;
+    for(auto const& r : rows)
+    {
+        CHECK(r.l == expected);
+        ++expected;
+    }
+    CHECK(expected == 1001);
+
+    auto copy = rows;
+    CHECK(copy.size() == 1001);
+    CHECK(copy[500].l == 500);
+    CHECK(copy.begin() != rows.begin());
+
+    rows.clear();
+    CHECK(rows.empty());
+    CHECK((bool)rows);
+    CHECK(rows.buffer().data_size() == 64);
+}
+
+TEST_CASE("view_array from buffer")
+{
+    view_array<my_struct> rows;
+    for(long i = 0; i < 3; ++i)
+    {
+        rows.push_back(row(i));
+    }
+    // what a receiver gets: a CARRAY of data_size bytes
+    auto exported = export_buffer(rows.buffer());
+    view_array<my_struct> received(import_buffer(exported));
+    REQUIRE(received.size() == 3);
+    CHECK(received[2].l == 2);
+    CHECK(received[1].d == doctest::Approx(0.25));
+
+    view_array<my_struct> moved(rows.move_buffer());
+    CHECK(moved.size() == 3);
+    CHECK((bool)rows == false);
+
+    // the header has to match the view and its size
+    CHECK_THROWS(view_array<string_info>{moved.move_buffer()});
+    CHECK_THROWS(view_array<my_struct>{carray("too short").move_buffer()});
+    CHECK_THROWS(view_array<my_struct>{buffer("FML32")});
+}
+
+TEST_CASE("view_array add_views/get_views")
+{
+    view_array<my_struct> rows;
+    for(long i = 0; i < 50; ++i)
+    {
+        rows.push_back(row(i));
+    }
+    fml32 f;
+    f.add(A_LONG_FIELD, 5L);
+    add_views(f, A_VIEW32_FIELD, rows);
+    REQUIRE(f.count(A_VIEW32_FIELD) == 50);
+    CHECK(f.get_view<my_struct>(A_VIEW32_FIELD, 49).l == 49);
+    CHECK(f.get_long(A_LONG_FIELD) == 5);
+
+    auto back = get_views<my_struct>(f, A_VIEW32_FIELD);
+    REQUIRE(back.size() == 50);
+    for(long i = 0; i < 50; ++i)
+    {
+        CHECK(back[static_cast<size_t>(i)].l == i);
+        CHECK(back[static_cast<size_t>(i)].d == doctest::Approx(static_cast<double>(i) / 4));
+    }
+
+    CHECK(get_views<my_struct>(fml32(), A_VIEW32_FIELD).empty());
+    CHECK_THROWS(get_views<string_info>(f, A_VIEW32_FIELD)); // types can't mismatch
+
+    // larger structs mustn't be copied into smaller rows
+    fml32 larger;
+    auto info = make_default<string_info>();
+    set(info.original_string, "longer than a my_struct");
+    for(int i = 0; i < 3; ++i)
+    {
+        larger.add_view(A_VIEW32_FIELD, info);
+    }
+    CHECK_THROWS(get_views<my_struct>(larger, A_VIEW32_FIELD));
+    larger.set_view(A_VIEW32_FIELD, row(1), 0);
+    CHECK_THROWS(get_views<my_struct>(larger, A_VIEW32_FIELD)); // only the first matches
+    CHECK_THROWS(get_views<my_struct>(f, A_LONG_FIELD));
+}
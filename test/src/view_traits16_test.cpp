@@ -0,0 +1,65 @@
+#include <cstring>
+#include "doctest.h"
+#include "tux/convert.hpp"
+#include "views16.hpp"
+#include "fields16.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("view_traits16");
+
+namespace
+{
+    typedef view_traits<long_strings, fml16> long_traits;
+
+    // three strings of length characters, a carray of length bytes and a long
+    long_strings some_strings(size_t length)
+    {
+        long_strings x;
+        memset(&x, 0, sizeof(x));
+        x.C_text = 3;
+        for(size_t i = 0; i < 3; ++i)
+        {
+            memset(x.text[i], static_cast<int>('a' + i), length);
+        }
+        x.L_blob = static_cast<unsigned short>(length);
+        memset(x.blob, 'b', length);
+        x.total = 42;
+        return x;
+    }
+}
+
+TEST_CASE("view_traits bytes_needed sizes struct->fml16 exactly")
+{
+    static_assert(long_traits::generated && long_traits::member_count == 3, "");
+
+    for(size_t length : {1, 10, 999})
+    {
+        auto x = some_strings(length);
+        long needed = long_traits::bytes_needed(x);
+        CHECK(needed == fml16::bytes_needed(5, static_cast<FLDLEN>(3 * (length + 1) + length + sizeof(long))));
+
+        // enough for Tuxedo's own conversion
+        fml16 exact;
+        exact.reserve(needed);
+        long size = exact.size();
+        REQUIRE(Fvstof(exact.as_fbfr(), reinterpret_cast<char*>(&x), FUPDATE, const_cast<char*>("long_strings")) != -1);
+        CHECK(exact.size() == size);
+
+        // which to_fml allocates once
+        fml16 generated;
+        long_traits::to_fml(x, generated);
+        CHECK(generated.size() == size);
+        CHECK(generated == exact);
+        CHECK(to_fml16(x) == exact);
+
+        auto back = to_struct<long_strings>(generated);
+        CHECK(back.C_text == 3);
+        CHECK(string(back.text[2]) == string(length, 'c'));
+        CHECK(back.L_blob == length);
+        CHECK(back.total == 42);
+    }
+    // short strings take what they hold, not what they're declared as
+    CHECK(long_traits::bytes_needed(some_strings(10)) < static_cast<long>(sizeof(long_strings)) / 4);
+}
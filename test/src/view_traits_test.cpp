@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "doctest.h"
+#include "tux/convert.hpp"
+#include "tux/view32.hpp"
+#include "views32.hpp"
+#include "fields32.h"
+
+using namespace std;
+using namespace tux;
+
+TEST_SUITE("view_traits");
+
+namespace
+{
+    typedef view_traits<mixed_struct, fml32> traits;
+
+    static_assert(!view_traits<int, fml32>::generated, "only generated views are described");
+    static_assert(traits::generated && traits::member_count == 9, "");
+    static_assert(traits::members[2].count == 3 && traits::members[2].count_offset == offsetof(mixed_struct, C_l), "");
+    static_assert(traits::members[6].length_offset == offsetof(mixed_struct, L_bytes), "");
+    static_assert(traits::members[8].direction == 'N', "");
+
+    typedef view_traits<long_strings, fml32> long_traits;
+
+    // three strings of length characters, a carray of length bytes and a long
+    long_strings some_strings(size_t length)
+    {
+        long_strings x;
+        memset(&x, 0, sizeof(x));
+        x.C_text = 3;
+        for(size_t i = 0; i < 3; ++i)
+        {
+            memset(x.text[i], static_cast<int>('a' + i), length);
+        }
+        x.L_blob = length;
+        memset(x.blob, 'b', length);
+        x.total = 42;
+        return x;
+    }
+
+    mixed_struct blank()
+    {
+        mixed_struct x;
+        memset(&x, 0, sizeof(x));
+        return x;
+    }
+
+    // all members null
+    mixed_struct nulls()
+    {
+        auto x = blank();
+        x.s = -1;
+        x.c = 'x';
+        strcpy(x.str[0], "none");
+        strcpy(x.str[1], "none");
+        x.C_str = 2;
+        x.C_l = 3;
+        return x;
+    }
+
+    fml32 tuxedo_to_fml(mixed_struct const& x, fml32 f, int mode)
+    {
+        if(!f)
+        {
+            f.reserve(100, 1024);
+        }
+        int rc = Fvstof32(f.as_fbfr(), reinterpret_cast<char*>(const_cast<mixed_struct*>(&x)),
+                          mode, const_cast<char*>("mixed_struct"));
+        REQUIRE(rc != -1);
+        return f;
+    }
+
+    mixed_struct tuxedo_to_struct(fml32 const& f)
+    {
+        auto x = blank();
+        int rc = Fvftos32(const_cast<FBFR32*>(f.as_fbfr()), reinterpret_cast<char*>(&x),
+                          const_cast<char*>("mixed_struct"));
+        REQUIRE(rc != -1);
+        return x;
+    }
+
+    mixed_struct generated_to_struct(fml32 const& f)
+    {
+        auto x = blank();
+        traits::to_struct(f, x);
+        return x;
+    }
+
+    void check_same(mixed_struct const& a, mixed_struct const& b)
+    {
+        CHECK(a.s == b.s);
+        CHECK(a.i == b.i);
+        CHECK(a.C_l == b.C_l);
+        CHECK(equal(a.l, a.l + 3, b.l));
+        CHECK(a.c == b.c);
+        CHECK(equal(a.d, a.d + 2, b.d));
+        CHECK(a.C_str == b.C_str);
+        CHECK(string(a.str[0]) == string(b.str[0]));
+        CHECK(string(a.str[1]) == string(b.str[1]));
+        CHECK(a.L_bytes == b.L_bytes);
+        CHECK(string(a.bytes, sizeof(a.bytes)) == string(b.bytes, sizeof(b.bytes)));
+        CHECK(a.converted == b.converted);
+        CHECK(a.local == b.local);
+    }
+}
+
+TEST_CASE("view_traits struct->fml32 matches Fvstof32")
+{
+    vector<mixed_struct> cases;
+    cases.push_back(nulls());
+
+    auto x = nulls();
+    x.s = 7;
+    x.i = 123456;
+    x.l[0] = 1; x.l[1] = 2; x.l[2] = 3;
+    x.c = 'q';
+    x.d[0] = 1.5; x.d[1] = -2.25;
+    strcpy(x.str[0], "first");
+    strcpy(x.str[1], "second");
+    memcpy(x.bytes, "a\0b\0c", 5);
+    x.L_bytes = 5;
+    x.converted = 42;
+    x.local = 99;
+    cases.push_back(x);
+
+    // counts and lengths limit what's transferred; null elements are skipped
+    x.C_l = 1;
+    x.d[0] = 0;
+    x.C_str = 1;
+    x.L_bytes = 100;
+    memcpy(x.bytes, "12345678", 8);
+    cases.push_back(x);
+    x.C_str = 2;
+    strcpy(x.str[0], "none");
+    cases.push_back(x);
+
+    for(auto const& c : cases)
+    {
+        fml32 generated;
+        traits::to_fml(c, generated);
+        CHECK(generated == tuxedo_to_fml(c, fml32(), FUPDATE));
+        CHECK(to_fml32(c) == generated);
+    }
+
+    // modes other than updating an empty buffer combine the converted struct with dest
+    fml32 dest;
+    dest.add(A_SHORT_FIELD, static_cast<short>(1));
+    dest.add(BYTE_COUNT, 10L);
+    dest.add(BYTE_COUNT, 20L);
+    dest.add(A_FLOAT_FIELD, 3.5);
+    for(int mode : {FUPDATE, FJOIN, FOJOIN, FCONCAT})
+    {
+        fml32 generated = dest;
+        convert(x, generated, mode);
+        CHECK(generated == tuxedo_to_fml(x, dest, mode));
+    }
+}
+
+TEST_CASE("view_traits fml32->struct matches Fvftos32")
+{
+    vector<fml32> cases;
+    cases.push_back(fml32(10, 100)); // all nulls
+
+    fml32 f;
+    f.add(A_SHORT_FIELD, static_cast<short>(3));
+    f.add(A_LONG_FIELD, 70000L); // to an int
+    f.add(BYTE_COUNT, 1L);
+    f.add(BYTE_COUNT, 2L);
+    f.add(A_DOUBLE_FIELD, 0.5);
+    f.add(A_STRING_FIELD, "only one");
+    f.add(A_CARRAY_FIELD, string("ab\0cd", 5));
+    f.add(ORIGINAL_STRING, "1234"); // to a long
+    cases.push_back(f);
+
+    // more occurrences than elements, and a carray longer than its member
+    f.add(BYTE_COUNT, 3L);
+    f.add(BYTE_COUNT, 4L);
+    f.add(A_STRING_FIELD, "two");
+    f.add(A_STRING_FIELD, "three");
+    f.set(A_CARRAY_FIELD, string("0123456789ab"));
+    f.add(A_CHAR_FIELD, 'z');
+    cases.push_back(f);
+
+    for(auto const& c : cases)
+    {
+        check_same(generated_to_struct(c), tuxedo_to_struct(c));
+    }
+    auto x = to_struct<mixed_struct>(cases[1]);
+    CHECK(x.i == 70000);
+    CHECK(x.C_l == 2);
+    CHECK(x.converted == 1234);
+    CHECK(x.L_bytes == 5);
+    CHECK(string(x.str[1]) == "none");
+}
+
+TEST_CASE("view_traits bytes_needed sizes struct->fml32 exactly")
+{
+    CHECK(traits::bytes_needed(nulls()) == fml32::bytes_needed(0, 0));
+
+    for(size_t length : {1, 10, 999})
+    {
+        auto x = some_strings(length);
+        long needed = long_traits::bytes_needed(x);
+        CHECK(needed == fml32::bytes_needed(5, static_cast<FLDLEN32>(3 * (length + 1) + length + sizeof(long))));
+
+        // enough for Tuxedo's own conversion
+        fml32 exact;
+        exact.reserve(needed);
+        long size = exact.size();
+        REQUIRE(Fvstof32(exact.as_fbfr(), reinterpret_cast<char*>(&x), FUPDATE, const_cast<char*>("long_strings")) != -1);
+        CHECK(exact.size() == size);
+
+        // which to_fml allocates once
+        fml32 generated;
+        long_traits::to_fml(x, generated);
+        CHECK(generated.size() == size);
+        CHECK(generated == exact);
+        CHECK(to_fml32(x) == exact);
+
+        // appending to a buffer with room doesn't grow it
+        fml32 roomy(10, 10000);
+        roomy.add(A_SHORT_FIELD, static_cast<short>(1));
+        size = roomy.size();
+        convert(x, roomy, FCONCAT);
+        CHECK(roomy.size() == size);
+        CHECK(roomy.field_count() == 6);
+    }
+    // short strings take what they hold, not what they're declared as
+    CHECK(long_traits::bytes_needed(some_strings(10)) < static_cast<long>(sizeof(long_strings)) / 4);
+}
+
+TEST_CASE("view32::member_handle with view_traits matches Fvnull32")
+{
+    vector<mixed_struct> rows;
+    for(int i = 0; i < 200; ++i)
+    {
+        auto x = nulls();
+        if(i % 2) x.s = static_cast<short>(i);
+        if(i % 3) x.d[1] = i * 0.5;
+        if(i % 5) strcpy(x.str[1], "set");
+        if(i % 7) x.c = 'c';
+        if(i % 11) x.bytes[7] = 1;
+        rows.push_back(x);
+    }
+    char* view_name = const_cast<char*>("mixed_struct");
+    for(auto const& m : traits::members)
+    {
+        view32<mixed_struct>::member_handle h(m.name);
+        for(FLDOCC32 oc = 0; oc < static_cast<FLDOCC32>(m.count); ++oc)
+        {
+            size_t expected = 0;
+            auto bits = h.null_bitmap(rows.data(), rows.size(), oc);
+            for(size_t i = 0; i < rows.size(); ++i)
+            {
+                int rc = Fvnull32(reinterpret_cast<char*>(&rows[i]), const_cast<char*>(m.name), oc, view_name);
+                REQUIRE(rc != -1);
+                CHECK(h.is_null(rows[i], oc) == (rc == 1));
+                CHECK(((bits[i / 64] >> (i % 64)) & 1) == static_cast<uint64_t>(rc));
+                expected += static_cast<size_t>(rc);
+            }
+            CHECK(h.count_nulls(rows.data(), rows.size(), oc) == expected);
+        }
+        CHECK_THROWS(h.is_null(rows[0], static_cast<FLDOCC32>(m.count)));
+
+        // clearing leaves what Fvselinit32 does
+        auto cleared = rows;
+        h.clear(cleared.data(), cleared.size());
+        for(size_t i = 0; i < rows.size(); i += 17)
+        {
+            auto expected = rows[i];
+            REQUIRE(Fvselinit32(reinterpret_cast<char*>(&expected), const_cast<char*>(m.name), view_name) != -1);
+            CHECK(memcmp(&expected, &cleared[i], sizeof(mixed_struct)) == 0);
+        }
+    }
+}
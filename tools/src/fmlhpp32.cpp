@@ -23,6 +23,16 @@ map<string, int> field_types = { {"short",    FLD_SHORT},
                                 {"fml32",    FLD_FML32},
                                 {"view32",   FLD_VIEW32} };
 
+// C++ value types for typed descriptors (-t); other field types get plain ids
+map<string, string> cpp_types = { {"short",  "short"},
+                                {"long",   "long"},
+                                {"char",   "char"},
+                                {"float",  "float"},
+                                {"double", "double"},
+                                {"string", "std::string"},
+                                {"carray", "std::string"},
+                                {"fml32",  "tux::fml32"} };
+
 struct field_def
 {
     string name;
@@ -93,18 +103,32 @@ size_t get_max_name_size(vector<field_def> const& fields)
     return result;
 }
 
-void write_output(ostream& os, vector<field_def> const& fields)
+void write_output(ostream& os, vector<field_def> const& fields, bool typed)
 {
     size_t name_width = get_max_name_size(fields);
     os << R"(
 #include "fml32.h"
-namespace field32 {
 )";
+    if(typed)
+    {
+        os << "#include \"tux/fml32.hpp\"\n";
+    }
+    os << "namespace field32 {\n";
     for(auto&& f : fields)
     {
-        os << "const FLDID32 " << setw(name_width) << left << f.name
-           << " = " << setw(12) << f.id << "; // number: "
-           << setw(12) <<  f.number << " type: " << f.type_str << "\n"; 
+        auto cpp_type = cpp_types.find(f.type_str);
+        if(typed && cpp_type != cpp_types.end())
+        {
+            os << "constexpr tux::fml32::field<" << f.id << ", " << cpp_type->second << "> "
+               << setw(name_width) << left << f.name
+               << " {}; // number: " << setw(12) << f.number << " type: " << f.type_str << "\n";
+        }
+        else
+        {
+            os << "const FLDID32 " << setw(name_width) << left << f.name
+               << " = " << setw(12) << f.id << "; // number: "
+               << setw(12) <<  f.number << " type: " << f.type_str << "\n";
+        }
     }
     os << "} // end namespace" << endl;
 }
@@ -117,12 +141,14 @@ int main(int argc, char** argv)
     {
         
         string program_name = argv[0];
-        if(argc < 3)
+        bool typed = argc > 1 && string(argv[1]) == "-t";
+        int first_file_arg = typed ? 2 : 1;
+        if(argc < first_file_arg + 2)
         {
-            throw runtime_error("Usage: " + program_name + " INPUT_FILE OUTPUT_FILE");
+            throw runtime_error("Usage: " + program_name + " [-t] INPUT_FILE OUTPUT_FILE");
         }
-        string input_file_name = argv[1];
-        string output_file_name = argv[2];
+        string input_file_name = argv[first_file_arg];
+        string output_file_name = argv[first_file_arg + 1];
         ifstream is(input_file_name);
         if(!is)
         {
@@ -134,7 +160,7 @@ int main(int argc, char** argv)
             throw runtime_error("error opening " + output_file_name + " for write");
         }
         
-        write_output(os, read_input(is));
+        write_output(os, read_input(is), typed);
    
         return 0;
     }
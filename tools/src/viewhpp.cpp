@@ -0,0 +1,683 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <algorithm>
+// for the FLD_ type constants, which fml.h shares
+#include "fml32.h"
+#include "viewhpp.hpp"
+
+using namespace std;
+
+namespace
+{
+
+struct member_type
+{
+    int type;
+    string constant; // the FLD_ macro
+    string c_type; // of one element (string and carray members are char arrays)
+};
+
+map<string, member_type> member_types = { {"short",  {FLD_SHORT,  "FLD_SHORT",  "short"}},
+                                          {"int",    {FLD_INT,    "FLD_INT",    "int"}},
+                                          {"long",   {FLD_LONG,   "FLD_LONG",   "long"}},
+                                          {"char",   {FLD_CHAR,   "FLD_CHAR",   "char"}},
+                                          {"float",  {FLD_FLOAT,  "FLD_FLOAT",  "float"}},
+                                          {"double", {FLD_DOUBLE, "FLD_DOUBLE", "double"}},
+                                          {"string", {FLD_STRING, "FLD_STRING", "char"}},
+                                          {"carray", {FLD_CARRAY, "FLD_CARRAY", "char"}} };
+
+// valid in views, but converted by Tuxedo only
+vector<string> unsupported_types = {"dec_t", "mbstring"};
+
+struct member_def
+{
+    string type_str;
+    member_type type;
+    string name;
+    string field_name;
+    long id = BADFLDID;
+    int field_type = 0; // of the mapped field
+    size_t count = 1;
+    size_t size = 0; // of strings and carrays
+    bool count_member = false; // C flag
+    bool length_member = false; // L flag
+    char direction = 'B';
+    string null_text; // as written
+    bool has_null = true;
+    string null_value; // a numeric literal, or the bytes of a char, string or carray
+};
+
+struct view_def
+{
+    string name;
+    vector<member_def> members;
+    string unsupported; // why no specialization is generated
+};
+
+bool starts_with(string const& source, string const& pattern)
+{
+    if(source.size() < pattern.size())
+    {
+        return false;
+    }
+    return memcmp(source.data(), pattern.data(), pattern.size()) == 0;
+}
+
+string trim(string const& s)
+{
+    size_t first = s.find_first_not_of(" \t\r");
+    if(first == string::npos)
+    {
+        return "";
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// decodes a quoted null value, with C escapes
+string unquote(string const& text)
+{
+    string result;
+    for(size_t i = 1; i + 1 < text.size(); ++i)
+    {
+        char c = text[i];
+        if(c != '\\' || i + 2 >= text.size())
+        {
+            result += c;
+            continue;
+        }
+        c = text[++i];
+        switch(c)
+        {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case 'f': result += '\f'; break;
+            case 'b': result += '\b'; break;
+            case 'v': result += '\v'; break;
+            case 'x':
+            {
+                size_t end = i + 1;
+                while(end < text.size() - 1 && end < i + 3 && isxdigit(static_cast<unsigned char>(text[end])))
+                {
+                    ++end;
+                }
+                result += static_cast<char>(strtol(text.substr(i + 1, end - i - 1).c_str(), nullptr, 16));
+                i = end - 1;
+                break;
+            }
+            default:
+                if(c >= '0' && c <= '7')
+                {
+                    size_t end = i;
+                    while(end < text.size() - 1 && end < i + 3 && text[end] >= '0' && text[end] <= '7')
+                    {
+                        ++end;
+                    }
+                    result += static_cast<char>(strtol(text.substr(i, end - i).c_str(), nullptr, 8));
+                    i = end - 1;
+                }
+                else
+                {
+                    result += c; // \\, \', \" and the rest
+                }
+        }
+    }
+    return result;
+}
+
+void parse_null(member_def& m, string const& where)
+{
+    string const& text = m.null_text;
+    bool numeric = m.type.type != FLD_CHAR && m.type.type != FLD_STRING && m.type.type != FLD_CARRAY;
+    bool quoted = text.size() >= 2 && (text[0] == '"' || text[0] == '\'') && text.back() == text[0];
+    if(text.empty() || text == "-")
+    {
+        m.null_value = numeric ? "0" : m.type.type == FLD_CHAR ? string(1, '\0') : "";
+    }
+    else if(text == "NONE")
+    {
+        m.has_null = false;
+        m.null_value = numeric ? "0" : m.type.type == FLD_CHAR ? string(1, '\0') : "";
+    }
+    else if(numeric)
+    {
+        char* end = nullptr;
+        strtod(text.c_str(), &end);
+        if(*end != '\0')
+        {
+            throw runtime_error(where + ": invalid null value " + text);
+        }
+        m.null_value = text;
+    }
+    else
+    {
+        m.null_value = quoted ? unquote(text) : text;
+        if(m.type.type == FLD_CHAR)
+        {
+            m.null_value.resize(1, '\0');
+        }
+    }
+}
+
+member_def parse_member(string const& line, string const& view, fml_flavor const& fml)
+{
+    member_def m;
+    string count, flags, size;
+    istringstream s(line);
+    s >> m.type_str >> m.name >> m.field_name >> count >> flags >> size;
+    getline(s, m.null_text);
+    m.null_text = trim(m.null_text);
+    string where = view + "." + m.name;
+    if(size.empty())
+    {
+        throw runtime_error("incomplete member: " + line);
+    }
+    auto type = member_types.find(m.type_str);
+    if(type == member_types.end())
+    {
+        throw runtime_error(where + ": unknown type " + m.type_str);
+    }
+    m.type = type->second;
+    m.count = static_cast<size_t>(atol(count.c_str()));
+    if(m.count == 0)
+    {
+        throw runtime_error(where + ": invalid count " + count);
+    }
+    if(m.type.type == FLD_STRING || m.type.type == FLD_CARRAY)
+    {
+        m.size = static_cast<size_t>(atol(size.c_str()));
+        if(m.size == 0)
+        {
+            throw runtime_error(where + ": invalid size " + size);
+        }
+    }
+    for(char c : flags == "-" ? string() : flags)
+    {
+        switch(c)
+        {
+            case 'C': m.count_member = true; break;
+            case 'L': m.length_member = true; break;
+            case 'F':
+            case 'S':
+            case 'N': m.direction = c; break;
+            default:
+                throw runtime_error(where + ": unknown flag " + string(1, c));
+        }
+    }
+    if(m.length_member && m.type.type != FLD_STRING && m.type.type != FLD_CARRAY)
+    {
+        throw runtime_error(where + ": the L flag applies to strings and carrays only");
+    }
+    if(m.field_name == "-")
+    {
+        m.direction = 'N';
+    }
+    if(m.direction != 'N')
+    {
+        m.id = fml.field_id(m.field_name.c_str());
+        if(m.id == BADFLDID)
+        {
+            throw runtime_error(where + ": unknown field " + m.field_name + " [" + fml.error() + "]");
+        }
+        m.field_type = fml.field_type(m.id);
+    }
+    parse_null(m, where);
+    return m;
+}
+
+vector<view_def> read_input(istream& is, fml_flavor const& fml)
+{
+    vector<view_def> result;
+    string line;
+    bool in_view = false;
+    while(getline(is, line))
+    {
+        line = trim(line);
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        else if(starts_with(line, "VIEW") && !in_view)
+        {
+            view_def v;
+            v.name = trim(line.substr(4));
+            if(v.name.empty())
+            {
+                throw runtime_error("VIEW without a name");
+            }
+            result.push_back(v);
+            in_view = true;
+        }
+        else if(line == "END" && in_view)
+        {
+            in_view = false;
+        }
+        else if(in_view)
+        {
+            view_def& v = result.back();
+            string type_str, name, field_name, count, flags;
+            istringstream s(line);
+            s >> type_str >> name >> field_name >> count >> flags;
+            if(find(unsupported_types.begin(), unsupported_types.end(), type_str) != unsupported_types.end())
+            {
+                v.unsupported = name + " is a " + type_str;
+            }
+            else if(flags.find('P') != string::npos)
+            {
+                v.unsupported = name + " has the P flag";
+            }
+            else
+            {
+                v.members.push_back(parse_member(line, v.name, fml));
+            }
+        }
+        else
+        {
+            throw runtime_error("unexpected line: " + line);
+        }
+    }
+    if(in_view)
+    {
+        throw runtime_error("missing END for VIEW " + result.back().name);
+    }
+    return result;
+}
+
+// a C++ string literal for arbitrary bytes
+string literal(string const& bytes)
+{
+    ostringstream os;
+    os << '"';
+    for(unsigned char c : bytes)
+    {
+        if(c == '"' || c == '\\')
+        {
+            os << '\\' << c;
+        }
+        else if(c >= ' ' && c < 0x7f)
+        {
+            os << c;
+        }
+        else
+        {
+            char octal[5];
+            snprintf(octal, sizeof(octal), "\\%03o", c);
+            os << octal;
+        }
+    }
+    os << '"';
+    return os.str();
+}
+
+string null_expression(member_def const& m)
+{
+    if(m.type.type == FLD_CHAR)
+    {
+        return "static_cast<char>(" + to_string(static_cast<int>(m.null_value[0])) + ")";
+    }
+    return "static_cast<" + m.type.c_type + ">(" + m.null_value + ")";
+}
+
+bool is_char_array(member_def const& m)
+{
+    return m.type.type == FLD_STRING || m.type.type == FLD_CARRAY;
+}
+
+string element_size(member_def const& m)
+{
+    return is_char_array(m) ? to_string(m.size) : "sizeof(" + m.type.c_type + ")";
+}
+
+void write_member_entry(ostream& os, view_def const& v, member_def const& m, bool last)
+{
+    os << "        {\"" << m.name << "\", \"" << m.field_name << "\", " << static_cast<long>(m.id) << "L, "
+       << m.type.constant << ", offsetof(" << v.name << ", " << m.name << "), "
+       << element_size(m) << ", " << m.count << ", ";
+    if(m.count_member)
+    {
+        os << "static_cast<std::ptrdiff_t>(offsetof(" << v.name << ", C_" << m.name << ")), ";
+    }
+    else
+    {
+        os << "-1, ";
+    }
+    if(m.length_member)
+    {
+        os << "static_cast<std::ptrdiff_t>(offsetof(" << v.name << ", L_" << m.name << ")), ";
+    }
+    else
+    {
+        os << "-1, ";
+    }
+    os << "'" << m.direction << "', " << literal(m.null_text.empty() ? "-" : m.null_text) << "}"
+       << (last ? "" : ",") << "\n";
+}
+
+// the bytes one element of m takes as a field value, once converted to the field's type
+string value_size(member_def const& m, string const& element)
+{
+    string terminator = m.field_type == FLD_STRING ? " + 1" : "";
+    switch(m.field_type)
+    {
+        case FLD_SHORT: return "sizeof(short)";
+        case FLD_LONG: return "sizeof(long)";
+        case FLD_CHAR: return "sizeof(char)";
+        case FLD_FLOAT: return "sizeof(float)";
+        case FLD_DOUBLE: return "sizeof(double)";
+        case FLD_STRING:
+        case FLD_CARRAY:
+            if(m.type.type == FLD_STRING)
+            {
+                return "view_detail::string_length(" + element + ", " + to_string(m.size) + ")" + terminator;
+            }
+            else if(m.type.type == FLD_CARRAY)
+            {
+                return "length" + terminator;
+            }
+            break;
+    }
+    return "view_detail::converted_length";
+}
+
+// the statements converting member m to the fielded buffer or, when sizing,
+// counting the fields and value bytes that conversion adds
+void write_to_fml(ostream& os, member_def const& m, bool sizing, fml_flavor const& fml)
+{
+    bool loop = m.count > 1 || m.count_member;
+    bool block = loop || m.type.type == FLD_CARRAY; // for locals
+    string indent = block ? "            " : "        ";
+    string element = "x." + m.name + (m.count > 1 ? "[i]" : "");
+    string id = to_string(m.id);
+    // the generator knows the field's type, so the code needn't ask Fldtype at run time
+    string add = m.field_type == m.type.type ? "view_detail::add(f, " : "view_detail::add_converted(f, ";
+    os << "        // " << m.name << "\n";
+    if(!loop && block)
+    {
+        os << "        {\n";
+    }
+    if(loop)
+    {
+        string limit = to_string(m.count);
+        if(m.count_member)
+        {
+            limit = "std::min<std::size_t>(static_cast<std::size_t>(x.C_" + m.name + "), " + limit + ")";
+        }
+        os << "        for(std::size_t i = 0, n = " << limit << "; i < n; ++i)\n"
+           << "        {\n";
+    }
+    string condition;
+    string call;
+    switch(m.type.type)
+    {
+        case FLD_STRING:
+            condition = "std::strncmp(" + element + ", " + literal(m.null_value) + ", " + to_string(m.size) + ") != 0";
+            call = add + id + ", " + element + ", " + to_string(m.size) + ", FLD_STRING);";
+            break;
+        case FLD_CARRAY:
+        {
+            string length = to_string(m.size);
+            if(m.length_member)
+            {
+                string length_member = "x.L_" + m.name + (m.count > 1 ? "[i]" : "");
+                length = "std::min<std::size_t>(static_cast<std::size_t>(" + length_member + "), " + length + ")";
+            }
+            os << indent << "std::size_t length = " << length << ";\n";
+            condition = "!view_detail::equals_padded(" + element + ", length, " + literal(m.null_value) + ", " +
+                        to_string(m.null_value.size()) + ")";
+            call = add + id + ", " + element + ", static_cast<" + fml.fldlen + ">(length), FLD_CARRAY);";
+            break;
+        }
+        default:
+            condition = element + " != " + null_expression(m);
+            call = add + id + ", reinterpret_cast<const char*>(&" + element + "), 0, " + m.type.constant + ");";
+    }
+    vector<string> statements;
+    if(sizing)
+    {
+        statements.push_back("++fields;");
+        statements.push_back("bytes += " + value_size(m, element) + ";");
+    }
+    else
+    {
+        statements.push_back(call);
+    }
+    if(m.has_null)
+    {
+        os << indent << "if(" << condition << ")\n"
+           << indent << "{\n";
+        for(auto&& statement : statements)
+        {
+            os << indent << "    " << statement << "\n";
+        }
+        os << indent << "}\n";
+    }
+    else
+    {
+        for(auto&& statement : statements)
+        {
+            os << indent << statement << "\n";
+        }
+    }
+    if(block)
+    {
+        os << "        }\n";
+    }
+}
+
+// the statements converting the fielded buffer to member m
+void write_to_struct(ostream& os, member_def const& m, fml_flavor const& fml)
+{
+    bool loop = m.count > 1 || m.count_member;
+    bool block = m.count_member || m.length_member; // for locals
+    string indent = string(loop ? 12 : 8, ' ') + (block ? "    " : "");
+    string element = "x." + m.name + (m.count > 1 ? "[i]" : "");
+    string occurrence = m.count > 1 ? "static_cast<" + string(fml.fldocc) + ">(i)" : "0";
+    string size = is_char_array(m) ? to_string(m.size) : "sizeof(" + element + ")";
+    string dest = is_char_array(m) ? element : "reinterpret_cast<char*>(&" + element + ")";
+    string get = string(m.field_type == m.type.type ? "view_detail::get(f, " : "view_detail::get_converted(f, ") + to_string(m.id) + ", " + occurrence + ", " + dest + ", " + size + ", " + m.type.constant + ")";
+    string set_null = is_char_array(m) ?
+                      "view_detail::set(" + element + ", " + to_string(m.size) + ", " + literal(m.null_value) + ", " +
+                      to_string(m.null_value.size()) + ", " + m.type.constant + ")" :
+                      element + " = " + null_expression(m);
+    os << "        // " << m.name << "\n";
+    if(block)
+    {
+        os << "        {\n";
+    }
+    if(m.count_member)
+    {
+        os << "            std::size_t found = 0;\n";
+    }
+    if(loop)
+    {
+        os << string(block ? 12 : 8, ' ') << "for(std::size_t i = 0; i < " << m.count << "; ++i)\n"
+           << string(block ? 12 : 8, ' ') << "{\n";
+    }
+    if(m.length_member)
+    {
+        string length_member = "x.L_" + m.name + (m.count > 1 ? "[i]" : "");
+        os << indent << "long length = " << get << ";\n"
+           << indent << "if(length == -1)\n"
+           << indent << "{\n"
+           << indent << "    length = " << set_null << ";\n"
+           << indent << "}\n";
+        if(m.count_member)
+        {
+            os << indent << "else\n"
+               << indent << "{\n"
+               << indent << "    ++found;\n"
+               << indent << "}\n";
+        }
+        os << indent << length_member << " = static_cast<typename std::remove_reference<decltype(" << length_member
+           << ")>::type>(length);\n";
+    }
+    else
+    {
+        os << indent << "if(" << get << " == -1)\n"
+           << indent << "{\n"
+           << indent << "    " << set_null << ";\n"
+           << indent << "}\n";
+        if(m.count_member)
+        {
+            os << indent << "else\n"
+               << indent << "{\n"
+               << indent << "    ++found;\n"
+               << indent << "}\n";
+        }
+    }
+    if(loop)
+    {
+        os << string(block ? 12 : 8, ' ') << "}\n";
+    }
+    if(m.count_member)
+    {
+        os << "            x.C_" << m.name << " = static_cast<decltype(x.C_" << m.name << ")>(found);\n";
+    }
+    if(block)
+    {
+        os << "        }\n";
+    }
+}
+
+void write_view(ostream& os, view_def const& v, string const& header, fml_flavor const& fml)
+{
+    os << "template <typename Unused>\n"
+       << "struct view_traits<" << v.name << ", " << fml.fml << ", Unused>\n"
+       << "{\n";
+    for(auto&& m : v.members)
+    {
+        os << "    static_assert(sizeof(" << v.name << "::" << m.name << ") == " << m.count << " * " << element_size(m)
+           << ", \"" << header << " doesn't match VIEW " << v.name << "\");\n";
+    }
+    os << "    static constexpr bool generated = true;\n"
+       << "    static constexpr std::size_t member_count = " << v.members.size() << ";\n"
+       << "    static constexpr view_member members[" << v.members.size() << "] = {\n";
+    for(size_t i = 0; i < v.members.size(); ++i)
+    {
+        write_member_entry(os, v, v.members[i], i + 1 == v.members.size());
+    }
+    os << "    };\n"
+       << "\n"
+       << "    static long bytes_needed(" << v.name << " const& x)\n"
+       << "    {\n"
+       << "        " << fml.fldocc << " fields = 0;\n"
+       << "        long bytes = 0;\n";
+    for(auto&& m : v.members)
+    {
+        if(m.direction == 'B' || m.direction == 'F')
+        {
+            write_to_fml(os, m, true, fml);
+        }
+    }
+    os << "        return " << fml.fml << "::bytes_needed(fields, static_cast<" << fml.fldlen << ">(bytes));\n"
+       << "    }\n"
+       << "\n"
+       << "    static void to_fml(" << v.name << " const& x, " << fml.fml << "& f)\n"
+       << "    {\n"
+       << "        view_detail::reserve(f, bytes_needed(x));\n";
+    for(auto&& m : v.members)
+    {
+        if(m.direction == 'B' || m.direction == 'F')
+        {
+            write_to_fml(os, m, false, fml);
+        }
+    }
+    os << "    }\n"
+       << "\n"
+       << "    static void to_struct(" << fml.fml << " const& f, " << v.name << "& x)\n"
+       << "    {\n";
+    for(auto&& m : v.members)
+    {
+        if(m.direction == 'B' || m.direction == 'S')
+        {
+            write_to_struct(os, m, fml);
+        }
+    }
+    os << "    }\n"
+       << "};\n"
+       << "\n"
+       << "template <typename Unused>\n"
+       << "constexpr view_member view_traits<" << v.name << ", " << fml.fml << ", Unused>::members[" << v.members.size() << "];\n"
+       << "\n";
+}
+
+void write_output(ostream& os, vector<view_def> const& views, string const& header, fml_flavor const& fml)
+{
+    os << "// generated by " << fml.program << ": view_traits for the views in " << header << "\n"
+       << "#pragma once\n"
+       << "#include <algorithm>\n"
+       << "#include <cstddef>\n"
+       << "#include <cstring>\n"
+       << "#include \"" << header << "\"\n"
+       << "#include \"tux/view_traits.hpp\"\n"
+       << "\n"
+       << "namespace tux {\n"
+       << "\n";
+    for(auto&& v : views)
+    {
+        if(!v.unsupported.empty())
+        {
+            cerr << "warning: VIEW " << v.name << " left to Tuxedo (" << v.unsupported << ")" << endl;
+            os << "// VIEW " << v.name << ": not generated (" << v.unsupported << ")\n\n";
+            continue;
+        }
+        write_view(os, v, header, fml);
+    }
+    os << "} // end namespace" << endl;
+}
+
+}
+
+int run_viewhpp(int argc, char** argv, fml_flavor const& fml)
+{
+    try
+    {
+
+        string program_name = argv[0];
+        string header;
+        int first_file_arg = 1;
+        if(argc > 2 && string(argv[1]) == "-i")
+        {
+            header = argv[2];
+            first_file_arg = 3;
+        }
+        if(argc < first_file_arg + 2)
+        {
+            throw runtime_error("Usage: " + program_name + " [-i VIEWC_HEADER] INPUT_FILE OUTPUT_FILE");
+        }
+        string input_file_name = argv[first_file_arg];
+        string output_file_name = argv[first_file_arg + 1];
+        if(header.empty())
+        {
+            // what viewc (or viewc32) names it
+            header = input_file_name.substr(input_file_name.find_last_of("/\\") + 1);
+            header = header.substr(0, header.find('.')) + ".h";
+        }
+        ifstream is(input_file_name);
+        if(!is)
+        {
+            throw runtime_error("error reading from " + input_file_name);
+        }
+        auto views = read_input(is, fml);
+        ofstream os(output_file_name);
+        if(!os)
+        {
+            throw runtime_error("error opening " + output_file_name + " for write");
+        }
+
+        write_output(os, views, header, fml);
+
+        return 0;
+    }
+    catch(exception const& e)
+    {
+        cerr << "error: " << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,17 @@
+// shared by viewhpp32 and viewhpp16, which differ only in the FML flavor they generate code for
+#pragma once
+
+struct fml_flavor
+{
+    const char* program; // for the generated header's comment
+    const char* fml; // the buffer class, fml32 or fml16
+    const char* fldlen; // FLDLEN32 or FLDLEN
+    const char* fldocc; // FLDOCC32 or FLDOCC
+    long (*field_id)(const char* name); // BADFLDID if there's no such field [Fldid32]
+    int (*field_type)(long id); // [Fldtype32]
+    const char* (*error)(); // the last FML error [Fstrerror32]
+};
+
+// reads the view descriptions and writes the view_traits specializations,
+// reporting errors to cerr; returns the exit status
+int run_viewhpp(int argc, char** argv, fml_flavor const& fml);
@@ -0,0 +1,25 @@
+#include "fml.h"
+#include "viewhpp.hpp"
+
+namespace
+{
+    long field_id(const char* name)
+    {
+        return static_cast<long>(Fldid(const_cast<char*>(name)));
+    }
+
+    int field_type(long id)
+    {
+        return Fldtype(static_cast<FLDID>(id));
+    }
+
+    const char* error()
+    {
+        return Fstrerror(Ferror);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    return run_viewhpp(argc, argv, {"viewhpp16", "fml16", "FLDLEN", "FLDOCC", field_id, field_type, error});
+}
@@ -0,0 +1,25 @@
+#include "fml32.h"
+#include "viewhpp.hpp"
+
+namespace
+{
+    long field_id(const char* name)
+    {
+        return static_cast<long>(Fldid32(const_cast<char*>(name)));
+    }
+
+    int field_type(long id)
+    {
+        return Fldtype32(static_cast<FLDID32>(id));
+    }
+
+    const char* error()
+    {
+        return Fstrerror32(Ferror32);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    return run_viewhpp(argc, argv, {"viewhpp32", "fml32", "FLDLEN32", "FLDOCC32", field_id, field_type, error});
+}